@@ -0,0 +1,364 @@
+/*
+ * @brief Write-back block cache between the SCSI layer and the storage media
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+/** @file
+ *
+ *  Write-back block cache. Hosts update the FAT, directory entries and the FSInfo sector with many small writes,
+ *  often to the same blocks again within a few milliseconds. The cache keeps them in RAM, a media page
+ *  (MSC_CACHE_PAGE_BLOCKS blocks) per entry with a valid and a dirty bit per block, and writes them back when an
+ *  entry is evicted (least recently used first), on a flush request or once writes have stopped for
+ *  MSC_CACHE_IDLE_MS. A write back gathers the run of contiguous dirty blocks around the page, across neighbouring
+ *  pages, into one media write.
+ */
+
+#include "BlockCache.h"
+
+/** @ingroup Mass_Storage_Device_BlockCache
+ * @{
+ */
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Valid bits of a fully read page */
+#define PAGE_MASK   ((MSC_CACHE_PAGE_BLOCKS == 32) ? 0xFFFFFFFFUL : ((1UL << MSC_CACHE_PAGE_BLOCKS) - 1))
+
+/* One cached page */
+typedef struct {
+	uint32_t Page;			/* Block address / MSC_CACHE_PAGE_BLOCKS */
+	uint32_t LastUse;		/* Use stamp, the lowest is evicted first */
+	uint32_t Valid;			/* Bit per block holding data, 0 = entry unused */
+	uint32_t Dirty;			/* Bit per block not written back yet */
+} BlockCache_Line_t;
+
+static BlockCache_Line_t Lines[MSC_CACHE_LINES];
+static uint8_t *LineData;
+static uint8_t *StagingBuffer;
+static uint32_t StagingSize;
+static BlockCache_Media_t MediaRead;
+static BlockCache_Media_t MediaWrite;
+static uint32_t UseCount;
+static bool DirtyData;
+static bool WrittenSinceTask;
+static uint32_t IdleSince;
+static BlockCache_Stats_t Stats;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* Data of a block of a line */
+static uint8_t *LineBlock(BlockCache_Line_t *Line, uint32_t Index)
+{
+	return LineData + (((uint32_t) (Line - Lines) * MSC_CACHE_PAGE_BLOCKS) + Index) * VIRTUAL_MEMORY_BLOCK_SIZE;
+}
+
+/* Returns the line caching a page, or NULL */
+static BlockCache_Line_t *FindLine(uint32_t Page)
+{
+	uint32_t i;
+
+	for (i = 0; i < MSC_CACHE_LINES; i++) {
+		if (Lines[i].Valid && (Lines[i].Page == Page)) {
+			return &Lines[i];
+		}
+	}
+	return NULL;
+}
+
+/* Returns the line holding a dirty copy of a block, or NULL */
+static BlockCache_Line_t *FindDirty(uint32_t BlockAddress)
+{
+	BlockCache_Line_t *Line = FindLine(BlockAddress / MSC_CACHE_PAGE_BLOCKS);
+
+	if (Line && (Line->Dirty & (1UL << (BlockAddress % MSC_CACHE_PAGE_BLOCKS)))) {
+		return Line;
+	}
+	return NULL;
+}
+
+/* Writes back the dirty blocks of a line. Each one goes out with the run of dirty blocks it belongs to, whichever
+   lines those are in, gathered in the staging buffer so the media sees one write per run. */
+static bool WriteBack(BlockCache_Line_t *Line)
+{
+	BlockCache_Line_t *Other;
+	uint32_t Start, Block, Count;
+	bool Success = true;
+
+	while (Line->Dirty) {
+		/* Find where the run containing the line's first dirty block starts */
+		Start = Line->Page * MSC_CACHE_PAGE_BLOCKS;
+		while (!(Line->Dirty & (1UL << (Start % MSC_CACHE_PAGE_BLOCKS)))) {
+			Start++;
+		}
+		while (Start && FindDirty(Start - 1)) {
+			Start--;
+		}
+
+		/* Gather it a staging buffer at a time */
+		Block = Start;
+		Count = 0;
+		while (((Other = FindDirty(Block)) != NULL) && (Count < StagingSize)) {
+			memcpy(StagingBuffer + Count * VIRTUAL_MEMORY_BLOCK_SIZE,
+				   LineBlock(Other, Block % MSC_CACHE_PAGE_BLOCKS),
+				   VIRTUAL_MEMORY_BLOCK_SIZE);
+			Other->Dirty &= ~(1UL << (Block % MSC_CACHE_PAGE_BLOCKS));
+			Block++;
+			Count++;
+		}
+
+		Stats.MediaWrites++;
+		Stats.MediaBlocksWritten += Count;
+		if (!MediaWrite(StagingBuffer, Start, Count)) {
+			/* The data is lost either way; keeping it dirty would only fail every later write back too */
+			Stats.MediaErrors++;
+			Success = false;
+		}
+	}
+
+	return Success;
+}
+
+/* Returns a line for a page, evicting the least recently used one if the page is not cached */
+static BlockCache_Line_t *GetLine(uint32_t Page, bool *Success)
+{
+	BlockCache_Line_t *Line = FindLine(Page);
+	uint32_t i;
+
+	if (Line == NULL) {
+		Line = &Lines[0];
+		for (i = 0; i < MSC_CACHE_LINES; i++) {
+			if (!Lines[i].Valid) {
+				Line = &Lines[i];
+				break;
+			}
+			if (Lines[i].LastUse < Line->LastUse) {
+				Line = &Lines[i];
+			}
+		}
+
+		if (Line->Dirty) {
+			Stats.Evictions++;
+			*Success &= WriteBack(Line);
+		}
+		Line->Page  = Page;
+		Line->Valid = 0;
+		Line->Dirty = 0;
+	}
+
+	Line->LastUse = ++UseCount;
+	return Line;
+}
+
+/* Bits of the blocks of a page that fall inside a range */
+static uint32_t PageMask(uint32_t Page, uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	uint32_t First = Page * MSC_CACHE_PAGE_BLOCKS;
+	uint32_t Mask = 0;
+	uint32_t i;
+
+	for (i = 0; i < MSC_CACHE_PAGE_BLOCKS; i++) {
+		if (((First + i) >= BlockAddress) && ((First + i - BlockAddress) < TotalBlocks)) {
+			Mask |= (1UL << i);
+		}
+	}
+	return Mask;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Empties the cache and sets the media callbacks */
+void BlockCache_Init(BlockCache_Media_t Read, BlockCache_Media_t Write, uint8_t *Data, uint8_t *Staging, uint32_t StagingBlocks)
+{
+	memset(Lines, 0, sizeof(Lines));
+	memset(&Stats, 0, sizeof(Stats));
+	MediaRead     = Read;
+	MediaWrite    = Write;
+	LineData      = Data;
+	StagingBuffer = Staging;
+	StagingSize   = StagingBlocks;
+	UseCount      = 0;
+	DirtyData     = false;
+}
+
+/* Reads blocks through the cache */
+bool BlockCache_Read(uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	BlockCache_Line_t *Line;
+	uint32_t Index, Missing, i;
+	bool Success = true;
+
+	while (TotalBlocks) {
+		Index = BlockAddress % MSC_CACHE_PAGE_BLOCKS;
+		Line  = GetLine(BlockAddress / MSC_CACHE_PAGE_BLOCKS, &Success);
+
+		if (Line->Valid & (1UL << Index)) {
+			Stats.ReadHits++;
+		}
+		else {
+			/* Fill in the whole page, the next block is likely to be asked for soon. Blocks already cached may be
+			   dirty so only the missing ones are taken from the media. */
+			Stats.ReadMisses++;
+			if (!MediaRead(StagingBuffer, Line->Page * MSC_CACHE_PAGE_BLOCKS, MSC_CACHE_PAGE_BLOCKS)) {
+				Stats.MediaErrors++;
+				return false;
+			}
+			Missing = ~Line->Valid;
+			for (i = 0; i < MSC_CACHE_PAGE_BLOCKS; i++) {
+				if (Missing & (1UL << i)) {
+					memcpy(LineBlock(Line, i), StagingBuffer + i * VIRTUAL_MEMORY_BLOCK_SIZE, VIRTUAL_MEMORY_BLOCK_SIZE);
+				}
+			}
+			Line->Valid = PAGE_MASK;
+		}
+
+		memcpy(Buffer, LineBlock(Line, Index), VIRTUAL_MEMORY_BLOCK_SIZE);
+		Buffer += VIRTUAL_MEMORY_BLOCK_SIZE;
+		BlockAddress++;
+		TotalBlocks--;
+	}
+
+	return Success;
+}
+
+/* Writes blocks into the cache */
+bool BlockCache_Write(const uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	BlockCache_Line_t *Line;
+	uint32_t Index;
+	bool Success = true;
+
+	while (TotalBlocks) {
+		Index = BlockAddress % MSC_CACHE_PAGE_BLOCKS;
+		Line  = GetLine(BlockAddress / MSC_CACHE_PAGE_BLOCKS, &Success);
+
+		if (Line->Valid & (1UL << Index)) {
+			Stats.WriteHits++;
+		}
+		else {
+			Stats.WriteMisses++;
+		}
+		memcpy(LineBlock(Line, Index), Buffer, VIRTUAL_MEMORY_BLOCK_SIZE);
+		Line->Valid |= (1UL << Index);
+		Line->Dirty |= (1UL << Index);
+
+		Buffer += VIRTUAL_MEMORY_BLOCK_SIZE;
+		BlockAddress++;
+		TotalBlocks--;
+	}
+
+	DirtyData = true;
+	WrittenSinceTask = true;
+	return Success;
+}
+
+/* Writes back the dirty blocks in a range */
+bool BlockCache_FlushRange(uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	uint32_t i;
+	bool Success = true;
+
+	if (!DirtyData) {
+		return true;
+	}
+	for (i = 0; i < MSC_CACHE_LINES; i++) {
+		if (Lines[i].Dirty & PageMask(Lines[i].Page, BlockAddress, TotalBlocks)) {
+			Success &= WriteBack(&Lines[i]);
+		}
+	}
+	return Success;
+}
+
+/* Drops the cached copies of a range */
+void BlockCache_Discard(uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	uint32_t Mask, i;
+
+	for (i = 0; i < MSC_CACHE_LINES; i++) {
+		if (Lines[i].Valid) {
+			Mask = PageMask(Lines[i].Page, BlockAddress, TotalBlocks);
+			Lines[i].Valid &= ~Mask;
+			Lines[i].Dirty &= ~Mask;
+		}
+	}
+}
+
+/* Writes back every dirty block */
+bool BlockCache_Flush(void)
+{
+	uint32_t i;
+	bool Found = false;
+	bool Success = true;
+
+	if (!DirtyData) {
+		return true;
+	}
+	for (i = 0; i < MSC_CACHE_LINES; i++) {
+		if (Lines[i].Dirty) {
+			Found = true;
+			Success &= WriteBack(&Lines[i]);
+		}
+	}
+	if (Found) {
+		Stats.Flushes++;
+	}
+	DirtyData = false;
+	return Success;
+}
+
+/* Flushes the cache once writes have stopped for MSC_CACHE_IDLE_MS */
+void BlockCache_Task(uint32_t NowMs)
+{
+	if (WrittenSinceTask) {
+		WrittenSinceTask = false;
+		IdleSince = NowMs;
+	}
+	else if (DirtyData && ((NowMs - IdleSince) >= MSC_CACHE_IDLE_MS)) {
+		BlockCache_Flush();
+	}
+}
+
+/* Returns the cache statistics */
+const BlockCache_Stats_t *BlockCache_GetStats(void)
+{
+	return &Stats;
+}
+
+/**
+ * @}
+ */
@@ -56,6 +56,14 @@ static USB_ClassInfo_MS_Host_t FlashDisk_MS_Interface = {
 static SCSI_Capacity_t DiskCapacity;
 static uint8_t buffer[8 * 1024];
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* The EHCI driver chains qTDs, so one command moves whatever READ(10)/WRITE(10) can address */
+#define MAX_XFER_BLOCKS         0xFFFF
+#else
+/* The OHCI path carries a command's byte count in 16 bits */
+#define MAX_XFER_BLOCKS         (0xFFFF / DiskCapacity.BlockSize)
+#endif
+
 STATIC FATFS fatFS;	/* File system object */
 STATIC FIL fileObj;	/* File object */
 
@@ -372,10 +380,17 @@ uint32_t FSUSB_DiskGetSectorSz(DISK_HANDLE_T *hDisk)
 /* Read sectors */
 int FSUSB_DiskReadSectors(DISK_HANDLE_T *hDisk, void *buff, uint32_t secStart, uint32_t numSec)
 {
-	if (MS_Host_ReadDeviceBlocks(hDisk, 0, secStart, numSec, DiskCapacity.BlockSize, buff)) {
-		DEBUGOUT("Error reading device block.\r\n");
-		USB_Host_SetDeviceConfiguration(FlashDisk_MS_Interface.Config.PortNumber, 0);
-		return 0;
+	while (numSec) {
+		uint32_t n = MIN(numSec, MAX_XFER_BLOCKS);
+
+		if (MS_Host_ReadDeviceBlocks(hDisk, 0, secStart, n, DiskCapacity.BlockSize, buff)) {
+			DEBUGOUT("Error reading device block.\r\n");
+			USB_Host_SetDeviceConfiguration(FlashDisk_MS_Interface.Config.PortNumber, 0);
+			return 0;
+		}
+		buff = (uint8_t *) buff + n * DiskCapacity.BlockSize;
+		secStart += n;
+		numSec -= n;
 	}
 	return 1;
 }
@@ -383,9 +398,16 @@ int FSUSB_DiskReadSectors(DISK_HANDLE_T *hDisk, void *buff, uint32_t secStart, u
 /* Write Sectors */
 int FSUSB_DiskWriteSectors(DISK_HANDLE_T *hDisk, void *buff, uint32_t secStart, uint32_t numSec)
 {
-	if (MS_Host_WriteDeviceBlocks(hDisk, 0, secStart, numSec, DiskCapacity.BlockSize, buff)) {
-		DEBUGOUT("Error writing device block.\r\n");
-		return 0;
+	while (numSec) {
+		uint32_t n = MIN(numSec, MAX_XFER_BLOCKS);
+
+		if (MS_Host_WriteDeviceBlocks(hDisk, 0, secStart, n, DiskCapacity.BlockSize, buff)) {
+			DEBUGOUT("Error writing device block.\r\n");
+			return 0;
+		}
+		buff = (uint8_t *) buff + n * DiskCapacity.BlockSize;
+		secStart += n;
+		numSec -= n;
 	}
 	return 1;
 }
@@ -118,6 +118,18 @@ int FSUSB_DiskReadyWait(DISK_HANDLE_T *hDisk, int tout);
 /* Erase block size fixed to 4K */
 #define FSUSB_DiskGetBlockSz(hDisk)         (4 * 1024)
 
+/**
+ * Sectors fetched in one command when FatFs reads a disk sequentially in small
+ * pieces (a file read through a buffer smaller than a sector, a directory walk).
+ * Later sectors are then served from RAM instead of costing a command each.
+ * Costs this many times _MAX_SS bytes of static RAM; 0 disables read-ahead.
+ * The default fits the internal flash parts' 32KB local SRAM. Targets with RAM
+ * to spare can define up to 128, one 64KB command per window.
+ */
+#ifndef FSUSB_READAHEAD_SECTORS
+#define FSUSB_READAHEAD_SECTORS             16
+#endif
+
 /**
  * @}
  */
@@ -60,8 +60,15 @@ extern "C" {
 /** Size in bytes of the CDC device-to-host notification IN endpoint. */
 #define CDC_NOTIFICATION_EPSIZE        8
 
-/** Size in bytes of the CDC data IN and OUT endpoints. */
-#define CDC_TXRX_EPSIZE                16
+/** Size in bytes of the CDC data IN and OUT endpoints. The loopback benchmark
+ *  (CDC_LOOPBACK_BENCHMARK, LPC18xx/43xx only) runs on high speed and needs whole
+ *  512 byte packets.
+ */
+#if defined(CDC_LOOPBACK_BENCHMARK)
+	#define CDC_TXRX_EPSIZE            512
+#else
+	#define CDC_TXRX_EPSIZE            16
+#endif
 
 /** @brief	Type define for the device configuration descriptor structure. This must be defined in the
  *          application code, as the configuration descriptor contains several sub-descriptors which
@@ -42,6 +42,29 @@
 
 #define ECHO_CHARACTER_TASK     (0)
 #define CDC_BRIDGE_TASK         (ECHO_CHARACTER_TASK + 1)
+#define CDC_LOOPBACK_TASK       (CDC_BRIDGE_TASK + 1)
+
+/** Select example task, currently lpc11Uxx and lpc17xx don't support for bridging task
+ * Only LPC18xx has this feature. Define CDC_LOOPBACK_BENCHMARK in the project to build
+ * the throughput loopback instead (LPC18xx/43xx only) */
+#if defined(CDC_LOOPBACK_BENCHMARK)
+#define CDC_TASK_SELECT CDC_LOOPBACK_TASK
+#else
+#define CDC_TASK_SELECT ECHO_CHARACTER_TASK
+#endif
+
+#if (CDC_TASK_SELECT == CDC_LOOPBACK_TASK)
+#if defined(USB_DEVICE_ROM_DRIVER) || !(defined(__LPC18XX__) || defined(__LPC43XX__))
+#error "The CDC loopback benchmark needs the LPCUSBlib stack on an LPC18xx/43xx"
+#endif
+
+/** Bytes the loopback moves per call, also the size of each half of the transmit buffer */
+#define CDC_LOOPBACK_CHUNK      4096
+
+/** Streaming mode buffers: two transmit halves and a receive ring of whole packets */
+static uint8_t LoopbackTxBuffer[2 * CDC_LOOPBACK_CHUNK];
+static uint8_t LoopbackRxBuffer[CDC_RX_MAX_PACKETS * CDC_TXRX_EPSIZE];
+#endif
 
 /** LPCUSBlib CDC Class driver interface configuration and state information. This structure is
  *  passed to all CDC Class driver functions, so that multiple instances of the same class
@@ -63,6 +86,12 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface = {
 		.NotificationEndpointSize       = CDC_NOTIFICATION_EPSIZE,
 		.NotificationEndpointDoubleBank = false,
 		.PortNumber             = 0,
+#if (CDC_TASK_SELECT == CDC_LOOPBACK_TASK)
+		.TxBuffer                       = LoopbackTxBuffer,
+		.TxBufferSize                   = sizeof(LoopbackTxBuffer),
+		.RxBuffer                       = LoopbackRxBuffer,
+		.RxPackets                      = CDC_RX_MAX_PACKETS,
+#endif
 	},
 };
 
@@ -71,10 +100,6 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface = {
  */
 // static FILE USBSerialStream;
 
-/** Select example task, currently lpc11Uxx and lpc17xx don't support for bridging task
- * Only LPC18xx has this feature */
-#define CDC_TASK_SELECT ECHO_CHARACTER_TASK
-
 /*****************************************************************************
  * Private functions
  ****************************************************************************/
@@ -111,6 +136,22 @@ static void EchoCharacter(void)
 
 }
 
+#elif (CDC_TASK_SELECT == CDC_LOOPBACK_TASK)
+/** Throughput loopback. Everything the host sends comes straight back; the class driver
+ *  receives into its packet ring and sends from its double buffer while this copies. */
+static void CDC_Loopback_Task(void)
+{
+	static char loopback_buff[CDC_LOOPBACK_CHUNK];
+	uint16_t recv_count;
+
+	recv_count = CDC_Device_ReceiveData(&VirtualSerial_CDC_Interface, loopback_buff, sizeof(loopback_buff));
+	if (recv_count) {
+		CDC_Device_SendData(&VirtualSerial_CDC_Interface, loopback_buff, recv_count);
+	}
+	/* sends what is left once the IN endpoint goes idle */
+	CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
+}
+
 #else
 /** USB-UART Bridge Task */
 static void CDC_Bridge_Task(void)
@@ -162,6 +203,8 @@ int main(void)
 
 #if (CDC_TASK_SELECT == ECHO_CHARACTER_TASK)
 		EchoCharacter();
+#elif (CDC_TASK_SELECT == CDC_LOOPBACK_TASK)
+		CDC_Loopback_Task();
 #else
 		CDC_Bridge_Task();
 #endif
@@ -51,6 +51,11 @@ extern "C" {
  * connected to either 9pin UART connector or a dedicated USB-to-COM chip
  * (FTDI) on the board.
  *
+ * Defining CDC_LOOPBACK_BENCHMARK in the project builds a throughput loopback
+ * instead: the bulk endpoints become 512 bytes and the CDC class driver runs in
+ * streaming mode, receiving into a ring of packet buffers and sending from a
+ * double buffer, so whatever the host writes comes back as fast as the bus allows.
+ *
  * CDC demo need driver for running, follow these steps for install this driver:
  * Right click on "My Computer" and select manage
  * Go to device manager, right click to undefined device and select "Update Driver Software"
@@ -217,6 +222,7 @@ extern "C" {
 
 #define ECHO_CHARACTER_TASK     (0)
 #define CDC_BRIDGE_TASK         (ECHO_CHARACTER_TASK + 1)
+#define CDC_LOOPBACK_TASK       (CDC_BRIDGE_TASK + 1)
 
 /**
  * @}
@@ -65,8 +65,9 @@ extern "C"
 #define LPC_CHECK_SLOWMEM 1
 #define LPC_SLOW_MEM_SIZE ((4 * 1024 * 1024) - 1)
 
-/* Array of slow memory address ranges for LPC_CHECK_SLOWMEM */
-#define LPC_SLOWMEM_ARRAY {{IMAGE_BASE_ADDR, (IMAGE_BASE_ADDR + LPC_SLOW_MEM_SIZE)}}
+/* Array of slow memory address ranges for LPC_CHECK_SLOWMEM, the DMA
+   sends SPIFI resident payloads in place */
+#define LPC_SLOWMEM_ARRAY {{IMAGE_BASE_ADDR, (IMAGE_BASE_ADDR + LPC_SLOW_MEM_SIZE), LPC_SLOWMEM_DMA}}
 
 #elif defined(TARGET_XFLASH)
 /* Enable slow speed memory buffering */
@@ -74,7 +75,7 @@ extern "C"
 #define LPC_SLOW_MEM_SIZE ((16 * 1024 * 1024) - 1)
 
 /* Array of slow memory address ranges for LPC_CHECK_SLOWMEM */
-#define LPC_SLOWMEM_ARRAY {{IMAGE_BASE_ADDR, (IMAGE_BASE_ADDR + LPC_SLOW_MEM_SIZE)}}
+#define LPC_SLOWMEM_ARRAY {{IMAGE_BASE_ADDR, (IMAGE_BASE_ADDR + LPC_SLOW_MEM_SIZE), 0}}
 
 #elif defined(TARGET_IFLASH)
 
@@ -63,7 +63,18 @@ extern "C"
 #define LPC_CHECK_SLOWMEM 1
 
 /* Array of slow memory address ranges for LPC_CHECK_SLOWMEM */
-#define LPC_SLOWMEM_ARRAY {{0x14000000, (0x14000000 + ((8 * 1024 * 1024) - 1))}}
+#define LPC_SLOWMEM_ARRAY {{0x14000000, (0x14000000 + ((8 * 1024 * 1024) - 1)), 0}}
+
+/* Frames the receive thread handles per poll pass before yielding */
+#define LPC_RX_BUDGET 16
+
+/* Free RX descriptors refilled together inside a poll pass */
+#define LPC_RX_REFILL_BATCH 4
+
+/* RX interrupt coalescing watchdog in units of 256 bus clocks, 0 for an
+   interrupt per frame. 20 is 25us at 204MHz, under the time 8 minimum
+   size frames take to fill the ring at 100Mbps. */
+#define LPC_RX_INT_WDT 20
 
 /**
  * @}
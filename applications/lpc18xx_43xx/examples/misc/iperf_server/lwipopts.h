@@ -55,16 +55,26 @@
 #define IP_SOF_BROADCAST                1
 #define IP_SOF_BROADCAST_RECV           1
 
-/* The ethernet FCS is performed in hardware. The IP, TCP, and UDP
-   CRCs still need to be done in hardware. */
-#define CHECKSUM_GEN_IP                 1
-#define CHECKSUM_GEN_UDP                1
-#define CHECKSUM_GEN_TCP                1
-#define CHECKSUM_CHECK_IP               1
-#define CHECKSUM_CHECK_UDP              1
-#define CHECKSUM_CHECK_TCP              1
+/* The ethernet FCS is performed in hardware. With LPC_CHECKSUM_OFFLOAD
+   the EMAC also inserts and checks the IP, TCP, UDP and ICMP checksums,
+   set it to 0 to have lwIP do them in software. */
+#define LPC_CHECKSUM_OFFLOAD            1
+#define CHECKSUM_GEN_IP                 (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_GEN_UDP                (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_GEN_TCP                (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_GEN_ICMP               (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_CHECK_IP               (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_CHECK_UDP              (!LPC_CHECKSUM_OFFLOAD)
+#define CHECKSUM_CHECK_TCP              (!LPC_CHECKSUM_OFFLOAD)
 #define LWIP_CHECKSUM_ON_COPY           1
 
+/* The EMAC does not insert or check the TCP, UDP and ICMP checksums of
+   IP fragments, so with LPC_CHECKSUM_OFFLOAD fragmentation is left out.
+   Datagrams must then fit in one frame (1472 bytes of UDP payload) and
+   fragmented datagrams from the network are dropped. */
+#define IP_FRAG                         (!LPC_CHECKSUM_OFFLOAD)
+#define IP_REASSEMBLY                   (!LPC_CHECKSUM_OFFLOAD)
+
 /* Use LWIP version of htonx() to allow generic functionality across
    all platforms. If you are using the Cortex Mx devices, you might
    be able to use the Cortex __rev instruction instead. */
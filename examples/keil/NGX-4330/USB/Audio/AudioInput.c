@@ -10,11 +10,16 @@
 #include "AudioInput.h"
 #include <limits.h>
 #include "apptypes.h"
+#include "audioring.h"
+#include "audiopack.h"
+#include "audiorate.h"
+#include "trace.h"
 
 #ifndef INC_FREERTOS_H
 #include "FreeRTOS.h"
 #include "queue.h"
 #include "task.h"
+#include "semphr.h"
 #endif
 
 
@@ -33,8 +38,6 @@ USB_ClassInfo_Audio_Device_t USBAudioIF =
 	},
 };
 
-// for runtime modification
-extern USB_Descriptor_Configuration_t ConfigurationDescriptor;
 //
 #define TICKRATE_HZ 1
 
@@ -69,10 +72,10 @@ static SSP_ConfigFormat ssp_format;
 extern void UARTTask(void* pvParameters);
 
 //-----------------------------------------------------------------------------
-// Max Sample Frequency.
-const uint32_t AUDIO_MAX_SAMPLE_FREQ = 48000;
+// Default Sample Frequency. See config.h for the highest.
+const uint32_t AUDIO_DEFAULT_SAMPLE_FREQ = 48000;
 /** Current audio sampling frequency of the streaming audio endpoint. */
-uint32_t CurrentAudioSampleFrequency = AUDIO_MAX_SAMPLE_FREQ;
+uint32_t CurrentAudioSampleFrequency = AUDIO_DEFAULT_SAMPLE_FREQ;
 /* Sample Buffer */
 // uint16_t* sample_buffer = NULL;
 PRAGMA_ALIGN_4
@@ -97,23 +100,42 @@ int iso_packets = 0;
 //
 int iso_index = 0;
 //-----------------------------------------------------------------------------
-//
-xQueueHandle logQueueHandle = 0;
-xQueueHandle usbQueueHandle = 0;
+// we send one packet of N channels * sizeof sample to the isoch EP every
+// SOF. 1ms frames at full-speed, 125us microframes at high-speed
+#define PACKETS_PER_SECOND AUDIO_PACKETS_PER_SECOND
+// i.e. 48 per frame at 48k, 24 per microframe at 192k. The scheduler picks
+// the actual count, packet by packet, for the current rate.
+#define SAMPLE_COUNT AUDIO_RATE_MAX_FRAMES(AUDIO_MAX_SAMPLE_RATE, PACKETS_PER_SECOND)
+// one scheduler per streaming alt setting, each with its own frame size and
+// so its own set of rates that fit
+AudioRate audioRates[AUDIO_ALT_COUNT];
+
 //-----------------------------------------------------------------------------
-// we assume that on SOF interrput we send N channels * sizeof sample to isoch EP
-#ifdef FULL_SPEED
-// 48 samples every microframe
-const int SAMPLE_COUNT = 48;
-#else
-// 6 samples per 125ns microframe
-const int SAMPLE_COUNT = 6;
-#endif
+// Alt setting the host last started streaming on, 1 based. Written by
+// EVENT_Audio_Device_StreamStartStop() in AudioTask, which can't preempt the
+// producer, so every packet is filled in one format. The ISO callback
+// flushes whatever was queued in the old one when it sees this change.
+volatile uint32_t streamAlt = 1;
+static uint32_t isoAlt = 1;
 
 //-----------------------------------------------------------------------------
-// JME fix sample size at 16 bits for the time being. Keeps init code simple
-// in any other configuration simply send zeroes
-int16_t data[CHANNEL_COUNT * SAMPLE_COUNT] = { 0 };
+// Test signal as per-channel planar Q31. Packed to the alt setting's
+// channels and subslots on the way into the packet ring, as a real capture
+// source would be.
+int32_t data[CHANNEL_COUNT][SAMPLE_COUNT] = { 0 };
+const int32_t* planes[CHANNEL_COUNT] = { 0 };
+
+//-----------------------------------------------------------------------------
+// packets queued between the producer and the SOF hand-off. Slots are
+// EP_SIZE_BYTES, Descriptors.c checks every alt setting fits.
+#define AUDIO_PACKET_BYTES EP_SIZE_BYTES
+PRAGMA_ALIGN_4
+static uint8_t ringStorage[AUDIO_RING_SLOTS * AUDIO_PACKET_BYTES] ATTR_ALIGNED(4);
+static AudioRingSlot ringSlots[AUDIO_RING_SLOTS];
+// sent when the producer falls behind
+PRAGMA_ALIGN_4
+static const uint8_t silence[AUDIO_PACKET_BYTES] ATTR_ALIGNED(4) = { 0 };
+AudioRing audioRing;
 
 //-----------------------------------------------------------------------------
 
@@ -153,108 +175,70 @@ const char* states[MaxStates] =
 };
 
 //-----------------------------------------------------------------------------
+// The Log* entry points are kept for the library's trace points. They all
+// land in the binary trace ring, see trace.h
 void Log(int index,int v1,int v2, int v3)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	dbm.psz = states[index];
-	dbm.v1 = v1;
-	dbm.v2 = v2;
-	dbm.v3 = v3;
-	xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(&traceRing, 0, 0, states[index], v1, v2, v3, 0, 0);
 }
 
 //-----------------------------------------------------------------------------
 void LogReq(const char* psz,int v1,int v2, int v3,int v4,int v5)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	dbm.psz = psz;
-	dbm.v1 = v1;
-	dbm.v2 = v2;
-	dbm.v3 = v3;
-	dbm.v4 = v4;
-	dbm.v5 = v5;
-	xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(&traceRing, 0, 0, psz, v1, v2, v3, v4, v5);
 }
 
 //-----------------------------------------------------------------------------
 void Log5F(const char* file,int line,const char* psz,int v1,int v2, int v3,int v4,int v5)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	dbm.file = file;
-	dbm.line = line;
-	dbm.psz = psz;
-	dbm.v1 = v1;
-	dbm.v2 = v2;
-	dbm.v3 = v3;
-	dbm.v4 = v4;
-	dbm.v5 = v5;
-	xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(&traceRing, file, line, psz, v1, v2, v3, v4, v5);
 }
 //-----------------------------------------------------------------------------
 void Log5(const char* psz,int v1,int v2, int v3,int v4,int v5)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	dbm.psz = psz;
-	dbm.v1 = v1;
-	dbm.v2 = v2;
-	dbm.v3 = v3;
-	dbm.v4 = v4;
-	dbm.v5 = v5;
-	xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(&traceRing, 0, 0, psz, v1, v2, v3, v4, v5);
 }
 
 //-----------------------------------------------------------------------------
 void Log3(const char* psz,int v1,int v2, int v3)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	dbm.psz = psz;
-	dbm.v1 = v1;
-	dbm.v2 = v2;
-	dbm.v3 = v3;
-	xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(&traceRing, 0, 0, psz, v1, v2, v3, 0, 0);
 }
 
 //-----------------------------------------------------------------------------
-// USB packet logger
+// USB packet logger. The SETUP fields go out as arguments and the host
+// decoder does the rest.
+static const char* setupFormat = "SETUP bmRequestType:0x%02X bRequest:0x%02X wValue:0x%04X wIndex:0x%04X wLength:0x%04X";
 void LogUSB(const char* file,int line,void* packet,int packet_size)
 {
-	/* No audio interface entities in the device descriptor, thus no properties to get or set. */
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	USBMessage um = { 0 };
-	um.file = file;
-	um.line = line;
-	memcpy(&um.request,packet,packet_size);
-	xQueueSendFromISR(usbQueueHandle,&um,&xHigherPriorityTaskWoken);
+	const USB_Request_Header_t* request = (const USB_Request_Header_t*) packet;
+	Trace_Write(&traceRing, file, line, setupFormat,
+				request->bmRequestType, request->bRequest,
+				request->wValue, request->wIndex, request->wLength);
 }
 
 //-----------------------------------------------------------------------------
 // Set up the pre-defined N channel waveform we currently stream to host
 void FillAudioBuffers()
 {
-	int16_t value = 0;
-	int16_t step = SHRT_MAX / (SAMPLE_COUNT / 2);
-	int index = 0;
-	// set up the sample pattern in the USB xfer buffer
+	// wraps, so unsigned
+	uint32_t value = 0;
+	uint32_t step = INT_MAX / (SAMPLE_COUNT / 2);
+	// set up the sample pattern in the planar source buffers
 	// depending on how many channels and bus speed
 	// this is a really simple full range saw wave
 	int sample = 0;
 	int channel = 0;
+	for (channel = 0; channel < CHANNEL_COUNT; channel++)
+	{
+		planes[channel] = data[channel];
+	}
 	for (sample = 0; sample < SAMPLE_COUNT; sample++)
 	{
 		// apply same values to all channels
 		for (channel = 0; channel < CHANNEL_COUNT; channel++)
 		{
-			data[index++] = value;
+			data[channel][sample] = (int32_t) value;
 		}
 		// next value
 		value += step;
@@ -281,8 +265,8 @@ void SetChannelMask()
 		}
 	}
 
-	// now set the mask.
-	ConfigurationDescriptor.Audio_InputTerminal.ChannelConfig = mask;
+	// now set the mask. and lay out the alt settings
+	Descriptors_Build(mask);
 }
 
 //-----------------------------------------------------------------------------
@@ -291,7 +275,7 @@ void SetChannelMask()
 // JME WTF does this not pass instance pointer?
 uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t* packet_size)
 {
-	*packet_size = CHANNEL_COUNT * SAMPLE_COUNT * BYTES_PER_SAMPLE;
+	*packet_size = 0;
 	// Check if this is audio stream endpoint
 	if ((EPNum & 0x7F) == AUDIO_STREAM_EPNUM)
 	{
@@ -302,8 +286,16 @@ uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t* packet
 			// should flash at sub-multiple of blue SOF LED
 			// Board_LED_Set(GREENLED, iso_state);
 		}
-		// return the audio data buffer
-		return (uint32_t) &data[0];
+		// host picked another alt setting, what's queued is the wrong shape
+		if (streamAlt != isoAlt)
+		{
+			AudioRate* rate = &audioRates[streamAlt - 1];
+			isoAlt = streamAlt;
+			AudioRing_Flush(&audioRing);
+			audioRing.underrun_size = rate->budgets[rate->pending].base * rate->frame_bytes;
+		}
+		// hand the next queued packet straight to the DCD
+		return (uint32_t) AudioRing_NextPacket(&audioRing, packet_size);
 	}
 	else
 	{
@@ -448,13 +440,102 @@ void SPITask(void* pvParameters)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Keeps the packet ring topped up. Stands in for the capture DMA ISR which
+// would Acquire/Commit one packet per completed block. Here we just pack
+// the saw wave. Each slot is one SOF's worth, so the scheduler sizes them
+// in SOF order: 44 or 45 samples per frame at 44.1k etc.
+void AudioProducerTask(void* pvParameters)
+{
+	for (;;)
+	{
+		while (AudioRing_Free(&audioRing) > 0)
+		{
+			const AudioAltSetting* alt = &AudioAltSettings[streamAlt - 1];
+			uint8_t* p = AudioRing_Acquire(&audioRing);
+			uint32_t samples = AudioRate_Next(&audioRates[streamAlt - 1]);
+			uint32_t bytes = AudioPack_Interleave(p, planes, alt->Channels, samples, alt->SubFrameSize);
+			AudioRing_Commit(&audioRing, bytes);
+		}
+		vTaskDelay(1);
+	}
+}
+
 //-----------------------------------------------------------------------------
 volatile bool connected = true;
 
 //-----------------------------------------------------------------------------
-// This polls the USB registers for state change. Not ideal but works for now
+// Event mode. The USB ISR gives usbEvent whenever a SETUP is waiting and
+// AudioTask sleeps on it rather than spinning. The timeout keeps the
+// connect switch and the stats going. See USB_EVENT_MODE in config.h
+#define USB_EVENT_TIMEOUT (configTICK_RATE_HZ / 10)
+static xSemaphoreHandle usbEvent = NULL;
+
+// all times in DWT cycles
+typedef struct _UsbTaskStats
+{
+	// times the task woke for a SETUP or timed out
+	uint32_t wakes;
+	uint32_t timeouts;
+	// spent in the USB task loop since the last report
+	uint32_t busy;
+	// ISR saw the SETUP -> EVENT_USB_Device_ControlRequest()
+	volatile uint32_t setup_stamp;
+	uint32_t setup_latency;
+	uint32_t max_setup_latency;
+} UsbTaskStats;
+
+UsbTaskStats usbTaskStats = { 0 };
+
+//-----------------------------------------------------------------------------
+// from the USB ISR
+void EVENT_USB_Device_TaskPending(const uint8_t corenum)
+{
+#if USB_EVENT_MODE == 1
+	portBASE_TYPE woken = pdFALSE;
+#endif
+	usbTaskStats.setup_stamp = AUDIO_RING_NOW();
+#if USB_EVENT_MODE == 1
+	xSemaphoreGiveFromISR(usbEvent, &woken);
+	portEND_SWITCHING_ISR(woken);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Sleep until the ISR has a request for us. Reports the task's share of the
+// CPU and the SETUP latency every ~10s.
+static void UsbTaskWait(void)
+{
+	static portTickType last = 0;
+	portTickType now = 0;
+#if USB_EVENT_MODE == 1
+	if (xSemaphoreTake(usbEvent, USB_EVENT_TIMEOUT) == pdTRUE)
+	{
+		usbTaskStats.wakes++;
+	}
+	else
+	{
+		usbTaskStats.timeouts++;
+	}
+#endif
+	now = xTaskGetTickCount();
+	if (now - last >= configTICK_RATE_HZ * 10)
+	{
+		Trace_Write(&traceRing, 0, 0, "USB task: busy %u cycles/10s wakes %u timeouts %u SETUP latency %u max %u",
+					usbTaskStats.busy, usbTaskStats.wakes, usbTaskStats.timeouts,
+					usbTaskStats.setup_latency, usbTaskStats.max_setup_latency);
+		usbTaskStats.busy = 0;
+		last = now;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Runs the USB device task whenever the ISR signals a control request, or
+// polls it when USB_EVENT_MODE is 0.
 void AudioTask(void* pvParameters)
 {
+	uint32_t start = 0;
+	int i = 0;
 	// switch off green LED
 	Board_LED_Set(GREENLED, false);
 
@@ -463,6 +544,29 @@ void AudioTask(void* pvParameters)
 
 	// set up our N channel waveform
 	FillAudioBuffers();
+
+	// the per SOF packet sizes for each rate and alt setting
+	for (i = 0; i < AUDIO_ALT_COUNT; i++)
+	{
+		AudioRate_Init(&audioRates[i], PACKETS_PER_SECOND, AudioAltSettings[i].Channels,
+					   AudioAltSettings[i].SubFrameSize, EP_SIZE_BYTES, CurrentAudioSampleFrequency);
+	}
+
+	// and the packet ring the ISO callback drains
+	AudioRing_InitTimestamp();
+	AudioRing_Init(&audioRing, ringSlots, ringStorage, AUDIO_RING_SLOTS, AUDIO_PACKET_BYTES,
+				   silence, AudioRate_Budget(&audioRates[0], CurrentAudioSampleFrequency)->base * audioRates[0].frame_bytes);
+	// the DCD keeps this many packets queued on the ISO endpoint
+	AudioRing_SetDepth(&audioRing, USB_ISO_DTDS);
+	xTaskCreate(AudioProducerTask, (signed char *) "AudioProducer",
+				configMINIMAL_STACK_SIZE, NULL, (tskIDLE_PRIORITY + 2UL),
+				(xTaskHandle *) NULL);
+
+	// the USB ISR wakes us through this
+	vSemaphoreCreateBinary(usbEvent);
+	// which means it may not preempt the kernel. costs the SOF hand-off a
+	// little jitter inside FreeRTOS critical sections
+	NVIC_SetPriority(USB0_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
 	
 	// 
 	for (;;)
@@ -488,13 +592,16 @@ void AudioTask(void* pvParameters)
 
 		Board_UARTPutSTR("Device is connected to host\n");
 
-		// JME audit:polled
+		// event driven unless USB_EVENT_MODE is 0
 		while (connected == true)
 		{
+			UsbTaskWait();
 			//
+			start = AUDIO_RING_NOW();
 			Audio_Device_USBTask(&USBAudioIF);
 			//
 			USB_USBTask(USBAudioIF.Config.PortNumber, USB_MODE_Device);
+			usbTaskStats.busy += AUDIO_RING_NOW() - start;
 		}
 		//
 		Board_UARTPutSTR("Device disconnecting from host\n");
@@ -588,12 +695,10 @@ int main(void)
 	//
 	Board_UARTPutSTR(states[eTarget]);
 
-	// create the ISR safe qeueue	
-	logQueueHandle = xQueueCreate(64,sizeof(DbgMessage));
-	// another ISR safe queue for USB packets so we can decode completely
-	usbQueueHandle = xQueueCreate(64,sizeof(USBMessage));
+	// lock-free trace ring, safe from any ISR
+	Trace_Init(&traceRing);
 	//
-	USBAudioIF.instance_data = logQueueHandle;
+	USBAudioIF.instance_data = &traceRing;
 	
 	// create the audio test. this currently polls, should eventually be
 	// modified so it waits correctly (power)
@@ -601,7 +706,7 @@ int main(void)
 				configMINIMAL_STACK_SIZE, NULL, (tskIDLE_PRIORITY + 1UL),
 				(xTaskHandle *) NULL);
 
-	//  UART thread monitors queue(s) and spits out any debug/tracing
+	//  UART thread drains the trace ring and spits it out in binary
 	xTaskCreate(UARTTask, (signed char *) "UARTTask",
 				configMINIMAL_STACK_SIZE, NULL, (tskIDLE_PRIORITY + 1UL),
 				(xTaskHandle *) NULL);
@@ -664,18 +769,19 @@ void EVENT_USB_Device_ConfigurationChanged(void)
 	bool ConfigSuccess = true;
 	ConfigSuccess &= Audio_Device_ConfigureEndpoints(&USBAudioIF);
 	//
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0 };
-	xQueueHandle xq = (xQueueHandle)USBAudioIF.instance_data;
-	dbm.psz = states[eConfigureEndpoints];
-	dbm.v1 = USB_Device_ConfigurationNumber;
-	xQueueSendFromISR(xq,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write((TraceRing*)USBAudioIF.instance_data, 0, 0, states[eConfigureEndpoints],
+				USB_Device_ConfigurationNumber, 0, 0, 0, 0);
 }
 
 //-----------------------------------------------------------------------------
 // Event handler for the library USB Control Request reception event.
 void EVENT_USB_Device_ControlRequest(void)
 {
+	usbTaskStats.setup_latency = AUDIO_RING_NOW() - usbTaskStats.setup_stamp;
+	if (usbTaskStats.setup_latency > usbTaskStats.max_setup_latency)
+	{
+		usbTaskStats.max_setup_latency = usbTaskStats.setup_latency;
+	}
 	Audio_Device_ProcessControlRequest(&USBAudioIF);
 }
 
@@ -683,14 +789,18 @@ void EVENT_USB_Device_ControlRequest(void)
 // Indicates if streaming has started ...
 void EVENT_Audio_Device_StreamStartStop(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo)
 {
-	portBASE_TYPE xHigherPriorityTaskWoken;
 	dbg_message dbm = { 0 };
-	xQueueHandle xq = (xQueueHandle)AudioInterfaceInfo->instance_data;
+	TraceRing* ring = (TraceRing*)AudioInterfaceInfo->instance_data;
 	if (AudioInterfaceInfo->State.InterfaceEnabled)
 	{
 		Board_LED_Set(GREENLED, 1);
-		// enabled
+		// enabled. the producer and the ISO callback switch format
+		if (AudioInterfaceInfo->State.AlternateSetting <= AUDIO_ALT_COUNT)
+		{
+			streamAlt = AudioInterfaceInfo->State.AlternateSetting;
+		}
 		dbm.psz = states[eEnabled];
+		dbm.v1 = AudioInterfaceInfo->State.AlternateSetting;
 	}
 	else
 	{
@@ -699,7 +809,7 @@ void EVENT_Audio_Device_StreamStartStop(USB_ClassInfo_Audio_Device_t* const Audi
 		dbm.psz = states[eDisabled];
 	}
 	//
-	xQueueSendFromISR(xq,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(ring, 0, 0, dbm.psz, dbm.v1, 0, 0, 0, 0);
 }
 
 //-----------------------------------------------------------------------------
@@ -737,9 +847,10 @@ CALLBACK_Audio_Device_GetSetEndpointProperty(
         uint16_t* const DataLength,
         uint8_t* Data)
 {
-	portBASE_TYPE xHigherPriorityTaskWoken;
 	bool ret = false;
-	xQueueHandle xq = (xQueueHandle)AudioInterfaceInfo->instance_data;
+	uint32_t rate = 0;
+	int i = 0;
+	TraceRing* ring = (TraceRing*)AudioInterfaceInfo->instance_data;
 	dbg_message dbm = { 0, 0 };
 	/* Check the requested endpoint to see if a supported endpoint is being manipulated */
 	if (EndpointAddress == (ENDPOINT_DIR_IN | USBAudioIF.Config.DataINEndpointNumber))
@@ -757,18 +868,28 @@ CALLBACK_Audio_Device_GetSetEndpointProperty(
 					dbm.psz = states[eSetSampleRate];
 					dbm.v2 = *DataLength;
 					// Set the new sampling frequency to the value given by the host
-					CurrentAudioSampleFrequency =
-					    (((uint32_t) Data[2] << 16) | ((uint32_t) Data[1] << 8) | (uint32_t) Data[0]);
-					switch (CurrentAudioSampleFrequency)
+					rate = (((uint32_t) Data[2] << 16) | ((uint32_t) Data[1] << 8) | (uint32_t) Data[0]);
+					// packets already queued go out at the old rate, the
+					// producer switches on the next slot. unknown or over
+					// budget rates are refused and we keep the old one.
+					// every alt setting that can carry it follows, the
+					// host sets the rate again after SET_INTERFACE anyway
+					for (i = 0; i < AUDIO_ALT_COUNT; i++)
 					{
-						case 48000:
-							dbm.v1 = 48000;
-						break;
-						case 44100:
-							dbm.v1 = 44100;
-						break;
-						default:
-							dbm.v1 = 999;
+						AudioRate_Set(&audioRates[i], rate);
+					}
+					if (AudioRate_Get(&audioRates[streamAlt - 1]) == rate)
+					{
+						AudioRate* active = &audioRates[streamAlt - 1];
+						CurrentAudioSampleFrequency = rate;
+						// silence for an underrun is a nominal packet
+						audioRing.underrun_size = AudioRate_Budget(active, rate)->base * active->frame_bytes;
+						dbm.v1 = rate;
+					}
+					else
+					{
+						dbm.v1 = 999;
+						ret = false;
 						break;
 					}
 				}
@@ -814,7 +935,7 @@ CALLBACK_Audio_Device_GetSetEndpointProperty(
 		// other end point address
 	}
 	//
-	xQueueSendFromISR(xq,&dbm,&xHigherPriorityTaskWoken);
+	Trace_Write(ring, 0, 0, dbm.psz, dbm.v1, dbm.v2, dbm.v3, dbm.v4, dbm.v5);
 	//
 	return ret;
 }
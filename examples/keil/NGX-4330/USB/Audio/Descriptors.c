@@ -36,6 +36,8 @@
 #include "Descriptors.h"
 #include "apptypes.h"
 #include "appenum.h"
+#include "audiorate.h"
+#include <string.h>
 
 #ifndef INC_FREERTOS_H
 #include "FreeRTOS.h"
@@ -105,220 +107,330 @@ USB_Descriptor_Device_t DeviceDescriptor =
 	.NumberOfConfigurations = FIXED_NUM_CONFIGURATIONS
 };
 
-/** Configuration descriptor structure. This descriptor, located in FLASH memory, describes the usage
- *  of the device in one of its supported configurations, including information about any device interfaces
- *  and endpoints. The descriptor is read out by the USB host during the enumeration process when selecting
- *  a configuration so that the host may correctly communicate with the USB device.
+//-----------------------------------------------------------------------------
+// every rate we list, in descriptor order. An alternate setting only lists
+// the ones it can carry.
+static const uint32_t SampleRates[SUPPORTED_SAMPLE_RATES] =
+{
+//		JME integral sample rates only
+//		No, keep these for testing control interface is working
+//		8000, 11025, 22050,
+	48000,
+	// this is just to persuade Windows to display
+	// an 'advanced' tab ...
+	// no longer, the IN packets are sized per frame for 44.1k too
+	44100,
+#if SUPPORTED_SAMPLE_RATES > 2
+	96000,
+	88200,
+	192000,
+	176400,
+#endif
+};
+
+//-----------------------------------------------------------------------------
+// Every alternate setting in AUDIO_ALT_SETTINGS must at least carry 48k in
+// one EP_SIZE_BYTES packet and be no wider than CHANNEL_COUNT, which sizes
+// the input terminal and the sample buffers. Fails to build otherwise, as
+// does an EP_SIZE_BYTES the bus can't carry in one (micro)frame.
+typedef char AudioEndpointCheck[EP_SIZE_BYTES <= (USE_FULL_SPEED ? 1023 : 3072) ? 1 : -1];
+#define AUDIO_ALT_FITS(channels, bytes) \
+	((AUDIO_RATE_MAX_FRAMES(48000, AUDIO_PACKETS_PER_SECOND) * (channels) * (bytes) <= EP_SIZE_BYTES) && \
+	 ((channels) <= CHANNEL_COUNT) && ((bytes) == 2 || (bytes) == 3))
+#define AUDIO_ALT_CHECK(channels, bytes) \
+	typedef char AudioAltCheck_##channels##_##bytes[AUDIO_ALT_FITS(channels, bytes) ? 1 : -1];
+AUDIO_ALT_SETTINGS(AUDIO_ALT_CHECK)
+
+#define AUDIO_ALT_ENTRY(channels, bytes) { channels, bytes, 0, 0 },
+AudioAltSetting AudioAltSettings[AUDIO_ALT_COUNT] =
+{
+	AUDIO_ALT_SETTINGS(AUDIO_ALT_ENTRY)
+};
+
+//-----------------------------------------------------------------------------
+// worst case, every alternate setting listing every rate
+#define AUDIO_ALT_DESCRIPTOR_SIZE (sizeof(USB_Descriptor_Interface_t) + \
+								   sizeof(USB_Audio_Descriptor_Interface_AS_t) + \
+								   sizeof(USB_Audio_Descriptor_Format_t) + \
+								   sizeof(USB_Audio_SampleFreq_t) * SUPPORTED_SAMPLE_RATES + \
+								   sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t) + \
+								   sizeof(USB_Audio_Descriptor_StreamEndpoint_Spc_t))
+#define CONFIG_DESCRIPTOR_MAX_SIZE (sizeof(USB_Descriptor_Configuration_Header_t) + \
+									sizeof(USB_Descriptor_Interface_t) * 2 + \
+									sizeof(USB_Audio_Descriptor_Interface_AC_t) + \
+									sizeof(USB_Audio_Descriptor_InputTerminal_t) + \
+									sizeof(USB_Audio_Descriptor_OutputTerminal_t) + \
+									AUDIO_ALT_DESCRIPTOR_SIZE * AUDIO_ALT_COUNT)
+
+/** Configuration descriptor. Built by Descriptors_Build() from the templates below, one
+ *  streaming interface, format and endpoint per alternate setting, and read out by the USB
+ *  host during the enumeration process when selecting a configuration so that the host may
+ *  correctly communicate with the USB device. The extra byte is the zero terminator.
  */
-USB_Descriptor_Configuration_t ConfigurationDescriptor =
+PRAGMA_ALIGN_4
+uint8_t ConfigurationDescriptor[CONFIG_DESCRIPTOR_MAX_SIZE + 1] ATTR_ALIGNED(4);
+uint16_t ConfigurationDescriptorSize = 0;
+
+static const USB_Descriptor_Configuration_Header_t ConfigHeader =
 {
-	.Config = 
+	.Header                   = 
 	{
-		.Header                   = 
-		{
-		.Size = sizeof(USB_Descriptor_Configuration_Header_t), 
-		.Type = DTYPE_Configuration
-		},
-		// termination byte not included in size
-		.TotalConfigurationSize   = sizeof(USB_Descriptor_Configuration_t) - 1,
-		.TotalInterfaces          = 2,
-		.ConfigurationNumber      = 1,
-		.ConfigurationStrIndex    = NO_DESCRIPTOR,
-		.ConfigAttributes         = (USB_CONFIG_ATTR_BUSPOWERED | USB_CONFIG_ATTR_SELFPOWERED),
-		.MaxPowerConsumption      = USB_CONFIG_POWER_MA(50)
+	.Size = sizeof(USB_Descriptor_Configuration_Header_t), 
+	.Type = DTYPE_Configuration
 	},
+	// filled in by Descriptors_Build()
+	.TotalConfigurationSize   = 0,
+	.TotalInterfaces          = 2,
+	.ConfigurationNumber      = 1,
+	.ConfigurationStrIndex    = NO_DESCRIPTOR,
+	.ConfigAttributes         = (USB_CONFIG_ATTR_BUSPOWERED | USB_CONFIG_ATTR_SELFPOWERED),
+	.MaxPowerConsumption      = USB_CONFIG_POWER_MA(50)
+};
 
-	.Audio_ControlInterface = 
+static const USB_Descriptor_Interface_t Audio_ControlInterface = 
+{
+	.Header = 
 	{
-		.Header = 
-		{
-		.Size = sizeof(USB_Descriptor_Interface_t), 
-		.Type = DTYPE_Interface
-		},
-		.InterfaceNumber          = 0,
-		.AlternateSetting         = 0,
-		.TotalEndpoints           = 0,
-		.Class                    = AUDIO_CSCP_AudioClass,
-		.SubClass                 = AUDIO_CSCP_ControlSubclass,
-		.Protocol                 = AUDIO_CSCP_ControlProtocol,
-		.InterfaceStrIndex        = NO_DESCRIPTOR
+	.Size = sizeof(USB_Descriptor_Interface_t), 
+	.Type = DTYPE_Interface
 	},
+	.InterfaceNumber          = 0,
+	.AlternateSetting         = 0,
+	.TotalEndpoints           = 0,
+	.Class                    = AUDIO_CSCP_AudioClass,
+	.SubClass                 = AUDIO_CSCP_ControlSubclass,
+	.Protocol                 = AUDIO_CSCP_ControlProtocol,
+	.InterfaceStrIndex        = NO_DESCRIPTOR
+};
 
-	/*.Audio_ControlInterface_SPC = */
+static const USB_Audio_Descriptor_Interface_AC_t Audio_ControlInterface_SPC =
+{
+	/*.Header = */
 	{
-		/*.Header = */
-		{
-		/*.Size = */ sizeof(ConfigurationDescriptor.Audio_ControlInterface_SPC),
-		/*.Type = */ DTYPE_CSInterface
-		},
-		.Subtype = AUDIO_DSUBTYPE_CSInterface_Header,
-		.ACSpecification = VERSION_BCD(01.00),
-		.TotalLength = (sizeof(USB_Audio_Descriptor_Interface_AC_t) +
-						sizeof(USB_Audio_Descriptor_InputTerminal_t) +
-						sizeof(USB_Audio_Descriptor_OutputTerminal_t)),
-		.InCollection             = 1,
-		.InterfaceNumber          = 1,
+	/*.Size = */ sizeof(USB_Audio_Descriptor_Interface_AC_t),
+	/*.Type = */ DTYPE_CSInterface
 	},
+	.Subtype = AUDIO_DSUBTYPE_CSInterface_Header,
+	.ACSpecification = VERSION_BCD(01.00),
+	.TotalLength = (sizeof(USB_Audio_Descriptor_Interface_AC_t) +
+					sizeof(USB_Audio_Descriptor_InputTerminal_t) +
+					sizeof(USB_Audio_Descriptor_OutputTerminal_t)),
+	.InCollection             = 1,
+	.InterfaceNumber          = 1,
+};
 
-	/*.Audio_InputTerminal = */
+static const USB_Audio_Descriptor_InputTerminal_t Audio_InputTerminal =
+{
+	/*.Header = */
 	{
-		/*.Header = */
-		{
-		/* .Size = */ sizeof(ConfigurationDescriptor.Audio_InputTerminal),
-		/* .Type = */ DTYPE_CSInterface
-		},
-		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
-		.TerminalID               = 0x01,
-		.TerminalType             = DIGITAL_AUDIO_INTERFACE,
-		/*.AssociatedOutputTerminal = */ 0x00,
-		// define channel count
-		.TotalChannels            = CHANNEL_COUNT,
-		// this is set at runtime. determines if the device gives hints for spatial location
-		.ChannelConfig            = 0,
-		// JME
-		.ChannelStrIndex          = NO_DESCRIPTOR,
-		.TerminalStrIndex         = NO_DESCRIPTOR
+	/* .Size = */ sizeof(USB_Audio_Descriptor_InputTerminal_t),
+	/* .Type = */ DTYPE_CSInterface
 	},
+	.Subtype                  = AUDIO_DSUBTYPE_CSInterface_InputTerminal,
+	.TerminalID               = 0x01,
+	.TerminalType             = DIGITAL_AUDIO_INTERFACE,
+	/*.AssociatedOutputTerminal = */ 0x00,
+	// the widest alternate setting
+	.TotalChannels            = CHANNEL_COUNT,
+	// this is set at runtime. determines if the device gives hints for spatial location
+	.ChannelConfig            = 0,
+	// JME
+	.ChannelStrIndex          = NO_DESCRIPTOR,
+	.TerminalStrIndex         = NO_DESCRIPTOR
+};
 
-
-	.Audio_OutputTerminal = 
+static const USB_Audio_Descriptor_OutputTerminal_t Audio_OutputTerminal = 
+{
+	.Header                   = 
 	{
-		.Header                   = 
-		{
-		.Size = sizeof(USB_Audio_Descriptor_OutputTerminal_t), 
-		.Type = DTYPE_CSInterface
-		},
-		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
-		.TerminalID               = 0x02,
-		.TerminalType             = AUDIO_TERMINAL_STREAMING,
-		.AssociatedInputTerminal  = 0x00,
-		.SourceID                 = 0x01,
-		.TerminalStrIndex         = NO_DESCRIPTOR
+	.Size = sizeof(USB_Audio_Descriptor_OutputTerminal_t), 
+	.Type = DTYPE_CSInterface
 	},
+	.Subtype                  = AUDIO_DSUBTYPE_CSInterface_OutputTerminal,
+	.TerminalID               = 0x02,
+	.TerminalType             = AUDIO_TERMINAL_STREAMING,
+	.AssociatedInputTerminal  = 0x00,
+	.SourceID                 = 0x01,
+	.TerminalStrIndex         = NO_DESCRIPTOR
+};
 
-	// selected when device is told to stop streaming. isoch packets no longer sent
-	.Audio_StreamInterface_Alt0 = 
+// alternate setting 0 is selected when device is told to stop streaming,
+// isoch packets no longer sent. Any other one starts streaming in its format
+static const USB_Descriptor_Interface_t Audio_StreamInterface = 
+{
+	.Header = 
 	{
-		.Header                   = 
-		{
-			.Size = sizeof(USB_Descriptor_Interface_t), 
-			.Type = DTYPE_Interface
-		},
-
-		.InterfaceNumber          = 1,
-		.AlternateSetting         = 0,
-		.TotalEndpoints           = 0,
-		.Class                    = AUDIO_CSCP_AudioClass,
-		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
-		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
-		.InterfaceStrIndex        = NO_DESCRIPTOR
+	.Size = sizeof(USB_Descriptor_Interface_t), 
+	.Type = DTYPE_Interface
 	},
 
-	// selected when device is told to start streaming. isoch packets required
-	.Audio_StreamInterface_Alt1 = 
-	{
-		.Header = 
-		{
-		.Size = sizeof(USB_Descriptor_Interface_t), 
-		.Type = DTYPE_Interface
-		},
+	.InterfaceNumber          = 1,
+	// filled in by Descriptors_Build(), as is TotalEndpoints
+	.AlternateSetting         = 0,
+	.TotalEndpoints           = 0,
+	.Class                    = AUDIO_CSCP_AudioClass,
+	.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
+	.Protocol                 = AUDIO_CSCP_StreamingProtocol,
+	.InterfaceStrIndex        = NO_DESCRIPTOR
+};
 
-		.InterfaceNumber          = 1,
-		.AlternateSetting         = 1,
-		.TotalEndpoints           = 1,
-		.Class                    = AUDIO_CSCP_AudioClass,
-		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
-		.Protocol                 = AUDIO_CSCP_StreamingProtocol,
-		.InterfaceStrIndex        = NO_DESCRIPTOR
+//
+static const USB_Audio_Descriptor_Interface_AS_t Audio_StreamInterface_SPC = 
+{
+	.Header = 
+	{
+	.Size = sizeof(USB_Audio_Descriptor_Interface_AS_t), 
+	.Type = DTYPE_CSInterface
 	},
+	.Subtype                  = AUDIO_DSUBTYPE_CSInterface_General,
+	.TerminalLink             = 0x02,
+	.FrameDelay               = 1,
+	.AudioFormat              = 0x0001
+};
 
-	//
-	.Audio_StreamInterface_SPC = 
+// Size, Channels, SubFrameSize, BitResolution and TotalDiscreteSampleRates
+// are per alternate setting
+static const USB_Audio_Descriptor_Format_t Audio_AudioFormat = 
+{
+	// .Header = 
 	{
-		.Header = 
-		{
-		.Size = sizeof(USB_Audio_Descriptor_Interface_AS_t), 
-		.Type = DTYPE_CSInterface
-		},
-		.Subtype                  = AUDIO_DSUBTYPE_CSInterface_General,
-		.TerminalLink             = 0x02,
-		.FrameDelay               = 1,
-		.AudioFormat              = 0x0001
+		/* .Size = */ sizeof(USB_Audio_Descriptor_Format_t),
+		/* .Type = */ DTYPE_CSInterface
 	},
+	/*.Subtype = */ AUDIO_DSUBTYPE_CSInterface_FormatType,
+	/* .FormatType = */ FORMAT_TYPE_1,
+	/* .Channels = */ 0,
+	/* .SubFrameSize = */ 0,
+	/* .BitResolution = */ 0,
+	/* .TotalDiscreteSampleRates = */ 0,
+};
 
-	.Audio_AudioFormat = 
+// EndpointSize is per alternate setting
+static const USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_StreamEndpoint = 
+{
+	/*.Endpoint = */
 	{
-		// .Header = 
+		/*.Header = */
 		{
-			/* .Size = */ sizeof(USB_Audio_Descriptor_Format_t) + sizeof(USB_Audio_SampleFreq_t) * SUPPORTED_SAMPLE_RATES,
-			/* .Type = */ DTYPE_CSInterface
+		/*.Size = */ sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), 
+		/*.Type = */ DTYPE_Endpoint
 		},
-		/*.Subtype = */ AUDIO_DSUBTYPE_CSInterface_FormatType,
-		/* .FormatType = */ FORMAT_TYPE_1,
-		/* .Channels = */ CHANNEL_COUNT,
-		// 2 bytes per subframe for 16bit, 3 for 24 bit
-		/* .SubFrameSize = */ BYTES_PER_SAMPLE,
-		// Bits per sample, i.e 3 * 8 for 24 bit audio
-		/* .BitResolution = */ BYTES_PER_SAMPLE * 8,
-		// how many sample rates do we support?
-		/* .TotalDiscreteSampleRates = */ SUPPORTED_SAMPLE_RATES,
+		/*.EndpointAddress = */ (ENDPOINT_DIR_IN | AUDIO_STREAM_EPNUM),
+		/* .Attributes     = */ (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_SYNC | ENDPOINT_USAGE_DATA),
+		/*.EndpointSize = */ AUDIO_STREAM_EPSIZE,
+		/*.PollingIntervalMS = */ 0x01
 	},
+	/*.Refresh            = */ 0,
+	/*.SyncEndpointNumber = */ 0
+};
 
-	//.Audio_AudioFormatSampleRates = 
+static const USB_Audio_Descriptor_StreamEndpoint_Spc_t Audio_StreamEndpoint_SPC = 
+{
+	.Header = 
 	{
-//		JME integral sample rates only
-//		No, keep these for testing control interface is working
-//		AUDIO_SAMPLE_FREQ(8000),
-//		AUDIO_SAMPLE_FREQ(11025),
-//		AUDIO_SAMPLE_FREQ(22050),
-//		AUDIO_SAMPLE_FREQ(44100),
-		AUDIO_SAMPLE_FREQ(48000),
-		// this is just to persuade Windows to display
-		// an 'advanced' tab ...
-		AUDIO_SAMPLE_FREQ(44100),	
-//		AUDIO_SAMPLE_FREQ(22050),
-//		AUDIO_SAMPLE_FREQ(11025),
-//		AUDIO_SAMPLE_FREQ(8000),		
+	.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Spc_t), 
+	.Type = DTYPE_CSEndpoint
 	},
+	.Subtype = AUDIO_DSUBTYPE_CSEndpoint_General,
+	.Attributes = (AUDIO_EP_ACCEPTS_SMALL_PACKETS | AUDIO_EP_SAMPLE_FREQ_CONTROL),
+	// USBAudio1.0 P62
+	// The bLockDelayUnitsand wLockDelayfields are only applicable for synchronous and adaptive
+	// endpoints. For asynchronous endpoints, the clock is generated internally in the audio function and is
+	// completely independent. In this case, bLockDelayUnits and wLockDelay must be set to zero
+	// Indicates the units used for the	wLockDelay field: 0: Undefined 1: Milliseconds	2: Decoded PCM samples 3..255: Reserved
+	.LockDelayUnits = ePCMSamples,
+	// table 4.21 in USB1.0. i.e. 2 samples for lock
+	.LockDelay = 2
+};
 
-	.Audio_StreamEndpoint = 
+//-----------------------------------------------------------------------------
+static uint8_t* AppendDescriptor(uint8_t* p, const void* descriptor, uint32_t size)
+{
+	memcpy(p, descriptor, size);
+	return p + size;
+}
+
+//-----------------------------------------------------------------------------
+// Lays out the control interface, alternate setting 0, then one streaming
+// interface per AudioAltSettings entry listing only the rates whose largest
+// packet fits EP_SIZE_BYTES and advertising that packet as wMaxPacketSize,
+// so the host reserves no more bus time than the alternate setting needs.
+// Packets over 1024 bytes are advertised high-bandwidth; the endpoint is
+// configured for EP_SIZE_BYTES and the DCD sends however many transactions
+// each packet takes.
+void Descriptors_Build(uint32_t channel_mask)
+{
+	uint8_t* p = ConfigurationDescriptor;
+	USB_Descriptor_Configuration_Header_t config = ConfigHeader;
+	USB_Audio_Descriptor_InputTerminal_t terminal = Audio_InputTerminal;
+	USB_Descriptor_Interface_t stream = Audio_StreamInterface;
+	USB_Audio_Descriptor_Format_t format = Audio_AudioFormat;
+	USB_Audio_Descriptor_StreamEndpoint_Std_t endpoint = Audio_StreamEndpoint;
+	int alt = 0;
+	int i = 0;
+
+	// header last, once we know the size
+	p += sizeof(config);
+	p = AppendDescriptor(p, &Audio_ControlInterface, sizeof(Audio_ControlInterface));
+	p = AppendDescriptor(p, &Audio_ControlInterface_SPC, sizeof(Audio_ControlInterface_SPC));
+	terminal.ChannelConfig = channel_mask;
+	p = AppendDescriptor(p, &terminal, sizeof(terminal));
+	p = AppendDescriptor(p, &Audio_OutputTerminal, sizeof(Audio_OutputTerminal));
+	// zero bandwidth
+	p = AppendDescriptor(p, &stream, sizeof(stream));
+
+	for (alt = 0; alt < AUDIO_ALT_COUNT; alt++)
 	{
-		/*.Endpoint = */
+		AudioAltSetting* setting = &AudioAltSettings[alt];
+		uint32_t frame_bytes = setting->Channels * setting->SubFrameSize;
+		setting->MaxPacketSize = 0;
+		setting->RateMask = 0;
+		format.TotalDiscreteSampleRates = 0;
+		for (i = 0; i < SUPPORTED_SAMPLE_RATES; i++)
 		{
-			/*.Header = */
+			uint32_t bytes = AUDIO_RATE_MAX_FRAMES(SampleRates[i], AUDIO_PACKETS_PER_SECOND) * frame_bytes;
+			if (bytes <= EP_SIZE_BYTES)
 			{
-			/*.Size = */ sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), 
-			/*.Type = */ DTYPE_Endpoint
-			},
-			/*.EndpointAddress = */ (ENDPOINT_DIR_IN | AUDIO_STREAM_EPNUM),
-			/* .Attributes     = */ (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_SYNC | ENDPOINT_USAGE_DATA),
-			/*.EndpointSize = */ EP_SIZE_BYTES,
-			/*.PollingIntervalMS = */ 0x01
-		},
-		/*.Refresh            = */ 0,
-		/*.SyncEndpointNumber = */ 0
-	},
+				setting->RateMask |= (1 << i);
+				if (bytes > setting->MaxPacketSize)
+				{
+					setting->MaxPacketSize = bytes;
+				}
+				format.TotalDiscreteSampleRates++;
+			}
+		}
 
-	.Audio_StreamEndpoint_SPC = 
-	{
-		.Header = 
+		stream.AlternateSetting = alt + 1;
+		stream.TotalEndpoints = 1;
+		p = AppendDescriptor(p, &stream, sizeof(stream));
+		p = AppendDescriptor(p, &Audio_StreamInterface_SPC, sizeof(Audio_StreamInterface_SPC));
+
+		format.Header.Size = sizeof(format) + sizeof(USB_Audio_SampleFreq_t) * format.TotalDiscreteSampleRates;
+		format.Channels = setting->Channels;
+		format.SubFrameSize = setting->SubFrameSize;
+		// Bits per sample, i.e 3 * 8 for 24 bit audio
+		format.BitResolution = setting->SubFrameSize * 8;
+		p = AppendDescriptor(p, &format, sizeof(format));
+		for (i = 0; i < SUPPORTED_SAMPLE_RATES; i++)
 		{
-		.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Spc_t), 
-		.Type = DTYPE_CSEndpoint
-		},
-		.Subtype = AUDIO_DSUBTYPE_CSEndpoint_General,
-		.Attributes = (AUDIO_EP_ACCEPTS_SMALL_PACKETS | AUDIO_EP_SAMPLE_FREQ_CONTROL),
-		// USBAudio1.0 P62
-		// The bLockDelayUnitsand wLockDelayfields are only applicable for synchronous and adaptive
-		// endpoints. For asynchronous endpoints, the clock is generated internally in the audio function and is
-		// completely independent. In this case, bLockDelayUnits and wLockDelay must be set to zero
-		// Indicates the units used for the	wLockDelay field: 0: Undefined 1: Milliseconds	2: Decoded PCM samples 3..255: Reserved
-		.LockDelayUnits = ePCMSamples,
-		// table 4.21 in USB1.0. i.e. 2 samples for lock
-		.LockDelay = 2
-	},
-	.Audio_Termination = 0x00
-};
+			if (setting->RateMask & (1 << i))
+			{
+				USB_Audio_SampleFreq_t rate = AUDIO_SAMPLE_FREQ(SampleRates[i]);
+				p = AppendDescriptor(p, &rate, sizeof(rate));
+			}
+		}
+
+		endpoint.Endpoint.EndpointSize = AUDIO_ENDPOINT_SIZE(setting->MaxPacketSize);
+		p = AppendDescriptor(p, &endpoint, sizeof(endpoint));
+		p = AppendDescriptor(p, &Audio_StreamEndpoint_SPC, sizeof(Audio_StreamEndpoint_SPC));
+	}
+
+	// termination byte not included in size
+	*p = 0x00;
+	ConfigurationDescriptorSize = (uint16_t) (p - ConfigurationDescriptor);
+	config.TotalConfigurationSize = ConfigurationDescriptorSize;
+	AppendDescriptor(ConfigurationDescriptor, &config, sizeof(config));
+}
 
 /** Language descriptor structure. This descriptor, located in FLASH memory, is returned when the host requests
  *  the string descriptor with index 0 (the first index). It is actually an array of 16-bit integers, which indicate
@@ -595,9 +707,6 @@ uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
 	const void* Address = NULL;
 	uint16_t    Size    = NO_DESCRIPTOR;
 	
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	dbg_message dbm = { 0, 0 };
-	
 	switch (DescriptorType)
 	{
 	case DTYPE_Device:
@@ -609,8 +718,8 @@ uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
 		Address = GetConfigStruct();
 		Size    = GetConfigStructSize();
 #else		
-		Address = &ConfigurationDescriptor;
-		Size    = sizeof(USB_Descriptor_Configuration_t);
+		Address = ConfigurationDescriptor;
+		Size    = ConfigurationDescriptorSize;
 #endif		
 		break;
 	case DTYPE_String:
@@ -626,21 +735,14 @@ uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
 		{
 			Address = &DeviceQualifier;
 			Size = sizeof(DeviceQualifier);
-			dbm.psz = states[eGet_DeviceQualifier_Descriptor];
-			dbm.v1 = DescriptorType;
-			dbm.v2 = DescriptorNumber;
-			dbm.v3 = Size;
-			xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+			Log(eGet_DeviceQualifier_Descriptor, DescriptorType, DescriptorNumber, Size);
 		}
 		break;
 */
 	default:
 		{
-			// dbm.psz = states[eGet_Unknown_Descriptor];
-			dbm.psz = descriptors[DescriptorType];
-			dbm.v1 = DescriptorType;
-			dbm.v2 = DescriptorNumber;
-			xQueueSendFromISR(logQueueHandle,&dbm,&xHigherPriorityTaskWoken);
+			// Log(eGet_Unknown_Descriptor, DescriptorType, DescriptorNumber, 0);
+			Log3(descriptors[DescriptorType], DescriptorType, DescriptorNumber, 0);
 		}
 	}
 	// queue the details for later logging
@@ -62,11 +62,17 @@ extern "C" {
 #endif
 
 /**
- * @brief Endpoint size in bytes of the Audio isochronous streaming data endpoint. The Windows audio stack requires
- *        at least 192 bytes for correct output, thus the smaller 128 byte maximum endpoint size on some of the smaller
- *        USB models will result in unavoidable distorted output.
+ * @brief wMaxPacketSize for isochronous packets of up to bytes. Past 1024 (high-speed only) the endpoint is
+ *        high-bandwidth: the packet goes as 1024 byte transactions, up to 3 a microframe, in bits 12:11.
  */
-#define AUDIO_STREAM_EPSIZE          ENDPOINT_MAX_SIZE(AUDIO_STREAM_EPNUM)
+#define AUDIO_ENDPOINT_SIZE(bytes)   ((bytes) > 1024 ? \
+									  ENDPOINT_SIZE_HIGH_BANDWIDTH(1024, ((bytes) + 1023) / 1024) : (bytes))
+
+/**
+ * @brief Endpoint size of the Audio isochronous streaming data endpoint, as configured on the controller. The
+ *        alternate settings advertise their own, never more than this.
+ */
+#define AUDIO_STREAM_EPSIZE          AUDIO_ENDPOINT_SIZE(EP_SIZE_BYTES)
 
 
 		/** @brief Audio class-specific Feature Unit Descriptor (nxpUSBlib naming conventions).
@@ -102,32 +108,52 @@ extern "C" {
 
 
 /**
- * @brief Type define for the device configuration descriptor structure. This must be defined in the
- *        application code, as the configuration descriptor contains several sub-descriptors which
- *        vary between devices, and which describe the device's usage to the host.
+ * @brief Packets per second on the isochronous endpoint, one per (micro)frame.
+ */
+#if USE_FULL_SPEED == 1
+#define AUDIO_PACKETS_PER_SECOND     1000
+#else
+#define AUDIO_PACKETS_PER_SECOND     8000
+#endif
+
+/**
+ * @brief Number of streaming alternate settings in AUDIO_ALT_SETTINGS, not counting the zero
+ *        bandwidth alternate setting 0.
+ */
+#define AUDIO_ALT_COUNT_ONE(channels, bytes) + 1
+#define AUDIO_ALT_COUNT              (0 AUDIO_ALT_SETTINGS(AUDIO_ALT_COUNT_ONE))
+
+/**
+ * @brief One streaming alternate setting. Alternate setting n is AudioAltSettings[n - 1].
+ *        Channels and SubFrameSize come from AUDIO_ALT_SETTINGS in config.h, the rest is
+ *        worked out by Descriptors_Build().
  */
-typedef struct 
+typedef struct _AudioAltSetting
 {
-	USB_Descriptor_Configuration_Header_t	Config;
-	/* Audio Control Interface */
-	USB_Descriptor_Interface_t				Audio_ControlInterface;
-	USB_Audio_Descriptor_Interface_AC_t		Audio_ControlInterface_SPC;
-	USB_Audio_Descriptor_InputTerminal_t	Audio_InputTerminal;
-	USB_Audio_Descriptor_OutputTerminal_t	Audio_OutputTerminal;
-
-	/* Audio Streaming Interface */
-	USB_Descriptor_Interface_t				Audio_StreamInterface_Alt0;
-	USB_Descriptor_Interface_t				Audio_StreamInterface_Alt1;
-	USB_Audio_Descriptor_Interface_AS_t		Audio_StreamInterface_SPC;
-	USB_Audio_Descriptor_Format_t			Audio_AudioFormat;
-	// no. you utter fucking knuckleheads. do not hardwire size!
-	USB_Audio_SampleFreq_t                    Audio_AudioFormatSampleRates[SUPPORTED_SAMPLE_RATES];
-	USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_StreamEndpoint;
-	USB_Audio_Descriptor_StreamEndpoint_Spc_t Audio_StreamEndpoint_SPC;
-	// this is zero filled and must not be included in size calculations
-	unsigned char                             Audio_Termination;
-	
-} USB_Descriptor_Configuration_t;
+	uint8_t  Channels;
+	// 2 bytes per subframe for 16bit, 3 for 24 bit
+	uint8_t  SubFrameSize;
+	// wMaxPacketSize, the largest packet at the highest rate listed
+	uint16_t MaxPacketSize;
+	// bit n set if the n'th supported sample rate fits EP_SIZE_BYTES
+	uint8_t  RateMask;
+} AudioAltSetting;
+
+extern AudioAltSetting AudioAltSettings[AUDIO_ALT_COUNT];
+
+/**
+ * @brief The configuration descriptor is generated into RAM from AudioAltSettings since each
+ *        alternate setting carries its own format and sample rate list. It is followed by a
+ *        zero byte, not included in ConfigurationDescriptorSize, for the ROM stack.
+ */
+extern uint8_t ConfigurationDescriptor[];
+extern uint16_t ConfigurationDescriptorSize;
+
+/**
+ * @brief (Re)build ConfigurationDescriptor. channel_mask goes in the input terminal's
+ *        wChannelConfig. Call before USB_Init().
+ */
+extern void Descriptors_Build(uint32_t channel_mask);
 
 /**
  * @}
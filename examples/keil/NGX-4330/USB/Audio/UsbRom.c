@@ -58,7 +58,7 @@ uint8_t StringDescriptor[] = {
 	WBVAL('D'), WBVAL('e'), WBVAL('m'), WBVAL('o')
 };
 extern USB_Descriptor_Device_t DeviceDescriptor;
-extern USB_Descriptor_Configuration_t ConfigurationDescriptor;
+extern uint8_t ConfigurationDescriptor[];
 
 /*****************************************************************************
  * Private functions
@@ -75,7 +75,7 @@ uint32_t CALLBACK_UsbdRom_Register_DeviceDescriptor(void)
 
 uint32_t CALLBACK_UsbdRom_Register_ConfigurationDescriptor(void)
 {
-	return (uint32_t) &ConfigurationDescriptor;
+	return (uint32_t) ConfigurationDescriptor;
 }
 
 uint32_t CALLBACK_UsbdRom_Register_StringDescriptor(void)
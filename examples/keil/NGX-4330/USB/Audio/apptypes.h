@@ -51,11 +51,7 @@ typedef enum
 } LockDelayUnits;
 
 //-----------------------------------------------------------------------------
-// This requires some abtraction too
-typedef void* xQueueHandle;
-extern xQueueHandle logQueueHandle;
-extern xQueueHandle usbQueueHandle;
-//-----------------------------------------------------------------------------
+// collects the fields of one trace point before it goes to the trace ring
 typedef struct _DbgMessage
 {
 	const char* file;
@@ -71,15 +67,6 @@ typedef struct _DbgMessage
 
 typedef DbgMessage dbg_message;
 
-//-----------------------------------------------------------------------------
-typedef struct _USBMessage
-{
-	const char* file;
-	int line;
-	USB_Request_Header_t request;
-	
-} USBMessage;
-
 //-----------------------------------------------------------------------------
 //
 extern int GetConfigStructSize(void);
@@ -0,0 +1,197 @@
+/*
+
+	Planar Q31 -> interleaved USB subslot packing. See audiopack.h
+
+	USB audio and the Cortex-M are both little endian so no byte reversal is
+	needed. The gain comes from building whole words in registers and doing
+	one store per word instead of one per byte.
+
+*/
+
+#include "audiopack.h"
+
+//-----------------------------------------------------------------------------
+// [b.hi16 : a.hi16]
+#ifdef AUDIO_PACK_SIMD
+#define PACK_HI16(a,b)		__PKHTB((uint32_t)(b), (uint32_t)(a), 16)
+#else
+#define PACK_HI16(a,b)		((((uint32_t)(a)) >> 16) | (((uint32_t)(b)) & 0xFFFF0000UL))
+#endif
+
+//-----------------------------------------------------------------------------
+void AudioPack_Generic(uint8_t* dst, const int32_t* const* planes,
+					   uint32_t channels, uint32_t samples, uint32_t subslot_bytes)
+{
+	uint32_t sample = 0;
+	uint32_t channel = 0;
+	uint32_t shift = 32 - (subslot_bytes * 8);
+	for (sample = 0; sample < samples; sample++)
+	{
+		for (channel = 0; channel < channels; channel++)
+		{
+			uint32_t v = ((uint32_t) planes[channel][sample]) >> shift;
+			uint32_t b = 0;
+			for (b = 0; b < subslot_bytes; b++)
+			{
+				*dst++ = (uint8_t) v;
+				v >>= 8;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// two channels per word store
+void AudioPack_S16(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples)
+{
+	uint32_t sample = 0;
+	uint32_t channel = 0;
+	uint32_t* out = (uint32_t*) dst;
+	if ((channels & 1) || ((uintptr_t) dst & 3))
+	{
+		AudioPack_Generic(dst, planes, channels, samples, 2);
+		return;
+	}
+	for (sample = 0; sample < samples; sample++)
+	{
+		for (channel = 0; channel < channels; channel += 2)
+		{
+			*out++ = PACK_HI16(planes[channel][sample], planes[channel + 1][sample]);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// four channels (12 bytes) per three word stores
+//   w0 = a0 a1 a2 b0, w1 = b1 b2 c0 c1, w2 = c2 d0 d1 d2
+void AudioPack_S24(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples)
+{
+	uint32_t sample = 0;
+	uint32_t channel = 0;
+	uint32_t* out = (uint32_t*) dst;
+	if ((channels & 3) || ((uintptr_t) dst & 3))
+	{
+		AudioPack_Generic(dst, planes, channels, samples, 3);
+		return;
+	}
+	for (sample = 0; sample < samples; sample++)
+	{
+		for (channel = 0; channel < channels; channel += 4)
+		{
+			uint32_t a = (uint32_t) planes[channel][sample];
+			uint32_t b = (uint32_t) planes[channel + 1][sample];
+			uint32_t c = (uint32_t) planes[channel + 2][sample];
+			uint32_t d = (uint32_t) planes[channel + 3][sample];
+			out[0] = (a >> 8) | (b << 16 & 0xFF000000UL);
+			out[1] = PACK_HI16(b, c << 8);
+			out[2] = (c >> 24) | (d & 0xFFFFFF00UL);
+			out += 3;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+void AudioPack_S32(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples)
+{
+	uint32_t sample = 0;
+	uint32_t channel = 0;
+	uint32_t* out = (uint32_t*) dst;
+	if ((uintptr_t) dst & 3)
+	{
+		AudioPack_Generic(dst, planes, channels, samples, 4);
+		return;
+	}
+	for (sample = 0; sample < samples; sample++)
+	{
+		for (channel = 0; channel < channels; channel++)
+		{
+			*out++ = (uint32_t) planes[channel][sample];
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+uint32_t AudioPack_Interleave(uint8_t* dst, const int32_t* const* planes,
+							  uint32_t channels, uint32_t samples,
+							  uint32_t subslot_bytes)
+{
+	switch (subslot_bytes)
+	{
+		case 2:
+			AudioPack_S16(dst, planes, channels, samples);
+		break;
+		case 3:
+			AudioPack_S24(dst, planes, channels, samples);
+		break;
+		case 4:
+			AudioPack_S32(dst, planes, channels, samples);
+		break;
+		default:
+			return 0;
+	}
+	return channels * samples * subslot_bytes;
+}
+
+#ifdef AUDIO_PACK_BENCH
+//-----------------------------------------------------------------------------
+// Host benchmark and cross-check against the generic packer.
+// gcc -O2 -DAUDIO_PACK_BENCH audiopack.c -o audiopack_bench && ./audiopack_bench
+#include <stdio.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#define BENCH_CHANNELS		48
+#define BENCH_SAMPLES		48
+#define BENCH_LOOPS			20000
+
+static int32_t bench_planes[BENCH_CHANNELS][BENCH_SAMPLES];
+static const int32_t* bench_ptrs[BENCH_CHANNELS];
+static uint32_t bench_ref[BENCH_CHANNELS * BENCH_SAMPLES];
+static uint32_t bench_out[BENCH_CHANNELS * BENCH_SAMPLES];
+
+static double bench(uint32_t subslot_bytes, int generic)
+{
+	uint32_t i = 0;
+	uint64_t start = __rdtsc();
+	for (i = 0; i < BENCH_LOOPS; i++)
+	{
+		if (generic)
+		{
+			AudioPack_Generic((uint8_t*) bench_out, bench_ptrs, BENCH_CHANNELS, BENCH_SAMPLES, subslot_bytes);
+		}
+		else
+		{
+			AudioPack_Interleave((uint8_t*) bench_out, bench_ptrs, BENCH_CHANNELS, BENCH_SAMPLES, subslot_bytes);
+		}
+		__asm__ __volatile__("" ::: "memory");
+	}
+	return (double) (BENCH_CHANNELS * BENCH_SAMPLES * subslot_bytes) * BENCH_LOOPS / (double) (__rdtsc() - start);
+}
+
+int main(void)
+{
+	uint32_t c = 0;
+	uint32_t s = 0;
+	uint32_t bytes = 0;
+	uint32_t seed = 12345;
+	for (c = 0; c < BENCH_CHANNELS; c++)
+	{
+		bench_ptrs[c] = bench_planes[c];
+		for (s = 0; s < BENCH_SAMPLES; s++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			bench_planes[c][s] = (int32_t) seed;
+		}
+	}
+	for (bytes = 2; bytes <= 4; bytes++)
+	{
+		uint32_t n = BENCH_CHANNELS * BENCH_SAMPLES * bytes;
+		AudioPack_Generic((uint8_t*) bench_ref, bench_ptrs, BENCH_CHANNELS, BENCH_SAMPLES, bytes);
+		AudioPack_Interleave((uint8_t*) bench_out, bench_ptrs, BENCH_CHANNELS, BENCH_SAMPLES, bytes);
+		printf("%u-bit %s generic %.2f bytes/cycle packed %.2f bytes/cycle\n", bytes * 8,
+			   memcmp(bench_ref, bench_out, n) == 0 ? "ok" : "MISMATCH",
+			   bench(bytes, 1), bench(bytes, 0));
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,51 @@
+/*
+
+	Sample packing for the audio IN path.
+
+	Converts per-channel planar 32-bit (Q31, MSB aligned) buffers into the
+	interleaved 2, 3 or 4 byte little endian subslots of a USB audio packet.
+	On the M4 the 16-bit path uses PKHTB and the 24-bit path packs four
+	channels into three word stores. Everything else falls back to portable C.
+
+*/
+
+#ifndef AUDIOPACK_H
+#define AUDIOPACK_H
+
+#include <stdint.h>
+
+#if defined(CORE_M4)
+#include "board.h"
+#define AUDIO_PACK_SIMD 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// planes[channel] points at 'samples' Q31 values. dst receives
+// samples * channels * subslot_bytes bytes. Returns bytes written or 0 if
+// subslot_bytes is not 2, 3 or 4.
+extern uint32_t AudioPack_Interleave(uint8_t* dst, const int32_t* const* planes,
+									 uint32_t channels, uint32_t samples,
+									 uint32_t subslot_bytes);
+
+//-----------------------------------------------------------------------------
+// the individual kernels. The word-store fast paths need dst 4 byte aligned
+// and channels a multiple of 2 (16-bit) or 4 (24-bit), otherwise they drop
+// to the portable loop.
+extern void AudioPack_S16(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples);
+extern void AudioPack_S24(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples);
+extern void AudioPack_S32(uint8_t* dst, const int32_t* const* planes, uint32_t channels, uint32_t samples);
+
+//-----------------------------------------------------------------------------
+// byte-at-a-time reference. Kept for the benchmark and for odd layouts.
+extern void AudioPack_Generic(uint8_t* dst, const int32_t* const* planes,
+							  uint32_t channels, uint32_t samples, uint32_t subslot_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+/*
+
+	Fractional samples per packet scheduler. See audiorate.h
+
+*/
+
+#include "audiorate.h"
+
+//-----------------------------------------------------------------------------
+static const uint32_t knownRates[AUDIO_RATE_COUNT] =
+{
+	44100, 48000, 88200, 96000, 176400, 192000
+};
+
+//-----------------------------------------------------------------------------
+static int FindRate(const AudioRate* sched, uint32_t rate)
+{
+	int i = 0;
+	for (i = 0; i < AUDIO_RATE_COUNT; i++)
+	{
+		if (sched->budgets[i].rate == rate)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+int AudioRate_Init(AudioRate* sched, uint32_t packets_per_second,
+				   uint32_t channels, uint32_t subslot_bytes,
+				   uint32_t max_packet_bytes, uint32_t rate)
+{
+	int i = 0;
+	sched->packets_per_second = packets_per_second;
+	sched->frame_bytes = channels * subslot_bytes;
+	for (i = 0; i < AUDIO_RATE_COUNT; i++)
+	{
+		AudioRateBudget* budget = &sched->budgets[i];
+		budget->rate = knownRates[i];
+		budget->base = knownRates[i] / packets_per_second;
+		budget->remainder = knownRates[i] % packets_per_second;
+		budget->max_frames = AUDIO_RATE_MAX_FRAMES(knownRates[i], packets_per_second);
+		budget->max_bytes = budget->max_frames * sched->frame_bytes;
+		budget->fits = (budget->max_bytes <= max_packet_bytes);
+	}
+	sched->current = 0;
+	sched->pending = 0;
+	sched->phase = 0;
+	sched->switches = 0;
+	sched->refused = 0;
+	if (AudioRate_Set(sched, rate) == 0)
+	{
+		return 0;
+	}
+	sched->current = sched->pending;
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+int AudioRate_Set(AudioRate* sched, uint32_t rate)
+{
+	int i = FindRate(sched, rate);
+	if (i < 0 || sched->budgets[i].fits == 0)
+	{
+		sched->refused++;
+		return 0;
+	}
+	sched->pending = (uint32_t) i;
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t AudioRate_Get(const AudioRate* sched)
+{
+	return sched->budgets[sched->pending].rate;
+}
+
+//-----------------------------------------------------------------------------
+const AudioRateBudget* AudioRate_Budget(const AudioRate* sched, uint32_t rate)
+{
+	int i = FindRate(sched, rate);
+	return (i < 0 ? 0 : &sched->budgets[i]);
+}
+
+//-----------------------------------------------------------------------------
+// base frames every packet plus one whenever the phase wraps, i.e. 44.1kHz
+// at 1000 packets/s adds 100 a packet and wraps every 10th.
+uint32_t AudioRate_Next(AudioRate* sched)
+{
+	const AudioRateBudget* budget = 0;
+	uint32_t frames = 0;
+	uint32_t pending = sched->pending;
+	// rate change takes effect on a packet boundary with a fresh phase
+	if (pending != sched->current)
+	{
+		sched->current = pending;
+		sched->phase = 0;
+		sched->switches++;
+	}
+	budget = &sched->budgets[sched->current];
+	frames = budget->base;
+	sched->phase += budget->remainder;
+	if (sched->phase >= sched->packets_per_second)
+	{
+		sched->phase -= sched->packets_per_second;
+		frames++;
+	}
+	return frames;
+}
+
+//-----------------------------------------------------------------------------
+#ifdef AUDIO_RATE_SIM
+//-----------------------------------------------------------------------------
+// Host check. For every rate at both bus speeds, ten seconds of packets must
+// add up to exactly ten seconds of frames and stay within the budget. Also
+// prints the budget table for a 6ch/16-bit stream on a 1024 byte endpoint.
+// gcc -O2 -DAUDIO_RATE_SIM audiorate.c -o audiorate_sim && ./audiorate_sim
+#include <stdio.h>
+
+#define SIM_SECONDS		10
+#define SIM_CHANNELS	6
+#define SIM_SUBSLOT		2
+#define SIM_EP_BYTES	1024
+
+int main(void)
+{
+	static const uint32_t speeds[2] = { 1000, 8000 };
+	AudioRate sched;
+	int errors = 0;
+	int s = 0;
+	int i = 0;
+	for (s = 0; s < 2; s++)
+	{
+		AudioRate_Init(&sched, speeds[s], SIM_CHANNELS, SIM_SUBSLOT, SIM_EP_BYTES, 48000);
+		for (i = 0; i < AUDIO_RATE_COUNT; i++)
+		{
+			const AudioRateBudget* budget = &sched.budgets[i];
+			uint32_t packets = speeds[s] * SIM_SECONDS;
+			uint32_t total = 0;
+			uint32_t lo = 0xFFFFFFFF;
+			uint32_t hi = 0;
+			uint32_t p = 0;
+			// check the accumulator whether or not the rate fits
+			sched.budgets[i].fits = 1;
+			AudioRate_Set(&sched, budget->rate);
+			for (p = 0; p < packets; p++)
+			{
+				uint32_t n = AudioRate_Next(&sched);
+				total += n;
+				lo = (n < lo ? n : lo);
+				hi = (n > hi ? n : hi);
+			}
+			if (total != budget->rate * SIM_SECONDS || hi > budget->max_frames || lo < budget->base)
+			{
+				errors++;
+			}
+			printf("%4u/s %6u Hz frames %2u..%2u (max %2u) %4u bytes %s total %s\n",
+				   speeds[s], budget->rate, lo, hi, budget->max_frames, budget->max_bytes,
+				   budget->max_bytes <= SIM_EP_BYTES ? "fits" : "OVER",
+				   total == budget->rate * SIM_SECONDS ? "ok" : "WRONG");
+		}
+	}
+	printf("%s\n", errors ? "FAILED" : "passed");
+	return errors;
+}
+#endif
@@ -0,0 +1,96 @@
+/*
+
+	Per packet sample count scheduling for the audio IN stream.
+
+	A synchronous ISO endpoint sends one packet per (micro)frame, so any rate
+	that is not a whole multiple of the packet rate needs packets of varying
+	length: 44.1kHz at full-speed is nine packets of 44 frames then one of 45.
+	The scheduler keeps the fractional part in a phase accumulator so the
+	long run average is exact and no packet is more than one frame off.
+
+	Each supported rate has a budget (largest packet in frames and bytes for
+	the configured channel count and subslot size) worked out once at init
+	and checked against the endpoint size. Rates that do not fit are refused.
+
+	No board dependencies. See AUDIO_RATE_SIM in audiorate.c for a host check.
+
+*/
+
+#ifndef AUDIORATE_H
+#define AUDIORATE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// largest packet, in frames, for 'rate' at 'packets_per_second'. For sizing
+// buffers at compile time.
+#define AUDIO_RATE_MAX_FRAMES(rate, packets_per_second) \
+	(((rate) + (packets_per_second) - 1) / (packets_per_second))
+
+// every rate the scheduler knows about
+#define AUDIO_RATE_COUNT	6
+
+//-----------------------------------------------------------------------------
+// precomputed per rate budget
+typedef struct _AudioRateBudget
+{
+	uint32_t rate;
+	// frames every packet carries
+	uint32_t base;
+	// rate % packets_per_second, added to the phase each packet
+	uint32_t remainder;
+	// worst case packet
+	uint32_t max_frames;
+	uint32_t max_bytes;
+	// 1 if max_bytes fits the endpoint
+	uint32_t fits;
+} AudioRateBudget;
+
+//-----------------------------------------------------------------------------
+// rate is written by AudioRate_Set() (control request context), everything
+// else only by AudioRate_Next() (producer). The new rate is picked up on the
+// next packet boundary.
+typedef struct _AudioRate
+{
+	AudioRateBudget budgets[AUDIO_RATE_COUNT];
+	// 1000 at full-speed, 8000 at high-speed
+	uint32_t packets_per_second;
+	// bytes per frame, channels * subslot size
+	uint32_t frame_bytes;
+	// requested budget index
+	volatile uint32_t pending;
+	// budget index in use and its phase
+	uint32_t current;
+	uint32_t phase;
+	// statistics
+	volatile uint32_t switches;
+	volatile uint32_t refused;
+} AudioRate;
+
+//-----------------------------------------------------------------------------
+// fills in the budgets and selects 'rate'. Returns 0 if 'rate' is unknown or
+// does not fit max_packet_bytes.
+extern int AudioRate_Init(AudioRate* sched, uint32_t packets_per_second,
+						  uint32_t channels, uint32_t subslot_bytes,
+						  uint32_t max_packet_bytes, uint32_t rate);
+
+// request a new rate. Returns 0 (and keeps the old rate) if it is unknown or
+// over budget.
+extern int AudioRate_Set(AudioRate* sched, uint32_t rate);
+extern uint32_t AudioRate_Get(const AudioRate* sched);
+
+// frames to put in the next packet. Producer side, once per packet.
+extern uint32_t AudioRate_Next(AudioRate* sched);
+
+// the budget for 'rate' or NULL if unknown
+extern const AudioRateBudget* AudioRate_Budget(const AudioRate* sched, uint32_t rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
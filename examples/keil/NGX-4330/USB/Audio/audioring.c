@@ -0,0 +1,277 @@
+/*
+
+	Lock-free SPSC ring of isochronous IN packets. See audioring.h
+
+*/
+
+#include <string.h>
+#include "audioring.h"
+
+//-----------------------------------------------------------------------------
+#define RING_MASK(r)		((r)->slot_count - 1)
+#define RING_SLOT(r,i)		(&(r)->slots[(i) & RING_MASK(r)])
+#define RING_HANDOFF(r,i)	(&(r)->handoffs[(i) & (AUDIO_RING_MAX_DEPTH - 1)])
+
+//-----------------------------------------------------------------------------
+int AudioRing_Init(AudioRing* ring, AudioRingSlot* slots, uint8_t* storage,
+				   uint32_t slot_count, uint32_t slot_bytes,
+				   const uint8_t* underrun_data, uint32_t underrun_size)
+{
+	uint32_t i = 0;
+	// need a power of 2 and room for one in flight plus one queued
+	if (slot_count < 2 || (slot_count & (slot_count - 1)) != 0)
+	{
+		return 0;
+	}
+	ring->slots = slots;
+	ring->slot_count = slot_count;
+	ring->slot_bytes = slot_bytes;
+	ring->underrun_data = underrun_data;
+	ring->underrun_size = underrun_size;
+	ring->depth = 1;
+	for (i = 0; i < slot_count; i++)
+	{
+		slots[i].data = storage + (i * slot_bytes);
+		slots[i].size = 0;
+		slots[i].stamp = 0;
+	}
+	AudioRing_Reset(ring);
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// only safe when neither side is running (i.e. stream stopped)
+void AudioRing_Reset(AudioRing* ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->next = 0;
+	ring->handoff_in = 0;
+	ring->handoff_out = 0;
+	ring->held = 0;
+	ring->underruns = 0;
+	ring->overruns = 0;
+	ring->packets = 0;
+	ring->max_latency = 0;
+	ring->last_latency = 0;
+	AUDIO_RING_DMB();
+}
+
+//-----------------------------------------------------------------------------
+int AudioRing_SetDepth(AudioRing* ring, uint32_t depth)
+{
+	if (depth == 0 || depth > AUDIO_RING_MAX_DEPTH || depth >= ring->slot_count)
+	{
+		return 0;
+	}
+	ring->depth = depth;
+	AudioRing_Reset(ring);
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t AudioRing_Free(const AudioRing* ring)
+{
+	return ring->slot_count - (ring->head - ring->tail);
+}
+
+//-----------------------------------------------------------------------------
+uint32_t AudioRing_Used(const AudioRing* ring)
+{
+	return ring->head - ring->next;
+}
+
+//-----------------------------------------------------------------------------
+// producer: get the next slot to fill. Data is not visible to the consumer
+// until AudioRing_Commit()
+uint8_t* AudioRing_Acquire(AudioRing* ring)
+{
+	if (AudioRing_Free(ring) == 0)
+	{
+		ring->overruns++;
+		return 0;
+	}
+	return RING_SLOT(ring, ring->head)->data;
+}
+
+//-----------------------------------------------------------------------------
+// producer: publish the slot returned by AudioRing_Acquire()
+void AudioRing_Commit(AudioRing* ring, uint32_t size)
+{
+	AudioRingSlot* slot = RING_SLOT(ring, ring->head);
+	slot->size = (size > ring->slot_bytes ? ring->slot_bytes : size);
+	slot->stamp = AUDIO_RING_NOW();
+	// packet contents must land before the index moves
+	AUDIO_RING_DMB();
+	ring->head = ring->head + 1;
+}
+
+//-----------------------------------------------------------------------------
+// consumer: called once per ISO completion from ISR context
+const uint8_t* AudioRing_NextPacket(AudioRing* ring, uint32_t* size)
+{
+	AudioRingSlot* slot = 0;
+	AudioRingHandoff* handoff = 0;
+	uint32_t latency = 0;
+	// the DCD has finished with the oldest packet it holds, give it back.
+	// Once it holds none any slots AudioRing_Flush() skipped go with it
+	if (ring->handoff_in - ring->handoff_out == ring->depth)
+	{
+		handoff = RING_HANDOFF(ring, ring->handoff_out);
+		ring->handoff_out++;
+		if (handoff->is_slot)
+		{
+			ring->held--;
+			AUDIO_RING_DMB();
+			ring->tail = (ring->held ? handoff->index + 1 : ring->next);
+		}
+	}
+	handoff = RING_HANDOFF(ring, ring->handoff_in);
+	ring->handoff_in++;
+	// anything queued?
+	if (ring->head == ring->next)
+	{
+		handoff->is_slot = 0;
+		ring->underruns++;
+		*size = ring->underrun_size;
+		return ring->underrun_data;
+	}
+	// read the index before the slot contents
+	AUDIO_RING_DMB();
+	slot = RING_SLOT(ring, ring->next);
+	handoff->index = ring->next;
+	handoff->is_slot = 1;
+	ring->next = ring->next + 1;
+	ring->held++;
+	ring->packets++;
+	// hand-off latency
+	latency = AUDIO_RING_NOW() - slot->stamp;
+	ring->last_latency = latency;
+	if (latency > ring->max_latency)
+	{
+		ring->max_latency = latency;
+	}
+	*size = slot->size;
+	return slot->data;
+}
+
+//-----------------------------------------------------------------------------
+// consumer: skip to the producer's head. The skipped slots go back to the
+// producer now unless the DCD still holds slots before them, in which case
+// they follow the last of those.
+void AudioRing_Flush(AudioRing* ring)
+{
+	ring->next = ring->head;
+	if (!ring->held)
+	{
+		AUDIO_RING_DMB();
+		ring->tail = ring->next;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void AudioRing_InitTimestamp(void)
+{
+#ifndef AUDIO_RING_HOST
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+#ifdef AUDIO_RING_SIM
+//-----------------------------------------------------------------------------
+// Linux harness. Simulated 8kHz SOF clock against a producer task that only
+// wakes every 125us-1ms and then commits every packet the capture DMA has
+// completed so far. The DCD holds 'depth' packets; none of them may be
+// back on the producer's side of the ring before it retires.
+// gcc -O2 -DAUDIO_RING_SIM audioring.c -o audioring_sim && ./audioring_sim [seed] [depth]
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIM_CHANNELS		48
+#define SIM_SAMPLES			6
+#define SIM_PACKET_BYTES	(SIM_CHANNELS * SIM_SAMPLES * 2)
+#define SIM_SLOTS			16
+#define SIM_PREFILL			8
+#define SIM_SOF_US			125
+#define SIM_SECONDS			600
+
+static uint32_t sim_now_us = 0;
+static uint8_t sim_storage[SIM_SLOTS * SIM_PACKET_BYTES];
+static AudioRingSlot sim_slots[SIM_SLOTS];
+static const uint8_t sim_silence[SIM_PACKET_BYTES] = { 0 };
+
+uint32_t AudioRing_HostNow(void)
+{
+	return sim_now_us;
+}
+
+int main(int argc, char** argv)
+{
+	AudioRing ring;
+	uint32_t sof = 0;
+	uint32_t frames = SIM_SECONDS * 8000;
+	uint32_t produced = 0;
+	uint32_t producer_due = 0;
+	uint32_t size = 0;
+	uint32_t depth = (argc > 2 ? (uint32_t) atoi(argv[2]) : 1);
+	// what the DCD holds, oldest first
+	const uint8_t* held[AUDIO_RING_MAX_DEPTH];
+	uint32_t held_count = 0;
+	uint32_t released = 0;
+	uint32_t i = 0;
+	AudioRing_Init(&ring, sim_slots, sim_storage, SIM_SLOTS, SIM_PACKET_BYTES,
+				   sim_silence, sizeof(sim_silence));
+	if (!AudioRing_SetDepth(&ring, depth))
+	{
+		printf("bad depth %u\n", depth);
+		return 1;
+	}
+	srand(argc > 1 ? atoi(argv[1]) : 1);
+	for (sof = 0; sof < frames; sof++)
+	{
+		// the DMA has completed 'sof' packets worth of capture by now
+		sim_now_us = sof * SIM_SOF_US;
+		if (sim_now_us >= producer_due)
+		{
+			while (produced < sof)
+			{
+				uint8_t* p = AudioRing_Acquire(&ring);
+				if (p == 0)
+				{
+					break;
+				}
+				memset(p, (int) produced, SIM_PACKET_BYTES);
+				AudioRing_Commit(&ring, SIM_PACKET_BYTES);
+				produced++;
+			}
+			producer_due = sim_now_us + SIM_SOF_US + (rand() % (7 * SIM_SOF_US));
+		}
+		// host starts streaming once the ring is primed
+		if (sof >= SIM_PREFILL)
+		{
+			// the oldest queued packet has gone out on the wire
+			if (held_count == depth)
+			{
+				memmove(held, held + 1, (depth - 1) * sizeof(held[0]));
+				held_count--;
+			}
+			held[held_count++] = AudioRing_NextPacket(&ring, &size);
+		}
+		// every slot the DCD holds must lie in [tail, head)
+		for (i = 0; i < held_count; i++)
+		{
+			if (held[i] != sim_silence)
+			{
+				uint32_t slot = (uint32_t) (held[i] - sim_storage) / SIM_PACKET_BYTES;
+				released += (((slot - ring.tail) & (SIM_SLOTS - 1)) >= ring.head - ring.tail);
+			}
+		}
+	}
+	printf("depth %u microframes %u packets %u underruns %u overruns %u max latency %u us, %u released in flight\n",
+		   depth, frames - SIM_PREFILL, ring.packets, ring.underruns, ring.overruns,
+		   ring.max_latency, released);
+	return (released != 0);
+}
+#endif
@@ -0,0 +1,138 @@
+/*
+
+	Lock-free single producer/single consumer ring of isochronous IN packets.
+
+	The producer (a task or a DMA ISR) fills whole USB packets of interleaved
+	multichannel frames. The consumer is the SOF/transfer-complete ISR, which
+	hands the slot pointer straight to the DCD (no copy). A slot handed to the
+	DCD stays 'in flight' for 'depth' further hand-offs, the number of dTDs
+	the DCD keeps queued (USB_ISO_DTDS), and is then returned to the
+	producer.
+
+	Nothing in here depends on the board so the ring can also be built on a
+	Linux host (see AUDIO_RING_HOST) with a simulated SOF clock.
+
+*/
+
+#ifndef AUDIORING_H
+#define AUDIORING_H
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// target or host build?
+#if defined(CORE_M4) || defined(CORE_M3)
+#include "board.h"
+#define AUDIO_RING_DMB()	__DMB()
+// DWT cycle counter. See AudioRing_InitTimestamp()
+#ifndef AUDIO_RING_NOW
+#define AUDIO_RING_NOW()	(DWT->CYCCNT)
+#endif
+#else
+#define AUDIO_RING_HOST 1
+#define AUDIO_RING_DMB()	__sync_synchronize()
+// host harness supplies the (simulated) clock
+#ifndef AUDIO_RING_NOW
+extern uint32_t AudioRing_HostNow(void);
+#define AUDIO_RING_NOW()	AudioRing_HostNow()
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// per packet slot bookkeeping
+typedef struct _AudioRingSlot
+{
+	// start of packet storage
+	uint8_t* data;
+	// bytes actually committed by the producer
+	uint32_t size;
+	// AUDIO_RING_NOW() at commit time
+	uint32_t stamp;
+} AudioRingSlot;
+
+// most hand-offs the DCD may hold at once. Power of 2
+#define AUDIO_RING_MAX_DEPTH	8
+
+//-----------------------------------------------------------------------------
+// one hand-off to the DCD, a slot or the underrun packet
+typedef struct _AudioRingHandoff
+{
+	uint32_t index;
+	uint32_t is_slot;
+} AudioRingHandoff;
+
+//-----------------------------------------------------------------------------
+// the ring. head is only written by the producer, tail, next and the
+// hand-off state only by the consumer. Indices free-run and are masked on use.
+typedef struct _AudioRing
+{
+	AudioRingSlot* slots;
+	// must be a power of 2
+	uint32_t slot_count;
+	// maximum bytes per slot
+	uint32_t slot_bytes;
+	// next slot the producer will fill
+	volatile uint32_t head;
+	// oldest slot not yet returned to the producer
+	volatile uint32_t tail;
+	// next slot the consumer will hand out. only touched by the consumer
+	uint32_t next;
+	// hand-offs the DCD still owns, oldest at handoff_out
+	AudioRingHandoff handoffs[AUDIO_RING_MAX_DEPTH];
+	uint32_t handoff_in;
+	uint32_t handoff_out;
+	// hand-offs the DCD holds before the oldest is returned, default 1
+	uint32_t depth;
+	// how many of them are slots
+	uint32_t held;
+	// packet returned when the ring runs dry (silence)
+	const uint8_t* underrun_data;
+	uint32_t underrun_size;
+	// statistics
+	volatile uint32_t underruns;
+	volatile uint32_t overruns;
+	volatile uint32_t packets;
+	// worst case commit -> hand-off latency in AUDIO_RING_NOW() ticks
+	volatile uint32_t max_latency;
+	volatile uint32_t last_latency;
+} AudioRing;
+
+//-----------------------------------------------------------------------------
+// storage is slot_count * slot_bytes. slots must have slot_count entries.
+extern int AudioRing_Init(AudioRing* ring, AudioRingSlot* slots, uint8_t* storage,
+						  uint32_t slot_count, uint32_t slot_bytes,
+						  const uint8_t* underrun_data, uint32_t underrun_size);
+extern void AudioRing_Reset(AudioRing* ring);
+// match the DCD's queue depth. Stream stopped only. Returns 0 if depth is
+// 0, over AUDIO_RING_MAX_DEPTH or leaves no slot for the producer.
+extern int AudioRing_SetDepth(AudioRing* ring, uint32_t depth);
+
+//-----------------------------------------------------------------------------
+// producer side. Acquire returns NULL (and counts an overrun) if full.
+extern uint8_t* AudioRing_Acquire(AudioRing* ring);
+extern void AudioRing_Commit(AudioRing* ring, uint32_t size);
+extern uint32_t AudioRing_Free(const AudioRing* ring);
+
+//-----------------------------------------------------------------------------
+// consumer side. Call once per SOF/ISO completion. Releases the packet
+// handed out 'depth' calls ago and returns the next one, or the underrun
+// packet if empty.
+extern const uint8_t* AudioRing_NextPacket(AudioRing* ring, uint32_t* size);
+extern uint32_t AudioRing_Used(const AudioRing* ring);
+// drop everything queued, i.e. after a format change. Consumer context. The
+// packets the DCD holds are released by later hand-offs as usual.
+extern void AudioRing_Flush(AudioRing* ring);
+
+//-----------------------------------------------------------------------------
+// enable the cycle counter used for latency stamps (target only)
+extern void AudioRing_InitTimestamp(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
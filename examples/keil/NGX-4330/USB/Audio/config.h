@@ -13,14 +13,22 @@
 // if 1 then we will set to full-speed (12MBS) 
 // if 0 then we run at default hispeed (480MBS)
 
+// streaming interface alternate settings, alt 1 first, each one
+// X(channels, bytes per sample). The host picks whichever fits the
+// bandwidth it has left. Descriptors.c lists only the sample rates each one
+// can carry in EP_SIZE_BYTES and will not build if one can't even do 48k.
+// CHANNEL_COUNT must be the widest.
+
 // Mac
 #if 1
 #define USE_FULL_SPEED 1
 #define CHANNEL_COUNT 6
+#define AUDIO_ALT_SETTINGS(X) X(6,3) X(6,2) X(2,3) X(2,2)
 #else
 // Windows/Linux
 #define USE_FULL_SPEED 0
-#define CHANNEL_COUNT 6
+#define CHANNEL_COUNT 48
+#define AUDIO_ALT_SETTINGS(X) X(48,3) X(48,2) X(24,3) X(24,2) X(16,3) X(8,3) X(8,2) X(2,3) X(2,2)
 #endif
 
 // the default is 12 channels ...
@@ -39,15 +47,43 @@
 
 // valid sizes are 2 and 3 for 16 and 24 bit respectively
 // do not change for purposes of resolving channel mask issue
+// only picks the ProductID now, the alt settings carry their own
 #define BYTES_PER_SAMPLE 2
 
-// sets the isoch endpoint size
-#define EP_SIZE_BYTES 1024
+// sets the isoch endpoint size, i.e. the largest packet any alt setting may
+// send. full-speed tops out at 1023. at high-speed anything over 1024 makes
+// the endpoint high-bandwidth, up to 3 transactions of 1024 a microframe, so
+// 3072 carries 48ch/24-bit at 96k or 16ch/24-bit at 192k. ring slots are
+// this size, mind the RAM
+#if USE_FULL_SPEED == 1
+#define EP_SIZE_BYTES 1023
+#else
+#define EP_SIZE_BYTES 3072
+#endif
+
+// number of isoch packets buffered between the audio producer and the SOF
+// hand-off. must be a power of 2. 16 = 2ms at high-speed, 16ms at full-speed
+#define AUDIO_RING_SLOTS 16
 
 // how many sample rates do we support?
 // we need this! if we fail to expose any user-configurable properties
 // then Window will never display an advanced tab in Sound applet ...
+// full-speed only has room for 44.1/48k at 6ch. at high-speed we go up to
+// 192k. AUDIO_MAX_SAMPLE_RATE is the highest one in the descriptor list and
+// sizes the ring slots. AudioInput.c will not build if it won't fit
+// EP_SIZE_BYTES, so drop it when adding channels.
+#if USE_FULL_SPEED == 1
 #define SUPPORTED_SAMPLE_RATES 2
+#define AUDIO_MAX_SAMPLE_RATE 48000
+#else
+#define SUPPORTED_SAMPLE_RATES 6
+#define AUDIO_MAX_SAMPLE_RATE 192000
+#endif
+
+// set to 1 to have AudioTask sleep until the USB ISR hands it a control
+// request. 0 polls USB_USBTask() flat out, as we used to. usbTaskStats
+// has the numbers for both
+#define USB_EVENT_MODE 1
 
 // set to 1 to use channel mask, set to 0 to zero it out
 #define USE_CHANNEL_MASK 0
@@ -0,0 +1,529 @@
+/*
+
+	Binary trace ring. See trace.h
+
+*/
+
+#include <string.h>
+#include "trace.h"
+
+//-----------------------------------------------------------------------------
+#define TRACE_MASK				(TRACE_RING_SIZE - 1)
+#define TRACE_EVENT_WORDS		9
+// largest string record we will emit, longer format strings are truncated
+#define TRACE_STRING_MAX		120
+
+// only a statistic, an ISR preempting another ISR's increment may lose one
+#if defined(TRACE_HOST)
+#define TRACE_COUNT_LOST(r)		__sync_fetch_and_add(&(r)->lost, 1)
+#else
+#define TRACE_COUNT_LOST(r)		((r)->lost++)
+#endif
+
+//-----------------------------------------------------------------------------
+TraceRing traceRing;
+
+//-----------------------------------------------------------------------------
+void Trace_Init(TraceRing* ring)
+{
+	memset(ring, 0, sizeof(TraceRing));
+#if !defined(TRACE_HOST) && !defined(CORE_M0)
+	// the M0 has no DWT, stamps read as 0 there unless TRACE_NOW is overridden
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void Trace_ResetDictionary(TraceRing* ring)
+{
+	memset((void*) ring->dict, 0, sizeof(ring->dict));
+}
+
+//-----------------------------------------------------------------------------
+// claim the next record. returns 0 if the ring is full
+static inline int Trace_Reserve(TraceRing* ring, uint32_t* index)
+{
+	uint32_t h = 0;
+#if defined(TRACE_HOST)
+	do
+	{
+		h = ring->head;
+		if (h - ring->tail >= TRACE_RING_SIZE)
+		{
+			return 0;
+		}
+	}
+	while (!__sync_bool_compare_and_swap(&ring->head, h, h + 1));
+#elif defined(CORE_M0)
+	// no exclusives on the M0
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	h = ring->head;
+	if (h - ring->tail >= TRACE_RING_SIZE)
+	{
+		__set_PRIMASK(primask);
+		return 0;
+	}
+	ring->head = h + 1;
+	__set_PRIMASK(primask);
+#else
+	do
+	{
+		h = __LDREXW(&ring->head);
+		if (h - ring->tail >= TRACE_RING_SIZE)
+		{
+			__CLREX();
+			return 0;
+		}
+	}
+	while (__STREXW(h + 1, &ring->head));
+#endif
+	*index = h;
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+void Trace_Write(TraceRing* ring, const char* file, uint32_t line, const char* fmt,
+				 uint32_t v1, uint32_t v2, uint32_t v3, uint32_t v4, uint32_t v5)
+{
+	uint32_t index = 0;
+	TraceRecord* r = 0;
+	if (!Trace_Reserve(ring, &index))
+	{
+		TRACE_COUNT_LOST(ring);
+		return;
+	}
+	r = &ring->records[index & TRACE_MASK];
+	r->stamp = TRACE_NOW();
+	r->fmt = fmt;
+	r->file = file;
+	r->line = line;
+	r->v[0] = v1;
+	r->v[1] = v2;
+	r->v[2] = v3;
+	r->v[3] = v4;
+	r->v[4] = v5;
+	// contents before the commit marker
+	TRACE_DMB();
+	r->seq = index + 1;
+}
+
+//-----------------------------------------------------------------------------
+// drain side encoding
+typedef struct _TraceOut
+{
+	uint8_t* buffer;
+	uint32_t size;
+	uint32_t used;
+	TraceSink sink;
+	void* context;
+} TraceOut;
+
+static void Trace_Flush(TraceOut* out)
+{
+	uint32_t sent = 0;
+	while (sent < out->used)
+	{
+		sent += out->sink(out->context, out->buffer + sent, out->used - sent);
+	}
+	out->used = 0;
+}
+
+static uint8_t* Trace_Room(TraceOut* out, uint32_t bytes)
+{
+	uint8_t* p = 0;
+	if (out->used + bytes > out->size)
+	{
+		Trace_Flush(out);
+	}
+	p = out->buffer + out->used;
+	out->used += bytes;
+	return p;
+}
+
+static uint8_t* Trace_PutWord(uint8_t* p, uint32_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+	p[2] = (uint8_t) (v >> 16);
+	p[3] = (uint8_t) (v >> 24);
+	return p + 4;
+}
+
+static uint8_t* Trace_PutHeader(uint8_t* p, uint8_t type, uint8_t words)
+{
+	p[0] = TRACE_SYNC;
+	p[1] = type;
+	p[2] = TRACE_CORE_ID;
+	p[3] = words;
+	return p + 4;
+}
+
+//-----------------------------------------------------------------------------
+// send the text for an ID the decoder has not seen yet
+static void Trace_Define(TraceRing* ring, TraceOut* out, const char* s)
+{
+	uint32_t slot = ((uint32_t) (uintptr_t) s >> 2) & (TRACE_DICT_SIZE - 1);
+	uint32_t length = 0;
+	uint32_t padded = 0;
+	uint8_t* p = 0;
+	if (s == 0 || ring->dict[slot] == s)
+	{
+		return;
+	}
+	while (length < TRACE_STRING_MAX && s[length])
+	{
+		length++;
+	}
+	// must fit the staging buffer in one piece
+	if (12 + length > out->size)
+	{
+		length = (out->size - 12) & ~3UL;
+	}
+	padded = (length + 3) & ~3UL;
+	p = Trace_Room(out, 12 + padded);
+	p = Trace_PutHeader(p, TRACE_WIRE_STRING, (uint8_t) (2 + padded / 4));
+	p = Trace_PutWord(p, (uint32_t) (uintptr_t) s);
+	p = Trace_PutWord(p, length);
+	memcpy(p, s, length);
+	memset(p + length, 0, padded - length);
+	ring->dict[slot] = s;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t Trace_Drain(TraceRing* ring, uint8_t* buffer, uint32_t buffer_size,
+					 TraceSink sink, void* context)
+{
+	TraceOut out = { 0 };
+	uint32_t count = 0;
+	uint32_t lost = ring->lost;
+	out.buffer = buffer;
+	out.size = buffer_size;
+	out.sink = sink;
+	out.context = context;
+	if (lost != ring->lost_sent)
+	{
+		uint8_t* p = Trace_Room(&out, 8);
+		p = Trace_PutHeader(p, TRACE_WIRE_LOST, 1);
+		Trace_PutWord(p, lost - ring->lost_sent);
+		ring->lost_sent = lost;
+	}
+	while (ring->tail != ring->head)
+	{
+		TraceRecord* r = &ring->records[ring->tail & TRACE_MASK];
+		TraceRecord copy;
+		uint8_t* p = 0;
+		uint32_t i = 0;
+		// reserved but the writer has not finished (or was preempted)
+		if (r->seq != ring->tail + 1)
+		{
+			break;
+		}
+		TRACE_DMB();
+		memcpy(&copy, r, sizeof(copy));
+		// slot contents read before it is handed back to the writers
+		TRACE_DMB();
+		ring->tail = ring->tail + 1;
+		Trace_Define(ring, &out, copy.fmt);
+		Trace_Define(ring, &out, copy.file);
+		p = Trace_Room(&out, 4 + TRACE_EVENT_WORDS * 4);
+		p = Trace_PutHeader(p, TRACE_WIRE_EVENT, TRACE_EVENT_WORDS);
+		p = Trace_PutWord(p, copy.stamp);
+		p = Trace_PutWord(p, (uint32_t) (uintptr_t) copy.fmt);
+		p = Trace_PutWord(p, (uint32_t) (uintptr_t) copy.file);
+		p = Trace_PutWord(p, copy.line);
+		for (i = 0; i < 5; i++)
+		{
+			p = Trace_PutWord(p, copy.v[i]);
+		}
+		count++;
+	}
+	if (out.used)
+	{
+		Trace_Flush(&out);
+	}
+	return count;
+}
+
+#ifdef TRACE_DECODE
+//-----------------------------------------------------------------------------
+// Host decoder. Reads a captured stream (UART/SPI/CDC dump) and prints it.
+// Format strings may only use integer conversions, each gets up to five
+// 32-bit arguments. Strings without a '%' print as 'label v1..v5' in hex.
+// gcc -O2 -DTRACE_DECODE trace.c -o tracedec -lpthread
+// ./tracedec [-f cpu_hz] < capture.bin
+// ./tracedec -t		stress test the ring with 4 writer threads and decode
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define DECODE_STRINGS		1024
+
+typedef struct _DecodeString
+{
+	uint32_t id;
+	char* text;
+} DecodeString;
+
+static DecodeString decode_strings[DECODE_STRINGS];
+static uint32_t decode_string_count = 0;
+static double decode_hz = 204000000.0;
+static uint32_t decode_last_stamp = 0;
+static uint32_t decode_events = 0;
+static uint32_t decode_lost = 0;
+static int decode_quiet = 0;
+
+// self test
+#define TEST_THREADS		4
+#define TEST_RECORDS		200000
+// per writer, the next record number we expect to decode
+static int64_t test_next[TEST_THREADS];
+static uint32_t test_order_errors = 0;
+
+static const char* Decode_Lookup(uint32_t id)
+{
+	uint32_t i = 0;
+	for (i = 0; i < decode_string_count; i++)
+	{
+		if (decode_strings[i].id == id)
+		{
+			return decode_strings[i].text;
+		}
+	}
+	return 0;
+}
+
+static void Decode_Define(uint32_t id, const uint8_t* text, uint32_t length)
+{
+	uint32_t i = 0;
+	for (i = 0; i < decode_string_count; i++)
+	{
+		if (decode_strings[i].id == id)
+		{
+			break;
+		}
+	}
+	if (i == DECODE_STRINGS)
+	{
+		return;
+	}
+	if (i == decode_string_count)
+	{
+		decode_string_count++;
+	}
+	free(decode_strings[i].text);
+	decode_strings[i].id = id;
+	decode_strings[i].text = (char*) malloc(length + 1);
+	memcpy(decode_strings[i].text, text, length);
+	decode_strings[i].text[length] = 0;
+}
+
+static uint32_t Decode_Word(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void Decode_Event(uint8_t core, const uint8_t* p)
+{
+	uint32_t stamp = Decode_Word(p);
+	const char* fmt = Decode_Lookup(Decode_Word(p + 4));
+	const char* file = Decode_Lookup(Decode_Word(p + 8));
+	uint32_t line = Decode_Word(p + 12);
+	uint32_t v[5];
+	uint32_t i = 0;
+	decode_events++;
+	if (decode_quiet)
+	{
+		// each writer's records must come out in order
+		uint32_t writer = Decode_Word(p + 16);
+		uint32_t record = Decode_Word(p + 20);
+		if (writer >= TEST_THREADS || (int64_t) record < test_next[writer])
+		{
+			test_order_errors++;
+		}
+		else
+		{
+			test_next[writer] = (int64_t) record + 1;
+		}
+		return;
+	}
+	for (i = 0; i < 5; i++)
+	{
+		v[i] = Decode_Word(p + 16 + i * 4);
+	}
+	printf("%u %10.3fus +%8.3fus ", core, stamp / decode_hz * 1e6,
+		   (uint32_t) (stamp - decode_last_stamp) / decode_hz * 1e6);
+	decode_last_stamp = stamp;
+	if (file)
+	{
+		printf("%s(%u) ", file, line);
+	}
+	if (fmt == 0)
+	{
+		printf("<id 0x%08X>", Decode_Word(p + 4));
+	}
+	else if (strchr(fmt, '%'))
+	{
+		printf(fmt, v[0], v[1], v[2], v[3], v[4]);
+	}
+	else
+	{
+		printf("%s 0x%X 0x%X 0x%X 0x%X 0x%X", fmt, v[0], v[1], v[2], v[3], v[4]);
+	}
+	printf("\n");
+}
+
+static void Decode_Stream(const uint8_t* data, uint32_t size)
+{
+	uint32_t pos = 0;
+	while (pos + 4 <= size)
+	{
+		uint8_t type = data[pos + 1];
+		uint32_t bytes = 4 + data[pos + 3] * 4;
+		// hunt for a plausible header, skips any text on the same port
+		if (data[pos] != TRACE_SYNC || type < TRACE_WIRE_EVENT || type > TRACE_WIRE_LOST)
+		{
+			pos++;
+			continue;
+		}
+		if (pos + bytes > size)
+		{
+			break;
+		}
+		switch (type)
+		{
+			case TRACE_WIRE_EVENT:
+				if (bytes == 4 + TRACE_EVENT_WORDS * 4)
+				{
+					Decode_Event(data[pos + 2], data + pos + 4);
+				}
+			break;
+			case TRACE_WIRE_STRING:
+				if (Decode_Word(data + pos + 8) <= bytes - 12)
+				{
+					Decode_Define(Decode_Word(data + pos + 4), data + pos + 12, Decode_Word(data + pos + 8));
+				}
+			break;
+			case TRACE_WIRE_LOST:
+				if (!decode_quiet)
+				{
+					printf("%u *** %u records lost\n", data[pos + 2], Decode_Word(data + pos + 4));
+				}
+				decode_lost += Decode_Word(data + pos + 4);
+			break;
+		}
+		pos += bytes;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// self test
+
+static uint8_t* test_capture = 0;
+static uint32_t test_capture_size = 0;
+static uint32_t test_capture_used = 0;
+static const char* test_fmt = "writer %u record %u";
+static volatile uint32_t test_done = 0;
+
+uint32_t Trace_HostNow(void)
+{
+	static volatile uint32_t now = 0;
+	return __sync_add_and_fetch(&now, 100);
+}
+
+static uint32_t Test_Sink(void* context, const uint8_t* data, uint32_t size)
+{
+	if (test_capture_used + size > test_capture_size)
+	{
+		test_capture_size = (test_capture_used + size) * 2;
+		test_capture = (uint8_t*) realloc(test_capture, test_capture_size);
+	}
+	memcpy(test_capture + test_capture_used, data, size);
+	test_capture_used += size;
+	return size;
+}
+
+static void* Test_Writer(void* arg)
+{
+	uint32_t id = (uint32_t) (uintptr_t) arg;
+	uint32_t i = 0;
+	for (i = 0; i < TEST_RECORDS; i++)
+	{
+		TRACE5(test_fmt, id, i, 0, 0, 0);
+		// roughly the burstiness of enumeration traffic
+		if ((i & 15) == 15)
+		{
+			sched_yield();
+		}
+	}
+	__sync_fetch_and_add(&test_done, 1);
+	return 0;
+}
+
+static int Test_Run(void)
+{
+	pthread_t threads[TEST_THREADS];
+	uint8_t buffer[256];
+	uint32_t drained = 0;
+	uint32_t i = 0;
+	Trace_Init(&traceRing);
+	for (i = 0; i < TEST_THREADS; i++)
+	{
+		pthread_create(&threads[i], 0, Test_Writer, (void*) (uintptr_t) i);
+	}
+	// drain while the writers are busy
+	while (test_done < TEST_THREADS)
+	{
+		drained += Trace_Drain(&traceRing, buffer, sizeof(buffer), Test_Sink, 0);
+	}
+	for (i = 0; i < TEST_THREADS; i++)
+	{
+		pthread_join(threads[i], 0);
+	}
+	drained += Trace_Drain(&traceRing, buffer, sizeof(buffer), Test_Sink, 0);
+	drained += Trace_Drain(&traceRing, buffer, sizeof(buffer), Test_Sink, 0);
+	decode_quiet = 1;
+	Decode_Stream(test_capture, test_capture_used);
+	printf("written %u drained %u decoded %u lost %u (ring %u) order errors %u %s\n",
+			TEST_THREADS * TEST_RECORDS, drained, decode_events, decode_lost, traceRing.lost,
+			test_order_errors,
+			(test_order_errors == 0 && drained == decode_events && drained + traceRing.lost == TEST_THREADS * TEST_RECORDS &&
+			 decode_lost == traceRing.lost) ? "ok" : "MISMATCH");
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	uint8_t* data = 0;
+	uint32_t size = 0;
+	uint32_t used = 0;
+	size_t n = 0;
+	int i = 0;
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-t") == 0)
+		{
+			return Test_Run();
+		}
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+		{
+			decode_hz = atof(argv[++i]);
+		}
+	}
+	do
+	{
+		if (used == size)
+		{
+			size = size ? size * 2 : 65536;
+			data = (uint8_t*) realloc(data, size);
+		}
+		n = fread(data + used, 1, size - used, stdin);
+		used += (uint32_t) n;
+	}
+	while (n > 0);
+	Decode_Stream(data, used);
+	return 0;
+}
+#endif
@@ -0,0 +1,145 @@
+/*
+
+	Binary trace ring.
+
+	Backs the Log* calls in logger.h. A trace point costs one slot reservation
+	(LDREX/STREX on the M3/M4, a PRIMASK section on the M0), a cycle counter
+	read and ten word stores. Nothing is formatted on the target: a record
+	carries the address of its format string as an ID and the drain side
+	sends each string once as a dictionary entry, so the host decoder
+	(see TRACE_DECODE in trace.c) can print it.
+
+	Any ISR or task may log. There is one ring per core and the drain runs
+	from a single task.
+
+	Wire format, all words little endian. Every record starts with a 4 byte
+	header so the decoder can resync if the stream is shared with text:
+
+		sync(0xA5) type core words
+
+	TRACE_WIRE_EVENT	stamp fmt_id file_id line v1 v2 v3 v4 v5
+	TRACE_WIRE_STRING	id length, then 'length' bytes padded to a word
+	TRACE_WIRE_LOST		count of records dropped because the ring was full
+
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// target or host build?
+#if defined(CORE_M4) || defined(CORE_M3) || defined(CORE_M0)
+#include "board.h"
+#define TRACE_DMB()			__DMB()
+#ifndef TRACE_NOW
+#define TRACE_NOW()			(DWT->CYCCNT)
+#endif
+#else
+#define TRACE_HOST 1
+#define TRACE_DMB()			__sync_synchronize()
+#ifndef TRACE_NOW
+extern uint32_t Trace_HostNow(void);
+#define TRACE_NOW()			Trace_HostNow()
+#endif
+#endif
+
+//-----------------------------------------------------------------------------
+// records per ring. Must be a power of 2
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE		128
+#endif
+
+// format strings remembered by the drain before they have to be resent
+#ifndef TRACE_DICT_SIZE
+#define TRACE_DICT_SIZE		64
+#endif
+
+// tags the records so the decoder can merge streams from both cores
+#ifndef TRACE_CORE_ID
+#if defined(CORE_M0)
+#define TRACE_CORE_ID		1
+#else
+#define TRACE_CORE_ID		0
+#endif
+#endif
+
+//-----------------------------------------------------------------------------
+#define TRACE_SYNC			0xA5
+#define TRACE_WIRE_EVENT	0x01
+#define TRACE_WIRE_STRING	0x02
+#define TRACE_WIRE_LOST		0x03
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// one trace point. seq is written last and is what tells the drain the
+// record is complete.
+typedef struct _TraceRecord
+{
+	volatile uint32_t seq;
+	uint32_t stamp;
+	const char* fmt;
+	const char* file;
+	uint32_t line;
+	uint32_t v[5];
+} TraceRecord;
+
+//-----------------------------------------------------------------------------
+// head is shared by all producers. tail and the dictionary belong to the
+// drain task.
+typedef struct _TraceRing
+{
+	TraceRecord records[TRACE_RING_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	// records dropped because the ring was full
+	volatile uint32_t lost;
+	uint32_t lost_sent;
+	// format string IDs the decoder has already seen
+	const char* dict[TRACE_DICT_SIZE];
+} TraceRing;
+
+//-----------------------------------------------------------------------------
+// drain output. Return the number of bytes accepted; the drain keeps calling
+// until everything is taken. UART, SPI or a CDC endpoint all fit.
+typedef uint32_t (*TraceSink)(void* context, const uint8_t* data, uint32_t size);
+
+//-----------------------------------------------------------------------------
+// this core's ring
+extern TraceRing traceRing;
+
+extern void Trace_Init(TraceRing* ring);
+
+//-----------------------------------------------------------------------------
+// ISR safe. fmt and file must point at strings that live for the life of the
+// image (literals or const tables) since only the address is recorded.
+extern void Trace_Write(TraceRing* ring, const char* file, uint32_t line, const char* fmt,
+						uint32_t v1, uint32_t v2, uint32_t v3, uint32_t v4, uint32_t v5);
+
+//-----------------------------------------------------------------------------
+// task context only. Encodes everything committed so far into 'buffer' in
+// bulk and passes it to sink. Returns the number of records sent. buffer
+// must hold at least one event (40 bytes), strings are cut to fit it.
+extern uint32_t Trace_Drain(TraceRing* ring, uint8_t* buffer, uint32_t buffer_size,
+							TraceSink sink, void* context);
+
+//-----------------------------------------------------------------------------
+// forget which strings have been sent, e.g. when a decoder (re)attaches
+extern void Trace_ResetDictionary(TraceRing* ring);
+
+//-----------------------------------------------------------------------------
+#define TRACE5(fmt,v1,v2,v3,v4,v5)	Trace_Write(&traceRing, __FILE__, __LINE__, (fmt), \
+											(uint32_t)(v1), (uint32_t)(v2), (uint32_t)(v3), \
+											(uint32_t)(v4), (uint32_t)(v5))
+#define TRACE3(fmt,v1,v2,v3)		TRACE5(fmt, v1, v2, v3, 0, 0)
+#define TRACE(fmt)					TRACE5(fmt, 0, 0, 0, 0, 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
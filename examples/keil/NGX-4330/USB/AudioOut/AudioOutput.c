@@ -44,6 +44,9 @@ USB_ClassInfo_Audio_Device_t Speaker_Audio_Interface = {
 
 		.DataOUTEndpointNumber    = AUDIO_STREAM_EPNUM,
 		.DataOUTEndpointSize      = AUDIO_STREAM_EPSIZE,
+#if USE_ASYNC_FEEDBACK
+		.DataFeedbackEndpointNumber = AUDIO_FEEDBACK_EPNUM,
+#endif
 		.PortNumber = 0,
 	},
 };
@@ -62,14 +65,23 @@ uint32_t CurrentAudioSampleFrequency = AUDIO_MAX_SAMPLE_FREQ;
 /**
  * Audio API
  */
-/** Audio max packet count. */
+/** Audio max packet count. With feedback the host tracks our clock so the
+ *  buffer only has to absorb scheduling jitter. */
+#if USE_ASYNC_FEEDBACK
+#define AUDIO_MAX_PC    3
+#else
 #define AUDIO_MAX_PC    10
+#endif
+/** 44.1kHz packets alternate 44/45 samples, keep whole stereo frames */
+#define AUDIO_44K1_BUFFER_SIZE	((441 * AUDIO_MAX_PC / 10) * 4)
 PRAGMA_ALIGN_4
 uint8_t audio_buffer[2048*2] ATTR_ALIGNED(4);
 uint32_t audio_buffer_size = 0;
 uint32_t audio_buffer_rd_index = 0;
 uint32_t audio_buffer_wr_index = 0;
 uint32_t audio_buffer_count = 0;
+/** Stereo frames clocked out of I2S since power up, sampled on SOF for the feedback endpoint */
+volatile uint32_t audio_samples_played = 0;
 
 typedef struct {
 	uint8_t BITRATE;
@@ -247,7 +259,7 @@ void Audio_Init(uint32_t samplefreq)
 		break;
 	case 44100:
 		I2S_SpeedConfig_index = 5;
-		audio_buffer_size = 1764;
+		audio_buffer_size = AUDIO_44K1_BUFFER_SIZE;
 		break;
 
 	case 8000:
@@ -285,7 +297,9 @@ void Audio_DeInit(void)
 void I2S0_IRQHandler(void)
 {
 	uint32_t txlevel, i;
+#if !USE_ASYNC_FEEDBACK
 	static bool double_speed = false;
+#endif
 	static uint32_t sample = 0;
 	txlevel = Chip_I2S_GetLevel(LPC_I2S0, I2S_TX_MODE);
 	if (txlevel <= 4) {
@@ -300,6 +314,8 @@ void I2S0_IRQHandler(void)
 			}
 			Chip_I2S_Send(LPC_I2S0, sample);
 		}
+		audio_samples_played += 8 - txlevel;
+#if !USE_ASYNC_FEEDBACK
 			/*Skip some samples if buffer run writting too fast. */
 		if(audio_buffer_size != 0)
  		{
@@ -319,6 +335,7 @@ void I2S0_IRQHandler(void)
 				}
  			}
  		}
+#endif
 	}
 }
 
@@ -370,6 +387,11 @@ uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t *last_p
 	if (EPNum == AUDIO_STREAM_EPNUM) {
 		return Audio_Get_ISO_Buffer_Address(*last_packet_size);
 	}
+#if USE_ASYNC_FEEDBACK
+	else if (EPNum == AUDIO_FEEDBACK_EPNUM) {
+		return Audio_Device_GetFeedbackBuffer(&Speaker_Audio_Interface, last_packet_size);
+	}
+#endif
 	else {return 0; }
 }
 
@@ -380,6 +402,7 @@ int main(void)
 {
 	Chip_I2S_Audio_Format_T audio_Confg;
 
+	Audio_Device_SetFeedbackRate(&Speaker_Audio_Interface, CurrentAudioSampleFrequency);
 	SetupHardware();
 
 	InitTimer();
@@ -460,8 +483,25 @@ void EVENT_Audio_Device_StreamStartStop(USB_ClassInfo_Audio_Device_t *const Audi
 {
 	/* reset audio buffer */
 	Audio_Reset_Data_Buffer();
+	/* and restart the rate estimate from nominal */
+	Audio_Device_SetFeedbackRate(AudioInterfaceInfo, CurrentAudioSampleFrequency);
 }
 
+#if USE_ASYNC_FEEDBACK
+/** Event handler for the library USB Start Of Frame event. Feeds the I2S consumption rate and the buffer
+ *  fill error (in stereo frames, relative to half full) to the feedback endpoint estimator.
+ */
+void EVENT_USB_Device_StartOfFrame(void)
+{
+	int32_t fill_error = 0;
+
+	if (audio_buffer_size != 0) {
+		fill_error = (int32_t) (audio_buffer_count / 4) - (int32_t) (audio_buffer_size / 8);
+	}
+	Audio_Device_FeedbackSOF(&Speaker_Audio_Interface, audio_samples_played, fill_error);
+}
+#endif
+
 /** Audio class driver callback for the setting and retrieval of streaming endpoint properties. This callback must be implemented
  *  in the user application to handle property manipulations on streaming audio endpoints.
  */
@@ -488,6 +528,7 @@ bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t *
 					}
 					Audio_DeInit();
 					Audio_Init(CurrentAudioSampleFrequency);
+					Audio_Device_SetFeedbackRate(&Speaker_Audio_Interface, CurrentAudioSampleFrequency);
 				}
 
 				return true;
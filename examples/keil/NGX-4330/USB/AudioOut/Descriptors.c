@@ -157,7 +157,7 @@ USB_Descriptor_Configuration_t ConfigurationDescriptor = {
 		.InterfaceNumber          = 1,
 		.AlternateSetting         = 1,
 
-		.TotalEndpoints           = 1,
+		.TotalEndpoints           = 1 + USE_ASYNC_FEEDBACK,
 
 		.Class                    = AUDIO_CSCP_AudioClass,
 		.SubClass                 = AUDIO_CSCP_AudioStreamingSubclass,
@@ -205,13 +205,21 @@ USB_Descriptor_Configuration_t ConfigurationDescriptor = {
 			.Header              = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
 
 			.EndpointAddress     = (ENDPOINT_DIR_OUT | AUDIO_STREAM_EPNUM),
+#if USE_ASYNC_FEEDBACK
+			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_ASYNC | ENDPOINT_USAGE_DATA),
+#else
 			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_SYNC | ENDPOINT_USAGE_DATA),
+#endif
 			.EndpointSize        = AUDIO_STREAM_EPSIZE,
 			.PollingIntervalMS   = 0x01
 		},
 
 		.Refresh                  = 0,
+#if USE_ASYNC_FEEDBACK
+		.SyncEndpointNumber       = (ENDPOINT_DIR_IN | AUDIO_FEEDBACK_EPNUM)
+#else
 		.SyncEndpointNumber       = 0
+#endif
 	},
 
 	.Audio_StreamEndpoint_SPC = {
@@ -224,6 +232,22 @@ USB_Descriptor_Configuration_t ConfigurationDescriptor = {
 		.LockDelayUnits           = 0x00,
 		.LockDelay                = 0x0000
 	},
+#if USE_ASYNC_FEEDBACK
+	.Audio_FeedbackEndpoint = {
+		.Endpoint = {
+			.Header              = {.Size = sizeof(USB_Audio_Descriptor_StreamEndpoint_Std_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress     = (ENDPOINT_DIR_IN | AUDIO_FEEDBACK_EPNUM),
+			.Attributes          = (EP_TYPE_ISOCHRONOUS | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_FEEDBACK),
+			.EndpointSize        = AUDIO_FEEDBACK_EPSIZE_HS,
+			.PollingIntervalMS   = 0x01
+		},
+
+		/* host polls every 2^Refresh ms */
+		.Refresh                  = 3,
+		.SyncEndpointNumber       = 0
+	},
+#endif
 	.Audio_Termination = 0x00
 };
 
@@ -313,6 +337,11 @@ uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum,
 		break;
 
 	case DTYPE_Configuration:
+#if USE_ASYNC_FEEDBACK
+		/* Must match the packet Audio_Device_GetFeedbackBuffer() sends at this bus speed */
+		ConfigurationDescriptor.Audio_FeedbackEndpoint.Endpoint.EndpointSize =
+			USB_Device_IsHighSpeed(corenum) ? AUDIO_FEEDBACK_EPSIZE_HS : AUDIO_FEEDBACK_EPSIZE_FS;
+#endif
 		Address = &ConfigurationDescriptor;
 		Size    = sizeof(USB_Descriptor_Configuration_t);
 		break;
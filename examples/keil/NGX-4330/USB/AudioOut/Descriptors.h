@@ -58,6 +58,18 @@ extern "C" {
  */
 		#define AUDIO_STREAM_EPSIZE          ENDPOINT_MAX_SIZE(AUDIO_STREAM_EPNUM)
 
+/**
+ * @brief Endpoint number and sizes of the asynchronous feedback endpoint. 3 bytes (10.14) are sent at
+ *        full-speed and 4 bytes (16.16) at high-speed; the descriptor is patched for the bus speed.
+ */
+		#if defined(__LPC17XX__) || defined(__LPC177X_8X__)
+			#define AUDIO_FEEDBACK_EPNUM         6
+		#else
+			#define AUDIO_FEEDBACK_EPNUM         2
+		#endif
+		#define AUDIO_FEEDBACK_EPSIZE_FS     3
+		#define AUDIO_FEEDBACK_EPSIZE_HS     4
+
 /** @brief	Type define for the device configuration descriptor structure. This must be defined in the
  *          application code, as the configuration descriptor contains several sub-descriptors which
  *          vary between devices, and which describe the device's usage to the host.
@@ -79,6 +91,9 @@ typedef struct {
 	USB_Audio_SampleFreq_t                    Audio_AudioFormatSampleRates[5];
 	USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_StreamEndpoint;
 	USB_Audio_Descriptor_StreamEndpoint_Spc_t Audio_StreamEndpoint_SPC;
+#if USE_ASYNC_FEEDBACK
+	USB_Audio_Descriptor_StreamEndpoint_Std_t Audio_FeedbackEndpoint;
+#endif
 	unsigned char                             Audio_Termination;
 } USB_Descriptor_Configuration_t;
 
@@ -10,6 +10,12 @@
 
 #define CHANNELS 4
 
+// 1: asynchronous OUT endpoint with an explicit feedback endpoint. The I2S
+// clock free-runs and the host is told how fast we consume samples, so the
+// buffer can be kept a few packets deep.
+// 0: adaptive. Speed up/slow down the I2S dividers from the buffer level.
+#define USE_ASYNC_FEEDBACK 1
+
 
 #endif
 
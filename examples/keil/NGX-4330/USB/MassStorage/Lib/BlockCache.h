@@ -0,0 +1,149 @@
+/*
+ * @brief Header file for BlockCache.c
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+/** @file
+ *  Header file for BlockCache.c.
+ */
+
+#ifndef __BLOCK_CACHE_H_
+#define __BLOCK_CACHE_H_
+
+#include "../MassStorage.h"
+#include "DataRam.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @defgroup Mass_Storage_Device_BlockCache Write-back block cache
+ * @ingroup USB_Mass_Storage_Device_18xx43xx USB_Mass_Storage_Device_17xx40xx
+ * @{
+ */
+
+#if (MSC_CACHE_PAGE_BLOCKS > 32)
+	#error MSC_CACHE_PAGE_BLOCKS must not exceed 32 blocks.
+#endif
+
+/** Type of the media callbacks the cache reads and writes through. Buffer holds TotalBlocks blocks of
+ *  VIRTUAL_MEMORY_BLOCK_SIZE bytes starting at BlockAddress. Return true on success.
+ */
+typedef bool (*BlockCache_Media_t)(uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks);
+
+/** Cache statistics, counted in blocks unless noted. Host writes minus MediaBlocksWritten are the writes the cache
+ *  absorbed; MediaBlocksWritten / MediaWrites is the average coalesced write length.
+ */
+typedef struct {
+	uint32_t ReadHits;				/**< Blocks the host read that were in the cache */
+	uint32_t ReadMisses;			/**< Blocks the host read that had to come from the media */
+	uint32_t WriteHits;				/**< Blocks the host wrote over a block already in the cache */
+	uint32_t WriteMisses;			/**< Blocks the host wrote that needed a new entry */
+	uint32_t Evictions;				/**< Dirty pages written back to make room for others */
+	uint32_t Flushes;				/**< Flush requests (SYNCHRONIZE CACHE, eject, idle) that found dirty data */
+	uint32_t MediaWrites;			/**< Write calls made to the media */
+	uint32_t MediaBlocksWritten;	/**< Blocks those calls wrote */
+	uint32_t MediaErrors;			/**< Media calls that failed */
+} BlockCache_Stats_t;
+
+/** @brief	Empties the cache and sets the media it sits in front of.
+ *
+ *  @param	Read :  Media read callback
+ *  @param	Write :  Media write callback
+ *  @param	Data :  MSC_CACHE_LINES * MSC_CACHE_PAGE_BLOCKS blocks of memory for the cached data
+ *  @param	Staging :  Buffer of StagingBlocks blocks the cache gathers coalesced writes and page reads in. Must not
+ *                     be a buffer the caller passes to @ref BlockCache_Read() or @ref BlockCache_Write()
+ *  @param	StagingBlocks :  Size of Staging in blocks, at least MSC_CACHE_PAGE_BLOCKS
+ *  @return	Nothing
+ */
+void BlockCache_Init(BlockCache_Media_t Read, BlockCache_Media_t Write, uint8_t *Data, uint8_t *Staging, uint32_t StagingBlocks);
+
+/** @brief	Reads blocks through the cache. Missing blocks are read a whole page at a time and kept.
+ *
+ *  @param	Buffer :  Receives TotalBlocks blocks
+ *  @param	BlockAddress :  First block to read
+ *  @param	TotalBlocks :  Number of blocks to read
+ *  @return	false if a media read (or a write back needed to make room) failed
+ */
+bool BlockCache_Read(uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks);
+
+/** @brief	Writes blocks into the cache. They reach the media when their page is evicted or the cache flushed.
+ *
+ *  @param	Buffer :  TotalBlocks blocks of data
+ *  @param	BlockAddress :  First block to write
+ *  @param	TotalBlocks :  Number of blocks to write
+ *  @return	false if a write back needed to make room failed
+ */
+bool BlockCache_Write(const uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks);
+
+/** @brief	Writes back the dirty blocks in a range, so the media can be read directly.
+ *
+ *  @param	BlockAddress :  First block of the range
+ *  @param	TotalBlocks :  Number of blocks in the range
+ *  @return	false if a media write failed
+ */
+bool BlockCache_FlushRange(uint32_t BlockAddress, uint32_t TotalBlocks);
+
+/** @brief	Drops the cached copies of a range, for blocks about to be written to the media directly.
+ *
+ *  @param	BlockAddress :  First block of the range
+ *  @param	TotalBlocks :  Number of blocks in the range
+ *  @return	Nothing
+ */
+void BlockCache_Discard(uint32_t BlockAddress, uint32_t TotalBlocks);
+
+/** @brief	Writes back every dirty block, contiguous runs in one media write each.
+ *
+ *  @return	false if a media write failed
+ */
+bool BlockCache_Flush(void);
+
+/** @brief	Flushes the cache once it has held dirty data for MSC_CACHE_IDLE_MS without another write. Call from
+ *          the main loop.
+ *
+ *  @param	NowMs :  Free running millisecond count
+ *  @return	Nothing
+ */
+void BlockCache_Task(uint32_t NowMs);
+
+/** @brief	Returns the cache statistics.
+ *
+ *  @return	Pointer to the statistics, updated in place
+ */
+const BlockCache_Stats_t *BlockCache_GetStats(void);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLOCK_CACHE_H_ */
@@ -80,14 +80,49 @@ static SCSI_Request_Sense_Response_t SenseData = {
 	.AdditionalLength    = 0x0A,
 };
 
-/** Under development, not working yet. */
 #ifdef CFG_SDCARD
-uint8_t *disk_cache = (uint8_t *) 0x20000000;
+/** SD card data is staged in two chunk sized halves of the AHB SRAM bank, so the card can fill (or drain) one
+ *  while the USB controller moves the other. */
+static uint8_t *const disk_cache[2] = {
+	(uint8_t *) 0x20000000,
+	(uint8_t *) 0x20000000 + MSC_SD_CHUNK_BLOCKS * VIRTUAL_MEMORY_BLOCK_SIZE,
+};
+
 static uint32_t MSC_Get_Block_Count(void)
 {
 	return (uint32_t) Chip_SDMMC_GetDeviceBlocks(LPC_SDMMC);
 }
 
+#if (MSC_CACHE_LINES > 0)
+#if (MSC_CACHE_MAX_BLOCKS > MSC_SD_CHUNK_BLOCKS) || (MSC_CACHE_PAGE_BLOCKS > MSC_SD_CHUNK_BLOCKS)
+	#error Cached reads and writes and cache pages must fit a disk_cache half.
+#endif
+#if (MSC_CACHE_LINES * MSC_CACHE_PAGE_BLOCKS) > 64
+	#error The cache pages must fit the AHB SRAM left after disk_cache, at most 64 blocks.
+#endif
+
+/** The write-back cache's pages follow disk_cache in the AHB SRAM bank. */
+#define SD_CACHE_DATA   ((uint8_t *) 0x20000000 + 2 * MSC_SD_CHUNK_BLOCKS * VIRTUAL_MEMORY_BLOCK_SIZE)
+
+/* Media callbacks of the write-back cache */
+static bool SD_ReadBlocks(uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	return Chip_SDMMC_ReadBlocks(LPC_SDMMC, Buffer, BlockAddress, TotalBlocks) != 0;
+}
+
+static bool SD_WriteBlocks(uint8_t *Buffer, uint32_t BlockAddress, uint32_t TotalBlocks)
+{
+	return Chip_SDMMC_WriteBlocks(LPC_SDMMC, Buffer, BlockAddress, TotalBlocks) != 0;
+}
+
+#endif
+
+#else
+static uint32_t MSC_Get_Block_Count(void)
+{
+	return LUN_MEDIA_BLOCKS;
+}
+
 #endif
 
 /*****************************************************************************
@@ -98,6 +133,17 @@ static uint32_t MSC_Get_Block_Count(void)
  * Public functions
  ****************************************************************************/
 
+/** Sets up the SCSI layer's media handling. With an SD card this empties the write-back cache and puts it in front of
+ *  the card, so it must run after the card has been acquired.
+ */
+void SCSI_Init(void)
+{
+#if defined(CFG_SDCARD) && (MSC_CACHE_LINES > 0)
+	/* disk_cache[1] is free whenever the cache runs, see SCSI_SD_CachedRead() */
+	BlockCache_Init(SD_ReadBlocks, SD_WriteBlocks, SD_CACHE_DATA, disk_cache[1], MSC_SD_CHUNK_BLOCKS);
+#endif
+}
+
 /** Main routine to process the SCSI command located in the Command Block Wrapper read from the host. This dispatches
  *  to the appropriate SCSI command handling routine if the issued command is supported by the device, else it returns
  *  a command failure due to a ILLEGAL REQUEST.
@@ -120,6 +166,10 @@ bool SCSI_DecodeSCSICommand(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
 		CommandSuccess = SCSI_Command_Read_Capacity_10(MSInterfaceInfo);
 		break;
 
+	case SCSI_CMD_SERVICE_ACTION_IN_16:
+		CommandSuccess = SCSI_Command_Read_Capacity_16(MSInterfaceInfo);
+		break;
+
 	case SCSI_CMD_SEND_DIAGNOSTIC:
 		CommandSuccess = SCSI_Command_Send_Diagnostic(MSInterfaceInfo);
 		break;
@@ -132,12 +182,25 @@ bool SCSI_DecodeSCSICommand(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
 		CommandSuccess = SCSI_Command_ReadWrite_10(MSInterfaceInfo, DATA_READ);
 		break;
 
+	case SCSI_CMD_WRITE_16:
+		CommandSuccess = SCSI_Command_ReadWrite_16(MSInterfaceInfo, DATA_WRITE);
+		break;
+
+	case SCSI_CMD_READ_16:
+		CommandSuccess = SCSI_Command_ReadWrite_16(MSInterfaceInfo, DATA_READ);
+		break;
+
 	case SCSI_CMD_MODE_SENSE_6:
 		CommandSuccess = SCSI_Command_ModeSense_6(MSInterfaceInfo);
 		break;
 
-	case SCSI_CMD_TEST_UNIT_READY:
+	case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+	case SCSI_CMD_START_STOP_UNIT:
 	case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+		CommandSuccess = SCSI_Command_Synchronize_Cache(MSInterfaceInfo);
+		break;
+
+	case SCSI_CMD_TEST_UNIT_READY:
 	case SCSI_CMD_VERIFY_10:
 		/* These commands should just succeed, no handling required */
 		CommandSuccess = true;
@@ -220,12 +283,7 @@ static bool SCSI_Command_Request_Sense(USB_ClassInfo_MS_Device_t *const MSInterf
  */
 static bool SCSI_Command_Read_Capacity_10(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
 {
-	/** Under development, not working yet. */
-#ifdef CFG_SDCARD
 	uint32_t LastBlockAddressInLUN = MSC_Get_Block_Count() - 1;
-#else
-	uint32_t LastBlockAddressInLUN = (LUN_MEDIA_BLOCKS - 1);
-#endif
 	uint32_t MediaBlockSize        = VIRTUAL_MEMORY_BLOCK_SIZE;
 
 	Endpoint_Write_Stream_BE(MSInterfaceInfo->Config.PortNumber,
@@ -241,6 +299,45 @@ static bool SCSI_Command_Read_Capacity_10(USB_ClassInfo_MS_Device_t *const MSInt
 	return true;
 }
 
+/** Command processing for an issued SCSI READ CAPACITY (16) command, the SERVICE ACTION IN (16) a host switches to
+ *  when the last block address does not fit READ CAPACITY (10). Returns the 64-bit last block address and the block
+ *  size; protection and provisioning fields are all zero.
+ */
+static bool SCSI_Command_Read_Capacity_16(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+	const uint8_t *CommandData     = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+	uint32_t AllocationLength      = ((uint32_t) CommandData[10] << 24) + ((uint32_t) CommandData[11] << 16) +
+									 ((uint32_t) CommandData[12] << 8) + CommandData[13];
+	uint64_t LastBlockAddressInLUN = (uint64_t) MSC_Get_Block_Count() - 1;
+	uint8_t  Response[32];
+	uint16_t BytesTransferred      = MIN(AllocationLength, sizeof(Response));
+	uint8_t  i;
+
+	/* READ CAPACITY (16) is the only SERVICE ACTION IN (16) supported */
+	if ((CommandData[1] & 0x1F) != SCSI_SERVICE_ACTION_READ_CAPACITY_16) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_ILLEGAL_REQUEST,
+					   SCSI_ASENSE_INVALID_COMMAND,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+
+		return false;
+	}
+
+	memset(Response, 0, sizeof(Response));
+	for (i = 0; i < 8; i++) {
+		Response[i] = (uint8_t) (LastBlockAddressInLUN >> (56 - 8 * i));
+	}
+	Response[10] = (uint8_t) (VIRTUAL_MEMORY_BLOCK_SIZE >> 8);
+	Response[11] = (uint8_t) VIRTUAL_MEMORY_BLOCK_SIZE;
+
+	Endpoint_Write_Stream_LE(MSInterfaceInfo->Config.PortNumber, Response, BytesTransferred, NULL);
+	Endpoint_ClearIN(MSInterfaceInfo->Config.PortNumber);
+
+	/* Succeed the command and update the bytes transferred counter */
+	MSInterfaceInfo->State.CommandBlock.DataTransferLength -= BytesTransferred;
+
+	return true;
+}
+
 /** Command processing for an issued SCSI SEND DIAGNOSTIC command. This command performs a quick check of the Dataflash ICs on the
  *  board, and indicates if they are present and functioning correctly. Only the Self-Test portion of the diagnostic command is
  *  supported.
@@ -262,15 +359,226 @@ static bool SCSI_Command_Send_Diagnostic(USB_ClassInfo_MS_Device_t *const MSInte
 	return true;
 }
 
-/** Command processing for an issued SCSI READ (10) or WRITE (10) command. This command reads in the block start address
- *  and total number of blocks to process, then calls the appropriate low-level Dataflash routine to handle the actual
- *  reading and writing of the data.
+#ifdef CFG_SDCARD
+/** Waits for one of the SD pipeline's USB transfers, if it was started, and counts the bytes it moved. */
+static bool SCSI_SD_CompleteTransfer(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									 const uint8_t EndpointAddress,
+									 Endpoint_Transfer_t *const Transfer)
+{
+	bool Success;
+
+	if (Transfer->Status == ENDPOINT_XFER_Idle) {
+		return true;
+	}
+
+	Success = (Endpoint_WaitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, Transfer) == ENDPOINT_RWSTREAM_NoError) &&
+			  (Transfer->Actual == Transfer->Length);
+	MSInterfaceInfo->State.CommandBlock.DataTransferLength -= Transfer->Actual;
+	Transfer->Status = ENDPOINT_XFER_Idle;
+
+	return Success;
+}
+
+/** Reads from the SD card to the host a chunk at a time. While the controller sends one half of disk_cache the card
+ *  reads the next chunk into the other, so the slower of the two sets the pace rather than their sum.
  */
-static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
-									  const bool IsDataRead)
+static bool SCSI_SD_Read(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						 uint32_t BlockAddress,
+						 uint32_t TotalBlocks)
 {
-	uint32_t BlockAddress;
-	uint16_t TotalBlocks;
+	const uint8_t EndpointAddress = MSInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN;
+	Endpoint_Transfer_t Transfer[2];
+	uint32_t Blocks = MIN(TotalBlocks, MSC_SD_CHUNK_BLOCKS);
+	uint8_t  Half   = 0;
+	bool     CardOK = true;
+	bool     USBOK  = true;
+
+	memset(Transfer, 0, sizeof(Transfer));
+
+	CardOK = (Chip_SDMMC_ReadBlocks(LPC_SDMMC, disk_cache[0], BlockAddress, Blocks) != 0);
+	while (CardOK && USBOK && Blocks) {
+		Transfer[Half].Buffer = disk_cache[Half];
+		Transfer[Half].Length = Blocks * VIRTUAL_MEMORY_BLOCK_SIZE;
+		if (Endpoint_SubmitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, &Transfer[Half]) != ENDPOINT_RWSTREAM_NoError) {
+			USBOK = false;
+			break;
+		}
+
+		BlockAddress += Blocks;
+		TotalBlocks  -= Blocks;
+		Blocks        = MIN(TotalBlocks, MSC_SD_CHUNK_BLOCKS);
+		Half         ^= 1;
+
+		/* The other half is free again once the chunk before last has gone out */
+		USBOK = SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer[Half]);
+		if (USBOK && Blocks) {
+			CardOK = (Chip_SDMMC_ReadBlocks(LPC_SDMMC, disk_cache[Half], BlockAddress, Blocks) != 0);
+		}
+	}
+	USBOK &= SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer[Half ^ 1]);
+
+	if (!CardOK) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+					   SCSI_ASENSE_UNRECOVERED_READ_ERROR,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+	}
+
+	return CardOK && USBOK;
+}
+
+/** Writes from the host to the SD card a chunk at a time. While the card writes one half of disk_cache the controller
+ *  receives the next chunk into the other. After a card error the rest of the data is still received, and dropped, so
+ *  the host gets a failed status rather than a stalled transfer.
+ */
+static bool SCSI_SD_Write(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						  uint32_t BlockAddress,
+						  uint32_t TotalBlocks)
+{
+	const uint8_t EndpointAddress = MSInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT;
+	Endpoint_Transfer_t Transfer[2];
+	uint32_t Blocks = MIN(TotalBlocks, MSC_SD_CHUNK_BLOCKS);
+	uint32_t NextBlocks;
+	uint8_t  Half   = 0;
+	bool     CardOK = true;
+	bool     USBOK  = true;
+
+	memset(Transfer, 0, sizeof(Transfer));
+
+	Transfer[0].Buffer = disk_cache[0];
+	Transfer[0].Length = Blocks * VIRTUAL_MEMORY_BLOCK_SIZE;
+	USBOK = (Endpoint_SubmitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, &Transfer[0]) == ENDPOINT_RWSTREAM_NoError);
+	while (USBOK && Blocks) {
+		USBOK = SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer[Half]);
+		if (!USBOK) {
+			break;
+		}
+
+		/* Start receiving the next chunk before the card is busy with this one */
+		NextBlocks = MIN(TotalBlocks - Blocks, MSC_SD_CHUNK_BLOCKS);
+		if (NextBlocks) {
+			Transfer[Half ^ 1].Buffer = disk_cache[Half ^ 1];
+			Transfer[Half ^ 1].Length = NextBlocks * VIRTUAL_MEMORY_BLOCK_SIZE;
+			USBOK = (Endpoint_SubmitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, &Transfer[Half ^ 1]) == ENDPOINT_RWSTREAM_NoError);
+		}
+
+		if (CardOK) {
+			CardOK = (Chip_SDMMC_WriteBlocks(LPC_SDMMC, disk_cache[Half], BlockAddress, Blocks) != 0);
+		}
+
+		BlockAddress += Blocks;
+		TotalBlocks  -= Blocks;
+		Blocks        = NextBlocks;
+		Half         ^= 1;
+	}
+	USBOK &= SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer[Half]);
+
+	if (!CardOK) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+					   SCSI_ASENSE_WRITE_ERROR,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+	}
+
+	return CardOK && USBOK;
+}
+
+#if (MSC_CACHE_LINES > 0)
+/** Reads a few blocks, too few to be worth pipelining, through the write-back cache into disk_cache[0] and sends them.
+ *  These are mostly the FAT and directory blocks a host keeps going back to. The cache uses disk_cache[1] to stage its
+ *  own card accesses.
+ */
+static bool SCSI_SD_CachedRead(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+							   uint32_t BlockAddress,
+							   uint32_t TotalBlocks)
+{
+	const uint8_t EndpointAddress = MSInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN;
+	Endpoint_Transfer_t Transfer;
+
+	memset(&Transfer, 0, sizeof(Transfer));
+
+	if (!BlockCache_Read(disk_cache[0], BlockAddress, TotalBlocks)) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+					   SCSI_ASENSE_UNRECOVERED_READ_ERROR,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+
+		return false;
+	}
+
+	Transfer.Buffer = disk_cache[0];
+	Transfer.Length = TotalBlocks * VIRTUAL_MEMORY_BLOCK_SIZE;
+	if (Endpoint_SubmitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, &Transfer) != ENDPOINT_RWSTREAM_NoError) {
+		return false;
+	}
+
+	return SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer);
+}
+
+/** Receives a few blocks into disk_cache[0] and leaves them in the write-back cache. They reach the card when their
+ *  page is evicted or the cache is flushed, by which time a host updating the same FAT block over and over has usually
+ *  rewritten them several times.
+ */
+static bool SCSI_SD_CachedWrite(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								uint32_t BlockAddress,
+								uint32_t TotalBlocks)
+{
+	const uint8_t EndpointAddress = MSInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT;
+	Endpoint_Transfer_t Transfer;
+
+	memset(&Transfer, 0, sizeof(Transfer));
+
+	Transfer.Buffer = disk_cache[0];
+	Transfer.Length = TotalBlocks * VIRTUAL_MEMORY_BLOCK_SIZE;
+	if ((Endpoint_SubmitTransfer(MSInterfaceInfo->Config.PortNumber, EndpointAddress, &Transfer) != ENDPOINT_RWSTREAM_NoError) ||
+		!SCSI_SD_CompleteTransfer(MSInterfaceInfo, EndpointAddress, &Transfer)) {
+		return false;
+	}
+
+	/* Making room may have written back other pages; a failure there is reported against this command */
+	if (!BlockCache_Write(disk_cache[0], BlockAddress, TotalBlocks)) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+					   SCSI_ASENSE_WRITE_ERROR,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+
+		return false;
+	}
+
+	return true;
+}
+
+#endif
+
+#endif
+
+/** Command processing for an issued SCSI SYNCHRONIZE CACHE (10), START STOP UNIT or PREVENT ALLOW MEDIUM REMOVAL command.
+ *  Each of them can mean the host is about to let go of the medium, so whatever the write-back cache holds is written to
+ *  the card before the command completes. Only the whole cache is flushed, the range of a SYNCHRONIZE CACHE is ignored.
+ */
+static bool SCSI_Command_Synchronize_Cache(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
+{
+#if defined(CFG_SDCARD) && (MSC_CACHE_LINES > 0)
+	if (!BlockCache_Flush()) {
+		SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+					   SCSI_ASENSE_WRITE_ERROR,
+					   SCSI_ASENSEQ_NO_QUALIFIER);
+
+		return false;
+	}
+#endif
+
+	/* Succeed the command and update the bytes transferred counter */
+	MSInterfaceInfo->State.CommandBlock.DataTransferLength = 0;
+
+	return true;
+}
+
+/** Common part of the SCSI READ and WRITE commands once the block address and count are decoded from the (10) or (16)
+ *  byte command block: checks the range and calls the appropriate low-level routine to move the data.
+ */
+static bool SCSI_Command_ReadWrite(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								   const bool IsDataRead,
+								   uint64_t BlockAddress,
+								   uint32_t TotalBlocks)
+{
+	uint64_t BlockCount = MSC_Get_Block_Count();
 
 	/* Check if the disk is write protected or not */
 	if ((IsDataRead == DATA_WRITE) && DISK_READ_ONLY) {
@@ -282,27 +590,8 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfa
 		return false;
 	}
 
-	/* Load in the 32-bit block address (SCSI uses big-endian, so have to reverse the byte order) */
-	BlockAddress =
-		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[2] <<
-		 24) + (MSInterfaceInfo->State.CommandBlock.SCSICommandData[3] << 16) +
-		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[4] <<
-		 8) + MSInterfaceInfo->State.CommandBlock.SCSICommandData[5];
-
-	/* Load in the 16-bit total blocks (SCSI uses big-endian, so have to reverse the byte order) */
-	TotalBlocks  =
-		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[7] <<
-		 8) + MSInterfaceInfo->State.CommandBlock.SCSICommandData[8];
-
-	/* Check if the block address is outside the maximum allowable value for the LUN */
-
-	/** Under development, not working yet. */
-#ifdef CFG_SDCARD
-	if (BlockAddress >= MSC_Get_Block_Count())
-#else
-	if (BlockAddress >= LUN_MEDIA_BLOCKS)
-#endif
-	{
+	/* Check if the block range is outside the maximum allowable value for the LUN */
+	if ((BlockAddress >= BlockCount) || (TotalBlocks > BlockCount - BlockAddress)) {
 		/* Block address is invalid, update SENSE key and return command fail */
 		SCSI_SET_SENSE(SCSI_SENSE_KEY_ILLEGAL_REQUEST,
 					   SCSI_ASENSE_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
@@ -311,37 +600,54 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfa
 		return false;
 	}
 
+	/* A transfer length of zero moves no data and is not an error */
+	if (TotalBlocks == 0) {
+		return true;
+	}
+
 	#if (TOTAL_LUNS > 1)
 	/* Adjust the given block address to the real media address based on the selected LUN */
 	BlockAddress += ((uint32_t) MSInterfaceInfo->State.CommandBlock.LUN * LUN_MEDIA_BLOCKS);
 	#endif
 
-	/** Under development, not working yet. */
 #ifdef CFG_SDCARD
-	/* Determine if the packet is a READ (10) or WRITE (10) command, call appropriate function */
+#if (MSC_CACHE_LINES > 0)
+	/* Short commands go through the write-back cache. Longer ones stream past it, once any cached data they overlap
+	   is on the card (reads) or has been superseded (writes). */
+	if (TotalBlocks <= MSC_CACHE_MAX_BLOCKS) {
+		if (IsDataRead == DATA_READ) {
+			return SCSI_SD_CachedRead(MSInterfaceInfo, (uint32_t) BlockAddress, TotalBlocks);
+		}
+		else {
+			return SCSI_SD_CachedWrite(MSInterfaceInfo, (uint32_t) BlockAddress, TotalBlocks);
+		}
+	}
 	if (IsDataRead == DATA_READ) {
-		Chip_SDMMC_ReadBlocks(LPC_SDMMC, (void *) disk_cache, BlockAddress, TotalBlocks);
-		while (!Endpoint_IsINReady(MSInterfaceInfo->Config.PortNumber)) {}
-		Endpoint_Streaming(MSInterfaceInfo->Config.PortNumber,
-						   (uint8_t *) disk_cache,
-						   VIRTUAL_MEMORY_BLOCK_SIZE,
-						   TotalBlocks,
-						   0);
+		if (!BlockCache_FlushRange((uint32_t) BlockAddress, TotalBlocks)) {
+			SCSI_SET_SENSE(SCSI_SENSE_KEY_MEDIUM_ERROR,
+						   SCSI_ASENSE_WRITE_ERROR,
+						   SCSI_ASENSEQ_NO_QUALIFIER);
+
+			return false;
+		}
 	}
 	else {
-		Endpoint_Streaming(MSInterfaceInfo->Config.PortNumber,
-						   (uint8_t *) disk_cache,
-						   VIRTUAL_MEMORY_BLOCK_SIZE,
-						   TotalBlocks,
-						   0);
-		while (!Endpoint_IsOUTReceived(MSInterfaceInfo->Config.PortNumber)) {}
-		Chip_SDMMC_WriteBlocks(LPC_SDMMC, (void *) disk_cache, BlockAddress, TotalBlocks);
+		BlockCache_Discard((uint32_t) BlockAddress, TotalBlocks);
+	}
+#endif
+
+	/* The transfers update the bytes transferred counter as they complete */
+	if (IsDataRead == DATA_READ) {
+		return SCSI_SD_Read(MSInterfaceInfo, (uint32_t) BlockAddress, TotalBlocks);
+	}
+	else {
+		return SCSI_SD_Write(MSInterfaceInfo, (uint32_t) BlockAddress, TotalBlocks);
 	}
 #else
 	uint32_t startaddr;
 	uint16_t blocks, dummyblocks;
 
-	startaddr = MassStorage_GetAddressInImage(BlockAddress, TotalBlocks, &blocks);
+	startaddr = MassStorage_GetAddressInImage((uint32_t) BlockAddress, (uint16_t) TotalBlocks, &blocks);
 	if (blocks == 0) {
 		dummyblocks = TotalBlocks;
 	}
@@ -355,11 +661,59 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfa
 					   blocks,
 					   dummyblocks);
 	while (!Endpoint_IsReadWriteAllowed(MSInterfaceInfo->Config.PortNumber)) {}
-#endif
+
 	/* Update the bytes transferred counter and succeed the command */
 	MSInterfaceInfo->State.CommandBlock.DataTransferLength -= ((uint32_t) TotalBlocks * VIRTUAL_MEMORY_BLOCK_SIZE);
 
 	return true;
+#endif
+}
+
+/** Command processing for an issued SCSI READ (10) or WRITE (10) command. This command reads in the block start address
+ *  and total number of blocks to process, then calls the appropriate low-level Dataflash routine to handle the actual
+ *  reading and writing of the data.
+ */
+static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									  const bool IsDataRead)
+{
+	uint32_t BlockAddress;
+	uint16_t TotalBlocks;
+
+	/* Load in the 32-bit block address (SCSI uses big-endian, so have to reverse the byte order) */
+	BlockAddress =
+		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[2] <<
+		 24) + (MSInterfaceInfo->State.CommandBlock.SCSICommandData[3] << 16) +
+		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[4] <<
+		 8) + MSInterfaceInfo->State.CommandBlock.SCSICommandData[5];
+
+	/* Load in the 16-bit total blocks (SCSI uses big-endian, so have to reverse the byte order) */
+	TotalBlocks  =
+		(MSInterfaceInfo->State.CommandBlock.SCSICommandData[7] <<
+		 8) + MSInterfaceInfo->State.CommandBlock.SCSICommandData[8];
+
+	return SCSI_Command_ReadWrite(MSInterfaceInfo, IsDataRead, BlockAddress, TotalBlocks);
+}
+
+/** Command processing for an issued SCSI READ (16) or WRITE (16) command, the forms a host uses for block addresses
+ *  beyond 32 bits. Same as @ref SCSI_Command_ReadWrite_10() with a 64-bit block address and a 32-bit block count.
+ */
+static bool SCSI_Command_ReadWrite_16(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									  const bool IsDataRead)
+{
+	const uint8_t *CommandData = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+	uint64_t BlockAddress = 0;
+	uint32_t TotalBlocks  = 0;
+	uint8_t  i;
+
+	/* Both fields are big-endian: bytes 2-9 the block address, 10-13 the block count */
+	for (i = 2; i < 10; i++) {
+		BlockAddress = (BlockAddress << 8) + CommandData[i];
+	}
+	for (i = 10; i < 14; i++) {
+		TotalBlocks = (TotalBlocks << 8) + CommandData[i];
+	}
+
+	return SCSI_Command_ReadWrite(MSInterfaceInfo, IsDataRead, BlockAddress, TotalBlocks);
 }
 
 /** Command processing for an issued SCSI MODE SENSE (6) command. This command returns various informational pages about
@@ -371,6 +725,32 @@ static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfa
  */
 static bool SCSI_Command_ModeSense_6(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo)
 {
+#if defined(CFG_SDCARD) && (MSC_CACHE_LINES > 0)
+	const uint8_t *CommandData = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+	uint8_t  PageCode          = CommandData[2] & 0x3F;
+
+	/* The Caching page reports the write-back cache (WCE set), so that hosts which check it send SYNCHRONIZE CACHE */
+	if ((PageCode == 0x08) || (PageCode == 0x3F)) {
+		uint8_t  Response[4 + 20];
+		uint16_t BytesTransferred = MIN(CommandData[4], sizeof(Response));
+
+		memset(Response, 0, sizeof(Response));
+		Response[0] = sizeof(Response) - 1;
+		Response[2] = DISK_READ_ONLY ? 0x80 : 0x00;
+		Response[4] = 0x08;
+		Response[5] = 20 - 2;
+		Response[6] = 0x04;
+
+		Endpoint_Write_Stream_LE(MSInterfaceInfo->Config.PortNumber, Response, BytesTransferred, NULL);
+		Endpoint_ClearIN(MSInterfaceInfo->Config.PortNumber);
+
+		/* Update the bytes transferred counter and succeed the command */
+		MSInterfaceInfo->State.CommandBlock.DataTransferLength -= BytesTransferred;
+
+		return true;
+	}
+#endif
+
 	/* Send an empty header response with the Write Protect flag status */
 	Endpoint_Write_8(MSInterfaceInfo->Config.PortNumber, 0x00);
 	Endpoint_Write_8(MSInterfaceInfo->Config.PortNumber, 0x00);
@@ -81,6 +81,13 @@ extern "C" {
  */
 bool SCSI_DecodeSCSICommand(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo);
 
+/** @brief	Sets up the SCSI layer's media handling: with an SD card (CFG_SDCARD), the write-back block cache in front of it.
+ *          Call once the media is ready, before USB is started.
+ *
+ *  @return Nothing
+ */
+void SCSI_Init(void);
+
 #if defined(INCLUDE_FROM_SCSI_C)
 /** @brief	Command processing for an issued SCSI INQUIRY command. This command returns information about the device's features
  *          and capabilities to the host.
@@ -109,6 +116,15 @@ static bool SCSI_Command_Request_Sense(USB_ClassInfo_MS_Device_t *const MSInterf
  */
 static bool SCSI_Command_Read_Capacity_10(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo);
 
+/** @brief	Command processing for an issued SCSI READ CAPACITY (16) command (SERVICE ACTION IN (16)). This command returns
+ *          the device's capacity as a 64-bit last block address, for media too large for READ CAPACITY (10).
+ *
+ *  @param	MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *
+ *  @return Boolean true if the command completed successfully, false otherwise.
+ */
+static bool SCSI_Command_Read_Capacity_16(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo);
+
 /** @brief	Command processing for an issued SCSI SEND DIAGNOSTIC command. This command performs a quick check of the Dataflash ICs on the
  *          board, and indicates if they are present and functioning correctly. Only the Self-Test portion of the diagnostic command is
  *          supported.
@@ -131,6 +147,104 @@ static bool SCSI_Command_Send_Diagnostic(USB_ClassInfo_MS_Device_t *const MSInte
 static bool SCSI_Command_ReadWrite_10(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
 									  const bool IsDataRead);
 
+/** @brief	Command processing for an issued SCSI READ (16) or WRITE (16) command. As @ref SCSI_Command_ReadWrite_10() with
+ *          a 64-bit block start address and a 32-bit number of blocks.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  IsDataRead :  Indicates if the command is a READ (16) command or WRITE (16) command (DATA_READ or DATA_WRITE)
+ *
+ *  @return Boolean true if the command completed successfully, false otherwise.
+ */
+static bool SCSI_Command_ReadWrite_16(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									  const bool IsDataRead);
+
+/** @brief	Checks the block range of a decoded READ or WRITE command and moves the data.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  IsDataRead :  DATA_READ or DATA_WRITE
+ *  @param  BlockAddress :  First block
+ *  @param  TotalBlocks :  Number of blocks
+ *
+ *  @return Boolean true if the command completed successfully, false otherwise.
+ */
+static bool SCSI_Command_ReadWrite(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								   const bool IsDataRead,
+								   uint64_t BlockAddress,
+								   uint32_t TotalBlocks);
+
+#ifdef CFG_SDCARD
+/** @brief	Reads blocks from the SD card to the host, overlapping card reads with USB transfers.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  BlockAddress :  First block
+ *  @param  TotalBlocks :  Number of blocks
+ *
+ *  @return Boolean true if the data was read and sent, false otherwise.
+ */
+static bool SCSI_SD_Read(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						 uint32_t BlockAddress,
+						 uint32_t TotalBlocks);
+
+/** @brief	Writes blocks from the host to the SD card, overlapping USB transfers with card writes.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  BlockAddress :  First block
+ *  @param  TotalBlocks :  Number of blocks
+ *
+ *  @return Boolean true if the data was received and written, false otherwise.
+ */
+static bool SCSI_SD_Write(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+						  uint32_t BlockAddress,
+						  uint32_t TotalBlocks);
+
+/** @brief	Waits for a USB transfer of the SD pipeline, if it was started, and counts the bytes it moved.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  EndpointAddress :  Endpoint the transfer was submitted to
+ *  @param  Transfer :  The transfer
+ *
+ *  @return Boolean true if the transfer moved all of its data or was never started, false otherwise.
+ */
+static bool SCSI_SD_CompleteTransfer(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+									 const uint8_t EndpointAddress,
+									 Endpoint_Transfer_t *const Transfer);
+
+#if (MSC_CACHE_LINES > 0)
+/** @brief	Reads up to MSC_CACHE_MAX_BLOCKS blocks through the write-back cache and sends them to the host.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  BlockAddress :  First block
+ *  @param  TotalBlocks :  Number of blocks
+ *
+ *  @return Boolean true if the data was read and sent, false otherwise.
+ */
+static bool SCSI_SD_CachedRead(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+							   uint32_t BlockAddress,
+							   uint32_t TotalBlocks);
+
+/** @brief	Receives up to MSC_CACHE_MAX_BLOCKS blocks from the host into the write-back cache.
+ *
+ *  @param  MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *  @param  BlockAddress :  First block
+ *  @param  TotalBlocks :  Number of blocks
+ *
+ *  @return Boolean true if the data was received and cached, false otherwise.
+ */
+static bool SCSI_SD_CachedWrite(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo,
+								uint32_t BlockAddress,
+								uint32_t TotalBlocks);
+#endif
+#endif
+
+/** @brief	Command processing for an issued SCSI SYNCHRONIZE CACHE (10), START STOP UNIT or PREVENT ALLOW MEDIUM REMOVAL
+ *          command. Writes back the write-back cache, if there is one.
+ *
+ *  @param	MSInterfaceInfo :  Pointer to the Mass Storage class interface structure that the command is associated with
+ *
+ *  @return Boolean true if the command completed successfully, false otherwise.
+ */
+static bool SCSI_Command_Synchronize_Cache(USB_ClassInfo_MS_Device_t *const MSInterfaceInfo);
+
 /** @brief	Command processing for an issued SCSI MODE SENSE (6) command. This command returns various informational pages about
  *          the SCSI device, as well as the device's Write Protect status.
  *
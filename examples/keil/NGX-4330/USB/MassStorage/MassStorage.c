@@ -40,6 +40,10 @@
 /* SDMMC card info structure */
 static mci_card_struct sdcardinfo;
 static volatile int32_t sdio_wait_exit = 0;
+#if (MSC_CACHE_LINES > 0)
+/* Millisecond count for the write-back cache's idle timeout */
+static volatile uint32_t systick_timems;
+#endif
 #endif
 
 /** nxpUSBlib Mass Storage Class driver interface configuration and state information. This structure is
@@ -148,8 +152,12 @@ static void SetupHardware(void)
 		DEBUGOUT("Card Acquire failed...\r\n");
 		while (1) {}
 	}
+#if (MSC_CACHE_LINES > 0)
+	SysTick_Config(SystemCoreClock / 1000);
+#endif
 #endif
 
+	SCSI_Init();
 	USB_Init(Disk_MS_Interface.Config.PortNumber, USB_MODE_Device);
 #if defined(USB_DEVICE_ROM_DRIVER)
 	UsbdMsc_Init();
@@ -179,6 +187,17 @@ void SDIO_IRQHandler(void)
 	sdio_wait_exit = 1;
 }
 
+#if (MSC_CACHE_LINES > 0)
+/**
+ * @brief	SysTick interrupt handler, counts milliseconds
+ * @return	Nothing
+ */
+void SysTick_Handler(void)
+{
+	systick_timems++;
+}
+
+#endif
 #endif
 
 /**
@@ -196,6 +215,9 @@ int main(void)
 		MS_Device_USBTask(&Disk_MS_Interface);
 		USB_USBTask(Disk_MS_Interface.Config.PortNumber, USB_MODE_Device);
 		#endif
+		#if defined(CFG_SDCARD) && (MSC_CACHE_LINES > 0)
+		BlockCache_Task(systick_timems);
+		#endif
 	}
 }
 
@@ -39,6 +39,7 @@
 #include "Descriptors.h"
 #include "Lib/SCSI.h"
 #include "Lib/DataRam.h"
+#include "Lib/BlockCache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,8 +54,10 @@ extern "C" {
  * the RAM to simulate a small massstorage device.<br>
  *
  * When **CFG_SDCARD** is defined then the board will enumerate the SD CARD connected
- * to the SD card slot as the USB mass storage device. To get the SD CARD working the
- * following board setup must be made.<br>
+ * to the SD card slot as the USB mass storage device. Reads and writes move through
+ * two 16KB buffers in the AHB SRAM so the card and the USB controller work at the
+ * same time, and READ/WRITE (16) and READ CAPACITY (16) are supported for large cards.
+ * To get the SD CARD working the following board setup must be made.<br>
  *
  * <b>Special connection requirements</b><br>
  * When **CFG_SDCARD** not defined:<br>
@@ -219,6 +222,26 @@ extern "C" {
 /** Indicates if the disk is write protected or not. */
 #define DISK_READ_ONLY            false
 
+/** Blocks per step of an SD card (CFG_SDCARD) read or write. Two such chunks are buffered so the card
+ *  works on one while USB moves the other; 32 blocks (16KB) is the most one transfer descriptor carries. */
+#define MSC_SD_CHUNK_BLOCKS       32
+
+/** Pages the SD card (CFG_SDCARD) write-back cache holds, 0 to write straight through to the card. The cache
+ *  keeps the small, repeated FAT and directory writes hosts make in RAM and writes them back coalesced. Its data
+ *  sits in AHB SRAM after the two chunk buffers, so MSC_CACHE_LINES * MSC_CACHE_PAGE_BLOCKS must not exceed 64. */
+#define MSC_CACHE_LINES           8
+
+/** Blocks per cache page. The cache allocates, reads ahead and tracks recency a page at a time. */
+#define MSC_CACHE_PAGE_BLOCKS     4
+
+/** Longest READ or WRITE that goes through the cache. Longer ones are file data, streamed to or from the card
+ *  directly after the cached blocks they overlap are written back (reads) or dropped (writes). */
+#define MSC_CACHE_MAX_BLOCKS      8
+
+/** Time without a write after which dirty cache pages are written back anyway, for hosts that do not send
+ *  SYNCHRONIZE CACHE or eject before the device is unplugged. */
+#define MSC_CACHE_IDLE_MS         500
+
 /**
  * @}
  */
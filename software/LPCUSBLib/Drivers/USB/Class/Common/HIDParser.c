@@ -57,6 +57,7 @@ uint8_t USB_ProcessHIDReport(const uint8_t* ReportData,
 	{
 		uint8_t  HIDReportItem  = *ReportData;
 		uint32_t ReportItemData = 0;
+		int32_t  ReportItemSigned = 0;
 
 		ReportData++;
 		ReportSize--;
@@ -65,16 +66,19 @@ uint8_t USB_ProcessHIDReport(const uint8_t* ReportData,
 		{
 			case HID_RI_DATA_BITS_32:
 				ReportItemData  = le32_to_cpu(*((uint32_t*)ReportData));
+				ReportItemSigned = (int32_t)ReportItemData;
 				ReportSize     -= 4;
 				ReportData     += 4;
 				break;
 			case HID_RI_DATA_BITS_16:
 				ReportItemData  = le16_to_cpu(*((uint16_t*)ReportData));
+				ReportItemSigned = (int16_t)ReportItemData;
 				ReportSize     -= 2;
 				ReportData     += 2;
 				break;
 			case HID_RI_DATA_BITS_8:
 				ReportItemData  = *((uint8_t*)ReportData);
+				ReportItemSigned = (int8_t)ReportItemData;
 				ReportSize     -= 1;
 				ReportData     += 1;
 				break;
@@ -105,16 +109,16 @@ uint8_t USB_ProcessHIDReport(const uint8_t* ReportData,
 				CurrStateTable->Attributes.Usage.Page       = ReportItemData;
 				break;
 			case HID_RI_LOGICAL_MINIMUM(0):
-				CurrStateTable->Attributes.Logical.Minimum  = ReportItemData;
+				CurrStateTable->Attributes.Logical.Minimum  = ReportItemSigned;
 				break;
 			case HID_RI_LOGICAL_MAXIMUM(0):
-				CurrStateTable->Attributes.Logical.Maximum  = ReportItemData;
+				CurrStateTable->Attributes.Logical.Maximum  = ReportItemSigned;
 				break;
 			case HID_RI_PHYSICAL_MINIMUM(0):
-				CurrStateTable->Attributes.Physical.Minimum = ReportItemData;
+				CurrStateTable->Attributes.Physical.Minimum = ReportItemSigned;
 				break;
 			case HID_RI_PHYSICAL_MAXIMUM(0):
-				CurrStateTable->Attributes.Physical.Maximum = ReportItemData;
+				CurrStateTable->Attributes.Physical.Maximum = ReportItemSigned;
 				break;
 			case HID_RI_UNIT_EXPONENT(0):
 				CurrStateTable->Attributes.Unit.Exponent    = ReportItemData;
@@ -363,3 +367,154 @@ uint16_t USB_GetHIDReportSize(HID_ReportInfo_t* const ParserData,
 
 	return 0;
 }
+
+uint8_t USB_CompileHIDReportPlan(const HID_ReportInfo_t* const ParserData,
+                                 const uint8_t ReportType,
+                                 const HID_Usage_t* const SlotUsages,
+                                 const uint8_t TotalSlots,
+                                 HID_ReportPlan_t* const Plan)
+{
+	memset(Plan, 0x00, sizeof(HID_ReportPlan_t));
+
+	Plan->UsingReportIDs = ParserData->UsingReportIDs;
+
+	for (uint8_t ReportIndex = 0; ReportIndex < ParserData->TotalDeviceReports; ReportIndex++)
+	{
+		const HID_ReportSizeInfo_t* ReportIDInfo = &ParserData->ReportIDSizes[ReportIndex];
+		HID_ReportLayout_t*         Layout       = &Plan->Layouts[Plan->TotalLayouts];
+		uint8_t                     IDBytes      = (ParserData->UsingReportIDs ? 1 : 0);
+
+		Layout->ReportID   = ReportIDInfo->ReportID;
+		Layout->FirstField = Plan->TotalFields;
+		Layout->ReportSize = IDBytes + ((ReportIDInfo->ReportSizeBits[ReportType] + 7) / 8);
+
+		for (uint8_t ItemIndex = 0; ItemIndex < ParserData->TotalReportItems; ItemIndex++)
+		{
+			const HID_ReportItem_t* ReportItem = &ParserData->ReportItems[ItemIndex];
+			uint8_t                 BitSize    = ReportItem->Attributes.BitSize;
+			uint8_t                 Slot       = ItemIndex;
+
+			if ((ReportItem->ItemType != ReportType) || (ReportItem->ReportID != Layout->ReportID))
+			  continue;
+
+			if (!(BitSize) || (BitSize > 32))
+			  continue;
+
+			if (SlotUsages != NULL)
+			{
+				for (Slot = 0; Slot < TotalSlots; Slot++)
+				{
+					if ((SlotUsages[Slot].Page  == ReportItem->Attributes.Usage.Page) &&
+					    (SlotUsages[Slot].Usage == ReportItem->Attributes.Usage.Usage))
+					{
+						break;
+					}
+				}
+
+				if (Slot == TotalSlots)
+				  continue;
+			}
+
+			HID_ReportField_t* Field = &Plan->Fields[Plan->TotalFields++];
+
+			Field->ByteOffset = IDBytes + (ReportItem->BitOffset / 8);
+			Field->Shift      = (ReportItem->BitOffset % 8);
+			Field->BitSize    = BitSize;
+			Field->Bytes      = (Field->Shift + BitSize + 7) / 8;
+			Field->Slot       = Slot;
+
+			if ((BitSize < 32) && ((int32_t)ReportItem->Attributes.Logical.Minimum < 0))
+			  Field->Flags   |= HID_FIELD_SIGNED;
+
+			Layout->TotalFields++;
+		}
+
+		if (Layout->TotalFields)
+		  Plan->TotalLayouts++;
+	}
+
+	if (!(Plan->TotalFields))
+	  return HID_PARSE_NoUnfilteredReportItems;
+
+	return HID_PARSE_Successful;
+}
+
+uint8_t USB_DecodeHIDReport(const HID_ReportPlan_t* const Plan,
+                            const uint8_t* ReportData,
+                            const uint16_t ReportSize,
+                            int32_t* const Values)
+{
+	const HID_ReportLayout_t* Layout = &Plan->Layouts[0];
+	uint8_t                   LayoutsRem;
+
+	if (Plan->UsingReportIDs)
+	{
+		if (!(ReportSize))
+		  return 0;
+
+		for (LayoutsRem = Plan->TotalLayouts; LayoutsRem; LayoutsRem--, Layout++)
+		{
+			if (Layout->ReportID == ReportData[0])
+			  break;
+		}
+
+		if (!(LayoutsRem))
+		  return 0;
+	}
+	else if (!(Plan->TotalLayouts))
+	{
+		return 0;
+	}
+
+	const HID_ReportField_t* Field     = &Plan->Fields[Layout->FirstField];
+	uint8_t                  FieldsRem = Layout->TotalFields;
+
+	/* Fields are in report order, so a short report just ends the pass early */
+	while (FieldsRem)
+	{
+		const uint8_t* FieldData = &ReportData[Field->ByteOffset];
+		uint32_t       Raw;
+
+		if ((Field->ByteOffset + Field->Bytes) > ReportSize)
+		  break;
+
+		switch (Field->Bytes)
+		{
+			case 1:
+				Raw = FieldData[0];
+				break;
+			case 2:
+				Raw = FieldData[0] | ((uint16_t)FieldData[1] << 8);
+				break;
+			case 3:
+				Raw = FieldData[0] | ((uint16_t)FieldData[1] << 8) | ((uint32_t)FieldData[2] << 16);
+				break;
+			default:
+				Raw = FieldData[0] | ((uint16_t)FieldData[1] << 8) | ((uint32_t)FieldData[2] << 16) |
+				      ((uint32_t)FieldData[3] << 24);
+				break;
+		}
+
+		Raw >>= Field->Shift;
+
+		if (Field->Bytes == 5)
+		  Raw |= ((uint32_t)FieldData[4] << (32 - Field->Shift));
+
+		if (Field->BitSize < 32)
+		{
+			uint8_t UnusedBits = (32 - Field->BitSize);
+
+			if (Field->Flags & HID_FIELD_SIGNED)
+			  Raw = (uint32_t)((int32_t)(Raw << UnusedBits) >> UnusedBits);
+			else
+			  Raw &= (0xFFFFFFFF >> UnusedBits);
+		}
+
+		Values[Field->Slot] = (int32_t)Raw;
+
+		Field++;
+		FieldsRem--;
+	}
+
+	return (Layout->TotalFields - FieldsRem);
+}
@@ -124,6 +124,11 @@
 			#define HID_MAX_REPORT_IDS            10
 		#endif
 
+		/** Flag for @ref HID_ReportField_t::Flags, set when the field's logical range is signed and the decoded value
+		 *  is sign extended to 32 bits.
+		 */
+		#define HID_FIELD_SIGNED                  (1 << 0)
+
 		/** Returns the value a given HID report item (once its value has been fetched via @ref USB_GetHIDReportItemInfo())
 		 *  left-aligned to the given data type. This allows for signed data to be interpreted correctly, by shifting the data
 		 *  leftwards until the data's sign bit is in the correct position.
@@ -154,7 +159,9 @@
 		/* Type Defines: */
 			/** @brief HID Parser Report Item Min/Max Structure.
 			 *
-			 *  Type define for an attribute with both minimum and maximum values (e.g. Logical Min/Max).
+			 *  Type define for an attribute with both minimum and maximum values (e.g. Logical Min/Max). The values are
+			 *  signed in the descriptor and are stored sign extended from their encoded size, cast to \c int32_t to
+			 *  read them.
 			 */
 			typedef struct
 			{
@@ -261,6 +268,48 @@
 				                                      */
 			} HID_ReportInfo_t;
 
+			/** @brief HID Report Plan Field Structure.
+			 *
+			 *  Type define for one report item of a compiled report plan, with its position in the report worked out
+			 *  ahead of time so that it can be extracted with a few byte loads and shifts.
+			 */
+			typedef struct
+			{
+				uint16_t ByteOffset; /**< Offset of the item's first byte in the report, including the report ID byte if any. */
+				uint8_t  Shift;      /**< Bit position of the item's least significant bit in its first byte. */
+				uint8_t  BitSize;    /**< Size in bits of the item's data, 1 to 32. */
+				uint8_t  Bytes;      /**< Number of report bytes the item touches, 1 to 5. */
+				uint8_t  Flags;      /**< Mask of HID_FIELD_* flags. */
+				uint8_t  Slot;       /**< Index of the decoded value in the array given to @ref USB_DecodeHIDReport(). */
+			} HID_ReportField_t;
+
+			/** @brief HID Report Plan Layout Structure.
+			 *
+			 *  Type define for the compiled layout of one report ID, a run of fields in the plan's \c Fields array.
+			 */
+			typedef struct
+			{
+				uint8_t  ReportID;    /**< Report ID of the report, or 0x00 if the device does not use report IDs. */
+				uint8_t  FirstField;  /**< Index of the layout's first field in the plan's \c Fields array. */
+				uint8_t  TotalFields; /**< Number of fields in the layout, in ascending report offset. */
+				uint16_t ReportSize;  /**< Size in bytes of the whole report, including the report ID byte if any. */
+			} HID_ReportLayout_t;
+
+			/** @brief HID Report Plan Structure.
+			 *
+			 *  Type define for a compiled report plan, built from a @ref HID_ReportInfo_t by @ref USB_CompileHIDReportPlan()
+			 *  for one report type. It holds no pointers into the parser output, so the (much larger) @ref HID_ReportInfo_t
+			 *  can be discarded once the plan is built.
+			 */
+			typedef struct
+			{
+				uint8_t            TotalLayouts; /**< Number of report IDs with at least one field in the plan. */
+				uint8_t            TotalFields;  /**< Total number of fields across all layouts. */
+				bool               UsingReportIDs; /**< Copy of @ref HID_ReportInfo_t::UsingReportIDs. */
+				HID_ReportLayout_t Layouts[HID_MAX_REPORT_IDS]; /**< Per report ID layouts. */
+				HID_ReportField_t  Fields[HID_MAX_REPORTITEMS]; /**< Fields of all layouts, grouped by layout. */
+			} HID_ReportPlan_t;
+
 		/* Function Prototypes: */
 			/** Function to process a given HID report returned from an attached device, and store it into a given
 			 *  @ref HID_ReportInfo_t structure.
@@ -320,6 +369,50 @@
 			                              const uint8_t ReportID,
 			                              const uint8_t ReportType) ATTR_CONST ATTR_NON_NULL_PTR_ARG(1);
 
+			/** Compiles the report items of one type from a parsed HID report descriptor into a report plan, so that
+			 *  received reports can be decoded in a single pass by @ref USB_DecodeHIDReport() rather than with a
+			 *  @ref USB_GetHIDReportItemInfo() call and a usage search per item.
+			 *
+			 *  Each item is given a slot, the index its value is decoded into. When \c SlotUsages is given, an item
+			 *  whose usage page and usage match \c SlotUsages[i] goes to slot \c i and items matching no entry are left
+			 *  out of the plan, so the values array can be a structure of \c int32_t members declared in the same order
+			 *  as the usage table. Items sharing a usage share its slot, the last one in the report wins. When
+			 *  \c SlotUsages is \c NULL the slot is the item's index in the \c ReportItems array of \c ParserData.
+			 *
+			 *  An item is decoded as signed when its logical minimum is negative.
+			 *
+			 *  @param ParserData  Pointer to a @ref HID_ReportInfo_t instance containing the parser output.
+			 *  @param ReportType  Type of the reports to compile, a value from the @ref HID_ReportItemTypes_t enum.
+			 *  @param SlotUsages  Usages to assign to slots 0 to \c TotalSlots - 1, or \c NULL to slot by item index.
+			 *  @param TotalSlots  Number of entries in \c SlotUsages.
+			 *  \param[out] Plan   Pointer to a @ref HID_ReportPlan_t instance for the compiled plan.
+			 *
+			 *  @return @ref HID_PARSE_Successful, or @ref HID_PARSE_NoUnfilteredReportItems if no item made it into the plan.
+			 */
+			uint8_t USB_CompileHIDReportPlan(const HID_ReportInfo_t* const ParserData,
+			                                 const uint8_t ReportType,
+			                                 const HID_Usage_t* const SlotUsages,
+			                                 const uint8_t TotalSlots,
+			                                 HID_ReportPlan_t* const Plan) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(5);
+
+			/** Decodes every field of a received report into its slot of \c Values in one pass, using a plan built by
+			 *  @ref USB_CompileHIDReportPlan(). Signed fields are sign extended, unsigned fields are zero extended (a
+			 *  32-bit unsigned field keeps its bit pattern). Slots of fields that are not in this report, or that lie past
+			 *  the end of a short report, are left untouched.
+			 *
+			 *  @param Plan        Pointer to the compiled report plan.
+			 *  @param ReportData  Buffer containing an IN or FEATURE report from an attached device.
+			 *  @param ReportSize  Number of valid bytes in \c ReportData.
+			 *  \param[out] Values Slot indexed array the decoded field values are written to.
+			 *
+			 *  @return Number of fields decoded, \c 0 if the report's ID is not in the plan.
+			 */
+			uint8_t USB_DecodeHIDReport(const HID_ReportPlan_t* const Plan,
+			                            const uint8_t* ReportData,
+			                            const uint16_t ReportSize,
+			                            int32_t* const Values) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2)
+			                                                   ATTR_NON_NULL_PTR_ARG(4);
+
 			/** Callback routine for the HID Report Parser. This callback <b>must</b> be implemented by the user code when
 			 *  the parser is used, to determine what report IN, OUT and FEATURE item's information is stored into the user
 			 *  @ref HID_ReportInfo_t structure. This can be used to filter only those items the application will be using, so that
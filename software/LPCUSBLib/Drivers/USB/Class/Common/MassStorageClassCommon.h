@@ -109,6 +109,24 @@
 
 		/** SCSI Command Code for a MODE SENSE (10) command. */
 		#define SCSI_CMD_MODE_SENSE_10                         0x5A
+
+		/** SCSI Command Code for a READ (16) command. */
+		#define SCSI_CMD_READ_16                               0x88
+
+		/** SCSI Command Code for a WRITE (16) command. */
+		#define SCSI_CMD_WRITE_16                              0x8A
+
+		/** SCSI Command Code for a SERVICE ACTION IN (16) command, the service action is in the low bits of byte 1. */
+		#define SCSI_CMD_SERVICE_ACTION_IN_16                  0x9E
+
+		/** SCSI SERVICE ACTION IN (16) service action of a READ CAPACITY (16) command. */
+		#define SCSI_SERVICE_ACTION_READ_CAPACITY_16           0x10
+
+		/** SCSI Command Code for a START STOP UNIT command. */
+		#define SCSI_CMD_START_STOP_UNIT                       0x1B
+
+		/** SCSI Command Code for a SYNCHRONIZE CACHE (10) command. */
+		#define SCSI_CMD_SYNCHRONIZE_CACHE_10                  0x35
 		//@}
 		
 		/** @name SCSI Sense Key Values */
@@ -188,6 +206,12 @@
 
 		/** SCSI Additional Sense Code to indicate that no removable medium is inserted into the device. */
 		#define SCSI_ASENSE_MEDIUM_NOT_PRESENT                 0x3A
+
+		/** SCSI Additional Sense Code to indicate that the medium failed to return the requested data. */
+		#define SCSI_ASENSE_UNRECOVERED_READ_ERROR             0x11
+
+		/** SCSI Additional Sense Code to indicate that the medium failed to store the written data. */
+		#define SCSI_ASENSE_WRITE_ERROR                        0x0C
 		//@}
 		
 		/** @name SCSI Additional Sense Key Code Qualifiers */
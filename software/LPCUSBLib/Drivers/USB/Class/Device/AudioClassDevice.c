@@ -93,10 +93,27 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 				Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
 				Endpoint_ClearStatusStage(AudioInterfaceInfo->Config.PortNumber);
 
-				AudioInterfaceInfo->State.InterfaceEnabled = ((USB_ControlRequest.wValue & 0xFF) != 0);
+				AudioInterfaceInfo->State.AlternateSetting = (USB_ControlRequest.wValue & 0xFF);
+				AudioInterfaceInfo->State.InterfaceEnabled = (AudioInterfaceInfo->State.AlternateSetting != 0);
 				EVENT_Audio_Device_StreamStartStop(AudioInterfaceInfo);
 			}
 
+			break;
+		case REQ_GetInterface:
+			if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_STANDARD | REQREC_INTERFACE))
+			{
+				/* The control interface only has alternate setting 0 */
+				uint8_t AlternateSetting = 0;
+
+				if ((uint8_t)USB_ControlRequest.wIndex == AudioInterfaceInfo->Config.StreamingInterfaceNumber)
+				  AlternateSetting = AudioInterfaceInfo->State.AlternateSetting;
+
+				Endpoint_ClearSETUP(AudioInterfaceInfo->Config.PortNumber);
+				Endpoint_Write_8(AudioInterfaceInfo->Config.PortNumber, AlternateSetting);
+				Endpoint_ClearIN(AudioInterfaceInfo->Config.PortNumber);
+				Endpoint_ClearStatusStage(AudioInterfaceInfo->Config.PortNumber);
+			}
+
 			break;
 		case AUDIO_REQ_GetStatus:
 			if ((USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) ||
@@ -207,8 +224,14 @@ void Audio_Device_ProcessControlRequest(USB_ClassInfo_Audio_Device_t* const Audi
 
 bool Audio_Device_ConfigureEndpoints(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo)
 {
+	uint32_t SampleRate = AudioInterfaceInfo->State.SampleRate;
+
 	memset(&AudioInterfaceInfo->State, 0x00, sizeof(AudioInterfaceInfo->State));
 
+	/* Feedback format follows the bus speed, so latch it before the feedback endpoint is primed */
+	AudioInterfaceInfo->State.HighSpeed = USB_Device_IsHighSpeed(AudioInterfaceInfo->Config.PortNumber);
+	Audio_Device_SetFeedbackRate(AudioInterfaceInfo, SampleRate);
+
 	for (uint8_t EndpointNum = 1; EndpointNum < ENDPOINT_TOTAL_ENDPOINTS(AudioInterfaceInfo->Config.PortNumber); EndpointNum++)
 	{
 		uint16_t Size;
@@ -230,6 +253,13 @@ bool Audio_Device_ConfigureEndpoints(USB_ClassInfo_Audio_Device_t* const AudioIn
 			Type         = EP_TYPE_ISOCHRONOUS;
 			DoubleBanked = true;
 		}
+		else if (EndpointNum == AudioInterfaceInfo->Config.DataFeedbackEndpointNumber)
+		{
+			Size         = AudioInterfaceInfo->State.HighSpeed ? 4 : 3;
+			Direction    = ENDPOINT_DIR_IN;
+			Type         = EP_TYPE_ISOCHRONOUS;
+			DoubleBanked = false;
+		}
 		else
 		{
 			continue;
@@ -245,6 +275,85 @@ bool Audio_Device_ConfigureEndpoints(USB_ClassInfo_Audio_Device_t* const AudioIn
 	return true;
 }
 
+static uint32_t Audio_Device_RateToFeedback(const uint32_t SampleRate, const bool HighSpeed)
+{
+	/* 16.16 samples per microframe at high-speed, 10.14 samples per frame at full-speed */
+	if (HighSpeed)
+	  return (uint32_t)(((uint64_t)SampleRate << 16) / 8000);
+	else
+	  return (uint32_t)(((uint64_t)SampleRate << 14) / 1000);
+}
+
+void Audio_Device_SetFeedbackRate(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+                                  const uint32_t SampleRate)
+{
+	AudioInterfaceInfo->State.SampleRate         = SampleRate;
+	AudioInterfaceInfo->State.FeedbackNominal    = Audio_Device_RateToFeedback(SampleRate, AudioInterfaceInfo->State.HighSpeed);
+	AudioInterfaceInfo->State.FeedbackValue      = AudioInterfaceInfo->State.FeedbackNominal;
+	AudioInterfaceInfo->State.FeedbackSOFCount   = 0;
+	AudioInterfaceInfo->State.FeedbackSampleMark = 0;
+}
+
+void Audio_Device_FeedbackSOF(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+                              const uint32_t SamplesPlayed,
+                              const int32_t FillError)
+{
+	uint8_t  FracBits = AudioInterfaceInfo->State.HighSpeed ? 16 : 14;
+	uint32_t Nominal  = AudioInterfaceInfo->State.FeedbackNominal;
+	int32_t  Error    = FillError;
+	int32_t  Measured;
+	int32_t  Value;
+
+	if (!(AudioInterfaceInfo->Config.DataFeedbackEndpointNumber) || !(AudioInterfaceInfo->State.InterfaceEnabled))
+	{
+		AudioInterfaceInfo->State.FeedbackSOFCount = 0;
+		return;
+	}
+
+	/* First SOF of a period only takes the timestamp */
+	if (AudioInterfaceInfo->State.FeedbackSOFCount++ == 0)
+	{
+		AudioInterfaceInfo->State.FeedbackSampleMark = SamplesPlayed;
+		return;
+	}
+
+	if (AudioInterfaceInfo->State.FeedbackSOFCount <= (1 << AUDIO_FEEDBACK_PERIOD_SHIFT))
+	  return;
+
+	/* Samples consumed per (micro)frame over the period, in feedback format */
+	Measured = (int32_t)((SamplesPlayed - AudioInterfaceInfo->State.FeedbackSampleMark) << (FracBits - AUDIO_FEEDBACK_PERIOD_SHIFT));
+
+	/* Steer the buffer back to its target depth over a few periods */
+	if (Error > 1024)
+	  Error = 1024;
+	else if (Error < -1024)
+	  Error = -1024;
+
+	Measured -= (Error * (1 << FracBits)) >> (AUDIO_FEEDBACK_PERIOD_SHIFT + AUDIO_FEEDBACK_FILTER_SHIFT);
+
+	/* Low-pass and keep within +/-3% of nominal so a bad period can't upset the host */
+	Value  = (int32_t)AudioInterfaceInfo->State.FeedbackValue;
+	Value += (Measured - Value) >> AUDIO_FEEDBACK_FILTER_SHIFT;
+
+	if (Value > (int32_t)(Nominal + (Nominal >> 5)))
+	  Value = (int32_t)(Nominal + (Nominal >> 5));
+	else if (Value < (int32_t)(Nominal - (Nominal >> 5)))
+	  Value = (int32_t)(Nominal - (Nominal >> 5));
+
+	AudioInterfaceInfo->State.FeedbackValue      = (uint32_t)Value;
+	AudioInterfaceInfo->State.FeedbackSampleMark = SamplesPlayed;
+	AudioInterfaceInfo->State.FeedbackSOFCount   = 1;
+}
+
+uint32_t Audio_Device_GetFeedbackBuffer(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+                                        uint32_t* const PacketSize)
+{
+	AudioInterfaceInfo->State.FeedbackData = cpu_to_le32(AudioInterfaceInfo->State.FeedbackValue);
+	*PacketSize = AudioInterfaceInfo->State.HighSpeed ? 4 : 3;
+
+	return (uint32_t)&AudioInterfaceInfo->State.FeedbackData;
+}
+
 void Audio_Device_Event_Stub(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo)
 {
 
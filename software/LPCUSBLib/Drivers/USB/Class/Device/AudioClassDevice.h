@@ -61,6 +61,17 @@
 		#endif
 
 	/* Public Interface - May be used in end-application: */
+		/* Macros: */
+			#if !defined(AUDIO_FEEDBACK_PERIOD_SHIFT) || defined(__DOXYGEN__)
+				/** Log2 of the number of SOF events per feedback estimation period. */
+				#define AUDIO_FEEDBACK_PERIOD_SHIFT    6
+			#endif
+
+			#if !defined(AUDIO_FEEDBACK_FILTER_SHIFT) || defined(__DOXYGEN__)
+				/** Log2 of the low-pass filter time constant applied to the feedback value, in estimation periods. */
+				#define AUDIO_FEEDBACK_FILTER_SHIFT    2
+			#endif
+
 		/* Type Defines: */
 			/** @brief Audio Class Device Mode Configuration and State Structure.
 			 *
@@ -98,6 +109,9 @@
 					uint16_t DataOUTEndpointSize; /**< Size in bytes of the outgoing Audio Streaming data endpoint, if available
 												   *   (zero if unused).
 												   */
+					uint8_t  DataFeedbackEndpointNumber; /**< Endpoint number of the asynchronous feedback IN endpoint paired with
+														  *   the outgoing Audio Streaming data endpoint, if available (zero if unused).
+														  */
 					uint8_t  PortNumber;				/**< Port number that this interface is running.*/
 				} Config; /**< Config data for the USB class interface within the device. All elements in this section
 				           *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
@@ -107,6 +121,20 @@
 					bool InterfaceEnabled; /**< Set and cleared by the class driver to indicate if the host has enabled the streaming endpoints
 					                        *   of the Audio Streaming interface.
 					                        */
+					uint8_t  AlternateSetting; /**< Alternate setting of the Audio Streaming interface last selected by the host,
+					                            *   zero when streaming is stopped. Reported back for GET_INTERFACE.
+					                            */
+					bool     HighSpeed; /**< Feedback format in use, 16.16 samples per microframe when set, 10.14 samples per
+					                     *   frame otherwise. Latched from the bus speed when the endpoints are configured.
+					                     */
+					uint32_t SampleRate; /**< Nominal sample rate the feedback estimator is centred on, see
+					                      *   @ref Audio_Device_SetFeedbackRate(). Preserved across re-configuration.
+					                      */
+					uint32_t FeedbackNominal; /**< Feedback value for \c SampleRate exactly. */
+					uint32_t FeedbackValue; /**< Current filtered feedback value reported to the host. */
+					uint32_t FeedbackSOFCount; /**< SOF events seen in the current estimation period. */
+					uint32_t FeedbackSampleMark; /**< Played sample counter at the start of the current estimation period. */
+					uint32_t FeedbackData; /**< Little endian feedback packet handed to the controller. */
 				} State; /**< State data for the USB class interface within the device. All elements in this section
 				          *   are reset to their defaults when the interface is enumerated.
 				          */
@@ -180,6 +208,45 @@
 			 */
 			void EVENT_Audio_Device_StreamStartStop(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo);
 
+			/**
+			 * @brief	Sets the nominal sample rate of the outgoing stream and resets the asynchronous feedback estimator to
+			 *  it. Call this before enumeration and whenever the host changes the sampling frequency.
+			 *
+			 * @param	AudioInterfaceInfo	: Pointer to a structure containing an Audio Class configuration and state.
+			 * @param	SampleRate			: Nominal sample rate in Hz.
+			 * @return	Nothing
+			 */
+			void Audio_Device_SetFeedbackRate(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+			                                  const uint32_t SampleRate) ATTR_NON_NULL_PTR_ARG(1);
+
+			/**
+			 * @brief	Feeds the asynchronous feedback rate estimator. This should be called from the
+			 *  @ref EVENT_USB_Device_StartOfFrame() event, i.e. once per frame at full-speed and once per microframe at
+			 *  high-speed, with a timestamp of the audio sink taken at that SOF.
+			 *
+			 *  Every 2^@ref AUDIO_FEEDBACK_PERIOD_SHIFT SOFs the number of samples consumed is converted to samples per
+			 *  (micro)frame, trimmed by the buffer fill error and low-pass filtered into the value sent to the host.
+			 *
+			 * @param	AudioInterfaceInfo	: Pointer to a structure containing an Audio Class configuration and state.
+			 * @param	SamplesPlayed		: Free running count of sample frames consumed by the audio sink (e.g. I2S).
+			 * @param	FillError			: Buffered sample frames above (positive) or below (negative) the target depth.
+			 * @return	Nothing
+			 */
+			void Audio_Device_FeedbackSOF(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+			                              const uint32_t SamplesPlayed,
+			                              const int32_t FillError) ATTR_NON_NULL_PTR_ARG(1);
+
+			/**
+			 * @brief	Returns the feedback packet for the asynchronous feedback endpoint. Call this from
+			 *  \c CALLBACK_HAL_GetISOBufferAddress() when it is asked for \c DataFeedbackEndpointNumber.
+			 *
+			 * @param	AudioInterfaceInfo	: Pointer to a structure containing an Audio Class configuration and state.
+			 * @param	PacketSize			: Set to the feedback packet size, 3 bytes at full-speed and 4 at high-speed.
+			 * @return	Address of the feedback packet.
+			 */
+			uint32_t Audio_Device_GetFeedbackBuffer(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+			                                        uint32_t* const PacketSize) ATTR_NON_NULL_PTR_ARG(1);
+
 		/* Inline Functions: */
 			/**
 			 * @brief	General management task for a given Audio class interface, required for the correct operation of the interface. This should
@@ -113,6 +113,12 @@ void CDC_Device_ProcessControlRequest(USB_ClassInfo_CDC_Device_t* const CDCInter
 
 bool CDC_Device_ConfigureEndpoints(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 {
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* have the controller let go of the streaming buffers before forgetting them */
+	Endpoint_AbortTransfers(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN);
+	Endpoint_AbortTransfers(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT);
+	#endif
+
 	memset(&CDCInterfaceInfo->State, 0x00, sizeof(CDCInterfaceInfo->State));
 
 	for (uint8_t EndpointNum = 1; EndpointNum < ENDPOINT_TOTAL_ENDPOINTS(CDCInterfaceInfo->Config.PortNumber); EndpointNum++)
@@ -155,6 +161,20 @@ bool CDC_Device_ConfigureEndpoints(USB_ClassInfo_CDC_Device_t* const CDCInterfac
 		}
 	}
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if ((CDCInterfaceInfo->Config.TxBuffer != NULL) && !(CDCInterfaceInfo->Config.TxBufferSize))
+	  return false;
+
+	if (CDCInterfaceInfo->Config.RxBuffer != NULL)
+	{
+		if (!(CDCInterfaceInfo->Config.RxPackets) || (CDCInterfaceInfo->Config.RxPackets > CDC_RX_MAX_PACKETS))
+		  return false;
+
+		for (uint8_t Slot = 0; Slot < CDCInterfaceInfo->Config.RxPackets; Slot++)
+		  CDC_Device_SubmitRx(CDCInterfaceInfo, Slot);
+	}
+	#endif
+
 	return true;
 }
 
@@ -164,6 +184,13 @@ void CDC_Device_USBTask(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 	  return;
 
 	#if !defined(NO_CLASS_DRIVER_AUTOFLUSH)
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* in streaming mode bytes collect while the IN endpoint is busy and go out together */
+	if ((CDCInterfaceInfo->Config.TxBuffer != NULL) && (CDCInterfaceInfo->State.Stream.TxLast != NULL) &&
+	    (CDCInterfaceInfo->State.Stream.TxLast->Status == ENDPOINT_XFER_Pending))
+	  return;
+	#endif
+
 	CDC_Device_Flush(CDCInterfaceInfo);
 	#endif
 }
@@ -174,6 +201,11 @@ uint8_t CDC_Device_SendString(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxBuffer != NULL)
+	  return CDC_Device_WriteTx(CDCInterfaceInfo, (const uint8_t*)String, strlen(String));
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 	Endpoint_Write_Stream_LE(CDCInterfaceInfo->Config.PortNumber, String, strlen(String), NULL);
 	Endpoint_ClearIN(CDCInterfaceInfo->Config.PortNumber);
@@ -187,6 +219,11 @@ uint8_t CDC_Device_SendData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxBuffer != NULL)
+	  return CDC_Device_WriteTx(CDCInterfaceInfo, (const uint8_t*)Buffer, Length);
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 	Endpoint_Write_Stream_LE(CDCInterfaceInfo->Config.PortNumber, Buffer, Length, NULL);
 	Endpoint_ClearIN(CDCInterfaceInfo->Config.PortNumber);
@@ -199,6 +236,11 @@ uint8_t CDC_Device_SendByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxBuffer != NULL)
+	  return CDC_Device_WriteTx(CDCInterfaceInfo, &Data, 1);
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 
 	if (!(Endpoint_IsReadWriteAllowed(CDCInterfaceInfo->Config.PortNumber)))
@@ -222,6 +264,25 @@ uint8_t CDC_Device_Flush(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 
 	uint8_t ErrorCode;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.TxBuffer != NULL)
+	{
+		ErrorCode = ENDPOINT_READYWAIT_NoError;
+
+		if (CDCInterfaceInfo->State.Stream.TxFill)
+		  ErrorCode = CDC_Device_SubmitTxHalf(CDCInterfaceInfo);
+
+		if (!(ErrorCode) && CDCInterfaceInfo->State.Stream.TxZlpOwed &&
+		    (CDCInterfaceInfo->State.Stream.TxZlp.Status != ENDPOINT_XFER_Pending))
+		{
+			CDCInterfaceInfo->State.Stream.TxZlp.Length = 0;
+			ErrorCode = CDC_Device_SubmitTx(CDCInterfaceInfo, &CDCInterfaceInfo->State.Stream.TxZlp);
+		}
+
+		return ErrorCode;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
 
 	if (!(Endpoint_BytesInEndpoint(CDCInterfaceInfo->Config.PortNumber)))
@@ -247,6 +308,28 @@ uint16_t CDC_Device_BytesReceived(USB_ClassInfo_CDC_Device_t* const CDCInterface
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
 	  return 0;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.RxBuffer != NULL)
+	{
+		Endpoint_Transfer_t* Transfer = CDC_Device_ReadRx(CDCInterfaceInfo);
+		uint8_t  Slot = CDCInterfaceInfo->State.Stream.RxHead;
+		uint32_t Bytes;
+
+		if (Transfer == NULL)
+		  return 0;
+
+		Bytes = Transfer->Actual - CDCInterfaceInfo->State.Stream.RxOffset;
+
+		while (((Slot = (Slot + 1) % CDCInterfaceInfo->Config.RxPackets) != CDCInterfaceInfo->State.Stream.RxHead) &&
+		       (CDCInterfaceInfo->State.Stream.Rx[Slot].Status == ENDPOINT_XFER_Done))
+		{
+			Bytes += CDCInterfaceInfo->State.Stream.Rx[Slot].Actual;
+		}
+
+		return MIN(Bytes, 0xFFFF);
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (Endpoint_IsOUTReceived(CDCInterfaceInfo->Config.PortNumber))
@@ -274,6 +357,18 @@ int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInf
 
 	int16_t ReceivedByte = -1;
 
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.RxBuffer != NULL)
+	{
+		Endpoint_Transfer_t* Transfer = CDC_Device_ReadRx(CDCInterfaceInfo);
+
+		if (Transfer != NULL)
+		  ReceivedByte = Transfer->Buffer[CDCInterfaceInfo->State.Stream.RxOffset++];
+
+		return ReceivedByte;
+	}
+	#endif
+
 	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber);
 
 	if (Endpoint_IsOUTReceived(CDCInterfaceInfo->Config.PortNumber))
@@ -290,6 +385,115 @@ int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInf
 	return ReceivedByte;
 }
 
+uint16_t CDC_Device_ReceiveData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                char* const Buffer,
+                                const uint16_t Length)
+{
+	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
+	  return 0;
+
+	uint16_t Count = 0;
+
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	if (CDCInterfaceInfo->Config.RxBuffer != NULL)
+	{
+		Endpoint_Transfer_t* Transfer;
+
+		/* read first so a slot emptied by the last copy goes straight back to the controller */
+		while (((Transfer = CDC_Device_ReadRx(CDCInterfaceInfo)) != NULL) && (Count < Length))
+		{
+			uint16_t Bytes = MIN(Transfer->Actual - CDCInterfaceInfo->State.Stream.RxOffset, (uint32_t)(Length - Count));
+
+			memcpy(&Buffer[Count], &Transfer->Buffer[CDCInterfaceInfo->State.Stream.RxOffset], Bytes);
+			CDCInterfaceInfo->State.Stream.RxOffset += Bytes;
+			Count += Bytes;
+		}
+
+		return Count;
+	}
+	#endif
+
+	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber);
+
+	if (Endpoint_IsOUTReceived(CDCInterfaceInfo->Config.PortNumber))
+	{
+		Count = MIN(Endpoint_BytesInEndpoint(CDCInterfaceInfo->Config.PortNumber), Length);
+
+		if (Count)
+		  Endpoint_Read_Stream_LE(CDCInterfaceInfo->Config.PortNumber, Buffer, Count, NULL);
+
+		if (!(Endpoint_BytesInEndpoint(CDCInterfaceInfo->Config.PortNumber)))
+		  Endpoint_ClearOUT(CDCInterfaceInfo->Config.PortNumber);
+	}
+
+	return Count;
+}
+
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+/* Waits for the packet Endpoint_ClearIN() primed on the selected endpoint to go */
+static uint8_t CDC_Device_WaitINReady(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	uint8_t  corenum             = CDCInterfaceInfo->Config.PortNumber;
+	uint16_t TimeoutMSRem        = USB_STREAM_TIMEOUT_MS;
+	uint16_t PreviousFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+
+	while (!(Endpoint_IsINReady(corenum)))
+	{
+		uint16_t CurrentFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+
+		if (USB_DeviceState[corenum] != DEVICE_STATE_Configured)
+		  return ENDPOINT_RWSTREAM_DeviceDisconnected;
+
+		if (CurrentFrameNumber != PreviousFrameNumber)
+		{
+			PreviousFrameNumber = CurrentFrameNumber;
+
+			if (!(TimeoutMSRem--))
+			  return ENDPOINT_RWSTREAM_Timeout;
+		}
+	}
+
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+uint8_t CDC_Device_SubmitData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                              Endpoint_Transfer_t* const Transfer)
+{
+	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
+	  return ENDPOINT_RWSTREAM_DeviceDisconnected;
+
+	uint8_t ErrorCode;
+
+	if (CDCInterfaceInfo->Config.TxBuffer != NULL)
+	{
+		/* what the send functions buffered goes first */
+		if (CDCInterfaceInfo->State.Stream.TxFill && ((ErrorCode = CDC_Device_SubmitTxHalf(CDCInterfaceInfo)) != ENDPOINT_RWSTREAM_NoError))
+		  return ErrorCode;
+	}
+	else
+	{
+		Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber);
+
+		if (Endpoint_BytesInEndpoint(CDCInterfaceInfo->Config.PortNumber))
+		{
+			if ((ErrorCode = CDC_Device_WaitINReady(CDCInterfaceInfo)) != ENDPOINT_RWSTREAM_NoError)
+			  return ErrorCode;
+
+			Endpoint_ClearIN(CDCInterfaceInfo->Config.PortNumber);
+
+			/* the buffered bytes go out before the transfer is queued */
+			if ((ErrorCode = CDC_Device_WaitINReady(CDCInterfaceInfo)) != ENDPOINT_RWSTREAM_NoError)
+			  return ErrorCode;
+		}
+
+		/* nothing flushes behind it in packet mode */
+		Transfer->Flags |= ENDPOINT_XFER_ZLP;
+	}
+
+	return CDC_Device_SubmitTx(CDCInterfaceInfo, Transfer);
+}
+#endif
+
 void CDC_Device_SendControlLineStateChange(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 {
 	if ((USB_DeviceState[CDCInterfaceInfo->Config.PortNumber] != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
@@ -361,6 +565,114 @@ static int CDC_Device_getchar_Blocking(FILE* Stream)
 }
 #endif
 
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+static uint8_t CDC_Device_SubmitTx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                   Endpoint_Transfer_t* const Transfer)
+{
+	/* a transfer that fills its last packet owes the host a zero length packet
+	 * unless more data follows before the endpoint goes idle */
+	CDCInterfaceInfo->State.Stream.TxLast    = Transfer;
+	CDCInterfaceInfo->State.Stream.TxZlpOwed = (Transfer->Length != 0) && !(Transfer->Flags & ENDPOINT_XFER_ZLP) &&
+	                                           !(Transfer->Length % CDCInterfaceInfo->Config.DataINEndpointSize);
+
+	return Endpoint_SubmitTransfer(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+	                               Transfer);
+}
+
+static uint8_t CDC_Device_SubmitTxHalf(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	Endpoint_Transfer_t* Transfer = &CDCInterfaceInfo->State.Stream.Tx[CDCInterfaceInfo->State.Stream.TxHalf];
+
+	Transfer->Buffer = &CDCInterfaceInfo->Config.TxBuffer[CDCInterfaceInfo->State.Stream.TxHalf * CDCInterfaceInfo->Config.TxBufferSize];
+	Transfer->Length = CDCInterfaceInfo->State.Stream.TxFill;
+	Transfer->Flags  = 0;
+
+	CDCInterfaceInfo->State.Stream.TxHalf ^= 1;
+	CDCInterfaceInfo->State.Stream.TxFill  = 0;
+
+	return CDC_Device_SubmitTx(CDCInterfaceInfo, Transfer);
+}
+
+static uint8_t CDC_Device_WriteTx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                  const uint8_t* Data,
+                                  uint16_t Length)
+{
+	uint8_t ErrorCode;
+
+	while (Length)
+	{
+		Endpoint_Transfer_t* Transfer = &CDCInterfaceInfo->State.Stream.Tx[CDCInterfaceInfo->State.Stream.TxHalf];
+		uint16_t Count = MIN(Length, CDCInterfaceInfo->Config.TxBufferSize - CDCInterfaceInfo->State.Stream.TxFill);
+
+		/* the half is still being sent from the last time round */
+		if ((Transfer->Status == ENDPOINT_XFER_Pending) &&
+		    ((ErrorCode = Endpoint_WaitTransfer(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataINEndpointNumber | ENDPOINT_DIR_IN,
+		                                        Transfer)) != ENDPOINT_RWSTREAM_NoError))
+		{
+			return ErrorCode;
+		}
+
+		memcpy(&CDCInterfaceInfo->Config.TxBuffer[CDCInterfaceInfo->State.Stream.TxHalf * CDCInterfaceInfo->Config.TxBufferSize +
+		                                          CDCInterfaceInfo->State.Stream.TxFill], Data, Count);
+		CDCInterfaceInfo->State.Stream.TxFill += Count;
+		Data   += Count;
+		Length -= Count;
+
+		if ((CDCInterfaceInfo->State.Stream.TxFill == CDCInterfaceInfo->Config.TxBufferSize) &&
+		    ((ErrorCode = CDC_Device_SubmitTxHalf(CDCInterfaceInfo)) != ENDPOINT_RWSTREAM_NoError))
+		{
+			return ErrorCode;
+		}
+	}
+
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+static void CDC_Device_SubmitRx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                const uint8_t Slot)
+{
+	Endpoint_Transfer_t* Transfer = &CDCInterfaceInfo->State.Stream.Rx[Slot];
+
+	Transfer->Buffer   = &CDCInterfaceInfo->Config.RxBuffer[Slot * CDCInterfaceInfo->Config.DataOUTEndpointSize];
+	Transfer->Length   = CDCInterfaceInfo->Config.DataOUTEndpointSize;
+	Transfer->Flags    = ENDPOINT_XFER_HOLD;
+	Transfer->Callback = CDC_Device_RxComplete;
+	Transfer->Context  = CDCInterfaceInfo;
+
+	Endpoint_SubmitTransfer(CDCInterfaceInfo->Config.PortNumber, CDCInterfaceInfo->Config.DataOUTEndpointNumber | ENDPOINT_DIR_OUT,
+	                        Transfer);
+}
+
+/* Returns the slot being read if it holds unread data. Slots read to the end, or
+ * filled by a zero length packet, go back to the controller on the way */
+static Endpoint_Transfer_t* CDC_Device_ReadRx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+{
+	for (uint8_t i = 0; i < CDCInterfaceInfo->Config.RxPackets; i++)
+	{
+		Endpoint_Transfer_t* Transfer = &CDCInterfaceInfo->State.Stream.Rx[CDCInterfaceInfo->State.Stream.RxHead];
+
+		if (Transfer->Status != ENDPOINT_XFER_Done)
+		  return NULL;
+
+		if (CDCInterfaceInfo->State.Stream.RxOffset < Transfer->Actual)
+		  return Transfer;
+
+		CDCInterfaceInfo->State.Stream.RxOffset = 0;
+		CDC_Device_SubmitRx(CDCInterfaceInfo, CDCInterfaceInfo->State.Stream.RxHead);
+		CDCInterfaceInfo->State.Stream.RxHead = (CDCInterfaceInfo->State.Stream.RxHead + 1) % CDCInterfaceInfo->Config.RxPackets;
+	}
+
+	return NULL;
+}
+
+static void CDC_Device_RxComplete(uint8_t corenum,
+                                  Endpoint_Transfer_t* Transfer)
+{
+	if ((Transfer->Status == ENDPOINT_XFER_Done) && Transfer->Actual)
+	  EVENT_CDC_Device_DataReceived((USB_ClassInfo_CDC_Device_t*)Transfer->Context);
+}
+#endif
+
 void CDC_Device_Event_Stub(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 {
 
@@ -105,8 +105,22 @@
 					uint16_t NotificationEndpointSize;  /**< Size in bytes of the CDC interface's IN notification endpoint, if used. */
 					bool     NotificationEndpointDoubleBank; /**< Indicates if the CDC interface's notification endpoint should use double banking. */
 					uint8_t  PortNumber;				/**< Port number that this interface is running.*/
+
+					#if defined(__LPC18XX__) || defined(__LPC43XX__)
+					uint8_t* TxBuffer; /**< Streaming mode: two halves of \c TxBufferSize bytes each. The send functions fill one
+					                    *   while the controller sends the other straight from memory, so the IN endpoint never
+					                    *   waits for the application. \c NULL (the default) sends packet by packet.
+					                    */
+					uint16_t TxBufferSize; /**< Size in bytes of each half of \c TxBuffer, a multiple of the IN endpoint size. */
+					uint8_t* RxBuffer; /**< Streaming mode: ring of \c RxPackets slots of \c DataOUTEndpointSize bytes each that
+					                    *   stay queued on the OUT endpoint, so the host can send that many packets ahead of
+					                    *   the application. \c NULL (the default) receives packet by packet.
+					                    */
+					uint8_t  RxPackets; /**< Number of slots in \c RxBuffer, at most @ref CDC_RX_MAX_PACKETS. */
+					#endif
 				} Config; /**< Config data for the USB class interface within the device. All elements in this section
-				           *   <b>must</b> be set or the interface will fail to enumerate and operate correctly.
+				           *   <b>must</b> be set or the interface will fail to enumerate and operate correctly, except
+				           *   for the streaming mode buffers.
 				           */
 				struct
 				{
@@ -125,6 +139,21 @@
 					                                  *  This is generally only used if the virtual serial port data is to be
 					                                  *  reconstructed on a physical UART.
 					                                  */
+
+					#if defined(__LPC18XX__) || defined(__LPC43XX__)
+					struct
+					{
+						Endpoint_Transfer_t Tx[2]; /**< Transfers of the two \c TxBuffer halves. */
+						Endpoint_Transfer_t TxZlp; /**< Zero length packet ending a burst that filled its last packet. */
+						Endpoint_Transfer_t* TxLast; /**< Last transfer submitted on the IN endpoint. */
+						uint16_t TxFill; /**< Bytes waiting in the half being filled. */
+						uint8_t  TxHalf; /**< Half being filled. */
+						bool     TxZlpOwed; /**< The last transfer ended on a packet boundary without a zero length packet. */
+						Endpoint_Transfer_t Rx[CDC_RX_MAX_PACKETS]; /**< Transfers of the \c RxBuffer slots. */
+						uint8_t  RxHead; /**< Slot being read, the oldest. */
+						uint16_t RxOffset; /**< Bytes read from it. */
+					} Stream; /**< Streaming mode buffer management, unused when sending and receiving packet by packet. */
+					#endif
 				} State; /**< State data for the USB class interface within the device. All elements in this section
 				          *   are reset to their defaults when the interface is enumerated.
 				          */
@@ -201,6 +230,9 @@
 			 *  becomes full, or the @ref CDC_Device_Flush() function is called to flush the pending data to the host. This allows
 			 *  for multiple bytes to be packed into a single endpoint packet, increasing data throughput.
 			 *
+			 *  In streaming mode the data is copied to the half of \c TxBuffer being filled, which is sent as soon as it is full;
+			 *  the function only waits when the other half is still on the bus.
+			 *
 			 *  \pre This function must only be called when the Device state machine is in the @ref DEVICE_STATE_Configured state or
 			 *       the call will fail.
 			 *
@@ -251,6 +283,9 @@
 			 *  succeed immediately. If multiple bytes are to be received, they should be buffered by the user application, as the endpoint
 			 *  bank will not be released back to the USB controller until all bytes are read.
 			 *
+			 *  In streaming mode this is the number of bytes waiting in the \c RxBuffer ring, and slots are handed back to the
+			 *  controller as they are read.
+			 *
 			 *  \pre This function must only be called when the Device state machine is in the @ref DEVICE_STATE_Configured state or
 			 *       the call will fail.
 			 *
@@ -273,9 +308,57 @@
 			 */
 			int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
 
+			/**
+			 * @brief	Reads up to Length bytes of data from the host without waiting. The bytes come from the OUT endpoint bank, or in
+			 *  streaming mode from as many \c RxBuffer slots as hold data.
+			 *
+			 *  \pre This function must only be called when the Device state machine is in the @ref DEVICE_STATE_Configured state or
+			 *       the call will fail.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   Buffer              : Pointer to a buffer where the received data is to be stored.
+			 * @param   Length              : Size of the buffer in bytes.
+			 * @return	Number of bytes read, 0 if no data was waiting.
+			 */
+			uint16_t CDC_Device_ReceiveData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                                char* const Buffer,
+			                                const uint16_t Length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+			#if defined(__LPC18XX__) || defined(__LPC43XX__)
+			/**
+			 * @brief	Queues a whole buffer for the host, sent straight from memory after anything the send functions have buffered.
+			 *  Returns at once; the buffer belongs to the controller until Transfer->Status leaves @ref ENDPOINT_XFER_Pending and
+			 *  Transfer->Callback, if set, runs in the USB interrupt. A transfer that ends on a packet boundary is followed by a zero
+			 *  length packet unless more data is queued behind it before the IN endpoint goes idle.
+			 *
+			 *  \pre This function must only be called when the Device state machine is in the @ref DEVICE_STATE_Configured state or
+			 *       the call will fail.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @param   Transfer            : Buffer, Length and optionally Callback and Context filled in.
+			 * @return	A value from the @ref Endpoint_Stream_RW_ErrorCodes_t enum.
+			 */
+			uint8_t CDC_Device_SubmitData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                              Endpoint_Transfer_t* const Transfer) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
+			/**
+			 * @brief	CDC class driver event for data arriving in streaming mode. Fires from the USB interrupt each time a packet
+			 *  lands in an \c RxBuffer slot, so an RTOS task can sleep until there is something to read. It must not call the
+			 *  receive functions itself.
+			 *
+			 * @param	CDCInterfaceInfo	: Pointer to a structure containing a CDC Class configuration and state.
+			 * @return	Nothing
+			 */
+			void EVENT_CDC_Device_DataReceived(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+			#endif
+
 			/**
 			 * @brief	Flushes any data waiting to be sent, ensuring that the send buffer is cleared.
 			 *
+			 *  In streaming mode the buffered bytes are handed to the controller, followed by a zero length packet if they end on a
+			 *  packet boundary, and the function returns without waiting for them to be sent. @ref CDC_Device_USBTask() does this
+			 *  whenever the IN endpoint is idle.
+			 *
 			 *  \pre This function must only be called when the Device state machine is in the @ref DEVICE_STATE_Configured state or
 			 *       the call will fail.
 			 *
@@ -346,6 +429,20 @@
 				static int CDC_Device_getchar_Blocking(FILE* Stream) ATTR_NON_NULL_PTR_ARG(1);
 				#endif
 
+				#if defined(__LPC18XX__) || defined(__LPC43XX__)
+				static uint8_t CDC_Device_SubmitTx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+				                                   Endpoint_Transfer_t* const Transfer) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+				static uint8_t CDC_Device_SubmitTxHalf(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+				static uint8_t CDC_Device_WriteTx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+				                                  const uint8_t* Data,
+				                                  uint16_t Length) ATTR_NON_NULL_PTR_ARG(1);
+				static void CDC_Device_SubmitRx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+				                                const uint8_t Slot) ATTR_NON_NULL_PTR_ARG(1);
+				static Endpoint_Transfer_t* CDC_Device_ReadRx(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
+				static void CDC_Device_RxComplete(uint8_t corenum,
+				                                  Endpoint_Transfer_t* Transfer) ATTR_NON_NULL_PTR_ARG(2);
+				#endif
+
 				void CDC_Device_Event_Stub(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_CONST;
 				void CDC_Device_Event_Stub2(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo, const uint8_t Duration) ATTR_CONST;
 
@@ -359,6 +456,11 @@ PRAGMA_WEAK(EVENT_CDC_Device_BreakSent,CDC_Device_Event_Stub2)
 				void EVENT_CDC_Device_BreakSent(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
 				                                const uint8_t Duration) ATTR_WEAK ATTR_NON_NULL_PTR_ARG(1)
 				                                ATTR_ALIAS(CDC_Device_Event_Stub2);
+				#if defined(__LPC18XX__) || defined(__LPC43XX__)
+PRAGMA_WEAK(EVENT_CDC_Device_DataReceived,CDC_Device_Event_Stub)
+				void EVENT_CDC_Device_DataReceived(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
+				                                   ATTR_WEAK ATTR_NON_NULL_PTR_ARG(1) ATTR_ALIAS(CDC_Device_Event_Stub);
+				#endif
 			#endif
 
 	#endif
@@ -272,7 +272,7 @@ static uint8_t MS_Host_SendReceiveData(USB_ClassInfo_MS_Host_t* const MSInterfac
                                        MS_CommandBlockWrapper_t* const SCSICommandBlock,
                                        void* BufferPtr)
 {
-	uint16_t BytesRem  = le32_to_cpu(SCSICommandBlock->DataTransferLength);
+	uint32_t BytesRem  = le32_to_cpu(SCSICommandBlock->DataTransferLength);
 	uint8_t portnum = MSInterfaceInfo->Config.PortNumber;
 #if defined(__LPC177X_8X__) || defined(__LPC407X_8X__)
 	uint8_t  ErrorCode = PIPE_RWSTREAM_NoError;
@@ -314,6 +314,7 @@ static uint8_t MS_Host_SendReceiveData(USB_ClassInfo_MS_Host_t* const MSInterfac
 
 	return ErrorCode;
 #else
+	uint8_t  ErrorCode;
 	uint16_t packsize;
 	if (SCSICommandBlock->Flags & MS_COMMAND_DIR_DATA_IN)
 	{
@@ -326,12 +327,13 @@ static uint8_t MS_Host_SendReceiveData(USB_ClassInfo_MS_Host_t* const MSInterfac
 		packsize = MSInterfaceInfo->State.DataOUTPipeSize;
 	}
 
-	Pipe_Streaming(portnum,(uint8_t*)BufferPtr,BytesRem,packsize);
+	if ((ErrorCode = Pipe_Streaming(portnum,(uint8_t*)BufferPtr,BytesRem,packsize)) != PIPE_RWSTREAM_NoError)
+	  return ErrorCode;
 
-	while(!Pipe_IsStatusOK(portnum));
+	ErrorCode = Pipe_WaitStreaming(portnum, MS_COMMAND_DATA_TIMEOUT_MS);
 
 	Pipe_ClearIN(portnum);
-	return PIPE_RWSTREAM_NoError;
+	return ErrorCode;
 #endif
 }
 
@@ -587,7 +589,7 @@ uint8_t MS_Host_PreventAllowMediumRemoval(USB_ClassInfo_MS_Host_t* const MSInter
 uint8_t MS_Host_ReadDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
                                  const uint8_t LUNIndex,
                                  const uint32_t BlockAddress,
-                                 const uint8_t Blocks,
+                                 const uint16_t Blocks,
                                  const uint16_t BlockSize,
                                  void* BlockBuffer)
 {
@@ -611,8 +613,8 @@ uint8_t MS_Host_ReadDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
 					(BlockAddress >> 8),
 					(BlockAddress & 0xFF),  // LSB of Block Address
 					0x00,                   // Reserved
-					0x00,                   // MSB of Total Blocks to Read
-					Blocks,                 // LSB of Total Blocks to Read
+					(Blocks >> 8),          // MSB of Total Blocks to Read
+					(Blocks & 0xFF),        // LSB of Total Blocks to Read
 					0x00                    // Unused (control)
 				}
 		};
@@ -626,7 +628,7 @@ uint8_t MS_Host_ReadDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
 uint8_t MS_Host_WriteDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
                                   const uint8_t LUNIndex,
                                   const uint32_t BlockAddress,
-                                  const uint8_t Blocks,
+                                  const uint16_t Blocks,
                                   const uint16_t BlockSize,
                                   const void* BlockBuffer)
 {
@@ -650,8 +652,8 @@ uint8_t MS_Host_WriteDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo
 					(BlockAddress >> 8),
 					(BlockAddress & 0xFF),  // LSB of Block Address
 					0x00,                   // Reserved
-					0x00,                   // MSB of Total Blocks to Write
-					Blocks,                 // LSB of Total Blocks to Write
+					(Blocks >> 8),          // MSB of Total Blocks to Write
+					(Blocks & 0xFF),        // LSB of Total Blocks to Write
 					0x00                    // Unused (control)
 				}
 		};
@@ -252,7 +252,9 @@
 			 *  @param MSInterfaceInfo : Pointer to a structure containing a MS Class host configuration and state.
 			 *  @param LUNIndex        : LUN index within the device the command is being issued to.
 			 *  @param BlockAddress    : Starting block address within the device to read from.
-			 *  @param Blocks          : Total number of blocks to read.
+			 *  @param Blocks          : Total number of blocks to read. On the LPC18xx/43xx the whole transfer is chained
+			 *                           into the controller's qTDs, so one command can move any amount; on the OHCI parts
+			 *                           keep Blocks * BlockSize below 64KB.
 			 *  @param BlockSize       : Size in bytes of each block within the device.
 			 *  @param BlockBuffer     : Pointer to where the read data from the device should be stored.
 			 *
@@ -261,7 +263,7 @@
 			uint8_t MS_Host_ReadDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
 			                                 const uint8_t LUNIndex,
 			                                 const uint32_t BlockAddress,
-			                                 const uint8_t Blocks,
+			                                 const uint16_t Blocks,
 			                                 const uint16_t BlockSize,
 			                                 void* BlockBuffer) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(6);
 
@@ -273,7 +275,8 @@
 			 *  @param MSInterfaceInfo : Pointer to a structure containing a MS Class host configuration and state.
 			 *  @param LUNIndex        : LUN index within the device the command is being issued to.
 			 *  @param BlockAddress    : Starting block address within the device to write to.
-			 *  @param Blocks          : Total number of blocks to read.
+			 *  @param Blocks          : Total number of blocks to write. The same size limits as
+			 *                           @ref MS_Host_ReadDeviceBlocks() apply.
 			 *  @param BlockSize       : Size in bytes of each block within the device.
 			 *  @param BlockBuffer     : Pointer to where the data to write should be sourced from.
 			 *
@@ -282,7 +285,7 @@
 			uint8_t MS_Host_WriteDeviceBlocks(USB_ClassInfo_MS_Host_t* const MSInterfaceInfo,
 			                                  const uint8_t LUNIndex,
 			                                  const uint32_t BlockAddress,
-			                                  const uint8_t Blocks,
+			                                  const uint16_t Blocks,
 			                                  const uint16_t BlockSize,
 			                                  const void* BlockBuffer) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(6);
 
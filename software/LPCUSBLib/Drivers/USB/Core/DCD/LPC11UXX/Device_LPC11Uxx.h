@@ -99,6 +99,14 @@ static inline uint16_t USB_Device_GetFrameNumber(void)
 	return 0;
 }
 
+/* Full-speed only controller */
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum) ATTR_ALWAYS_INLINE ATTR_WARN_UNUSED_RESULT;
+
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum)
+{
+	return false;
+}
+
 			#if !defined(NO_SOF_EVENTS)
 
 PRAGMA_ALWAYS_INLINE
@@ -242,6 +242,9 @@ void USB_IRQHandler(void)
 		for (PhyEP = 0; PhyEP < USED_PHYSICAL_ENDPOINTS; PhyEP++) /* Check All Endpoints */
 			if ( IntStat & (1 << PhyEP) ) {
 				if ( IsOutEndpoint(PhyEP) ) {	/* OUT Endpoint */
+					if ((PhyEP == 0) && Endpoint_IsSETUPReceived(0)) {
+						EVENT_USB_Device_TaskPending(0);
+					}
 					if ( !Endpoint_IsSETUPReceived(0) ) {
 						if (EndPointCmdStsList[PhyEP][0].NBytes == 0x200) {
 							if (PhyEP == 0) {
@@ -117,6 +117,14 @@ static inline uint16_t USB_Device_GetFrameNumber(void)
 	return val;
 }*/
 
+/* Full-speed only controller */
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum) ATTR_ALWAYS_INLINE ATTR_WARN_UNUSED_RESULT;
+
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum)
+{
+	return false;
+}
+
 			#if !defined(NO_SOF_EVENTS)
 /** Enables the device mode Start Of Frame events. When enabled, this causes the
 *  @ref EVENT_USB_Device_StartOfFrame() event to fire once per millisecond, synchronized to the USB bus,
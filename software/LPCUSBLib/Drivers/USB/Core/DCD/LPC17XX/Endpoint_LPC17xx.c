@@ -265,6 +265,7 @@ void SlaveEndpointISR()
 				if (SIEEndpointStatus & EP_SEL_STP) {	/* Setup Packet */
 					SETUPReceived = true;
 					ReadControlEndpoint(SetupPackage);
+					EVENT_USB_Device_TaskPending(0);
 				}
 				else {
 					ReadControlEndpoint(usb_data_buffer[0]);
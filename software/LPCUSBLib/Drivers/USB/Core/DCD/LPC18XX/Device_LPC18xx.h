@@ -140,6 +140,19 @@ static inline uint16_t USB_Device_GetFrameNumber(uint8_t corenum)
 	return USB_REG(corenum)->FRINDEX_D;
 }
 
+/**
+ * @brief Returns whether the port has negotiated high-speed operation with the host, in which case SOF events fire
+ *  once per 125us microframe rather than once per millisecond.
+ *  @param	corenum		: ID Number of USB Core to be processed.
+ *  @return Boolean \c true if the port is running at high-speed.
+ */
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum) ATTR_ALWAYS_INLINE ATTR_WARN_UNUSED_RESULT;
+
+static inline bool USB_Device_IsHighSpeed(uint8_t corenum)
+{
+	return (USB_REG(corenum)->PORTSC1_D & PORTSC_D_HighSpeedStatus) ? true : false;
+}
+
 			#if !defined(NO_SOF_EVENTS)
 /**
  * @brief Enables the device mode Start Of Frame events. When enabled, this causes the
@@ -68,11 +68,26 @@ PRAGMA_ALIGN_32
 DeviceTransferDescriptor dStreamTD0[STREAM_TDs] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
 PRAGMA_ALIGN_32
 DeviceTransferDescriptor dStreamTD1[STREAM_TDs] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
+/* Isochronous endpoints run from a ring of USB_ISO_DTDS linked dTDs each */
+PRAGMA_ALIGN_32
+DeviceTransferDescriptor dIsoTD0[USED_PHYSICAL_ENDPOINTS0][USB_ISO_DTDS] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
+PRAGMA_ALIGN_32
+DeviceTransferDescriptor dIsoTD1[USED_PHYSICAL_ENDPOINTS1][USB_ISO_DTDS] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
+/* Endpoint_SubmitTransfer() runs each bulk/interrupt endpoint from USB_XFER_DTDS dTDs */
+PRAGMA_ALIGN_32
+DeviceTransferDescriptor dXferTD0[USED_PHYSICAL_ENDPOINTS0][USB_XFER_DTDS] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
+PRAGMA_ALIGN_32
+DeviceTransferDescriptor dXferTD1[USED_PHYSICAL_ENDPOINTS1][USB_XFER_DTDS] ATTR_ALIGNED(32) __BSS(USBRAM_SECTION);
 PRAGMA_ALIGN_4
 uint8_t iso_buffer[512] ATTR_ALIGNED(4);
 volatile DeviceQueueHead* const dQueueHead[LPC18_43_MAX_USB_CORE] = {dQueueHead0, dQueueHead1};
 DeviceTransferDescriptor* const dTransferDescriptor[LPC18_43_MAX_USB_CORE] = {dTransferDescriptor0, dTransferDescriptor1};
 DeviceTransferDescriptor* const dStreamTD_Tbl[LPC18_43_MAX_USB_CORE] = {dStreamTD0, dStreamTD1};
+DeviceTransferDescriptor(*const dIsoTD_Tbl[LPC18_43_MAX_USB_CORE])[USB_ISO_DTDS] = {dIsoTD0, dIsoTD1};
+DeviceTransferDescriptor(*const dXferTD_Tbl[LPC18_43_MAX_USB_CORE])[USB_XFER_DTDS] = {dXferTD0, dXferTD1};
+
+/* Oldest queued dTD of each isochronous ring. The newest is the one before it */
+static uint8_t IsoTDHead[LPC18_43_MAX_USB_CORE][USED_PHYSICAL_ENDPOINTS0];
 
 typedef struct
 {
@@ -86,6 +101,31 @@ typedef struct
 
 static STREAM_VAR_t Stream_Variable[LPC18_43_MAX_USB_CORE];
 
+/* Most one dTD carries: five 4KB buffer pages hold 16KB wherever the data starts */
+#define XFER_TD_BYTES   0x4000
+
+/* ENDPTSTAT polls DcdXferFill() gives a dTD that is still retiring, with
+ * interrupts masked, before it leaves the transfer to that dTD's completion
+ * interrupt */
+#define XFER_STAT_POLLS 1000
+
+/* Transfers queued on an endpoint by Endpoint_SubmitTransfer(). dTDs retire in
+ * order so the oldest one always belongs to head */
+typedef struct
+{
+	Endpoint_Transfer_t *head,		/* oldest transfer not completed */
+	                    *tail,		/* newest */
+	                    *fill;		/* first transfer not yet all handed to dTDs */
+	uint32_t fill_offset;			/* bytes of it handed over */
+	uint8_t fill_zlp;				/* it ends with a zero length packet */
+	uint8_t first;					/* oldest queued dTD */
+	uint8_t count;					/* dTDs queued */
+	uint8_t last[USB_XFER_DTDS];	/* dTD ends its transfer */
+	uint16_t size[USB_XFER_DTDS];	/* bytes the dTD was given */
+} XFER_VAR_t;
+
+static XFER_VAR_t Xfer_Variable[LPC18_43_MAX_USB_CORE][USED_PHYSICAL_ENDPOINTS0];
+
 PRAGMA_WEAK(CALLBACK_HAL_GetISOBufferAddress, Dummy_EPGetISOAddress)
 uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t* last_packet_size) ATTR_WEAK ATTR_ALIAS(
     Dummy_EPGetISOAddress);
@@ -100,6 +140,37 @@ void DcdInsertTD(uint32_t head, uint32_t newtd);
 
 void DcdPrepareTD(DeviceTransferDescriptor* pDTD, uint8_t* pData, uint32_t length, uint8_t IOC);
 
+static void DcdIsoStart(uint8_t corenum, uint8_t PhyEP);
+
+static void DcdIsoComplete(uint8_t corenum, uint8_t PhyEP);
+
+static bool DcdFlushEndpoint(uint8_t corenum, uint8_t PhyEP);
+
+static bool DcdXferStop(uint8_t corenum, uint8_t PhyEP);
+
+static void DcdXferComplete(uint8_t corenum, uint8_t PhyEP);
+
+static void DcdXferAbort(uint8_t corenum, uint8_t PhyEP);
+
+#if defined(USB_CAPTURE_ENABLED)
+/* Transfer type of a physical endpoint, control on endpoint 0 */
+static uint8_t DcdCaptureType(uint8_t corenum, uint8_t PhyEP)
+{
+	return (ENDPTCTRL_REG(corenum, PhyEP / 2) >> ((PhyEP & 1) ? 18 : 2)) & EP_TYPE_MASK;
+}
+
+/* Error bits of a retired dTD */
+static uint8_t DcdCaptureStatus(DeviceTransferDescriptor* pDTD)
+{
+	return (pDTD->Halted ? USB_CAPTURE_STATUS_HALTED : 0) |
+	       (pDTD->TransactionErr ? USB_CAPTURE_STATUS_XACT_ERROR : 0) |
+	       (pDTD->BufferErr ? USB_CAPTURE_STATUS_BUFFER_ERROR : 0);
+}
+
+/* Endpoint address of a physical endpoint */
+#define DCD_CAPTURE_ADDRESS(PhyEP)		(((PhyEP) / 2) | (((PhyEP) & 1) ? ENDPOINT_DIR_IN : 0))
+#endif
+
 void HAL_Reset(uint8_t corenum)
 {
 	uint32_t i;
@@ -124,6 +195,10 @@ void HAL_Reset(uint8_t corenum)
 	while (USB_Reg->ENDPTPRIME) ;				/* Wait until all bits are 0 */
 	USB_Reg->ENDPTFLUSH = 0xFFFFFFFF;
 	while (USB_Reg->ENDPTFLUSH) ;	/* Wait until all bits are 0 */
+	for (i = 0; i < USED_PHYSICAL_ENDPOINTS(corenum); i++)
+	{
+		DcdXferAbort(corenum, i);
+	}
 	/* Set the interrupt Threshold control interval to 0 */
 	USB_Reg->USBCMD_D &= ~0x00FF0000;
 	/* Configure the Endpoint List Address */
@@ -152,14 +227,19 @@ void HAL_Reset(uint8_t corenum)
 bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uint8_t Type,
                                 const uint8_t Direction, const uint16_t Size, const uint8_t Banks)
 {
-	uint8_t* ISO_Address;
 	volatile DeviceQueueHead* pdQueueHead;
 	uint32_t PhyEP = 2 * Number + (Direction == ENDPOINT_DIR_OUT ? 0 : 1);
 	__IO uint32_t* pEndPointCtrl = &ENDPTCTRL_REG(corenum, Number);
 	uint32_t EndPtCtrl = *pEndPointCtrl;
 	pdQueueHead = &(dQueueHead[corenum][PhyEP]);
+	/* An isochronous ring keeps itself primed, stop it before reusing the dQH */
+	if (!DcdFlushEndpoint(corenum, PhyEP))
+	{
+		return false;
+	}
+	DcdXferAbort(corenum, PhyEP);
 	memset((void*) pdQueueHead, 0, sizeof(DeviceQueueHead) );
-	pdQueueHead->MaxPacketSize = Size & 0x3ff;
+	pdQueueHead->MaxPacketSize = ENDPOINT_SIZE_PACKET(Size);
 	pdQueueHead->IntOnSetup = 1;
 	pdQueueHead->ZeroLengthTermination = 1;
 	pdQueueHead->overlay.NextTD = LINK_TERMINATE;
@@ -169,10 +249,8 @@ bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uin
 		EndPtCtrl |= ((Type << 2) & ENDPTCTRL_RxType) | ENDPTCTRL_RxEnable | ENDPTCTRL_RxToggleReset;
 		if (Type == EP_TYPE_ISOCHRONOUS)
 		{
-			uint32_t size = 0;
-			*pEndPointCtrl = (Type << 2);					// TODO dummy to let DcdDataTransfer() knows iso transfer
-			ISO_Address = (uint8_t*) CALLBACK_HAL_GetISOBufferAddress(Number, &size);
-			DcdDataTransfer(corenum, PhyEP, ISO_Address, USB_DATA_BUFFER_TEM_LENGTH);
+			pdQueueHead->Mult = ENDPOINT_SIZE_TRANSACTIONS(Size);
+			DcdIsoStart(corenum, PhyEP);
 		}
 		else
 		{
@@ -185,10 +263,8 @@ bool Endpoint_ConfigureEndpoint(uint8_t corenum, const uint8_t Number, const uin
 		EndPtCtrl |= ((Type << 18) & ENDPTCTRL_TxType) | ENDPTCTRL_TxEnable | ENDPTCTRL_TxToggleReset;
 		if (Type == EP_TYPE_ISOCHRONOUS)
 		{
-			uint32_t size = 0;
-			*pEndPointCtrl = (Type << 18);					// TODO dummy to let DcdDataTransfer() knows iso transfer
-			ISO_Address = (uint8_t*) CALLBACK_HAL_GetISOBufferAddress(Number, &size);
-			DcdDataTransfer(corenum, PhyEP, ISO_Address, size);
+			pdQueueHead->Mult = ENDPOINT_SIZE_TRANSACTIONS(Size);
+			DcdIsoStart(corenum, PhyEP);
 		}
 	}
 	*pEndPointCtrl = EndPtCtrl;
@@ -292,9 +368,9 @@ void DcdPrepareTD(DeviceTransferDescriptor* pDTD, uint8_t* pData, uint32_t lengt
 	pDTD->Active = 1;
 	pDTD->BufferPage[0] = (uint32_t) pData;
 	pDTD->BufferPage[1] = ((uint32_t) pData + 0x1000) & 0xfffff000;
-	//	pDTD->BufferPage[2] = ((uint32_t) pData + 0x2000) & 0xfffff000;
-	//	pDTD->BufferPage[3] = ((uint32_t) pData + 0x3000) & 0xfffff000;
-	//	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
+	pDTD->BufferPage[2] = ((uint32_t) pData + 0x2000) & 0xfffff000;
+	pDTD->BufferPage[3] = ((uint32_t) pData + 0x3000) & 0xfffff000;
+	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
 }
 
 void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t* pData, uint32_t length)
@@ -306,22 +382,8 @@ void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t* pData, uint32_t le
 	}
 	/* Zero out the device transfer descriptors */
 	memset((void*) pDTD, 0, sizeof(DeviceTransferDescriptor));
-	if (((ENDPTCTRL_REG(corenum, PhyEP / 2) >> 2) & EP_TYPE_MASK) == EP_TYPE_ISOCHRONOUS)  	// iso out endpoint
-	{
-		uint32_t mult = (USB_DATA_BUFFER_TEM_LENGTH + 1024) / 1024;
-		pDTD->NextTD = LINK_TERMINATE;
-		pdQueueHead->Mult = mult;
-	}
-	else if (((ENDPTCTRL_REG(corenum, PhyEP / 2) >> 18) & EP_TYPE_MASK) == EP_TYPE_ISOCHRONOUS)  // iso in endpoint
-	{
-		uint32_t mult = (USB_DATA_BUFFER_TEM_LENGTH + 1024) / 1024;
-		pDTD->NextTD = LINK_TERMINATE;
-		pdQueueHead->Mult = mult;
-	}
-	else  																		// other endpoint types
-	{
-		pDTD->NextTD = LINK_TERMINATE;	/* The next DTD pointer is INVALID */
-	}
+	/* isochronous Mult is set from the endpoint size by Endpoint_ConfigureEndpoint() */
+	pDTD->NextTD = LINK_TERMINATE;	/* The next DTD pointer is INVALID */
 	pDTD->TotalBytes = length;
 	pDTD->IntOnComplete = 1;
 	pDTD->Active = 1;
@@ -330,17 +392,466 @@ void DcdDataTransfer(uint8_t corenum, uint8_t PhyEP, uint8_t* pData, uint32_t le
 	pDTD->BufferPage[2] = ((uint32_t) pData + 0x2000) & 0xfffff000;
 	pDTD->BufferPage[3] = ((uint32_t) pData + 0x3000) & 0xfffff000;
 	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
+	/* the controller never touches the eighth word, keep the size in it */
+	pDTD->reserved = length;
 	pdQueueHead->overlay.Halted = 0;	/* this should be in USBInt */
 	pdQueueHead->overlay.Active = 0;	/* this should be in USBInt */
 	pdQueueHead->overlay.NextTD = (uint32_t) &dTransferDescriptor[corenum][PhyEP];
 	pdQueueHead->TransferCount = length;
+#if defined(USB_CAPTURE_ENABLED)
+	if (PhyEP & 1)
+	{
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_SUBMIT, DCD_CAPTURE_ADDRESS(PhyEP), DcdCaptureType(corenum, PhyEP),
+		            length, pData, length, 0);
+	}
+#endif
 	/* prime the endpoint for transmit */
 	USB_REG(corenum)->ENDPTPRIME |= _BIT(EP_Physical2BitPosition(PhyEP) );
 }
 
+/* Fills in an isochronous dTD without the memset/busy wait of DcdDataTransfer().
+ * NextTD is left terminated, DcdIsoQueue() links it. MultO is 0 or, for a
+ * high-bandwidth IN, the transactions this packet takes. */
+static void DcdIsoPrepareTD(DeviceTransferDescriptor* pDTD, uint8_t* pData, uint32_t length, uint32_t MultO)
+{
+	pDTD->NextTD = LINK_TERMINATE;
+	pDTD->TransactionErr = 0;
+	pDTD->BufferErr = 0;
+	pDTD->Halted = 0;
+	pDTD->MultiplierOverride = MultO;
+	pDTD->TotalBytes = length;
+	pDTD->IntOnComplete = 1;
+	pDTD->BufferPage[0] = (uint32_t) pData;
+	pDTD->BufferPage[1] = ((uint32_t) pData + 0x1000) & 0xfffff000;
+	pDTD->BufferPage[2] = ((uint32_t) pData + 0x2000) & 0xfffff000;
+	pDTD->BufferPage[3] = ((uint32_t) pData + 0x3000) & 0xfffff000;
+	pDTD->BufferPage[4] = ((uint32_t) pData + 0x4000) & 0xfffff000;
+	pDTD->reserved = length;
+	pDTD->Active = 1;
+}
+
+/* Bytes an isochronous OUT dTD offers: a whole (micro)frame, Mult transactions
+ * of MaxPacketSize, but never less than the USB_DATA_BUFFER_TEM_LENGTH the
+ * callbacks have always been given */
+static uint32_t DcdIsoOutLength(volatile DeviceQueueHead* pdQueueHead)
+{
+	uint32_t length = pdQueueHead->Mult * pdQueueHead->MaxPacketSize;
+	return (length > USB_DATA_BUFFER_TEM_LENGTH) ? length : USB_DATA_BUFFER_TEM_LENGTH;
+}
+
+/* Asks the application for a buffer and prepares the dTD for it */
+static void DcdIsoFillTD(uint8_t corenum, uint8_t PhyEP, DeviceTransferDescriptor* pDTD, uint32_t size)
+{
+	volatile DeviceQueueHead* pdQueueHead = &(dQueueHead[corenum][PhyEP]);
+	uint8_t* pData = (uint8_t*) CALLBACK_HAL_GetISOBufferAddress(PhyEP / 2, &size);
+	if (PhyEP & 1)
+	{
+		/* IN sends what the callback asked for. A high-bandwidth endpoint
+		 * sends only the transactions that takes so the data PIDs tell the
+		 * host how many to expect this microframe */
+		uint32_t MultO = 0;
+		if (pdQueueHead->Mult > 1)
+		{
+			MultO = (size + pdQueueHead->MaxPacketSize - 1) / pdQueueHead->MaxPacketSize;
+			MultO = MultO ? MultO : 1;
+		}
+		DcdIsoPrepareTD(pDTD, pData, size, MultO);
+	}
+	else
+	{
+		/* OUT always offers the whole (micro)frame */
+		DcdIsoPrepareTD(pDTD, pData, DcdIsoOutLength(pdQueueHead), 0);
+	}
+}
+
+/* Puts a prepared dTD behind pPrev on an endpoint that may still be running,
+ * the UM's procedure for adding a dTD to a primed endpoint: link it, then use
+ * the add dTD tripwire to read ENDPTSTAT atomically with respect to the
+ * controller moving on. If the controller already ran off the end, or pPrev is
+ * NULL, the endpoint is primed again starting from this dTD. */
+static void DcdQueueTD(uint8_t corenum, uint8_t PhyEP, DeviceTransferDescriptor* pPrev, DeviceTransferDescriptor* pDTD)
+{
+	IP_USBHS_001_T* USB_Reg = USB_REG(corenum);
+	volatile DeviceQueueHead* pdQueueHead = &(dQueueHead[corenum][PhyEP]);
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+	if (pPrev != NULL)
+	{
+		uint32_t status;
+		pPrev->NextTD = (uint32_t) pDTD;
+		if (USB_Reg->ENDPTPRIME & bit)
+		{
+			return;
+		}
+		do
+		{
+			USB_Reg->USBCMD_D |= USBCMD_D_AddTDTripWire;
+			status = USB_Reg->ENDPTSTAT & bit;
+		} while (!(USB_Reg->USBCMD_D & USBCMD_D_AddTDTripWire));
+		USB_Reg->USBCMD_D &= ~USBCMD_D_AddTDTripWire;
+		if (status)
+		{
+			return;
+		}
+	}
+	pdQueueHead->overlay.Halted = 0;
+	pdQueueHead->overlay.Active = 0;
+	pdQueueHead->overlay.NextTD = (uint32_t) pDTD;
+	USB_Reg->ENDPTPRIME = bit;
+}
+
+/* Fills the whole ring, links it and primes the endpoint */
+static void DcdIsoStart(uint8_t corenum, uint8_t PhyEP)
+{
+	DeviceTransferDescriptor* ring = dIsoTD_Tbl[corenum][PhyEP];
+	volatile DeviceQueueHead* pdQueueHead = &(dQueueHead[corenum][PhyEP]);
+	uint32_t i;
+	for (i = 0; i < USB_ISO_DTDS; i++)
+	{
+		DcdIsoFillTD(corenum, PhyEP, &ring[i], 0);
+		if (i > 0)
+		{
+			ring[i - 1].NextTD = (uint32_t) &ring[i];
+		}
+	}
+	IsoTDHead[corenum][PhyEP] = 0;
+	pdQueueHead->overlay.Halted = 0;
+	pdQueueHead->overlay.Active = 0;
+	pdQueueHead->overlay.NextTD = (uint32_t) ring;
+	USB_REG(corenum)->ENDPTPRIME = _BIT(EP_Physical2BitPosition(PhyEP));
+}
+
+/* Recycles every retired dTD, oldest first, onto the tail of the ring. One
+ * interrupt may find several if it was held off for more than a (micro)frame */
+static void DcdIsoComplete(uint8_t corenum, uint8_t PhyEP)
+{
+	DeviceTransferDescriptor* ring = dIsoTD_Tbl[corenum][PhyEP];
+	uint32_t head = IsoTDHead[corenum][PhyEP];
+	uint32_t i;
+	for (i = 0; i < USB_ISO_DTDS && !ring[head].Active; i++)
+	{
+		/* OUT reports what arrived in the retired buffer */
+		uint32_t size = (PhyEP & 1) ? 0 : DcdIsoOutLength(&dQueueHead[corenum][PhyEP]) - ring[head].TotalBytes;
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_ISO, DCD_CAPTURE_ADDRESS(PhyEP), EP_TYPE_ISOCHRONOUS,
+		            ring[head].reserved - ring[head].TotalBytes, NULL, 0, DcdCaptureStatus(&ring[head]));
+		DcdIsoFillTD(corenum, PhyEP, &ring[head], size);
+		DcdQueueTD(corenum, PhyEP, (USB_ISO_DTDS > 1) ? &ring[(head + USB_ISO_DTDS - 1) % USB_ISO_DTDS] : NULL, &ring[head]);
+		head = (head + 1) % USB_ISO_DTDS;
+	}
+	IsoTDHead[corenum][PhyEP] = head;
+}
+
+/* Physical endpoint of an endpoint address */
+static uint8_t DcdXferPhyEP(uint8_t EndpointAddress)
+{
+	return 2 * (EndpointAddress & ENDPOINT_EPNUM_MASK) + ((EndpointAddress & ENDPOINT_DIR_IN) ? 1 : 0);
+}
+
+/* Makes Transfer the next one to be handed to dTDs */
+static void DcdXferNext(uint8_t corenum, uint8_t PhyEP, Endpoint_Transfer_t* Transfer)
+{
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	xfer->fill = Transfer;
+	xfer->fill_offset = 0;
+	xfer->fill_zlp = (Transfer != NULL) && (PhyEP & 1) && (Transfer->Flags & ENDPOINT_XFER_ZLP) &&
+	                 (Transfer->Length % dQueueHead[corenum][PhyEP].MaxPacketSize) == 0;
+}
+
+/* Hands queued transfers to free dTDs, up to XFER_TD_BYTES each, and appends
+ * them to the endpoint. An OUT transfer gets its next dTD only once the one
+ * before has finished: the controller moves on after a short packet, so a dTD
+ * queued behind it would take the host's next transfer into this buffer */
+static void DcdXferFill(uint8_t corenum, uint8_t PhyEP)
+{
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	DeviceTransferDescriptor* ring = dXferTD_Tbl[corenum][PhyEP];
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+	while (xfer->fill != NULL && xfer->count < USB_XFER_DTDS)
+	{
+		Endpoint_Transfer_t* Transfer = xfer->fill;
+		uint32_t index = (xfer->first + xfer->count) % USB_XFER_DTDS;
+		uint32_t length = Transfer->Length - xfer->fill_offset;
+		DeviceTransferDescriptor* pPrev = NULL;
+		uint8_t more;
+		if (xfer->count)
+		{
+			if (!(PhyEP & 1) && !xfer->last[(index + USB_XFER_DTDS - 1) % USB_XFER_DTDS])
+			{
+				break;
+			}
+			pPrev = &ring[(index + USB_XFER_DTDS - 1) % USB_XFER_DTDS];
+		}
+		else if (USB_REG(corenum)->ENDPTSTAT & bit)
+		{
+			/* nothing of ours is running. An IN packet Endpoint_ClearIN()
+			 * primed goes out first, the transfer follows it. Anything else
+			 * gets a moment to retire; if it is still live its completion
+			 * interrupt fills the ring instead */
+			if ((PhyEP & 1) && dTransferDescriptor[corenum][PhyEP].Active)
+			{
+				pPrev = (DeviceTransferDescriptor*) &dTransferDescriptor[corenum][PhyEP];
+			}
+			else
+			{
+				uint32_t polls = XFER_STAT_POLLS;
+				while ((USB_REG(corenum)->ENDPTSTAT & bit) && --polls) ;
+				if (polls == 0)
+				{
+					break;
+				}
+			}
+		}
+		if (length > XFER_TD_BYTES)
+		{
+			length = XFER_TD_BYTES;
+		}
+		DcdPrepareTD(&ring[index], Transfer->Buffer + xfer->fill_offset, length, 1);
+		xfer->fill_offset += length;
+		/* the zero length packet is a dTD of its own after the data */
+		more = (xfer->fill_offset < Transfer->Length) || (xfer->fill_zlp && length != 0);
+		xfer->size[index] = length;
+		xfer->last[index] = !more;
+		if (!more)
+		{
+			DcdXferNext(corenum, PhyEP, Transfer->Next);
+		}
+		DcdQueueTD(corenum, PhyEP, pPrev, &ring[index]);
+		xfer->count++;
+	}
+}
+
+/* Flushes the endpoint until ENDPTSTAT lets go of it, a prime racing the
+ * flush gets flushed again. Gives up after USB_STREAM_TIMEOUT_MS frames or
+ * once the device is detached and no frames come */
+static bool DcdFlushEndpoint(uint8_t corenum, uint8_t PhyEP)
+{
+	IP_USBHS_001_T* USB_Reg = USB_REG(corenum);
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+	uint16_t TimeoutMSRem = USB_STREAM_TIMEOUT_MS;
+	uint16_t PreviousFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+	while ((USB_Reg->ENDPTFLUSH | USB_Reg->ENDPTSTAT) & bit)
+	{
+		uint16_t CurrentFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+		if (!(USB_Reg->ENDPTFLUSH & bit))
+		{
+			USB_Reg->ENDPTFLUSH = bit;
+		}
+		if (USB_DeviceState[corenum] == DEVICE_STATE_Unattached)
+		{
+			return false;
+		}
+		if (CurrentFrameNumber != PreviousFrameNumber)
+		{
+			PreviousFrameNumber = CurrentFrameNumber;
+			if (!(TimeoutMSRem--))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Flushes the endpoint and forgets its queued dTDs. False if the flush timed
+ * out and a dTD may still be live */
+static bool DcdXferStop(uint8_t corenum, uint8_t PhyEP)
+{
+	Xfer_Variable[corenum][PhyEP].count = 0;
+	return DcdFlushEndpoint(corenum, PhyEP);
+}
+
+/* Completes the oldest transfer. An OUT endpoint goes back to the NAK
+ * interrupt's packet handling once its queue is empty, unless the transfer
+ * asks to hold it */
+static void DcdXferRetire(uint8_t corenum, uint8_t PhyEP, uint8_t Status)
+{
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	Endpoint_Transfer_t* Transfer = xfer->head;
+	xfer->head = Transfer->Next;
+	if (xfer->head == NULL)
+	{
+		xfer->tail = NULL;
+		if (!(PhyEP & 1) && !(Transfer->Flags & ENDPOINT_XFER_HOLD))
+		{
+			USB_REG(corenum)->ENDPTNAKEN |= _BIT(EP_Physical2Logical(PhyEP));
+		}
+	}
+	Transfer->Next = NULL;
+	Transfer->Status = Status;
+	USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_COMPLETE, DCD_CAPTURE_ADDRESS(PhyEP), DcdCaptureType(corenum, PhyEP),
+	            Transfer->Actual, (PhyEP & 1) ? NULL : Transfer->Buffer, Transfer->Actual,
+	            (Status == ENDPOINT_XFER_Aborted) ? USB_CAPTURE_STATUS_ABORTED : 0);
+	if (Transfer->Callback != NULL)
+	{
+		Transfer->Callback(corenum, Transfer);
+	}
+}
+
+/* Retires finished dTDs oldest first, completes the transfers they end and
+ * refills the ring. A short OUT packet ends its transfer early; DcdXferFill()
+ * never queues anything behind an OUT dTD that is not its transfer's last, so
+ * there is nothing to flush and the next transfer starts on the next packet.
+ * A halted dTD flushes the endpoint */
+static void DcdXferComplete(uint8_t corenum, uint8_t PhyEP)
+{
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	DeviceTransferDescriptor* ring = dXferTD_Tbl[corenum][PhyEP];
+	while (xfer->count && !ring[xfer->first].Active)
+	{
+		DeviceTransferDescriptor* pDTD = &ring[xfer->first];
+		Endpoint_Transfer_t* Transfer = xfer->head;
+		uint8_t last = xfer->last[xfer->first];
+		Transfer->Actual += xfer->size[xfer->first] - pDTD->TotalBytes;
+		xfer->first = (xfer->first + 1) % USB_XFER_DTDS;
+		xfer->count--;
+		if (last || pDTD->TotalBytes != 0 || pDTD->Halted)
+		{
+			if (!last)
+			{
+				if (pDTD->Halted)
+				{
+					DcdXferStop(corenum, PhyEP);
+				}
+				DcdXferNext(corenum, PhyEP, Transfer->Next);
+			}
+			DcdXferRetire(corenum, PhyEP, pDTD->Halted ? ENDPOINT_XFER_Aborted : ENDPOINT_XFER_Done);
+		}
+	}
+	DcdXferFill(corenum, PhyEP);
+}
+
+/* Stops the endpoint and completes everything queued on it as aborted */
+static void DcdXferAbort(uint8_t corenum, uint8_t PhyEP)
+{
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	DeviceTransferDescriptor* ring = dXferTD_Tbl[corenum][PhyEP];
+	Endpoint_Transfer_t* Transfer = xfer->head;
+	uint32_t i;
+	if (Transfer == NULL)
+	{
+		return;
+	}
+	DcdXferStop(corenum, PhyEP);
+	/* count what the queued dTDs had moved */
+	for (i = 0; i < xfer->count && Transfer != NULL; i++)
+	{
+		uint32_t index = (xfer->first + i) % USB_XFER_DTDS;
+		Transfer->Actual += xfer->size[index] - ring[index].TotalBytes;
+		if (xfer->last[index])
+		{
+			Transfer = Transfer->Next;
+		}
+	}
+	xfer->count = 0;
+	DcdXferNext(corenum, PhyEP, NULL);
+	while (xfer->head != NULL)
+	{
+		DcdXferRetire(corenum, PhyEP, ENDPOINT_XFER_Aborted);
+	}
+}
+
+uint8_t Endpoint_SubmitTransfer(uint8_t corenum, uint8_t EndpointAddress, Endpoint_Transfer_t* Transfer)
+{
+	uint8_t PhyEP = DcdXferPhyEP(EndpointAddress);
+	XFER_VAR_t* xfer = &Xfer_Variable[corenum][PhyEP];
+	uint32_t bit = _BIT(EP_Physical2BitPosition(PhyEP));
+	uint32_t primask;
+	if (USB_DeviceState[corenum] != DEVICE_STATE_Configured)
+	{
+		return ENDPOINT_RWSTREAM_DeviceDisconnected;
+	}
+	Transfer->Actual = 0;
+	Transfer->Status = ENDPOINT_XFER_Pending;
+	Transfer->Next = NULL;
+#if defined(USB_CAPTURE_ENABLED)
+	if (PhyEP & 1)
+	{
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_SUBMIT, EndpointAddress, DcdCaptureType(corenum, PhyEP),
+		            Transfer->Length, Transfer->Buffer, Transfer->Length, 0);
+	}
+#endif
+	/* the completion interrupt walks the same queue. GlobalInterruptDisable()
+	 * is a no-op on LPC, mask PRIMASK directly */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (xfer->head == NULL && !(PhyEP & 1))
+	{
+		/* the data goes to the transfer now, not to a bank the NAK interrupt
+		 * primes. Take back a bank it primed that nothing has arrived in yet */
+		DeviceTransferDescriptor* pDTD = &dTransferDescriptor[corenum][PhyEP];
+		USB_REG(corenum)->ENDPTNAKEN &= ~_BIT(EP_Physical2Logical(PhyEP));
+		if ((USB_REG(corenum)->ENDPTSTAT & bit) && pDTD->Active &&
+		    dQueueHead[corenum][PhyEP].overlay.TotalBytes == pDTD->TotalBytes &&
+		    !DcdXferStop(corenum, PhyEP))
+		{
+			USB_REG(corenum)->ENDPTNAKEN |= _BIT(EP_Physical2Logical(PhyEP));
+			__set_PRIMASK(primask);
+			return ENDPOINT_RWSTREAM_Timeout;
+		}
+	}
+	if (xfer->tail != NULL)
+	{
+		xfer->tail->Next = Transfer;
+	}
+	else
+	{
+		xfer->head = Transfer;
+	}
+	xfer->tail = Transfer;
+	if (xfer->fill == NULL)
+	{
+		DcdXferNext(corenum, PhyEP, Transfer);
+	}
+	DcdXferFill(corenum, PhyEP);
+	__set_PRIMASK(primask);
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+void Endpoint_AbortTransfers(uint8_t corenum, uint8_t EndpointAddress)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	DcdXferAbort(corenum, DcdXferPhyEP(EndpointAddress));
+	__set_PRIMASK(primask);
+}
+
+uint8_t Endpoint_WaitTransfer(uint8_t corenum, uint8_t EndpointAddress, Endpoint_Transfer_t* Transfer)
+{
+	uint8_t PhyEP = DcdXferPhyEP(EndpointAddress);
+	uint16_t TimeoutMSRem = USB_STREAM_TIMEOUT_MS;
+	uint16_t PreviousFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+	uint32_t PreviousRemaining = dQueueHead[corenum][PhyEP].overlay.TotalBytes;
+	uint8_t PreviousFirst = Xfer_Variable[corenum][PhyEP].first;
+	while (Transfer->Status == ENDPOINT_XFER_Pending)
+	{
+		uint16_t CurrentFrameNumber = USB_Device_GetFrameNumber(corenum) >> 3;
+		if (USB_DeviceState[corenum] != DEVICE_STATE_Configured)
+		{
+			Endpoint_AbortTransfers(corenum, EndpointAddress);
+			break;
+		}
+		/* the timeout runs while the endpoint moves no data, not per transfer */
+		if (dQueueHead[corenum][PhyEP].overlay.TotalBytes != PreviousRemaining ||
+		    Xfer_Variable[corenum][PhyEP].first != PreviousFirst)
+		{
+			PreviousRemaining = dQueueHead[corenum][PhyEP].overlay.TotalBytes;
+			PreviousFirst = Xfer_Variable[corenum][PhyEP].first;
+			TimeoutMSRem = USB_STREAM_TIMEOUT_MS;
+		}
+		else if (CurrentFrameNumber != PreviousFrameNumber)
+		{
+			PreviousFrameNumber = CurrentFrameNumber;
+			if (!(TimeoutMSRem--))
+			{
+				Endpoint_AbortTransfers(corenum, EndpointAddress);
+				return ENDPOINT_RWSTREAM_Timeout;
+			}
+		}
+	}
+	return (Transfer->Status == ENDPOINT_XFER_Done) ? ENDPOINT_RWSTREAM_NoError : ENDPOINT_RWSTREAM_DeviceDisconnected;
+}
+
 void TransferCompleteISR(uint8_t corenum)
 {
-	uint8_t* ISO_Address;
 	IP_USBHS_001_T* 	USB_Reg = USB_REG(corenum);
 	STREAM_VAR_t* current_stream = &Stream_Variable[corenum];
 	uint32_t ENDPTCOMPLETE = USB_Reg->ENDPTCOMPLETE;
@@ -354,16 +865,25 @@ void TransferCompleteISR(uint8_t corenum)
 			{
 				if (((ENDPTCTRL_REG(corenum, n) >> 2) & EP_TYPE_MASK) == EP_TYPE_ISOCHRONOUS)  	// iso out endpoint
 				{
-					uint32_t size = dQueueHead[corenum][2 * n].TransferCount;
-					size -= dQueueHead[corenum][2 * n].overlay.TotalBytes;
-					// copy to share buffer
-					ISO_Address = (uint8_t*) CALLBACK_HAL_GetISOBufferAddress(n, &size);
-					DcdDataTransfer(corenum, 2 * n, ISO_Address, USB_DATA_BUFFER_TEM_LENGTH);
+					DcdIsoComplete(corenum, 2 * n);
+				}
+				else if (Xfer_Variable[corenum][2 * n].count != 0)
+				{
+					DcdXferComplete(corenum, 2 * n);
 				}
 				else
 				{
 					uint32_t tem = dQueueHead[corenum][2 * n].overlay.TotalBytes;
 					dQueueHead[corenum][2 * n].TransferCount -= tem;
+#if defined(USB_CAPTURE_ENABLED)
+					/* a packet lands in the endpoint's bank, a stream straight in the caller's buffer */
+					USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_COMPLETE, n, DcdCaptureType(corenum, 2 * n),
+					            dQueueHead[corenum][2 * n].TransferCount,
+					            current_stream->stream_total_packets ? NULL :
+					            (n == 0) ? usb_data_buffer[corenum] : usb_data_buffer_OUT[corenum],
+					            dQueueHead[corenum][2 * n].TransferCount,
+					            DcdCaptureStatus(&dTransferDescriptor[corenum][2 * n]));
+#endif
 					if (current_stream->stream_total_packets > 0)
 					{
 						if (current_stream->stream_remain_packets > 0)
@@ -394,6 +914,8 @@ void TransferCompleteISR(uint8_t corenum)
 					{
 						usb_data_buffer_OUT_size[corenum] = dQueueHead[corenum][2 * n].TransferCount;
 					}
+					/* a transfer submitted while this bank was live starts now */
+					DcdXferFill(corenum, 2 * n);
 				}
 				EVENT_USB_Device_TransferComplete(n, 0);
 			}
@@ -402,12 +924,19 @@ void TransferCompleteISR(uint8_t corenum)
 				// device => host. isochronous endpoint.
 				if (((ENDPTCTRL_REG(corenum, n) >> 18) & EP_TYPE_MASK) == EP_TYPE_ISOCHRONOUS)  	// iso in endpoint
 				{
-					uint32_t size;
-					ISO_Address = (uint8_t*) CALLBACK_HAL_GetISOBufferAddress(n, &size);
-					DcdDataTransfer(corenum, 2 * n + 1, ISO_Address, size);
+					DcdIsoComplete(corenum, 2 * n + 1);
+				}
+				else if (Xfer_Variable[corenum][2 * n + 1].count != 0)
+				{
+					DcdXferComplete(corenum, 2 * n + 1);
 				}
 				else
 				{
+#if defined(USB_CAPTURE_ENABLED)
+					DeviceTransferDescriptor* pDTD = &dTransferDescriptor[corenum][2 * n + 1];
+					USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_COMPLETE, n | ENDPOINT_DIR_IN, DcdCaptureType(corenum, 2 * n + 1),
+					            pDTD->reserved - pDTD->TotalBytes, NULL, 0, DcdCaptureStatus(pDTD));
+#endif
 					if (current_stream->stream_remain_packets > 0)
 					{
 						uint32_t cnt = dQueueHead[corenum][2 * n].TransferCount;
@@ -421,6 +950,7 @@ void TransferCompleteISR(uint8_t corenum)
 					{
 						current_stream->stream_total_packets = 0;
 					}
+					DcdXferFill(corenum, 2 * n + 1);
 				}
 				EVENT_USB_Device_TransferComplete(n, 1);
 			}
@@ -460,7 +990,11 @@ void DcdIrqHandler(uint8_t corenum)
 		if (USB_Reg->ENDPTSETUPSTAT)
 		{
 			//			memcpy(SetupPackage, dQueueHead[0].SetupPackage, 8);
+			USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_SETUP, 0, EP_TYPE_CONTROL, 8,
+			            (const void*) dQueueHead[corenum][0].SetupPackage, 8, 0);
 			/* Will be cleared by Endpoint_ClearSETUP */
+			/* USB_USBTask() has a request to process, wake it */
+			EVENT_USB_Device_TaskPending(corenum);
 		}
 		if (USB_Reg->ENDPTCOMPLETE)
 		{
@@ -512,6 +1046,7 @@ void DcdIrqHandler(uint8_t corenum)
 	}
 	if (USBSTS_D & USBSTS_D_ResetReceived)  					/* Reset */
 	{
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_RESET, 0, EP_TYPE_CONTROL, 0, NULL, 0, 0);
 		HAL_Reset(corenum);
 		USB_DeviceState[corenum] = DEVICE_STATE_Default;
 		Endpoint_ConfigureEndpoint(corenum,
@@ -529,9 +1064,11 @@ void DcdIrqHandler(uint8_t corenum)
 	}
 	if (USBSTS_D & USBSTS_D_SuspendInt)  					/* Suspend */
 	{
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_SUSPEND, 0, EP_TYPE_CONTROL, 0, NULL, 0, 0);
 	}
 	if (USBSTS_D & USBSTS_D_PortChangeDetect)  					/* Resume */
 	{
+		USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_RESUME, 0, EP_TYPE_CONTROL, USB_Device_IsHighSpeed(corenum), NULL, 0, 0);
 	}
 	if (USBSTS_D & USBSTS_D_UsbErrorInt)  					/* Error Interrupt */
 	{
@@ -66,6 +66,7 @@
 #define __ENDPOINT_LPC18XX_H__
 
 	#include "../EndpointCommon.h"
+	#include "../../USBCapture.h"
 
 /* Enable C linkage for C++ Compilers: */
 		#if defined(__cplusplus)
@@ -173,7 +174,6 @@ extern uint8_t usb_RomDriver_HID_buffer[ROMDRIVER_HID_MEM_SIZE];
 				#define PORTSC_D_ForcePortResume                0x00000040UL		/* Force Port Resume */
 				#define PORTSC_D_PortSuspend                    0x00000080UL		/* Port Suspend */
 				#define PORTSC_D_PortReset                  0x00000100UL		/* Port Reset */
-				#define PORTSC_D_HighSpeedStatus                0x00000200UL		/* Line Status */
 				#define PORTSC_D_PortIndicatorControl           0x0000C000UL		/* Port Indicator Control */
 				#define PORTSC_D_PortTestControl                0x000F0000UL		/* Port Test Control */
 				#define PORTSC_D_PhyClockDisable                0x00800000UL		/* PHY Clock Disable - EHCI derivation */
@@ -306,7 +306,10 @@ bool Endpoint_ConfigureEndpoint_Prv(uint8_t corenum,
  * @param  Size           : Size of the endpoint's bank, where packets are stored before they are transmitted
  *                          to the USB host, or after they have been received from the USB host (depending on
  *                          the endpoint's data direction). The bank size must indicate the maximum packet size
- *                          that the endpoint can handle.
+ *                          that the endpoint can handle. A high-speed isochronous endpoint may carry up to 3
+ *                          transactions per microframe in bits 12:11, as in wMaxPacketSize (see
+ *                          @ref ENDPOINT_SIZE_HIGH_BANDWIDTH); it is then primed for that many and an OUT
+ *                          callback buffer must hold them all.
  * @param  Banks          : Number of banks to use for the endpoint being configured, an \c ENDPOINT_BANK_* mask.
  *                          More banks uses more USB DPRAM, but offers better performance. Isochronous type
  *                          endpoints <b>must</b> have at least two banks.
@@ -462,6 +465,9 @@ static inline uint16_t Endpoint_BytesInEndpoint(uint8_t corenum)
 	if (endpointselected[corenum] == ENDPOINT_CONTROLEP) {
 		return usb_data_buffer_size[corenum];
 	}
+	else if (endpointhandle(corenum)[endpointselected[corenum]] & 1) {
+		return usb_data_buffer_IN_index[corenum];
+	}
 	else {
 		return usb_data_buffer_OUT_size[corenum];
 	}
@@ -601,6 +607,7 @@ static inline void Endpoint_StallTransaction(uint8_t corenum) ATTR_ALWAYS_INLINE
 
 static inline void Endpoint_StallTransaction(uint8_t corenum)
 {
+	USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_STALL, endpointselected[corenum], 0, 0, NULL, 0, 0);
 	ENDPTCTRL_REG(corenum, EP_Physical2Logical(endpointhandle(corenum)[endpointselected[corenum]]) ) |= ENDPTCTRL_RxStall | ENDPTCTRL_TxStall;
 }
 
@@ -666,7 +673,93 @@ extern uint8_t USB_Device_ControlEndpointSize;
 				#define USB_Device_ControlEndpointSize FIXED_CONTROL_ENDPOINT_SIZE
 			#endif
 
+/* Enums: */
+/** Enum for the states of an @ref Endpoint_Transfer_t. */
+enum Endpoint_Transfer_Status_t
+{
+	ENDPOINT_XFER_Idle    = 0, /**< Not submitted. */
+	ENDPOINT_XFER_Pending = 1, /**< Queued or in progress; the buffer belongs to the controller. */
+	ENDPOINT_XFER_Done    = 2, /**< Completed, @ref Endpoint_Transfer_t::Actual bytes were moved. */
+	ENDPOINT_XFER_Aborted = 3, /**< Stopped by @ref Endpoint_AbortTransfers(), a stall or a bus reset. */
+};
+
+/** Flags of an @ref Endpoint_Transfer_t. */
+#define ENDPOINT_XFER_ZLP       (1 << 0)	/**< IN: end a transfer that is a whole number of packets with a zero length packet. */
+#define ENDPOINT_XFER_HOLD      (1 << 1)	/**< OUT: if the queue runs empty after this transfer, keep NAKing the host until the
+											 *   next one is submitted rather than receiving into the endpoint bank again. For
+											 *   buffers that are resubmitted as soon as they are read. */
+
+/* Type Defines: */
+struct Endpoint_Transfer;
+
+/** Completion callback of an @ref Endpoint_Transfer_t. It runs in the USB interrupt and may submit the
+ *  next transfer or give a semaphore, but must not wait.
+ */
+typedef void (*Endpoint_TransferCallback_t)(uint8_t corenum, struct Endpoint_Transfer *Transfer);
+
+/**
+ * @brief Buffer descriptor for @ref Endpoint_SubmitTransfer(). The controller reads or writes Buffer directly,
+ *  16KB per dTD, so the buffer must be in memory the USB DMA can reach and must not be touched until Status
+ *  leaves @ref ENDPOINT_XFER_Pending. The descriptor itself is owned by the library until then too.
+ */
+typedef struct Endpoint_Transfer {
+	uint8_t *Buffer;						/**< Data to send or room to receive into. */
+	uint32_t Length;						/**< Bytes to send, or the most to receive. 0 sends a zero length packet. */
+	uint8_t Flags;							/**< \c ENDPOINT_XFER_* flags. */
+	Endpoint_TransferCallback_t Callback;	/**< Called on completion, NULL to poll Status instead. */
+	void *Context;							/**< Not used by the library. */
+	volatile uint32_t Actual;				/**< Bytes moved. An OUT transfer ends early on a short packet. */
+	volatile uint8_t Status;				/**< A value from the @ref Endpoint_Transfer_Status_t enum. */
+	struct Endpoint_Transfer *Next;			/**< Library use: the endpoint's queue. */
+} Endpoint_Transfer_t;
+
 /* Function Prototypes: */
+/**
+ * @brief  Queues a transfer on a bulk or interrupt endpoint. The controller moves the data straight between
+ *  the caller's buffer and the bus without going through the endpoint bank, and the next transfer queued on
+ *  the endpoint follows without a gap. Completion is reported through Transfer->Status and Transfer->Callback.
+ *
+ *  An OUT transfer completes when Length bytes or a short packet arrive. If a short packet ends a transfer of
+ *  more than 16KB early, whatever the host sent after it before the interrupt was serviced is dropped.
+ *
+ *  Do not mix with the packet functions (@ref Endpoint_ClearIN(), @ref Endpoint_ClearOUT()) on the same
+ *  endpoint while a transfer is pending. May be called from a completion callback.
+ *
+ *  @ingroup Group_EndpointRW_LPC18xx
+ *
+ *  @param  corenum         : ID Number of USB Core to be processed.
+ *  @param  EndpointAddress : Endpoint number ORed with @ref ENDPOINT_DIR_IN or @ref ENDPOINT_DIR_OUT.
+ *  @param  Transfer        : Filled in Buffer, Length, Flags and Callback. Status and Actual are set here.
+ *  @return A value from the @ref Endpoint_Stream_RW_ErrorCodes_t enum.
+ */
+uint8_t Endpoint_SubmitTransfer(uint8_t corenum, uint8_t EndpointAddress, Endpoint_Transfer_t *Transfer);
+
+/**
+ * @brief  Stops an endpoint and completes every transfer queued on it as @ref ENDPOINT_XFER_Aborted, with
+ *  Actual holding what had been moved.
+ *
+ *  @ingroup Group_EndpointRW_LPC18xx
+ *
+ *  @param  corenum         : ID Number of USB Core to be processed.
+ *  @param  EndpointAddress : Endpoint number ORed with @ref ENDPOINT_DIR_IN or @ref ENDPOINT_DIR_OUT.
+ *  @return Nothing.
+ */
+void Endpoint_AbortTransfers(uint8_t corenum, uint8_t EndpointAddress);
+
+/**
+ * @brief  Waits for a transfer submitted with @ref Endpoint_SubmitTransfer() to finish. Everything queued on
+ *  the endpoint is aborted if the device leaves the configured state meanwhile, or if the endpoint moves no
+ *  data for @ref USB_STREAM_TIMEOUT_MS.
+ *
+ *  @ingroup Group_EndpointRW_LPC18xx
+ *
+ *  @param  corenum         : ID Number of USB Core to be processed.
+ *  @param  EndpointAddress : Endpoint the transfer was submitted on.
+ *  @param  Transfer        : The transfer.
+ *  @return A value from the @ref Endpoint_Stream_RW_ErrorCodes_t enum.
+ */
+uint8_t Endpoint_WaitTransfer(uint8_t corenum, uint8_t EndpointAddress, Endpoint_Transfer_t *Transfer);
+
 /**
  * @brief Completes the status stage of a control transfer on a CONTROL type endpoint automatically,
  *  with respect to the data direction. This is a convenience function which can be used to
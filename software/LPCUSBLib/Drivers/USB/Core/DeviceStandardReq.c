@@ -38,6 +38,7 @@
 
 #define  __INCLUDE_FROM_DEVICESTDREQ_C
 #include "DeviceStandardReq.h"
+#include "USBCapture.h"
 
 uint8_t USB_Device_ConfigurationNumber;
 
@@ -237,6 +238,8 @@ static void USB_Device_SetAddress(uint8_t corenum)
 	
 	SetGlobalInterruptMask(CurrentGlobalInt);
 
+	USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_ADDRESS, 0, EP_TYPE_CONTROL, DeviceAddress, NULL, 0, 0);
+
 	// JME
 	Log(eREQ_SetAddress,corenum,DeviceAddress,0);
 
@@ -305,6 +308,8 @@ static void USB_Device_SetConfiguration(uint8_t corenum)
 	else
 	  USB_DeviceState[corenum] = (USB_Device_IsAddressSet()) ? DEVICE_STATE_Configured : DEVICE_STATE_Powered;
 
+	USB_CAPTURE_RECORD(corenum, USB_CAPTURE_EVENT_CONFIGURED, 0, EP_TYPE_CONTROL, USB_Device_ConfigurationNumber, NULL, 0, 0);
+
 	// call into application code
 	EVENT_USB_Device_ConfigurationChanged();
 }
@@ -35,15 +35,87 @@
 #if defined(USB_CAN_BE_DEVICE)
 
 #include "EndpointStream.h"
+#include <string.h>
 
 #if !defined(CONTROL_ONLY_DEVICE)
+/* Frame counter for the stream timeouts, FRINDEX counts microframes */
+#if defined(__LPC18XX__) || defined(__LPC43XX__)
+#define Endpoint_StreamFrame(corenum)   (USB_Device_GetFrameNumber(corenum) >> 3)
+#else
+#define Endpoint_StreamFrame(corenum)   USB_Device_GetFrameNumber()
+#endif
+
+/* Waits for the IN bank to be free, the previous Endpoint_ClearIN() sent. Gives
+ * up after USB_STREAM_TIMEOUT_MS frames with no IN token taking it */
+static uint8_t Endpoint_WaitINBank(uint8_t corenum)
+{
+	uint16_t TimeoutMSRem = USB_STREAM_TIMEOUT_MS;
+	uint16_t PreviousFrameNumber = Endpoint_StreamFrame(corenum);
+
+	while (!Endpoint_IsINReady(corenum)) {
+		uint16_t CurrentFrameNumber = Endpoint_StreamFrame(corenum);
+		if (USB_DeviceState[corenum] == DEVICE_STATE_Unattached) {
+			return ENDPOINT_RWSTREAM_DeviceDisconnected;
+		}
+		else if (USB_DeviceState[corenum] == DEVICE_STATE_Suspended) {
+			return ENDPOINT_RWSTREAM_BusSuspended;
+		}
+		if (CurrentFrameNumber != PreviousFrameNumber) {
+			PreviousFrameNumber = CurrentFrameNumber;
+			if (!(TimeoutMSRem--)) {
+				return ENDPOINT_RWSTREAM_Timeout;
+			}
+		}
+	}
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
+/* Appends Length bytes to the IN bank, or zeros if Data is NULL. A full bank is
+ * sent and refilled, so a stream of any length goes out in order and the last
+ * bytes wait for Endpoint_ClearIN() as before. */
+static uint8_t Endpoint_Write_Bank(uint8_t corenum, const uint8_t *Data, uint16_t Length)
+{
+	uint8_t *bank = usb_data_buffer_IN[corenum];
+	volatile uint32_t *index = &usb_data_buffer_IN_index[corenum];
+	if (endpointselected[corenum] == ENDPOINT_CONTROLEP) {
+		bank = usb_data_buffer[corenum];
+		index = &usb_data_buffer_index[corenum];
+	}
+	while (Length) {
+		uint16_t n = MIN(Length, USB_DATA_BUFFER_TEM_LENGTH - *index);
+		uint8_t ErrorCode;
+		if (n == 0) {
+			Endpoint_ClearIN(corenum);
+			if ((ErrorCode = Endpoint_WaitINBank(corenum)) != ENDPOINT_RWSTREAM_NoError) {
+				return ErrorCode;
+			}
+			continue;
+		}
+		if (Data) {
+			memcpy(&bank[*index], Data, n);
+			Data += n;
+		}
+		else {
+			memset(&bank[*index], 0, n);
+		}
+		*index += n;
+		Length -= n;
+	}
+	return ENDPOINT_RWSTREAM_NoError;
+}
+
 uint8_t Endpoint_Discard_Stream(uint8_t corenum,
 								uint16_t Length,
 								uint16_t *const BytesProcessed)
 {
-	uint32_t i;
-	for (i = 0; i < Length; i++)
-		Endpoint_Discard_8(corenum);
+	if (endpointselected[corenum] == ENDPOINT_CONTROLEP) {
+		usb_data_buffer_index[corenum] += Length;
+		usb_data_buffer_size[corenum] -= Length;
+	}
+	else {
+		usb_data_buffer_OUT_index[corenum] += Length;
+		usb_data_buffer_OUT_size[corenum] -= Length;
+	}
 	return ENDPOINT_RWSTREAM_NoError;
 }
 
@@ -51,14 +123,12 @@ uint8_t Endpoint_Null_Stream(uint8_t corenum,
 							 uint16_t Length,
 							 uint16_t *const BytesProcessed)
 {
-	uint32_t i;
+	uint8_t ErrorCode;
 
-	while ( !Endpoint_IsINReady(corenum) ) {	/*-- Wait until ready --*/
-		Delay_MS(2);
+	if ((ErrorCode = Endpoint_WaitINBank(corenum)) != ENDPOINT_RWSTREAM_NoError) {
+		return ErrorCode;
 	}
-	for (i = 0; i < Length; i++)
-		Endpoint_Write_8(corenum, 0);
-	return ENDPOINT_RWSTREAM_NoError;
+	return Endpoint_Write_Bank(corenum, NULL, Length);
 }
 
 uint8_t Endpoint_Write_Stream_LE(uint8_t corenum,
@@ -66,15 +136,34 @@ uint8_t Endpoint_Write_Stream_LE(uint8_t corenum,
 								 uint16_t Length,
 								 uint16_t *const BytesProcessed)
 {
-	uint16_t i;
+	const uint8_t *Data = (const uint8_t *) Buffer;
+	uint8_t ErrorCode;
 
-	while ( !Endpoint_IsINReady(corenum) ) {	/*-- Wait until ready --*/
-		Delay_MS(2);
+	if ((ErrorCode = Endpoint_WaitINBank(corenum)) != ENDPOINT_RWSTREAM_NoError) {
+		return ErrorCode;
 	}
-	for (i = 0; i < Length; i++)
-		Endpoint_Write_8(corenum, ((uint8_t *) Buffer)[i]);
-
-	return ENDPOINT_RWSTREAM_NoError;
+	#if defined(__LPC18XX__) || defined(__LPC43XX__)
+	/* Whole packets go straight from the caller's buffer. The bank keeps the
+	 * last 1 to packet size bytes so Endpoint_ClearIN() ends the transfer the
+	 * way it always has */
+	if ((endpointselected[corenum] != ENDPOINT_CONTROLEP) && (usb_data_buffer_IN_index[corenum] == 0)) {
+		uint8_t EndpointAddress = endpointselected[corenum] | ENDPOINT_DIR_IN;
+		uint16_t PacketSize = dQueueHead[corenum][endpointhandle(corenum)[endpointselected[corenum]]].MaxPacketSize;
+		if (Length > PacketSize) {
+			Endpoint_Transfer_t Transfer;
+			memset(&Transfer, 0, sizeof(Transfer));
+			Transfer.Buffer = (uint8_t *) Data;
+			Transfer.Length = ((Length - 1) / PacketSize) * PacketSize;
+			if ((ErrorCode = Endpoint_SubmitTransfer(corenum, EndpointAddress, &Transfer)) != ENDPOINT_RWSTREAM_NoError ||
+				(ErrorCode = Endpoint_WaitTransfer(corenum, EndpointAddress, &Transfer)) != ENDPOINT_RWSTREAM_NoError) {
+				return ErrorCode;
+			}
+			Data += Transfer.Length;
+			Length -= Transfer.Length;
+		}
+	}
+	#endif
+	return Endpoint_Write_Bank(corenum, Data, Length);
 }
 
 uint8_t Endpoint_Write_Stream_BE(uint8_t corenum,
@@ -82,10 +171,16 @@ uint8_t Endpoint_Write_Stream_BE(uint8_t corenum,
 								 uint16_t Length,
 								 uint16_t *const BytesProcessed)
 {
-	uint16_t i;
+	uint8_t ErrorCode;
 
-	for (i = 0; i < Length; i++)
-		Endpoint_Write_8(corenum, ((uint8_t *) Buffer)[Length - 1 - i]);
+	if ((ErrorCode = Endpoint_WaitINBank(corenum)) != ENDPOINT_RWSTREAM_NoError) {
+		return ErrorCode;
+	}
+	while (Length) {
+		if ((ErrorCode = Endpoint_Write_Bank(corenum, &((const uint8_t *) Buffer)[--Length], 1)) != ENDPOINT_RWSTREAM_NoError) {
+			return ErrorCode;
+		}
+	}
 	return ENDPOINT_RWSTREAM_NoError;
 }
 
@@ -104,14 +199,26 @@ uint8_t Endpoint_Read_Stream_LE(uint8_t corenum,
 		return ENDPOINT_RWSTREAM_IncompleteTransfer;
 	}
 
+	#if defined(__LPC175X_6X__) || defined(__LPC177X_8X__) || defined(__LPC407X_8X__)
 	for (i = 0; i < Length; i++) {
-		#if defined(__LPC175X_6X__) || defined(__LPC177X_8X__) || defined(__LPC407X_8X__)
 		if (endpointselected[corenum] != ENDPOINT_CONTROLEP) {
 			while (usb_data_buffer_OUT_size[corenum] == 0) ;	/* Current Fix for LPC17xx, havent checked for others */
 		}
-		#endif
 		((uint8_t *) Buffer)[i] = Endpoint_Read_8(corenum);
 	}
+	#else
+	i = Length;
+	if (endpointselected[corenum] == ENDPOINT_CONTROLEP) {
+		memcpy(Buffer, &usb_data_buffer[corenum][usb_data_buffer_index[corenum]], i);
+		usb_data_buffer_index[corenum] += i;
+		usb_data_buffer_size[corenum] -= i;
+	}
+	else {
+		memcpy(Buffer, &usb_data_buffer_OUT[corenum][usb_data_buffer_OUT_index[corenum]], i);
+		usb_data_buffer_OUT_index[corenum] += i;
+		usb_data_buffer_OUT_size[corenum] -= i;
+	}
+	#endif
 	return ENDPOINT_RWSTREAM_NoError;
 }
 
@@ -49,3 +49,8 @@ void USB_Host_DeviceEnumerationFailed_Event_Stub(const uint8_t ErrorCode,
 {
 }
 #endif
+
+void USB_Device_TaskPending_Event_Stub(const uint8_t corenum)
+{
+
+}
@@ -317,6 +317,20 @@
 			 *        @ref Group_USBManagement documentation).
 			 */
 			void EVENT_USB_Device_StartOfFrame(void);
+
+			/** Event for deferred device processing. This event fires from the USB interrupt whenever there is
+			 *  work waiting for @ref USB_USBTask(), i.e. a SETUP packet has arrived on the control endpoint.
+			 *
+			 *  An RTOS application can give a semaphore or set an event group bit here and block the task that
+			 *  runs @ref USB_USBTask() until it is signalled, instead of calling it in a busy loop. The task
+			 *  should still time out once in a while as this is the only event raised.
+			 *
+			 *  This event is time-critical; it is run from the USB interrupt and should only wake the task.
+			 *
+			 *  @note This event does not exist if the \c USB_HOST_ONLY token is supplied to the compiler (see
+			 *        @ref Group_USBManagement documentation).
+			 */
+			void EVENT_USB_Device_TaskPending(const uint8_t corenum);
 		#endif
 
 	/* Private Interface - For use in library only: */
@@ -329,6 +343,7 @@
                                 void USB_Host_DeviceEnumerationFailed_Event_Stub(const uint8_t ErrorCode,
                                                  const uint8_t SubErrorCode);
                                 #endif
+				void USB_Device_TaskPending_Event_Stub(const uint8_t corenum);
 				#if defined(USB_CAN_BE_BOTH)
 PRAGMA_WEAK(EVENT_USB_UIDChange,USB_Event_Stub)				
 					void EVENT_USB_UIDChange(void) ATTR_WEAK ATTR_ALIAS(USB_Event_Stub);
@@ -372,6 +387,10 @@ PRAGMA_WEAK(EVENT_USB_Device_Reset,USB_Event_Stub)
 					void EVENT_USB_Device_Reset(void) ATTR_WEAK ATTR_ALIAS(USB_Event_Stub);
 PRAGMA_WEAK(EVENT_USB_Device_StartOfFrame,USB_Event_Stub)				
 					void EVENT_USB_Device_StartOfFrame(void) ATTR_WEAK ATTR_ALIAS(USB_Event_Stub);
+PRAGMA_WEAK(EVENT_USB_Device_TaskPending,USB_Device_TaskPending_Event_Stub)
+                                    #if !defined(__ICCARM__)
+					void EVENT_USB_Device_TaskPending(const uint8_t corenum) ATTR_WEAK ATTR_ALIAS(USB_Device_TaskPending_Event_Stub);
+                                    #endif
 				#endif
 			#endif
 	#endif
@@ -53,6 +53,9 @@
 #define USBDEV_ADDR_AD  (1 << 24)
 #define USBDEV_ADDR(n)  (((n) & 0x7F) << 25)
 
+/* high-speed status bit of PORTSC1 in device mode. */
+#define PORTSC_D_HighSpeedStatus  0x00000200UL
+
 /* Max USB Core specially for LPC18xx/43xx series. */
 #define LPC18_43_MAX_USB_CORE	2
 
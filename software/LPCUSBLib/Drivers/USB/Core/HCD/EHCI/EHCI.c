@@ -51,7 +51,9 @@ PRAGMA_ALIGN_4096
 NextLinkPointer PeriodFrameList0[FRAME_LIST_SIZE] ATTR_ALIGNED(4096) __BSS(USBRAM_SECTION);		/* Period Frame List */
 PRAGMA_ALIGN_4096
 NextLinkPointer PeriodFrameList1[FRAME_LIST_SIZE] ATTR_ALIGNED(4096) __BSS(USBRAM_SECTION);		/* Period Frame List */
-Pipe_Stream_Handle_T PipeStreaming[MAX_USB_CORE];
+Pipe_Stream_Handle_T PipeStreaming[MAX_USB_CORE][HCD_MAX_QHD];
+Pipe_Callback_T PipeCallback[MAX_USB_CORE][HCD_MAX_QHD];
+Period_Bandwidth_T PeriodBandwidth[MAX_USB_CORE];
 /*=======================================================================*/
 /* G L O B A L   F U N C T I O N S                                       */
 /*=======================================================================*/
@@ -131,6 +133,7 @@ HCD_STATUS HcdOpenPipe(uint8_t HostID,
 					   uint32_t *const pPipeHandle)
 {
 	uint32_t HeadIdx;
+	HCD_STATUS status;
 
 #if !ISO_LIST_ENABLE
 	if ( TransferType == ISOCHRONOUS_TRANSFER ) {
@@ -164,10 +167,16 @@ HCD_STATUS HcdOpenPipe(uint8_t HostID,
 	case INTERRUPT_TRANSFER:
 		ASSERT_STATUS_OK(AllocQhd(HostID, DeviceAddr, DeviceSpeed, EndpointNumber, TransferType, TransferDir,
 								  MaxPacketSize, Interval, Mult, HSHubDevAddr, HSHubPortNum, &HeadIdx) );
+		status = AllocBandwidth(HostID, HeadIdx, DeviceSpeed, TransferType, TransferDir, MaxPacketSize, Interval, Mult);
+		if (status != HCD_STATUS_OK) {
+			FreeQhd(HostID, HeadIdx);
+			ASSERT_STATUS_OK(status);
+		}
+		HcdQHD(HostID, HeadIdx)->uFrameSMask = PeriodBandwidth[HostID].Slot[HeadIdx].SMask;
+		HcdQHD(HostID, HeadIdx)->uFrameCMask = PeriodBandwidth[HostID].Slot[HeadIdx].CMask;
 		DisablePeriodSchedule(HostID);
 		InsertLinkPointer(&HcdIntHead(HostID)->Horizontal, &HcdQHD(HostID, HeadIdx)->Horizontal, QHD_TYPE);
 		EnablePeriodSchedule(HostID);
-		memset(&PipeStreaming[HostID], 0, sizeof(Pipe_Stream_Handle_T));
 		break;
 
 	case ISOCHRONOUS_TRANSFER:
@@ -179,10 +188,17 @@ HCD_STATUS HcdOpenPipe(uint8_t HostID,
 #endif
 		ASSERT_STATUS_OK(AllocQhd(HostID, DeviceAddr, DeviceSpeed, EndpointNumber, TransferType, TransferDir,
 								  MaxPacketSize, Interval, Mult, HSHubDevAddr, HSHubPortNum, &HeadIdx) );
+		status = AllocBandwidth(HostID, HeadIdx, DeviceSpeed, TransferType, TransferDir, MaxPacketSize, Interval, Mult);
+		if (status != HCD_STATUS_OK) {
+			FreeQhd(HostID, HeadIdx);
+			ASSERT_STATUS_OK(status);
+		}
 		EnablePeriodSchedule(HostID);
 		break;
 	}
 
+	memset(&PipeStreaming[HostID][HeadIdx], 0, sizeof(Pipe_Stream_Handle_T));
+	memset(&PipeCallback[HostID][HeadIdx], 0, sizeof(Pipe_Callback_T));
 	PipehandleCreate(pPipeHandle, HostID, TransferType, HeadIdx);
 	return HCD_STATUS_OK;
 }
@@ -194,6 +210,10 @@ HCD_STATUS HcdClosePipe(uint32_t PipeHandle)
 
 	ASSERT_STATUS_OK(HcdCancelTransfer(PipeHandle) );
 	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, &XferType, &HeadIdx) );
+	PipeCallback[HostID][HeadIdx].Callback = NULL;
+	if ((XferType == INTERRUPT_TRANSFER) || (XferType == ISOCHRONOUS_TRANSFER)) {
+		FreeBandwidth(HostID, HeadIdx);
+	}
 
 	switch (XferType) {
 	case CONTROL_TRANSFER:
@@ -264,6 +284,14 @@ HCD_STATUS HcdCancelTransfer(uint32_t PipeHandle)
 			FreeQtd(pQtd);
 		}
 		HcdQHD(HostID, HeadIdx)->FirstQtd = LINK_TERMINATE;
+		memset(&PipeStreaming[HostID][HeadIdx], 0, sizeof(Pipe_Stream_Handle_T));
+
+		/* The overlay still holds the qTD that was running: retire it so the controller does not resume
+		   it, keeping the data toggle it carries */
+		HcdQHD(HostID, HeadIdx)->Overlay.NextQtd = LINK_TERMINATE;
+		HcdQHD(HostID, HeadIdx)->Overlay.AlterNextQtd = LINK_TERMINATE;
+		HcdQHD(HostID, HeadIdx)->Overlay.Active = 0;
+		HcdQHD(HostID, HeadIdx)->Overlay.Halted = 0;
 	}
 
 	EnableSchedule(HostID, (XferType == INTERRUPT_TRANSFER) || (XferType == ISOCHRONOUS_TRANSFER) ? 1 : 0);
@@ -273,6 +301,16 @@ HCD_STATUS HcdCancelTransfer(uint32_t PipeHandle)
 HCD_STATUS HcdControlTransfer(uint32_t PipeHandle,
 							  const USB_Request_Header_t *const pDeviceRequest,
 							  uint8_t *const buffer)
+{
+	ASSERT_STATUS_OK(HcdControlTransferSubmit(PipeHandle, pDeviceRequest, buffer) );
+
+	/* wait for semaphore compete TDs */
+	return HcdWaitTransfer(PipeHandle, TRANSFER_TIMEOUT_MS);
+}
+
+HCD_STATUS HcdControlTransferSubmit(uint32_t PipeHandle,
+									const USB_Request_Header_t *const pDeviceRequest,
+									uint8_t *const buffer)
 {
 	uint8_t HostID, QhdIdx;
 	HCD_TRANSFER_TYPE XferType;
@@ -313,9 +351,6 @@ HCD_STATUS HcdControlTransfer(uint32_t PipeHandle,
 	HcdQHD(HostID, QhdIdx)->FirstQtd = Align32( (uint32_t) HcdQTD(HostID, SetupTdIdx) );
 	HcdQHD(HostID, QhdIdx)->Overlay.NextQtd = (uint32_t) HcdQTD(HostID, SetupTdIdx);
 
-	/* wait for semaphore compete TDs */
-	ASSERT_STATUS_OK(WaitForTransferComplete(HostID, QhdIdx) );
-
 	return HCD_STATUS_OK;
 }
 
@@ -350,7 +385,7 @@ HCD_STATUS HcdDataTransfer(uint32_t PipeHandle,
 	else {	/*-- Control / Bulk / Interrupt --*/
 		if(XferType == BULK_TRANSFER)
 		{
-			ASSERT_STATUS_OK( QueueQTDs(HostID, &DataTdIdx, buffer, ExpectedLength,
+			ASSERT_STATUS_OK( QueueQTDs(HostID, HeadIdx, &DataTdIdx, buffer, ExpectedLength,
 									HcdQHD(HostID,HeadIdx)->Direction ? IN_TRANSFER : OUT_TRANSFER, 0) );
 		}
 		else
@@ -381,6 +416,40 @@ HCD_STATUS HcdGetPipeStatus(uint32_t PipeHandle)/* TODO can be implemented based
 	return (HCD_STATUS)HcdQHD(HostID, HeadIdx)->status;
 }
 
+HCD_STATUS HcdWaitTransfer(uint32_t PipeHandle, uint32_t TimeoutMs)
+{
+	uint8_t HostID, HeadIdx;
+	HCD_STATUS status;
+
+	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, NULL, &HeadIdx) );
+
+	status = WaitForTransferComplete(HostID, HeadIdx, TimeoutMs);
+	if (status == HCD_STATUS_TRANSFER_TIMEOUT) {
+		HcdCancelTransfer(PipeHandle);
+		if (HcdQHD(HostID, HeadIdx)->status == HCD_STATUS_TRANSFER_QUEUED) {
+			HcdQHD(HostID, HeadIdx)->status = HCD_STATUS_TRANSFER_TIMEOUT;
+			TransferComplete(HostID, HeadIdx);
+		}
+		else {	/* finished while it was being cancelled */
+			status = (HCD_STATUS) HcdQHD(HostID, HeadIdx)->status;
+		}
+	}
+	return status;
+}
+
+HCD_STATUS HcdSetTransferCallback(uint32_t PipeHandle, HCD_TRANSFER_CALLBACK Callback, void *Context)
+{
+	uint8_t HostID, HeadIdx;
+
+	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, NULL, &HeadIdx) );
+
+	PipeCallback[HostID][HeadIdx].Callback = NULL;	/* never seen half written by the interrupt */
+	PipeCallback[HostID][HeadIdx].Context = Context;
+	PipeCallback[HostID][HeadIdx].PipeHandle = PipeHandle;
+	PipeCallback[HostID][HeadIdx].Callback = Callback;
+	return HCD_STATUS_OK;
+}
+
 static void FreeQhd(uint8_t HostID, uint8_t QhdIdx)
 {
 	HcdQHD(HostID, QhdIdx)->status = HCD_STATUS_STRUCTURE_IS_FREE;
@@ -430,13 +499,7 @@ static HCD_STATUS AllocQhd(uint8_t HostID,
 		   *pQhdIdx)->ControlEndpointFlag = (DeviceSpeed != HIGH_SPEED && TransferType == CONTROL_TRANSFER) ? 1 : 0;
 	HcdQHD(HostID, *pQhdIdx)->NakCountReload = 0;	/* infinite NAK/NYET */
 
-	/*-- Currently All interrupt endpoints will be served as 1 (micro)frame polling, thus Interval parameter is ignored --*/
-	/*-- For High Speed Interval should be used to compute the uFrameSMask --*/
-	HcdQHD(HostID,
-		   *pQhdIdx)->uFrameSMask =
-		(TransferType == INTERRUPT_TRANSFER) ? (DeviceSpeed == HIGH_SPEED ? 0xFF : 0x01) : 0;
-	HcdQHD(HostID,
-		   *pQhdIdx)->uFrameCMask = (DeviceSpeed != HIGH_SPEED && TransferType == INTERRUPT_TRANSFER) ? 0x1C : 0;			/*-- Schedule Complete Split at uFrame2, uFrame3 and uFrame4 --*/
+	/*-- uFrameSMask/uFrameCMask of interrupt endpoints come from AllocBandwidth --*/
 	HcdQHD(HostID, *pQhdIdx)->HubAddress = HSHubDevAddr;
 	HcdQHD(HostID, *pQhdIdx)->PortNumber = HSHubPortNum;
 	HcdQHD(HostID, *pQhdIdx)->Mult = (DeviceSpeed == HIGH_SPEED ? Mult : 1);
@@ -531,6 +594,7 @@ static HCD_STATUS AllocQTD(uint8_t HostID,
 }
 
 static HCD_STATUS QueueQTDs (uint8_t HostID,
+							 uint8_t QhdIdx,
 							 uint32_t* pTdIdx,
 							 uint8_t* dataBuff,
 							 uint32_t xferLen,
@@ -544,10 +608,12 @@ static HCD_STATUS QueueQTDs (uint8_t HostID,
 		uint32_t TdLen;
 		uint32_t MaxTDLen = QTD_MAX_XFER_LENGTH - Offset4k((uint32_t)dataBuff);
 
-		if(PipeStreaming[HostID].PacketSize > 0)
-			TdLen = MIN(xferLen, PipeStreaming[HostID].PacketSize);
-		else
-			TdLen = MIN(xferLen, MaxTDLen);
+		/* Streaming: fill each qTD with as many whole packets as its five pages take, so a
+		   64KB command runs off four or five qTDs. A qTD ending inside a packet would send a
+		   short packet (OUT) or take the device's full packet as babble (IN). */
+		if(PipeStreaming[HostID][QhdIdx].PacketSize > 0)
+			MaxTDLen -= MaxTDLen % PipeStreaming[HostID][QhdIdx].PacketSize;
+		TdLen = MIN(xferLen, MaxTDLen);
 		xferLen -= TdLen;
 
 		if (TailTdIdx == 0xFFFFFFFF)
@@ -565,10 +631,10 @@ static HCD_STATUS QueueQTDs (uint8_t HostID,
 			}
 			else
 			{
-				PipeStreaming[HostID].BufferAddress = (uint32_t)dataBuff;
-				PipeStreaming[HostID].RemainBytes = xferLen + TdLen;
-				PipeStreaming[HostID].DataToggle = DataToggle;
-				HcdQTD(HostID,HCD_MAX_QTD - 1)->IntOnComplete = 1;
+				PipeStreaming[HostID][QhdIdx].BufferAddress = (uint32_t)dataBuff;
+				PipeStreaming[HostID][QhdIdx].RemainBytes = xferLen + TdLen;
+				PipeStreaming[HostID][QhdIdx].DataToggle = DataToggle;
+				HcdQTD(HostID,TailTdIdx)->IntOnComplete = 1;	/* refill from RemoveCompletedQTD() */
 				break;
 			}
 		}
@@ -578,8 +644,200 @@ static HCD_STATUS QueueQTDs (uint8_t HostID,
 	}
 	if(xferLen == 0)
 	{
-		memset(&PipeStreaming[HostID], 0, sizeof(Pipe_Stream_Handle_T));
+		memset(&PipeStreaming[HostID][QhdIdx], 0, sizeof(Pipe_Stream_Handle_T));
+	}
+	return HCD_STATUS_OK;
+}
+
+/*---------- Periodic Bandwidth ----------*/
+/* Adds (Sign 1) or takes back (Sign -1) an endpoint's reservation. Returns how loaded the busiest microframe
+   of the frame is afterwards, in thousandths of a microframe's budget, or 0xFFFFFFFF if it does not fit */
+static uint32_t ChargeBandwidth(uint8_t HostID, Period_Slot_T *pSlot, int32_t Sign)
+{
+	Period_Bandwidth_T *pBandwidth = &PeriodBandwidth[HostID];
+	uint32_t TtBytes = pSlot->TtBytes;
+	uint32_t Backlog = 0;
+	uint32_t Peak = 0;
+	uint8_t uFrame;
+
+	for (uFrame = 0; uFrame < 8; uFrame++) {
+		if ((pSlot->SMask | pSlot->CMask) & (1 << uFrame)) {
+			pBandwidth->HsBytes[uFrame] += Sign * pSlot->HsBytes;
+		}
+		/*-- A start split hands the TT at most SPLIT_MAX_LEN_UFRAME bytes, one split a microframe from the first on --*/
+		if (TtBytes && (pSlot->SMask & ((2 << uFrame) - 1))) {
+			uint32_t Bytes = MIN(TtBytes, SPLIT_MAX_LEN_UFRAME);
+
+			TtBytes -= Bytes;
+			pBandwidth->TtBytes[uFrame] += Sign * Bytes;
+		}
+	}
+
+	for (uFrame = 0; uFrame < 8; uFrame++) {
+		if (pBandwidth->HsBytes[uFrame] > HS_UFRAME_BUDGET) {
+			return 0xFFFFFFFF;
+		}
+		/*-- The TT's full speed bus moves SPLIT_MAX_LEN_UFRAME bytes a microframe, what it cannot move carries over into
+		   the next one and all of it must be through by the end of microframe 6 --*/
+		Backlog += pBandwidth->TtBytes[uFrame];
+		Peak = MAX(Peak, MAX(pBandwidth->HsBytes[uFrame] * 1000UL / HS_UFRAME_BUDGET,
+							 Backlog * 1000UL / SPLIT_MAX_LEN_UFRAME));
+		Backlog -= MIN(Backlog, SPLIT_MAX_LEN_UFRAME);
+		if ((uFrame >= 6) && Backlog) {
+			return 0xFFFFFFFF;
+		}
+	}
+	return TtBytes ? 0xFFFFFFFF : Peak;
+}
+
+/* Picks the microframes an interrupt or isochronous endpoint runs in: the ones that leave the fullest
+   microframe least full, so several streams spread over the frame instead of piling onto microframe 0 */
+static HCD_STATUS AllocBandwidth(uint8_t HostID,
+								 uint8_t QhdIdx,
+								 HCD_USB_SPEED DeviceSpeed,
+								 HCD_TRANSFER_TYPE TransferType,
+								 HCD_TRANSFER_DIR TransferDir,
+								 uint16_t MaxPacketSize,
+								 uint8_t Interval,
+								 uint8_t Mult)
+{
+	Period_Slot_T *pSlot = &PeriodBandwidth[HostID].Slot[QhdIdx];
+	Period_Slot_T Best;
+	uint32_t BestPeak = 0xFFFFFFFF;
+	uint8_t Phase, uFrame;
+
+	memset(pSlot, 0, sizeof(Period_Slot_T));
+	pSlot->FramePeriod = 1;
+
+	if (DeviceSpeed == HIGH_SPEED) {
+		/*-- bInterval is an exponent: 2^(Interval-1) microframes, one transaction per frame from 8 on --*/
+		uint8_t uFramePeriod = (Interval > 4) ? 8 : (1 << (Interval - 1));
+
+		pSlot->HsBytes = Mult * (MaxPacketSize * 7 / 6 + HS_XACT_OVERHEAD);	/* worst case bit stuffing */
+		if ((TransferType == ISOCHRONOUS_TRANSFER) && (Interval > 4)) {
+			pSlot->FramePeriod = MIN(1 << (Interval - 4), FRAME_LIST_SIZE);
+		}
+
+		for (Phase = 0; Phase < uFramePeriod; Phase++) {
+			uint32_t Peak;
+
+			pSlot->SMask = 0;
+			for (uFrame = Phase; uFrame < 8; uFrame += uFramePeriod) {
+				pSlot->SMask |= 1 << uFrame;
+			}
+			Peak = ChargeBandwidth(HostID, pSlot, 1);
+			ChargeBandwidth(HostID, pSlot, -1);
+			if (Peak < BestPeak) {
+				BestPeak = Peak;
+				Best = *pSlot;
+			}
+		}
+	}
+	else {	/*-- Full/Low speed: split transactions through the TT, interrupt endpoints are polled every frame --*/
+		uint8_t Splits;
+
+		pSlot->TtBytes = MaxPacketSize * (DeviceSpeed == LOW_SPEED ? 8 : 1);
+		pSlot->HsBytes = MIN(MaxPacketSize, SPLIT_MAX_LEN_UFRAME) + HS_XACT_OVERHEAD;
+		Splits = (pSlot->TtBytes + SPLIT_MAX_LEN_UFRAME - 1) / SPLIT_MAX_LEN_UFRAME;
+		if (TransferType == ISOCHRONOUS_TRANSFER) {
+			pSlot->FramePeriod = MIN(1 << (Interval - 1), FRAME_LIST_SIZE);
+		}
+
+		for (Phase = 0; Phase < 8; Phase++) {
+			uint32_t Peak;
+
+			if ((TransferType == ISOCHRONOUS_TRANSFER) && (TransferDir == OUT_TRANSFER)) {
+				/*-- The data goes out in the start splits, all sent by microframe 5 --*/
+				if (Phase + Splits > 6) {
+					break;
+				}
+				pSlot->SMask = ((1 << Splits) - 1) << Phase;
+				pSlot->CMask = 0;
+			}
+			else {
+				/*-- One start split, complete splits from two microframes later until the data is in --*/
+				if (Phase + Splits + 3 > 7) {
+					break;
+				}
+				pSlot->SMask = 1 << Phase;
+				pSlot->CMask = ((1 << (Splits + 2)) - 1) << (Phase + 2);
+			}
+			Peak = ChargeBandwidth(HostID, pSlot, 1);
+			ChargeBandwidth(HostID, pSlot, -1);
+			if (Peak < BestPeak) {
+				BestPeak = Peak;
+				Best = *pSlot;
+			}
+		}
+	}
+
+	if (BestPeak == 0xFFFFFFFF) {
+		memset(pSlot, 0, sizeof(Period_Slot_T));
+		return HCD_STATUS_NOT_ENOUGH_BANDWIDTH;
+	}
+	*pSlot = Best;
+	ChargeBandwidth(HostID, pSlot, 1);
+	return HCD_STATUS_OK;
+}
+
+static void FreeBandwidth(uint8_t HostID, uint8_t QhdIdx)
+{
+	ChargeBandwidth(HostID, &PeriodBandwidth[HostID].Slot[QhdIdx], -1);
+	memset(&PeriodBandwidth[HostID].Slot[QhdIdx], 0, sizeof(Period_Slot_T));
+}
+
+/*---------- ISO TD Routines ----------*/
+/* Frame list slot for the first of TDCount iTDs/siTDs. Right behind the ones still queued while the
+   controller has not reached the end of them, so transfers queued back to back play without a gap,
+   otherwise ISO_START_DELAY_FRAMES ahead of the controller. Fails before anything is queued if the
+   pool is short or the ring would wrap onto frames not played yet */
+static HCD_STATUS IsoStartFrame(uint8_t HostID, uint8_t HeadIdx, uint32_t TDCount, uint32_t *pFrameIdx)
+{
+	Period_Slot_T *pSlot = &PeriodBandwidth[HostID].Slot[HeadIdx];
+	uint32_t Now = (USB_REG(HostID)->FRINDEX_H >> 3) % FRAME_LIST_SIZE;
+	uint32_t Ahead = (pSlot->NextFrame - Now) % FRAME_LIST_SIZE;
+	uint32_t Queued = 0, Free = 0;
+	uint32_t i;
+
+	/*-- Counted rather than tracked: the interrupt frees TDs behind the task's back --*/
+	if ( HcdQHD(HostID, HeadIdx)->EndpointSpeed == HIGH_SPEED ) {
+		for (i = 0; i < HCD_MAX_HS_ITD; i++) {
+			if (!HcdHsITD(HostID, i)->inUse) {
+				Free++;
+			}
+			else if (HcdHsITD(HostID, i)->IhdIdx == HeadIdx) {
+				Queued++;
+			}
+		}
+		if (Free < TDCount) {
+			return HCD_STATUS_NOT_ENOUGH_HS_ITD;
+		}
 	}
+	else {
+		for (i = 0; i < HCD_MAX_SITD; i++) {
+			if (!HcdSITD(HostID, i)->inUse) {
+				Free++;
+			}
+			else if (HcdSITD(HostID, i)->IhdIdx == HeadIdx) {
+				Queued++;
+			}
+		}
+		if (Free < TDCount) {
+			return HCD_STATUS_NOT_ENOUGH_SITD;
+		}
+	}
+
+	if ((Ahead == 0) || (Ahead > Queued * pSlot->FramePeriod)) {	/*-- ring ran dry or fell behind: start over --*/
+		Ahead = ISO_START_DELAY_FRAMES;
+	}
+	if (Ahead + (TDCount - 1) * pSlot->FramePeriod >= FRAME_LIST_SIZE) {
+		ASSERT_STATUS_OK_MESSAGE(
+			HCD_STATUS_DATA_OVERFLOW,
+			"ISO data length overflows the Period Frame List size, Please increase size by FRAMELIST_SIZE_BITS or reduce data length");
+	}
+
+	*pFrameIdx = (Now + Ahead) % FRAME_LIST_SIZE;
+	pSlot->NextFrame = (*pFrameIdx + TDCount * pSlot->FramePeriod) % FRAME_LIST_SIZE;
 	return HCD_STATUS_OK;
 }
 
@@ -594,13 +852,12 @@ HCD_STATUS AllocHsItd(uint8_t HostID,
 					  uint8_t IhdIdx,
 					  uint8_t *dataBuff,
 					  uint32_t TDLen,
-					  uint8_t XactPerITD,
+					  uint8_t uFrameMask,
 					  uint8_t IntOnComplete)
 {
 	for ((*pTdIdx) = 0; (*pTdIdx) < HCD_MAX_HS_ITD && HcdHsITD(HostID, *pTdIdx)->inUse; (*pTdIdx)++) {}
 	if ((*pTdIdx) < HCD_MAX_HS_ITD) {
-		uint8_t i;
-		uint8_t XactStep = 8 / XactPerITD;
+		uint8_t i, Page = 0;
 		uint32_t MaxXactLen = HcdQHD(HostID, IhdIdx)->MaxPackageSize * HcdQHD(HostID, IhdIdx)->Mult;
 
 		memset(HcdHsITD(HostID, *pTdIdx), 0, sizeof(HCD_HS_ITD));
@@ -609,19 +866,30 @@ HCD_STATUS AllocHsItd(uint8_t HostID,
 		HcdHsITD(HostID, *pTdIdx)->IhdIdx = IhdIdx;
 
 		HcdHsITD(HostID, *pTdIdx)->Horizontal.Link = LINK_TERMINATE;
-		for (i = 0; TDLen > 0 && i < 8; i += XactStep) {
-			uint32_t XactLen = MIN(TDLen, MaxXactLen);
-			TDLen -= XactLen;
+		HcdHsITD(HostID, *pTdIdx)->BufferPointer[0] = Align4k( (uint32_t) dataBuff);
+		for (i = 0; TDLen > 0 && i < 8; i++) {
+			uint32_t XactLen;
 
-			HcdHsITD(HostID, *pTdIdx)->BufferPointer[i] = Align4k( (uint32_t) dataBuff);
+			if (!(uFrameMask & (1 << i))) {
+				continue;
+			}
+			XactLen = MIN(TDLen, MaxXactLen);
+			TDLen -= XactLen;
 
+			/*-- 7 page pointers shared by the 8 transactions, a transaction crossing a page moves on to the next --*/
+			if (Align4k( (uint32_t) dataBuff) != Align4k(HcdHsITD(HostID, *pTdIdx)->BufferPointer[Page])) {
+				HcdHsITD(HostID, *pTdIdx)->BufferPointer[++Page] = Align4k( (uint32_t) dataBuff);
+			}
 			HcdHsITD(HostID, *pTdIdx)->Transaction[i].Offset = ( (uint32_t) dataBuff ) & 4095;
-			HcdHsITD(HostID, *pTdIdx)->Transaction[i].PageSelect = i;
+			HcdHsITD(HostID, *pTdIdx)->Transaction[i].PageSelect = Page;
 			HcdHsITD(HostID, *pTdIdx)->Transaction[i].IntOnComplete = (IntOnComplete && TDLen == 0) ? 1 : 0;
 			HcdHsITD(HostID, *pTdIdx)->Transaction[i].Length = XactLen;
 			HcdHsITD(HostID, *pTdIdx)->Transaction[i].Active = 1;
 
 			dataBuff += XactLen;
+			if (Align4k( (uint32_t) dataBuff - 1) != Align4k(HcdHsITD(HostID, *pTdIdx)->BufferPointer[Page])) {
+				HcdHsITD(HostID, *pTdIdx)->BufferPointer[++Page] = Align4k( (uint32_t) dataBuff - 1);
+			}
 		}
 
 		HcdHsITD(HostID, *pTdIdx)->BufferPointer[0] |= (HcdQHD(HostID, IhdIdx)->EndpointNumber << 8) | HcdQHD(HostID,
@@ -641,33 +909,18 @@ HCD_STATUS AllocHsItd(uint8_t HostID,
 
 static HCD_STATUS QueueITDs(uint8_t HostID, uint8_t IhdIdx, uint8_t *dataBuff, uint32_t xferLen)
 {
+	Period_Slot_T *pSlot = &PeriodBandwidth[HostID].Slot[IhdIdx];
 	uint32_t MaxTDLen;
 	uint32_t FrameIdx;
+	uint8_t XactPerITD = 0;
+	uint8_t i;
 
-#if 0	/* Maximum bandwidth (Interval = 1) regardless of Interval value */
-	uint8_t XactPerITD;
-	uint32_t FramePeriod;
-	if (HcdQHD(IhdIdx)->Interval < 4) {	/*-- Period < 8 --*/
-		XactPerITD = 1 << ( 4 - HcdQHD(IhdIdx)->Interval );		/*-- Interval 1 => 8, 2 => 4, 3 => 2 --*/
-		FramePeriod = 1;
-	}
-	else {
-		XactPerITD = 1;
-		FramePeriod = 1 << ( HcdQHD(IhdIdx)->Interval - 4 );	/*-- Frame step 4 => 1, 5 => 2, 6 => 3 --*/
+	for (i = 0; i < 8; i++) {	/*-- one transaction in each microframe AllocBandwidth gave the endpoint --*/
+		XactPerITD += (pSlot->SMask >> i) & 1;
 	}
-#else
-	#define XactPerITD      8
-	#define FramePeriod     1
-#endif
-
 	MaxTDLen = XactPerITD * HcdQHD(HostID, IhdIdx)->MaxPackageSize * HcdQHD(HostID, IhdIdx)->Mult;
-	FrameIdx = USB_REG(HostID)->FRINDEX_H >> 3;
 
-	if (xferLen > MaxTDLen * FRAME_LIST_SIZE) {	/*-- Data length overflow the Period FRAME LIST  --*/
-		ASSERT_STATUS_OK_MESSAGE(
-			HCD_STATUS_DATA_OVERFLOW,
-			"ISO data length overflows the Period Frame List size, Please increase size by FRAMELIST_SIZE_BITS or reduce data length");
-	}
+	ASSERT_STATUS_OK(IsoStartFrame(HostID, IhdIdx, (xferLen + MaxTDLen - 1) / MaxTDLen, &FrameIdx) );
 
 	while (xferLen > 0) {
 		uint32_t TdIdx;
@@ -676,11 +929,11 @@ static HCD_STATUS QueueITDs(uint8_t HostID, uint8_t IhdIdx, uint8_t *dataBuff, u
 		TDLen = MIN(xferLen, MaxTDLen);
 		xferLen -= TDLen;
 
-		ASSERT_STATUS_OK(AllocHsItd(HostID, &TdIdx, IhdIdx, dataBuff, TDLen, XactPerITD, xferLen ? 0 : 1) );
+		ASSERT_STATUS_OK(AllocHsItd(HostID, &TdIdx, IhdIdx, dataBuff, TDLen, pSlot->SMask, xferLen ? 0 : 1) );
 
-		FrameIdx = (FrameIdx + FramePeriod) % FRAME_LIST_SIZE;
 		/*-- Hook ITD to Period List Base --*/
 		InsertLinkPointer(&EHCI_FRAME_LIST(HostID)[FrameIdx], &HcdHsITD(HostID, TdIdx)->Horizontal, ITD_TYPE);
+		FrameIdx = (FrameIdx + pSlot->FramePeriod) % FRAME_LIST_SIZE;
 		dataBuff += TDLen;
 	}
 
@@ -706,7 +959,9 @@ static HCD_STATUS AllocSItd(uint8_t HostID,
 	for ((*pTdIdx) = 0; (*pTdIdx) < HCD_MAX_SITD && HcdSITD(HostID, *pTdIdx)->inUse; (*pTdIdx)++) {}
 
 	if ((*pTdIdx) < HCD_MAX_SITD) {
+		Period_Slot_T *pSlot = &PeriodBandwidth[HostID].Slot[HeadIdx];
 		uint8_t TCount = TDLen / SPLIT_MAX_LEN_UFRAME + (TDLen % SPLIT_MAX_LEN_UFRAME ? 1 : 0);	/*-- Number of Split Transactions --*/
+		uint8_t FirstSplit = pSlot->SMask & (-pSlot->SMask);
 
 		memset(HcdSITD(HostID, *pTdIdx), 0, sizeof(HCD_SITD) );
 
@@ -721,9 +976,10 @@ static HCD_STATUS AllocSItd(uint8_t HostID,
 		HcdSITD(HostID, *pTdIdx)->HubAddress = HcdQHD(HostID, HeadIdx)->HubAddress;
 		HcdSITD(HostID, *pTdIdx)->PortNumber = HcdQHD(HostID, HeadIdx)->PortNumber;
 		HcdSITD(HostID, *pTdIdx)->Direction = HcdQHD(HostID, HeadIdx)->Direction;
-		/*-- Word 3 --*/
-		HcdSITD(HostID, *pTdIdx)->uFrameSMask = (1 << TCount) - 1;
-		HcdSITD(HostID, *pTdIdx)->uFrameCMask = 0;
+		/*-- Word 3: the microframes AllocBandwidth gave the endpoint, a short OUT packet needs fewer start splits --*/
+		HcdSITD(HostID, *pTdIdx)->uFrameSMask = HcdQHD(HostID, HeadIdx)->Direction ?
+												pSlot->SMask : (pSlot->SMask & (FirstSplit * ((1 << TCount) - 1)));
+		HcdSITD(HostID, *pTdIdx)->uFrameCMask = pSlot->CMask;
 		/*-- Word 4 --*/
 		HcdSITD(HostID, *pTdIdx)->Active = 1;
 		HcdSITD(HostID, *pTdIdx)->TotalBytesToTransfer = TDLen;
@@ -751,51 +1007,47 @@ static HCD_STATUS AllocSItd(uint8_t HostID,
 
 static HCD_STATUS QueueSITDs(uint8_t HostID, uint8_t HeadIdx, uint8_t *dataBuff, uint32_t xferLen)
 {
+	Period_Slot_T *pSlot = &PeriodBandwidth[HostID].Slot[HeadIdx];
+	uint32_t MaxTDLen = HcdQHD(HostID, HeadIdx)->MaxPackageSize;
 	uint32_t FrameIdx;
 
-#if 0	/* Maximum bandwidth (Interval = 1) regardless of Interval value */
-	uint8_t XactPerITD;
-	uint32_t FramePeriod;
-	if (HcdQHD(IhdIdx)->Interval < 4) {	/*-- Period < 8 --*/
-		FramePeriod = 1;
-	}
-	else {
-		FramePeriod = 1 << ( HcdQHD(IhdIdx)->Interval - 4 );	/*-- Frame step 4 => 1, 5 => 2, 6 => 3 --*/
-	}
-#else
-	#define FramePeriod     1
-#endif
+	ASSERT_STATUS_OK(IsoStartFrame(HostID, HeadIdx, (xferLen + MaxTDLen - 1) / MaxTDLen, &FrameIdx) );
 
-	if (xferLen > HcdQHD(HostID, HeadIdx)->MaxPackageSize * FRAME_LIST_SIZE) {	/*-- Data length overflow the Period FRAME LIST  --*/
-		ASSERT_STATUS_OK_MESSAGE(
-			HCD_STATUS_DATA_OVERFLOW,
-			"ISO data length overflows the Period Frame List size, Please increase size by FRAMELIST_SIZE_BITS or reduce data length");
-	}
-
-	FrameIdx = USB_REG(HostID)->FRINDEX_H >> 3;
 	while (xferLen) {
 		uint32_t TdIdx;
 		uint32_t TDLen;
 
-		TDLen = MIN(xferLen, HcdQHD(HostID, HeadIdx)->MaxPackageSize);
+		TDLen = MIN(xferLen, MaxTDLen);
 		xferLen -= TDLen;
 
 		ASSERT_STATUS_OK(AllocSItd(HostID, &TdIdx, HeadIdx, dataBuff, TDLen, xferLen ? 0 : 1) );
 
-		FrameIdx = (FrameIdx + FramePeriod) % FRAME_LIST_SIZE;
 		/*-- Hook SITD to Period List Base --*/
 		InsertLinkPointer(&EHCI_FRAME_LIST(HostID)[FrameIdx], &HcdSITD(HostID, TdIdx)->Horizontal, SITD_TYPE);
+		FrameIdx = (FrameIdx + pSlot->FramePeriod) % FRAME_LIST_SIZE;
 		dataBuff += TDLen;
 	}
 	return HCD_STATUS_OK;
 }
 
-static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EdIdx)/* TODO indentical to OHCI now */
+static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EdIdx, uint32_t TimeoutMs)/* TODO indentical to OHCI now */
 {
 
 #ifndef __TEST__
+	uint32_t Frame = HcdGetFrameNumber(HostID);
+	uint32_t uFrames = 0;
+
 	while ( HcdQHD(HostID, EdIdx)->status == HCD_STATUS_TRANSFER_QUEUED ) {
-		/* Should have time-out but left blank intentionally for bug catcher */
+		uint32_t Now = HcdGetFrameNumber(HostID);
+
+		if (!(USB_REG(HostID)->PORTSC1_H & EHC_PORTSC_CurrentConnectStatus)) {
+			return HCD_STATUS_DEVICE_DISCONNECTED;
+		}
+		uFrames += (Now - Frame) & 0x3FFF;	/* FRINDEX counts microframes, 14 bits */
+		Frame = Now;
+		if (uFrames >= TimeoutMs * 8) {
+			return HCD_STATUS_TRANSFER_TIMEOUT;
+		}
 	}
 	return (HCD_STATUS) HcdQHD(HostID, EdIdx)->status;
 #else
@@ -936,11 +1188,23 @@ void    HcdIrqHandler(uint8_t HostID)
 	/* Enable Interrupt */
 }
 
+/* Hands the status a transfer finished with to the pipe's callback */
+static void TransferComplete(uint8_t HostID, uint8_t QhdIdx)
+{
+	Pipe_Callback_T *pCallback = &PipeCallback[HostID][QhdIdx];
+
+	if ((pCallback->Callback != NULL) && (HcdQHD(HostID, QhdIdx)->status != HCD_STATUS_TRANSFER_QUEUED)) {
+		pCallback->Callback(pCallback->PipeHandle, (HCD_STATUS) HcdQHD(HostID, QhdIdx)->status, pCallback->Context);
+	}
+}
+
 static void RemoveCompletedQTD(uint8_t HostID, PHCD_QHD pQhd)
 {
 	PHCD_QTD pQtd;
 	uint32_t TdLink = pQhd->FirstQtd;
+	uint8_t QhdIdx = pQhd - HcdQHD(HostID, 0);
 	bool is_data_remain = false;
+	bool is_complete = false;
 
 	/*-- Foreach Qtd in Qhd --*/
 	while( (isValidLink(TdLink), pQtd = (PHCD_QTD) Align32(TdLink) ) &&
@@ -953,14 +1217,19 @@ static void RemoveCompletedQTD(uint8_t HostID, PHCD_QHD pQhd)
 
 		if (pQtd->IntOnComplete)
 		{
-			if(PipeStreaming[HostID].RemainBytes > 0)
+			if(PipeStreaming[HostID][QhdIdx].RemainBytes > 0)
 				is_data_remain = true;
 			else
+			{
 				pQhd->status = HCD_STATUS_OK;
+				is_complete = true;
+			}
 		}
 		if (pQtd->Halted /*|| pQtd->Babble || pQtd->BufferError || pQtd->TransactionError*/)
 		{
 			pQhd->status = HCD_STATUS_TRANSFER_Stall;
+			is_complete = true;
+			is_data_remain = false;
 		}
 		FreeQtd(pQtd);
 	}
@@ -968,16 +1237,21 @@ static void RemoveCompletedQTD(uint8_t HostID, PHCD_QHD pQhd)
 	if(is_data_remain)
 	{
 		uint32_t pQtd;
-		QueueQTDs(HostID, &pQtd,(uint8_t*)PipeStreaming[HostID].BufferAddress,
-				PipeStreaming[HostID].RemainBytes,
+		QueueQTDs(HostID, QhdIdx, &pQtd,(uint8_t*)PipeStreaming[HostID][QhdIdx].BufferAddress,
+				PipeStreaming[HostID][QhdIdx].RemainBytes,
 				pQhd->Direction ? IN_TRANSFER : OUT_TRANSFER,
-				PipeStreaming[HostID].DataToggle);
+				PipeStreaming[HostID][QhdIdx].DataToggle);
 		pQhd->FirstQtd = Align32( (uint32_t) HcdQTD(HostID,pQtd) );
 		pQhd->Overlay.NextQtd = (uint32_t) HcdQTD(HostID,pQtd);
 	}	
+	else if(is_complete)
+	{
+		memset(&PipeStreaming[HostID][QhdIdx], 0, sizeof(Pipe_Stream_Handle_T));
+		TransferComplete(HostID, QhdIdx);
+	}
 }
 
-static void RemoveErrorQTD(PHCD_QHD pQhd)
+static void RemoveErrorQTD(uint8_t HostID, PHCD_QHD pQhd)
 {
 	PHCD_QTD pQtd;
 	uint32_t TdLink = pQhd->FirstQtd;
@@ -1005,6 +1279,8 @@ static void RemoveErrorQTD(PHCD_QHD pQhd)
 		}
 		pQhd->FirstQtd = LINK_TERMINATE;
 		pQhd->Overlay.Halted = 0;
+		memset(&PipeStreaming[HostID][pQhd - HcdQHD(HostID, 0)], 0, sizeof(Pipe_Stream_Handle_T));
+		TransferComplete(HostID, pQhd - HcdQHD(HostID, 0));
 	}
 }
 
@@ -1038,16 +1314,23 @@ static void PeriodScheduleIsr(uint8_t HostID)
 					( pItd->Transaction[2].Active == 0) && ( pItd->Transaction[3].Active == 0) &&
 					( pItd->Transaction[4].Active == 0) && ( pItd->Transaction[5].Active == 0) &&
 					( pItd->Transaction[6].Active == 0) && ( pItd->Transaction[7].Active == 0) ) {
+					uint8_t IhdIdx = pItd->IhdIdx;
+					bool is_complete = false;
+
 					if ((pItd->Transaction[0].IntOnComplete == 1) || (pItd->Transaction[1].IntOnComplete == 1) ||
 						( pItd->Transaction[2].IntOnComplete == 1) || ( pItd->Transaction[3].IntOnComplete == 1) ||
 						( pItd->Transaction[4].IntOnComplete == 1) || ( pItd->Transaction[5].IntOnComplete == 1) ||
 						( pItd->Transaction[6].IntOnComplete == 1) || ( pItd->Transaction[7].IntOnComplete == 1) ) {
 						/*-- request complete, signal on Iso Head --*/
-						HcdQHD(HostID, pItd->IhdIdx)->status = HCD_STATUS_OK;
+						HcdQHD(HostID, IhdIdx)->status = HCD_STATUS_OK;
+						is_complete = true;
 					}
 					/*-- remove executed ITD --*/
 					pNextPointer->Link = pItd->Horizontal.Link;
 					FreeHsItd(pItd);
+					if (is_complete) {
+						TransferComplete(HostID, IhdIdx);
+					}
 					continue;	/*-- skip advance pNextPointer due to TD removal --*/
 				}
 			}
@@ -1055,14 +1338,21 @@ static void PeriodScheduleIsr(uint8_t HostID)
 				PHCD_SITD pSItd = (PHCD_SITD) Align32(pNextPointer->Link);
 
 				if (pSItd->Active == 0) {
+					uint8_t IhdIdx = pSItd->IhdIdx;
+					bool is_complete = false;
+
 					if (pSItd->IntOnComplete) {
 						/*-- request complete, signal on Iso Head --*/
-						HcdQHD(HostID, pSItd->IhdIdx)->status = HCD_STATUS_OK;
+						HcdQHD(HostID, IhdIdx)->status = HCD_STATUS_OK;
+						is_complete = true;
 					}
 
 					/*-- removed executed SITD --*/
 					pNextPointer->Link = pSItd->Horizontal.Link;
 					FreeSItd(pSItd);
+					if (is_complete) {
+						TransferComplete(HostID, IhdIdx);
+					}
 					continue;	/*-- skip advance pNextPointer due to TD removal --*/
 				}
 			}
@@ -1091,7 +1381,14 @@ static void UsbErrorIsr(uint8_t HostID)
 	while ( isValidLink(pQhd->Horizontal.Link) &&
 			Align32(pQhd->Horizontal.Link) != (uint32_t) HcdAsyncHead(HostID) ) {
 		pQhd = (PHCD_QHD) Align32(pQhd->Horizontal.Link);
-		RemoveErrorQTD(pQhd);
+		RemoveErrorQTD(HostID, pQhd);
+	}
+
+	/*-- Foreach Qhd in interrupt list --*/
+	pQhd = HcdIntHead(HostID);
+	while ( isValidLink(pQhd->Horizontal.Link) ) {
+		pQhd = (PHCD_QHD) Align32(pQhd->Horizontal.Link);
+		RemoveErrorQTD(HostID, pQhd);
 	}
 }
 
@@ -1150,6 +1447,7 @@ static __INLINE HCD_STATUS EHciHostInit(uint8_t HostID)
 
 	/*---------- Host Data Structure Init ----------*/
 	//	memset(&ehci_data[HostID], 0, sizeof(EHCI_HOST_DATA_T) );
+	memset(&PeriodBandwidth[HostID], 0, sizeof(Period_Bandwidth_T));
 
 	/*---------- USBINT ----------*/
 	USB_REG(HostID)->USBINTR_H &= ~EHC_USBINTR_ALL;	/* Disable All Interrupt */
@@ -1249,7 +1547,7 @@ void HcdSetStreamPacketSize(uint32_t PipeHandle, uint16_t packetsize)
 
 	PipehandleParse(PipeHandle, &HostID, &XferType, &HeadIdx);
 
-	PipeStreaming[HostID].PacketSize = packetsize;
+	PipeStreaming[HostID][HeadIdx].PacketSize = packetsize;
 }
 
 #endif // __LPC_EHCI__
@@ -50,8 +50,12 @@
 #define HCD_MAX_QHD					HCD_MAX_ENDPOINT		/* USBD_USB_HC_EHCI */
 //#define	HCD_MAX_QTD					(HCD_MAX_ENDPOINT+3)	/* USBD_USB_HC_EHCI */
 #define	HCD_MAX_QTD					8						/* USBD_USB_HC_EHCI */
+#ifndef HCD_MAX_HS_ITD
 #define	HCD_MAX_HS_ITD				4						/* USBD_USB_HC_EHCI */
+#endif
+#ifndef HCD_MAX_SITD
 #define HCD_MAX_SITD				16						/* USBD_USB_HC_EHCI */
+#endif
 
 #define FRAMELIST_SIZE_BITS         5			/* (0:1024) - (1:512) - (2:256) - (3:128) - (4:64) - (5:32) - (6:16) - (7:8) */
 #define FRAME_LIST_SIZE             (1024 >> FRAMELIST_SIZE_BITS)
@@ -173,6 +177,12 @@
 //#define LINK_TERMINATE                          0x01
 #define SPLIT_MAX_LEN_UFRAME                    188
 
+/* Periodic bandwidth. Every interrupt and isochronous endpoint is given fixed microframes when its
+   pipe is opened and is charged for them in every frame, so what fits once fits in all frames */
+#define HS_UFRAME_BUDGET                        6000		/* 80% of the 7500 byte times in a microframe */
+#define HS_XACT_OVERHEAD                        55			/* token, handshake, sync, EOP and inter packet gaps */
+#define ISO_START_DELAY_FRAMES                  1			/* frames ahead of FRINDEX a new iTD/siTD ring starts */
+
 /*=======================================================================*/
 /*  E H C I		S T R U C T U R E S				*/
 /*=======================================================================*/
@@ -386,6 +396,22 @@ typedef struct st_PipeHandle {
 	uint8_t HostId;
 } Pipe_Handle_T;
 
+/* Microframes and bus time an interrupt or isochronous endpoint holds in every frame */
+typedef struct st_PeriodSlot {
+	uint8_t  SMask;			/* microframes it starts a transaction (or start split) in */
+	uint8_t  CMask;			/* microframes its complete splits are sent in */
+	uint16_t HsBytes;		/* high speed byte times taken in each S/C-mask microframe */
+	uint16_t TtBytes;		/* full/low speed bytes the transaction translator carries from the first S-mask microframe on */
+	uint16_t FramePeriod;	/* isochronous: frames from one iTD/siTD to the next */
+	uint16_t NextFrame;		/* isochronous: frame list slot the next iTD/siTD goes into while the ring runs */
+} Period_Slot_T;
+
+typedef struct st_PeriodBandwidth {
+	uint16_t HsBytes[8];	/* high speed byte times reserved in each microframe */
+	uint16_t TtBytes[8];	/* full/low speed bytes reserved through the transaction translator in each microframe */
+	Period_Slot_T Slot[HCD_MAX_QHD];
+} Period_Bandwidth_T;
+
 typedef struct st_PipeStreamHandle {
 	uint32_t BufferAddress;
 	uint32_t RemainBytes;
@@ -488,13 +514,30 @@ static HCD_STATUS AllocQTD (uint8_t HostID,
 							uint8_t IOC);
 
 static HCD_STATUS QueueQTDs (uint8_t HostID,
+							 uint8_t QhdIdx,
 							 uint32_t* pTdIdx,
 							 uint8_t* dataBuff,
 							 uint32_t xferLen,
 							 HCD_TRANSFER_DIR PIDCode,
 							 uint8_t DataToggle);
 
+/********************************* Periodic Bandwidth *********************************/
+static HCD_STATUS AllocBandwidth(uint8_t HostID,
+								 uint8_t QhdIdx,
+								 HCD_USB_SPEED DeviceSpeed,
+								 HCD_TRANSFER_TYPE TransferType,
+								 HCD_TRANSFER_DIR TransferDir,
+								 uint16_t MaxPacketSize,
+								 uint8_t Interval,
+								 uint8_t Mult);
+
+static void FreeBandwidth(uint8_t HostID, uint8_t QhdIdx);
+
+static uint32_t ChargeBandwidth(uint8_t HostID, Period_Slot_T *pSlot, int32_t Sign);
+
 /********************************* ISO Head & ISO TD & Split ISO *********************************/
+static HCD_STATUS IsoStartFrame(uint8_t HostID, uint8_t HeadIdx, uint32_t TDCount, uint32_t *pFrameIdx);
+
 static void FreeHsItd(PHCD_HS_ITD pItd);
 
 static HCD_STATUS AllocHsItd(uint8_t HostID,
@@ -502,7 +545,7 @@ static HCD_STATUS AllocHsItd(uint8_t HostID,
 							 uint8_t IhdIdx,
 							 uint8_t *dataBuff,
 							 uint32_t TDLen,
-							 uint8_t XactPerITD,
+							 uint8_t uFrameMask,
 							 uint8_t IntOnComplete);
 
 static HCD_STATUS QueueITDs(uint8_t HostID, uint8_t IhdIdx, uint8_t *dataBuff, uint32_t xferLen);
@@ -519,7 +562,9 @@ static HCD_STATUS AllocSItd(uint8_t HostID,
 static HCD_STATUS QueueSITDs(uint8_t HostID, uint8_t HeadIdx, uint8_t *dataBuff, uint32_t xferLen);
 
 /********************************* Transfer Routines *********************************/
-static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EpIdx);
+static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EpIdx, uint32_t TimeoutMs);
+
+static void TransferComplete(uint8_t HostID, uint8_t QhdIdx);
 
 static HCD_STATUS PipehandleParse(uint32_t Pipehandle, uint8_t *pHostID, HCD_TRANSFER_TYPE *XferType, uint8_t *pIdx);
 
@@ -148,9 +148,15 @@ typedef enum {
 	HCD_STATUS_TRANSFER_TYPE_NOT_SUPPORTED,	/**< USB transfer set up status: transfer is not supported */
 
 	HCD_STATUS_PIPEHANDLE_INVALID,			/**< USB transfer set up status: pipe handle information is not valid */
-	HCD_STATUS_PARAMETER_INVALID			/**< USB transfer set up status: wrong supply parameters */
+	HCD_STATUS_PARAMETER_INVALID,			/**< USB transfer set up status: wrong supply parameters */
+	HCD_STATUS_TRANSFER_TIMEOUT,			/**< Transfer/process completion fail: not finished within the wait's timeout, cancelled */
+	HCD_STATUS_NOT_ENOUGH_BANDWIDTH			/**< USB transfer set up status: periodic schedule has no room for the endpoint */
 } HCD_STATUS;
 
+/** Transfer completion callback, see \ref HcdSetTransferCallback()
+ */
+typedef void (*HCD_TRANSFER_CALLBACK)(uint32_t PipeHandle, HCD_STATUS Status, void *Context);
+
 /**
  * @brief  Initiate host driver
  *
@@ -272,7 +278,7 @@ HCD_STATUS HcdCancelTransfer(uint32_t PipeHandle);
 HCD_STATUS HcdClearEndpointHalt(uint32_t PipeHandle);
 
 /**
- * @brief  Perform a control transfer
+ * @brief  Perform a control transfer, waiting up to \ref TRANSFER_TIMEOUT_MS for it
  *
  * @param  PipeHandle	: encoded pipe handle information
  * @param  pDeviceRequest: pointer to \ref USB_Request_Header_t structure
@@ -283,6 +289,20 @@ HCD_STATUS HcdControlTransfer(uint32_t PipeHandle,
 							  const USB_Request_Header_t *const pDeviceRequest,
 							  uint8_t *const buffer);
 
+/**
+ * @brief  Queue a control transfer and return without waiting for it
+ *
+ * @param  PipeHandle	: encoded pipe handle information
+ * @param  pDeviceRequest: pointer to \ref USB_Request_Header_t structure, must stay valid until the transfer completes
+ * @param  buffer		: pointer to share buffer used in data phase
+ * @return \ref HCD_STATUS code
+ * @note   Completion is reported as for \ref HcdDataTransfer(): through the pipe's callback,
+ *         \ref HcdGetPipeStatus() or \ref HcdWaitTransfer().
+ */
+HCD_STATUS HcdControlTransferSubmit(uint32_t PipeHandle,
+									const USB_Request_Header_t *const pDeviceRequest,
+									uint8_t *const buffer);
+
 /**
  * @brief  Perform a non-control transfer
  *
@@ -305,6 +325,31 @@ HCD_STATUS HcdDataTransfer(uint32_t PipeHandle,
  */
 HCD_STATUS HcdGetPipeStatus(uint32_t PipeHandle);
 
+/**
+ * @brief  Wait for the transfer queued on a pipe to complete
+ *
+ * @param  PipeHandle	: encoded pipe handle information
+ * @param  TimeoutMs	: longest wait in milliseconds, counted in bus frames
+ * @return status of the completed transfer, \ref HCD_STATUS_DEVICE_DISCONNECTED if the device went away,
+ *         or \ref HCD_STATUS_TRANSFER_TIMEOUT if it was still running after TimeoutMs. The transfer is
+ *         then cancelled and the pipe's status left at \ref HCD_STATUS_TRANSFER_TIMEOUT.
+ */
+HCD_STATUS HcdWaitTransfer(uint32_t PipeHandle, uint32_t TimeoutMs);
+
+/**
+ * @brief  Register a function to call each time a transfer queued on a pipe completes
+ *
+ * @param  PipeHandle	: encoded pipe handle information
+ * @param  Callback		: function to call, NULL to go back to polling \ref HcdGetPipeStatus()
+ * @param  Context		: handed to Callback unchanged
+ * @return \ref HCD_STATUS code
+ * @note   Callback runs inside \ref HcdIrqHandler() once the pipe's status has left
+ *         \ref HCD_STATUS_TRANSFER_QUEUED, and gets that status. It may queue the pipe's next transfer
+ *         or signal an RTOS event a task is blocked on, but must not wait. The registration lasts until
+ *         the pipe is closed.
+ */
+HCD_STATUS HcdSetTransferCallback(uint32_t PipeHandle, HCD_TRANSFER_CALLBACK Callback, void *Context);
+
 /**
  * @brief  Set size of each packet in a continuous data transfer
  *
@@ -340,6 +385,13 @@ void assert_status_ok_message(HCD_STATUS status,
 
 #if defined(__LPC_OHCI_C__) || defined(__LPC_EHCI_C__)
 
+/* Per pipe registration made by HcdSetTransferCallback() */
+typedef struct st_PipeCallback {
+	HCD_TRANSFER_CALLBACK Callback;
+	void *Context;
+	uint32_t PipeHandle;
+} Pipe_Callback_T;
+
 void  HcdDelayUS (uint32_t  delay);
 
 void  HcdDelayMS (uint32_t  delay);
@@ -45,6 +45,7 @@
 
 PRAGMA_ALIGN_256
 OHCI_HOST_DATA_T ohci_data[MAX_USB_CORE] __BSS(USBRAM_SECTION) ATTR_ALIGNED(256);
+Pipe_Callback_T PipeCallback[MAX_ED];
 
 /*=======================================================================*/
 /*  G L O B A L   S Y M B O L   D E C L A R A T I O N S                  */
@@ -187,6 +188,7 @@ HCD_STATUS HcdOpenPipe(uint8_t HostID,
 	HcdED(EdIdx)->ListIndex  = ListIdx;
 	InsertEndpoint(HostID, EdIdx, ListIdx);
 
+	memset(&PipeCallback[EdIdx], 0, sizeof(Pipe_Callback_T));
 	PipehandleCreate(PipeHandle, HostID, EdIdx);
 	return HCD_STATUS_OK;
 }
@@ -229,6 +231,7 @@ HCD_STATUS HcdClosePipe(uint32_t PipeHandle)
 	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, &EdIdx) );
 
 	ASSERT_STATUS_OK(HcdCancelTransfer(PipeHandle) );
+	PipeCallback[EdIdx].Callback = NULL;
 
 	HcdED(EdIdx)->hcED.Skip = 1;/* no need for delay, it is already delayed in cancel transfer */
 	RemoveEndpoint(HostID, EdIdx);
@@ -254,6 +257,16 @@ HCD_STATUS HcdClearEndpointHalt(uint32_t PipeHandle)
 HCD_STATUS HcdControlTransfer(uint32_t PipeHandle,
 							  const USB_Request_Header_t *const pDeviceRequest,
 							  uint8_t *const buffer)
+{
+	ASSERT_STATUS_OK(HcdControlTransferSubmit(PipeHandle, pDeviceRequest, buffer) );
+
+	/* wait for semaphore compete TDs */
+	return HcdWaitTransfer(PipeHandle, TRANSFER_TIMEOUT_MS);
+}
+
+HCD_STATUS HcdControlTransferSubmit(uint32_t PipeHandle,
+									const USB_Request_Header_t *const pDeviceRequest,
+									uint8_t *const buffer)
 {
 	uint8_t HostID, EdIdx;
 
@@ -285,9 +298,6 @@ HCD_STATUS HcdControlTransfer(uint32_t PipeHandle,
 
 	HcdED(EdIdx)->status = HCD_STATUS_TRANSFER_QUEUED;
 
-	/* wait for semaphore compete TDs */
-	ASSERT_STATUS_OK(WaitForTransferComplete(EdIdx) );
-
 	return HCD_STATUS_OK;
 }
 
@@ -402,6 +412,40 @@ HCD_STATUS HcdGetPipeStatus(uint32_t PipeHandle)
 	return (HCD_STATUS)HcdED(EdIdx)->status;
 }
 
+HCD_STATUS HcdWaitTransfer(uint32_t PipeHandle, uint32_t TimeoutMs)
+{
+	uint8_t HostID, EdIdx;
+	HCD_STATUS status;
+
+	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, &EdIdx) );
+
+	status = WaitForTransferComplete(HostID, EdIdx, TimeoutMs);
+	if (status == HCD_STATUS_TRANSFER_TIMEOUT) {
+		HcdCancelTransfer(PipeHandle);
+		if (HcdED(EdIdx)->status == HCD_STATUS_TRANSFER_QUEUED) {
+			HcdED(EdIdx)->status = HCD_STATUS_TRANSFER_TIMEOUT;
+			TransferComplete(EdIdx);
+		}
+		else {	/* finished while it was being cancelled */
+			status = (HCD_STATUS) HcdED(EdIdx)->status;
+		}
+	}
+	return status;
+}
+
+HCD_STATUS HcdSetTransferCallback(uint32_t PipeHandle, HCD_TRANSFER_CALLBACK Callback, void *Context)
+{
+	uint8_t HostID, EdIdx;
+
+	ASSERT_STATUS_OK(PipehandleParse(PipeHandle, &HostID, &EdIdx) );
+
+	PipeCallback[EdIdx].Callback = NULL;	/* never seen half written by the interrupt */
+	PipeCallback[EdIdx].Context = Context;
+	PipeCallback[EdIdx].PipeHandle = PipeHandle;
+	PipeCallback[EdIdx].Callback = Callback;
+	return HCD_STATUS_OK;
+}
+
 static void OHciRhStatusChangeIsr(uint8_t HostID, uint32_t deviceConnect)
 {
 	if (deviceConnect) {/* Device Attached */
@@ -412,6 +456,15 @@ static void OHciRhStatusChangeIsr(uint8_t HostID, uint32_t deviceConnect)
 	}
 }
 
+/* Hands the status a transfer finished with to the pipe's callback */
+static void TransferComplete(uint8_t EdIdx)
+{
+	if ((PipeCallback[EdIdx].Callback != NULL) && (HcdED(EdIdx)->status != HCD_STATUS_TRANSFER_QUEUED)) {
+		PipeCallback[EdIdx].Callback(PipeCallback[EdIdx].PipeHandle, (HCD_STATUS) HcdED(EdIdx)->status,
+									 PipeCallback[EdIdx].Context);
+	}
+}
+
 static void ProcessDoneQueue(uint8_t HostID, uint32_t donehead)
 {
 	PHC_GTD pCurTD = (PHC_GTD) donehead;
@@ -432,6 +485,7 @@ static void ProcessDoneQueue(uint8_t HostID, uint32_t donehead)
 
 	while (pTDList != NULL) {
 		uint32_t EdIdx;
+		bool is_complete;
 
 		pCurTD  = pTDList;
 		pTDList = (PHC_GTD) pTDList->NextTD;
@@ -458,6 +512,7 @@ static void ProcessDoneQueue(uint8_t HostID, uint32_t donehead)
 			}
 		}
 
+		is_complete = (pCurTD->DelayInterrupt != TD_NoInterruptOnComplete) || pCurTD->ConditionCode;
 		if (pCurTD->DelayInterrupt != TD_NoInterruptOnComplete) {	/* Update ED status if Interrupt on Complete is set */
 			HcdED(EdIdx)->status = pCurTD->ConditionCode;
 		}
@@ -480,6 +535,9 @@ static void ProcessDoneQueue(uint8_t HostID, uint32_t donehead)
 		}
 
 		/* Post Semaphore to signal TDs are transfer */
+		if (is_complete) {
+			TransferComplete(EdIdx);
+		}
 	}
 }
 
@@ -650,10 +708,24 @@ static HCD_STATUS QueueGTDs(uint32_t EdIdx, uint8_t *dataBuff, uint32_t xferLen,
 	return HCD_STATUS_OK;
 }
 
-static HCD_STATUS WaitForTransferComplete(uint8_t EdIdx)
+static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EdIdx, uint32_t TimeoutMs)
 {
 #ifndef __TEST__
-	while ( HcdED(EdIdx)->status == HCD_STATUS_TRANSFER_QUEUED ) {}
+	uint16_t Frame = HcdGetFrameNumber(HostID);
+	uint32_t Frames = 0;
+
+	while ( HcdED(EdIdx)->status == HCD_STATUS_TRANSFER_QUEUED ) {
+		uint16_t Now = HcdGetFrameNumber(HostID);
+
+		if (!(USB_REG(HostID)->RhPortStatus1 & HC_RH_PORT_STATUS_CurrentConnectStatus)) {
+			return HCD_STATUS_DEVICE_DISCONNECTED;
+		}
+		Frames += (uint16_t) (Now - Frame);
+		Frame = Now;
+		if (Frames >= TimeoutMs) {
+			return HCD_STATUS_TRANSFER_TIMEOUT;
+		}
+	}
 	return (HCD_STATUS) HcdED(EdIdx)->status;
 #else
 	return HCD_STATUS_OK;
@@ -373,7 +373,9 @@ static HCD_STATUS QueueOneGTD (uint32_t EdIdx,
 
 static HCD_STATUS QueueGTDs (uint32_t EdIdx, uint8_t *dataBuff, uint32_t xferLen, uint8_t Direction);
 
-static HCD_STATUS WaitForTransferComplete(uint8_t EdIdx);
+static HCD_STATUS WaitForTransferComplete(uint8_t HostID, uint8_t EdIdx, uint32_t TimeoutMs);
+
+static void TransferComplete(uint8_t EdIdx);
 
 #endif /*defined(__LPC_OHCI__)*/
 
@@ -221,4 +221,25 @@ uint8_t Pipe_Streaming(uint8_t corenum, uint8_t* const buffer, uint32_t const tr
 	else return PIPE_RWSTREAM_IncompleteTransfer;
 }
 
+uint8_t Pipe_WaitStreaming(uint8_t corenum, uint32_t TimeoutMs)
+{
+	switch (HcdWaitTransfer(PipeInfo[corenum][pipeselected[corenum]].PipeHandle, TimeoutMs))
+	{
+	case HCD_STATUS_OK:
+		return PIPE_RWSTREAM_NoError;
+
+	case HCD_STATUS_TRANSFER_Stall:
+		return PIPE_RWSTREAM_PipeStalled;
+
+	case HCD_STATUS_DEVICE_DISCONNECTED:
+		return PIPE_RWSTREAM_DeviceDisconnected;
+
+	case HCD_STATUS_TRANSFER_TIMEOUT:
+		return PIPE_RWSTREAM_Timeout;
+
+	default:
+		return PIPE_RWSTREAM_IncompleteTransfer;
+	}
+}
+
 #endif
@@ -455,6 +455,14 @@
 		 * @return A value from the @ref Pipe_Stream_RW_ErrorCodes_t enum
 		 */
 		 uint8_t Pipe_Streaming(uint8_t corenum, uint8_t* const buffer, uint32_t const transferlength, uint16_t const packetsize);
+
+		/**
+		 * @brief  Wait for the transfer started by @ref Pipe_Streaming() on the selected pipe to finish
+		 * @param  corenum :		streaming USB core number
+		 * @param  TimeoutMs :		longest wait in milliseconds. A transfer still running then is cancelled.
+		 * @return A value from the @ref Pipe_Stream_RW_ErrorCodes_t enum
+		 */
+		 uint8_t Pipe_WaitStreaming(uint8_t corenum, uint32_t TimeoutMs);
 		 
 		//@}
 
@@ -178,7 +178,25 @@
 			 */
 			#define ENDPOINT_USAGE_IMPLICIT_FEEDBACK  (2 << 4)
 			//@}
-			
+
+			/** \name Endpoint Descriptor Size Macros */
+			//@{
+			/** Packs a high-speed, high-bandwidth isochronous or interrupt endpoint's size for a @ref USB_Descriptor_Endpoint_t
+			 *  descriptor's EndpointSize value: \c Size bytes per transaction (bits 10:0) and 1 to 3 \c Transactions per
+			 *  microframe (bits 12:11 hold the additional ones). The same value configures the endpoint in the LPC18xx/43xx
+			 *  device controller driver.
+			 *
+			 *  @see The USB specification, table 9-13, for the sizes allowed with 2 and 3 transactions.
+			 */
+			#define ENDPOINT_SIZE_HIGH_BANDWIDTH(Size, Transactions) ((Size) | (((Transactions) - 1) << 11))
+
+			/** Bytes per transaction of a (possibly high-bandwidth) endpoint size, see @ref ENDPOINT_SIZE_HIGH_BANDWIDTH. */
+			#define ENDPOINT_SIZE_PACKET(EndpointSize)            ((EndpointSize) & 0x7FF)
+
+			/** Transactions per microframe, 1 to 3, of a (possibly high-bandwidth) endpoint size. */
+			#define ENDPOINT_SIZE_TRANSACTIONS(EndpointSize)      ((((EndpointSize) >> 11) & 3) + 1)
+			//@}
+
 		/* Enums: */
 			/** Enum for the possible standard descriptor types, as given in each descriptor's header. */
 			enum USB_DescriptorTypes_t
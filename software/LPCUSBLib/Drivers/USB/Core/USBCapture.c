@@ -0,0 +1,158 @@
+/*
+ * @brief Device side USB traffic capture
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#define  __INCLUDE_FROM_USB_DRIVER
+#include "USBMode.h"
+#include "USBCapture.h"
+
+#if defined(USB_CAPTURE_ENABLED)
+
+#include "Device.h"
+
+/* One ring slot. Writers fill a slot and advance Head with interrupts masked, so on this single core the
+ * drain never sees a half written record and needs no lock of its own */
+typedef struct {
+	uint32_t Stamp;
+	uint16_t Length;
+	uint8_t  Event;
+	uint8_t  EndpointAddress;
+	uint8_t  Info;
+	uint8_t  Status;
+	uint8_t  DataLength;
+	uint8_t  Data[USB_CAPTURE_SNAPLEN];
+} USB_Capture_Slot_t;
+
+#define CAPTURE_MASK		(USB_CAPTURE_RING_SIZE - 1)
+/* FRINDEX counts 14 bits of microframes, 2.048 s */
+#define CAPTURE_FRINDEX		0x3FFF
+
+volatile uint32_t USB_Capture_Events = USB_CAPTURE_EVENTS_ALL;
+
+static USB_Capture_Slot_t CaptureRing[USB_CAPTURE_RING_SIZE];
+static volatile uint32_t CaptureHead;
+static volatile uint32_t CaptureTail;
+static volatile uint32_t CaptureLost;
+static uint32_t CaptureLostSent;
+/* extends FRINDEX past its wrap, per core. A gap of more than 2 s without a record is taken as less */
+static uint32_t CaptureEpoch[MAX_USB_CORE];
+static uint16_t CaptureFrame[MAX_USB_CORE];
+
+void USB_Capture_SetEvents(uint32_t Events)
+{
+	USB_Capture_Events = Events;
+}
+
+void USB_Capture_Record(uint8_t corenum, uint8_t Event, uint8_t EndpointAddress, uint8_t Type,
+						uint16_t Length, const void *Data, uint32_t DataLength, uint8_t Status)
+{
+	USB_Capture_Slot_t *Slot;
+	uint16_t Frame;
+	uint32_t primask;
+	if (DataLength > USB_CAPTURE_SNAPLEN) {
+		DataLength = USB_CAPTURE_SNAPLEN;
+	}
+	if (Data == NULL) {
+		DataLength = 0;
+	}
+	/* GlobalInterruptDisable() is a no-op on LPC, mask PRIMASK directly */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (CaptureHead - CaptureTail >= USB_CAPTURE_RING_SIZE) {
+		CaptureLost++;
+		__set_PRIMASK(primask);
+		return;
+	}
+	Frame = USB_Device_GetFrameNumber(corenum) & CAPTURE_FRINDEX;
+	if (Frame < CaptureFrame[corenum]) {
+		CaptureEpoch[corenum] += CAPTURE_FRINDEX + 1;
+	}
+	CaptureFrame[corenum] = Frame;
+	Slot = &CaptureRing[CaptureHead & CAPTURE_MASK];
+	Slot->Stamp = CaptureEpoch[corenum] + Frame;
+	Slot->Length = Length;
+	Slot->Event = Event;
+	Slot->EndpointAddress = EndpointAddress;
+	Slot->Info = (Type & 3) | (corenum << 2);
+	Slot->Status = Status;
+	Slot->DataLength = DataLength;
+	memcpy(Slot->Data, Data, DataLength);
+	CaptureHead++;
+	__set_PRIMASK(primask);
+}
+
+static uint8_t *USB_Capture_Encode(uint8_t *p, const USB_Capture_Slot_t *Slot)
+{
+	p[0] = USB_CAPTURE_SYNC;
+	p[1] = Slot->Event;
+	p[2] = Slot->EndpointAddress;
+	p[3] = Slot->Info;
+	p[4] = (uint8_t) Slot->Stamp;
+	p[5] = (uint8_t) (Slot->Stamp >> 8);
+	p[6] = (uint8_t) (Slot->Stamp >> 16);
+	p[7] = (uint8_t) (Slot->Stamp >> 24);
+	p[8] = (uint8_t) Slot->Length;
+	p[9] = (uint8_t) (Slot->Length >> 8);
+	p[10] = Slot->DataLength;
+	p[11] = Slot->Status;
+	memcpy(p + USB_CAPTURE_HEADER_SIZE, Slot->Data, Slot->DataLength);
+	return p + USB_CAPTURE_HEADER_SIZE + Slot->DataLength;
+}
+
+uint32_t USB_Capture_Drain(uint8_t *Buffer, uint32_t BufferSize)
+{
+	uint8_t *p = Buffer;
+	uint8_t *End = Buffer + BufferSize;
+	uint32_t Lost = CaptureLost;
+	if (Lost != CaptureLostSent && (uint32_t) (End - p) >= USB_CAPTURE_HEADER_SIZE) {
+		USB_Capture_Slot_t Marker;
+		memset(&Marker, 0, sizeof(Marker));
+		Marker.Event = USB_CAPTURE_EVENT_LOST;
+		Marker.Length = (Lost - CaptureLostSent > 0xFFFF) ? 0xFFFF : (uint16_t) (Lost - CaptureLostSent);
+		if (CaptureTail != CaptureHead) {
+			Marker.Stamp = CaptureRing[CaptureTail & CAPTURE_MASK].Stamp;
+		}
+		p = USB_Capture_Encode(p, &Marker);
+		CaptureLostSent = Lost;
+	}
+	while (CaptureTail != CaptureHead) {
+		const USB_Capture_Slot_t *Slot = &CaptureRing[CaptureTail & CAPTURE_MASK];
+		if ((uint32_t) (End - p) < USB_CAPTURE_HEADER_SIZE + Slot->DataLength) {
+			break;
+		}
+		p = USB_Capture_Encode(p, Slot);
+		/* slot read before it is handed back to the writers */
+		__DMB();
+		CaptureTail++;
+	}
+	return p - Buffer;
+}
+
+#endif /* USB_CAPTURE_ENABLED */
@@ -0,0 +1,159 @@
+/*
+ * @brief Device side USB traffic capture
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+
+/** @defgroup Group_USBCapture USB Traffic Capture
+ *  @ingroup Group_USB
+ *  @brief Records device side USB traffic into a compact binary ring for offline analysis.
+ *
+ *  When \c USB_CAPTURE is set in LPCUSBlibConfig.h the LPC18xx/43xx device driver records each SETUP packet,
+ *  data stage, transfer completion, isochronous packet, STALL and bus event. Every record is stamped with
+ *  the controller's microframe counter (FRINDEX, extended to 32 bits). A record costs a short interrupt
+ *  masked copy of at most \c USB_CAPTURE_SNAPLEN bytes and nothing is formatted on the target, so capture can
+ *  stay on during enumeration. Built with \c USB_CAPTURE 0, every hook compiles away.
+ *
+ *  The application moves the ring out over whatever secondary channel it has spare (UART, SWO, a second
+ *  USB core, a RAM dump) by calling @ref USB_Capture_Drain() from task context. Tools/USBCapture/usbcap2pcap
+ *  converts the byte stream into a Linux usbmon pcap file that Wireshark opens directly.
+ *
+ *  Wire format, little endian, one record after another. Records start with \c USB_CAPTURE_SYNC so a decoder
+ *  can resynchronise on a channel shared with text:
+ *
+ *		sync event endpoint info stamp[4] length[2] data_length status data[data_length]
+ *
+ *  \c info holds the endpoint's transfer type in bits 0-1 and the core number in bit 2. \c length is the
+ *  transfer size and \c data holds its first \c data_length bytes.
+ *  @{
+ */
+
+#ifndef __USBCAPTURE_H__
+#define __USBCAPTURE_H__
+
+/* Includes: */
+#include "../../../Common/Common.h"
+
+/* Enable C linkage for C++ Compilers: */
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Public Interface - May be used in end-application: */
+/* Macros: */
+#if !defined(USB_CAPTURE_RING_SIZE) || defined(__DOXYGEN__)
+/** Records the ring holds, a power of two. Each costs 12 + \c USB_CAPTURE_SNAPLEN bytes of RAM. */
+#define USB_CAPTURE_RING_SIZE			64
+#endif
+
+#if !defined(USB_CAPTURE_SNAPLEN) || defined(__DOXYGEN__)
+/** Payload bytes kept per record. 8 is enough for SETUP packets alone, 32 also shows most descriptors. */
+#define USB_CAPTURE_SNAPLEN				32
+#endif
+
+/** First byte of every record on the wire */
+#define USB_CAPTURE_SYNC				0xC5
+
+/** Bytes of a record on the wire ahead of its data */
+#define USB_CAPTURE_HEADER_SIZE			12
+
+/** Record events, also the bit numbers for @ref USB_Capture_SetEvents() */
+#define USB_CAPTURE_EVENT_SETUP			1	/**< SETUP packet received, data is the 8 byte request */
+#define USB_CAPTURE_EVENT_SUBMIT		2	/**< IN data queued to the controller, data is the start of it */
+#define USB_CAPTURE_EVENT_COMPLETE		3	/**< Transfer retired, length is what was moved, OUT data is the start of it */
+#define USB_CAPTURE_EVENT_ISO			4	/**< Isochronous packet retired, length is what was moved */
+#define USB_CAPTURE_EVENT_STALL			5	/**< Endpoint stalled by the firmware */
+#define USB_CAPTURE_EVENT_RESET			6	/**< Bus reset started */
+#define USB_CAPTURE_EVENT_SUSPEND		7	/**< Bus suspended */
+#define USB_CAPTURE_EVENT_RESUME		8	/**< Port change at the end of a reset or on resume, length is 1 at high speed */
+#define USB_CAPTURE_EVENT_ADDRESS		9	/**< SET_ADDRESS taken, length is the new address */
+#define USB_CAPTURE_EVENT_CONFIGURED	10	/**< SET_CONFIGURATION taken, length is the configuration number */
+#define USB_CAPTURE_EVENT_LOST			15	/**< Inserted by the drain, length is the records dropped on a full ring */
+
+/** All events */
+#define USB_CAPTURE_EVENTS_ALL			0xFFFFFFFFUL
+
+/** Record status bits, from the retired transfer descriptor */
+#define USB_CAPTURE_STATUS_HALTED		(1 << 0)
+#define USB_CAPTURE_STATUS_XACT_ERROR	(1 << 1)
+#define USB_CAPTURE_STATUS_BUFFER_ERROR	(1 << 2)
+#define USB_CAPTURE_STATUS_ABORTED		(1 << 3)
+
+#if (USB_CAPTURE) && (defined(__LPC18XX__) || defined(__LPC43XX__)) && defined(USB_CAN_BE_DEVICE)
+/** Defined when the capture hooks are compiled in */
+#define USB_CAPTURE_ENABLED
+
+/** Records an event if it is enabled. Safe from interrupt and task context.
+ *  @param corenum         : ID Number of USB Core to be processed.
+ *  @param Event           : A USB_CAPTURE_EVENT_* value.
+ *  @param EndpointAddress : Endpoint number ORed with ENDPOINT_DIR_IN for IN.
+ *  @param Type            : Transfer type of the endpoint, an EP_TYPE_* value.
+ *  @param Length          : Transfer size, or the event's value.
+ *  @param Data            : Payload to keep the start of, or NULL.
+ *  @param DataLength      : Bytes available at Data.
+ *  @param Status          : USB_CAPTURE_STATUS_* bits.
+ */
+#define USB_CAPTURE_RECORD(corenum, Event, EndpointAddress, Type, Length, Data, DataLength, Status) \
+	do { if (USB_Capture_Events & (1UL << (Event))) \
+	     USB_Capture_Record((corenum), (Event), (EndpointAddress), (Type), (Length), (Data), (DataLength), (Status)); } while (0)
+
+/* External Variables: */
+/** Enabled events, one bit per USB_CAPTURE_EVENT_* value. See @ref USB_Capture_SetEvents(). */
+extern volatile uint32_t USB_Capture_Events;
+
+/* Function Prototypes: */
+/** Selects the events recorded, e.g. to leave isochronous packets out on a slow channel. All are on at reset.
+ *  @param Events : Mask of (1 << USB_CAPTURE_EVENT_*) bits, 0 to stop capturing.
+ */
+void USB_Capture_SetEvents(uint32_t Events);
+
+/** Records one event, see @ref USB_CAPTURE_RECORD() which checks the event mask first. */
+void USB_Capture_Record(uint8_t corenum, uint8_t Event, uint8_t EndpointAddress, uint8_t Type,
+						uint16_t Length, const void *Data, uint32_t DataLength, uint8_t Status);
+
+/** Moves the records captured so far into Buffer in wire format, whole records only, oldest first. Call
+ *  from one task; writers are never blocked by it.
+ *  @param Buffer     : Where to encode the records.
+ *  @param BufferSize : Room in Buffer, at least USB_CAPTURE_HEADER_SIZE + USB_CAPTURE_SNAPLEN.
+ *  @return Bytes written to Buffer, 0 if nothing was captured since the last call.
+ */
+uint32_t USB_Capture_Drain(uint8_t *Buffer, uint32_t BufferSize);
+
+#else
+#define USB_CAPTURE_RECORD(corenum, Event, EndpointAddress, Type, Length, Data, DataLength, Status) do {} while (0)
+#endif
+
+/* Disable C linkage for C++ Compilers: */
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __USBCAPTURE_H__ */
+
+/** @} */
@@ -42,245 +42,190 @@
 /************************************************************************/
 /* LOCAL SYMBOL DECLARATIION                                            */
 /************************************************************************/
-#define TEST_NEW_ALLOC	0
-
-#if TEST_NEW_ALLOC
-
-typedef struct MemBlockInfo_t {
-	uint32_t size :15; // memory size of this block
-	uint32_t type :2;  // indicate whether this memory block is free, pad or used
-	uint32_t next :15; // offset (from head address) to the next block
-} sMemBlockInfo, *PMemBlockInfo;
-
-typedef enum
-{
-	MEM_FREE = 0,
-	MEM_PAD,
-	MEM_USED,
-}enMemBlockType;
-
-#else
-
-typedef struct MemBlockInfo_t {
-	uint32_t size :15; // memory size of this block
-	uint32_t isFree :1; // indicate whether this memory block is free or used
-	uint32_t next :16; // offset (from head address) to the next block
-} sMemBlockInfo, *PMemBlockInfo;
+/* Buddy allocator: the pool is cut into power of two blocks from MEM_MIN_BLOCK up, one free list per
+ * size class. Alloc takes the smallest non empty class that fits and halves it down to size, free
+ * merges a block with its buddy for as long as the buddy is free. Both are bounded by the number of
+ * classes whatever the pool looks like, and every block is aligned to its own size.
+ */
+typedef struct MemFreeBlock_t {
+	struct MemFreeBlock_t *next;
+	struct MemFreeBlock_t *prev;
+} sMemFreeBlock, *PMemFreeBlock;
 
-#endif
 /************************************************************************/
 /* LOCAL DEFINE                                                         */
 /************************************************************************/
-#define ALIGN_FOUR_BYTES    (4) // FIXME only m3 is 1 byte alignment
+#define MEM_MIN_BLOCK_SHIFT		5									// 32 bytes, smallest block
+#define MEM_MIN_BLOCK			(1 << MEM_MIN_BLOCK_SHIFT)
+#define MEM_POOL_ALIGN			4096								// blocks up to this size are aligned to their size
+#define MEM_UNITS				(USBRAM_BUFFER_SIZE / MEM_MIN_BLOCK)
+#define MEM_CLASSES				12									// 32 bytes .. 64KB
 
-/* FIXME the following dynamic allocation is temporarly */
+#define MEM_ORDER_MASK			0x7F								// USB_Mem_Order[]: size class of the block starting here
+#define MEM_ORDER_FREE			0x80								// USB_Mem_Order[]: the block starting here is free
 
-#define  HEADER_SIZE                (sizeof(sMemBlockInfo))
-#define  HEADER_POINTER(x)          ((uint8_t *)x - sizeof(sMemBlockInfo))
-#define  NEXT_BLOCK(x)            	((PMemBlockInfo) ( ((x)->next==0) ? 0 : ((uint32_t)head +(x)->next) ))
-#define  LINK_TO_THIS_BLOCK(x)      (((uint32_t)(x))-((uint32_t)head))
+#define UNIT_OF(x)				((uint32_t) (((uint8_t *) (x)) - USB_Mem_Buffer) >> MEM_MIN_BLOCK_SHIFT)
+#define BLOCK_AT(unit)			((PMemFreeBlock) (USB_Mem_Buffer + ((unit) << MEM_MIN_BLOCK_SHIFT)))
 
-PRAGMA_ALIGN_4
-static uint8_t USB_Mem_Buffer[USBRAM_BUFFER_SIZE] ATTR_ALIGNED(4) __BSS(USBRAM_SECTION);
+PRAGMA_ALIGN_4096
+static uint8_t USB_Mem_Buffer[USBRAM_BUFFER_SIZE] ATTR_ALIGNED(MEM_POOL_ALIGN) __BSS(USBRAM_SECTION);
 
-void USB_Memory_Init(uint32_t Memory_Pool_Size)
+static uint8_t USB_Mem_Order[MEM_UNITS];			// kept out of USB RAM, only block heads are meaningful
+static PMemFreeBlock USB_Mem_FreeList[MEM_CLASSES];
+static uint32_t USB_Mem_FreeMap;					// bit n set: USB_Mem_FreeList[n] is not empty
+static uint32_t USB_Mem_PoolUnits;
+static USB_Memory_Stats_t USB_Mem_Stats;
+
+static void FreeListAdd(uint32_t unit, uint8_t order)
 {
-	PMemBlockInfo head = (PMemBlockInfo) USB_Mem_Buffer;
-
-	head->next = 0;
-	head->size = (Memory_Pool_Size & 0xfffffffc) - HEADER_SIZE ;// align memory size
-#if TEST_NEW_ALLOC
-	head->type = MEM_FREE;
-#else
-	head->isFree = 1;
-#endif
+	PMemFreeBlock blk = BLOCK_AT(unit);
+
+	blk->prev = NULL;
+	blk->next = USB_Mem_FreeList[order];
+	if (blk->next != NULL)
+	{
+		blk->next->prev = blk;
+	}
+	USB_Mem_FreeList[order] = blk;
+	USB_Mem_FreeMap |= 1UL << order;
+	USB_Mem_Order[unit] = order | MEM_ORDER_FREE;
 }
 
-uint8_t* USB_Memory_Alloc(uint32_t size, uint32_t num_aligned_bytes)
+static void FreeListRemove(uint32_t unit, uint8_t order)
 {
-	PMemBlockInfo freeBlock=NULL, newBlock, blk_ptr = NULL;
-	PMemBlockInfo head = (PMemBlockInfo) USB_Mem_Buffer;
+	PMemFreeBlock blk = BLOCK_AT(unit);
 
-#if TEST_NEW_ALLOC
-	for (blk_ptr = head; blk_ptr != NULL; blk_ptr = NEXT_BLOCK(blk_ptr)) // 1st-fit technique
+	if (blk->prev != NULL)
 	{
-		if (((blk_ptr->type == MEM_FREE)||(blk_ptr->type == MEM_PAD)) && (blk_ptr->size >= size))
-		{
-			/* Filter by requested size */
-			if (blk_ptr->size <= HEADER_SIZE + size) // where (blk_size=size | blk_size=size+HEAD) then allocate whole block & do not create freeBlock
-			{
-				blk_ptr->next = 0;
-				blk_ptr->type = MEM_USED;
-			} else {
-				/* Locate empty block at end of found block */
-				freeBlock = (PMemBlockInfo) (((uint32_t) blk_ptr) + size + HEADER_SIZE);
-				freeBlock->next = blk_ptr->next;
-				freeBlock->size = blk_ptr->size - (HEADER_SIZE + size);
-				freeBlock->type = blk_ptr->type;
-
-				/* Locate new block at start of found block */
-				blk_ptr->size = size;
-				blk_ptr->next = LINK_TO_THIS_BLOCK(freeBlock);
-				blk_ptr->type = MEM_USED;
-			}
-			/* Filter by requested alignment*/
-			if(num_aligned_bytes > 0)
-			{
-				uint32_t pad_size = (((uint32_t)blk_ptr) + HEADER_SIZE) % num_aligned_bytes;
-				if(pad_size == 0) break;							//block found
-				else 												//not fit alignment
-					if(blk_ptr->next != 0)							//break if this is the last block in chain
-					{
-						uint32_t padBlkSize;
-
-						if((num_aligned_bytes - pad_size) >= HEADER_SIZE)
-							padBlkSize = num_aligned_bytes - pad_size - HEADER_SIZE;
-						else
-							padBlkSize = 2*num_aligned_bytes - pad_size - HEADER_SIZE;
-
-						if(padBlkSize > freeBlock->size) 			//not enough space to create new pad
-						{
-							blk_ptr->next = freeBlock->next;
-							blk_ptr->size = freeBlock->size + HEADER_SIZE + size;
-							blk_ptr->type = MEM_PAD;
-						}
-						else										//there is space for new pad
-						{
-							newBlock = (PMemBlockInfo) (((uint32_t) blk_ptr) + HEADER_SIZE + padBlkSize);
-							newBlock->next = freeBlock->next;
-							newBlock->type = freeBlock->type;
-							newBlock->size = freeBlock->size + HEADER_SIZE + size - padBlkSize;
-
-							blk_ptr->size = padBlkSize;
-							blk_ptr->next = LINK_TO_THIS_BLOCK(newBlock);
-							blk_ptr->type = MEM_PAD;
-						}
-					}
-			}
-			else if(blk_ptr->type == MEM_USED)	break;
-		}
+		blk->prev->next = blk->next;
 	}
+	else
+	{
+		USB_Mem_FreeList[order] = blk->next;
+	}
+	if (blk->next != NULL)
+	{
+		blk->next->prev = blk->prev;
+	}
+	if (USB_Mem_FreeList[order] == NULL)
+	{
+		USB_Mem_FreeMap &= ~(1UL << order);
+	}
+	USB_Mem_Order[unit] = order;
+}
 
-	if (blk_ptr == NULL) {
-		return ((uint8_t *) NULL);
+static uint8_t HighestClass(uint32_t map)
+{
+	uint8_t order = 0;
+
+	while (map >>= 1)
+	{
+		order++;
+	}
+	return order;
+}
+
+void USB_Memory_Init(uint32_t Memory_Pool_Size)
+{
+	uint32_t unit = 0;
+	uint8_t order;
+
+	memset(USB_Mem_FreeList, 0, sizeof(USB_Mem_FreeList));
+	memset(&USB_Mem_Stats, 0, sizeof(USB_Mem_Stats));
+	USB_Mem_FreeMap = 0;
+
+	USB_Mem_PoolUnits = MIN(Memory_Pool_Size, USBRAM_BUFFER_SIZE) >> MEM_MIN_BLOCK_SHIFT;
+	USB_Mem_Stats.PoolSize = USB_Mem_PoolUnits << MEM_MIN_BLOCK_SHIFT;
+
+	/* A pool that is not a power of two starts out as the largest aligned blocks that tile it */
+	while (unit < USB_Mem_PoolUnits)
+	{
+		for (order = MEM_CLASSES - 1; ((unit & ((1UL << order) - 1)) != 0) || (unit + (1UL << order) > USB_Mem_PoolUnits); order--) {}
+		FreeListAdd(unit, order);
+		unit += 1UL << order;
 	}
+	USB_Mem_Stats.LargestFree = MEM_MIN_BLOCK << HighestClass(USB_Mem_FreeMap);
+}
 
-	return (((uint8_t *) blk_ptr) + HEADER_SIZE);		
+uint8_t* USB_Memory_Alloc(uint32_t size, uint32_t num_aligned_bytes)
+{
+	uint32_t unit, avail;
+	uint8_t order = 0, found;
 
-#else
-	/* Align the requested size by 4 bytes */
-	if ((size % ALIGN_FOUR_BYTES) != 0) {
-		size = (((size >> 2) << 2) + ALIGN_FOUR_BYTES);
+	if (num_aligned_bytes > MEM_POOL_ALIGN)
+	{
+		USB_Mem_Stats.Failures++;
+		return ((uint8_t *) NULL);
 	}
 
-	for (freeBlock = head; freeBlock != NULL; freeBlock = NEXT_BLOCK(freeBlock)) // 1st-fit technique
+	/* Smallest class that holds the size and, blocks being aligned to their size, the alignment */
+	size = MAX(size, num_aligned_bytes);
+	while ((order < MEM_CLASSES) && ((MEM_MIN_BLOCK << order) < size))
 	{
-		if ((freeBlock->isFree == 1) && (freeBlock->size >= size))
-		{
-			blk_ptr = freeBlock;
-			break;
-		}
+		order++;
 	}
 
-	if (blk_ptr == NULL) {
+	avail = (order < MEM_CLASSES) ? (USB_Mem_FreeMap & ~((1UL << order) - 1)) : 0;
+	if (avail == 0)
+	{
+		USB_Mem_Stats.Failures++;
 		return ((uint8_t *) NULL);
 	}
+	found = HighestClass(avail & (~avail + 1));					// lowest class that has a block
 
-	if (blk_ptr->size <= HEADER_SIZE + size) // where (blk_size=size | blk_size=size+HEAD) then allocate whole block & do not create freeBlock
+	unit = UNIT_OF(USB_Mem_FreeList[found]);
+	FreeListRemove(unit, found);
+
+	/* Halve it down to size, the upper halves go back on the free lists */
+	while (found > order)
 	{
-		newBlock = blk_ptr;
-		//newBlock->size    = blk_ptr->size;
-		//newBlock->next    = blk_ptr->next;
-		newBlock->isFree = 0;
-	} else {
-		/* Locate empty block at end of found block */
-		freeBlock = (PMemBlockInfo) (((uint8_t *) blk_ptr) + size + HEADER_SIZE);
-		freeBlock->next = blk_ptr->next;
-		freeBlock->size = blk_ptr->size - (HEADER_SIZE + size);
-		freeBlock->isFree = 1;
-
-		/* Locate new block at start of found block */
-		newBlock = blk_ptr;
-		newBlock->size = size;
-		newBlock->next = LINK_TO_THIS_BLOCK(freeBlock);
-		newBlock->isFree = 0;
+		found--;
+		FreeListAdd(unit + (1UL << found), found);
 	}
+	USB_Mem_Order[unit] = order;
 
-	return (((uint8_t *) newBlock) + HEADER_SIZE);
-#endif
+	USB_Mem_Stats.InUse += MEM_MIN_BLOCK << order;
+	USB_Mem_Stats.HighWater = MAX(USB_Mem_Stats.HighWater, USB_Mem_Stats.InUse);
+	USB_Mem_Stats.LargestFree = USB_Mem_FreeMap ? (MEM_MIN_BLOCK << HighestClass(USB_Mem_FreeMap)) : 0;
+
+	return ((uint8_t *) BLOCK_AT(unit));
 }
 
 void USB_Memory_Free(uint8_t *ptr)
 {
-	PMemBlockInfo prev;
-	PMemBlockInfo head = (PMemBlockInfo) USB_Mem_Buffer;
-	PMemBlockInfo blk_ptr;
+	uint32_t unit;
+	uint8_t order;
 
 	if (ptr == NULL)
 	{
 		return;
 	}
 
-	blk_ptr = (PMemBlockInfo) HEADER_POINTER(ptr);
-	
-#if TEST_NEW_ALLOC
-	
-	bool being_pad = false;
-	if (blk_ptr->next != 0) // merge with next free block
-	{
-		if ((NEXT_BLOCK(blk_ptr)->type == MEM_FREE)||(NEXT_BLOCK(blk_ptr)->type == MEM_PAD))
-		{
-			blk_ptr->size = blk_ptr->size + NEXT_BLOCK(blk_ptr)->size + HEADER_SIZE;
-			blk_ptr->next = NEXT_BLOCK(blk_ptr)->next;
-			blk_ptr->type = NEXT_BLOCK(blk_ptr)->type;
-		}
-		else being_pad = true;
-	}
-
-	for (prev = head; prev != NULL; prev = NEXT_BLOCK(prev)) // merge with previous free block
-	{
-		if (NEXT_BLOCK(prev) == blk_ptr)
-		{
-			if ((prev->type == MEM_FREE)||(prev->type == MEM_PAD))
-			{
-				prev->size = prev->size + blk_ptr->size + HEADER_SIZE;
-				prev->next = blk_ptr->next;
-			}
-			else if(being_pad == true)						 // prev&next blocks are used
-				blk_ptr->type = MEM_PAD;
-
-			break;
-		}
-	}	
+	unit = UNIT_OF(ptr);
+	order = USB_Mem_Order[unit];
+	USB_Mem_Stats.InUse -= MEM_MIN_BLOCK << order;
 
-#else
-	if (blk_ptr->next != 0) // merge with next free block
+	/* Merge with the buddy while it is a whole free block of the same class */
+	while (order < MEM_CLASSES - 1)
 	{
-		if (NEXT_BLOCK(blk_ptr)->isFree == 1)
-		{
-			blk_ptr->size = blk_ptr->size + NEXT_BLOCK(blk_ptr)->size + HEADER_SIZE;
-			blk_ptr->next = NEXT_BLOCK(blk_ptr)->next;
-		}
-	}
+		uint32_t buddy = unit ^ (1UL << order);
 
-	for (prev = head; prev != NULL; prev = NEXT_BLOCK(prev)) // merge with previous free block
-	{
-		if (NEXT_BLOCK(prev) == blk_ptr)
+		if ((buddy + (1UL << order) > USB_Mem_PoolUnits) || (USB_Mem_Order[buddy] != (order | MEM_ORDER_FREE)))
 		{
-			if (prev->isFree == 1)
-			{
-				prev->size = prev->size + blk_ptr->size + HEADER_SIZE;
-				prev->next = blk_ptr->next;
-				blk_ptr = prev;
-			}
 			break;
 		}
+		FreeListRemove(buddy, order);
+		unit = MIN(unit, buddy);
+		order++;
 	}
+	FreeListAdd(unit, order);
 
-	blk_ptr->isFree = 1;
+	USB_Mem_Stats.LargestFree = MEM_MIN_BLOCK << HighestClass(USB_Mem_FreeMap);
+}
 
-#endif
-	return;
+void USB_Memory_GetStats(USB_Memory_Stats_t *pStats)
+{
+	*pStats = USB_Mem_Stats;
 }
 
 #endif
@@ -36,9 +36,32 @@
 #include "lpc_types.h"
 #include "../../../Common/Common.h"
 
+/* Public Interface - May be used in end-application: */
+/* Type Defines: */
+/** Allocator figures, see \ref USB_Memory_GetStats(). Sizes are in bytes and count whole blocks, a request
+ *  takes the next power of two from 32 bytes up.
+ */
+typedef struct {
+	uint32_t PoolSize;		/**< Bytes the pool was initialised with */
+	uint32_t InUse;			/**< Bytes allocated now */
+	uint32_t HighWater;		/**< Most bytes ever allocated at once */
+	uint32_t LargestFree;	/**< Largest block an allocation can get now */
+	uint32_t Failures;		/**< Allocations that returned NULL */
+} USB_Memory_Stats_t;
+
 /* Function Prototypes: */
 void USB_Memory_Init(uint32_t Memory_Pool_Size);
+
+/** Allocates from the USB RAM pool in constant time. The block is the next power of two of at least
+ *  MAX(size, num_aligned_bytes) bytes and is aligned to its size, so num_aligned_bytes may be any power
+ *  of two up to 4096 (0 for no requirement). Returns NULL if no block that large is free.
+ */
 uint8_t* USB_Memory_Alloc(uint32_t size, uint32_t num_aligned_bytes);
+
+/** Returns a block to the pool in constant time, merging it with its free neighbours */
 void USB_Memory_Free(uint8_t *ptr);
 
+/** Copies the allocator figures, to size USBRAM_BUFFER_SIZE or to spot leaks across re-enumeration */
+void USB_Memory_GetStats(USB_Memory_Stats_t *pStats);
+
 #endif /* __USBMEMORY_H__ */
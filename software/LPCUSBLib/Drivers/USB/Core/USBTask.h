@@ -164,6 +164,10 @@
 			 *  If in device mode (only), the control endpoint can instead be managed via interrupts entirely by the library
 			 *  by defining the INTERRUPT_CONTROL_ENDPOINT token and passing it to the compiler via the -D switch.
 			 *
+			 *  Under an RTOS the device task can also sleep until there is something to do: the USB interrupt raises
+			 *  @ref EVENT_USB_Device_TaskPending() whenever a SETUP packet is waiting, so the task can block on a
+			 *  semaphore given from that event and call this function when it wakes.
+			 *
 			 *  @see @ref Group_Events for more information on the USB events.
 			 *
 			 *  @ingroup Group_USBManagement
@@ -59,6 +59,45 @@
 /** Define USE_USB_ROM_STACK = 1 to use MCU's internal ROM stack, 0 if otherwise */
 #define USE_USB_ROM_STACK			0
 
+/** Number of dTDs kept queued on each isochronous endpoint (LPC18xx/43xx device).
+ *  With more than one the controller moves on to the next packet by itself and the
+ *  completion interrupt only has to refill the ring before it runs dry, so interrupt
+ *  latency of up to USB_ISO_DTDS - 1 (micro)frames no longer drops packets.
+ *  A buffer returned by CALLBACK_HAL_GetISOBufferAddress() then belongs to the
+ *  controller until USB_ISO_DTDS further calls for that endpoint, and on OUT
+ *  last_packet_size is the byte count of the oldest buffer. 1 keeps the one
+ *  buffer at a time behaviour the existing callbacks were written for.
+ */
+#ifndef USB_ISO_DTDS
+#define USB_ISO_DTDS				1
+#endif
+
+/** Number of dTDs each bulk/interrupt endpoint keeps queued for Endpoint_SubmitTransfer()
+ *  (LPC18xx/43xx device). Each carries up to 16KB straight from the caller's buffer and the
+ *  completion interrupt refills it while the others run, so 2 keeps the endpoint busy as long
+ *  as the interrupt is serviced within 16KB of bus time. Costs 32 bytes of USB RAM per
+ *  endpoint and dTD.
+ */
+#ifndef USB_XFER_DTDS
+#define USB_XFER_DTDS				2
+#endif
+
+/** Largest receive ring a CDC device interface can be given in streaming mode
+ *  (LPC18xx/43xx), in packets. Each slot costs a transfer descriptor (32 bytes) in
+ *  every USB_ClassInfo_CDC_Device_t whether it is used or not.
+ */
+#ifndef CDC_RX_MAX_PACKETS
+#define CDC_RX_MAX_PACKETS			8
+#endif
+
+/** Define USB_CAPTURE = 1 to record device side traffic (LPC18xx/43xx) into a ring that
+ *  USB_Capture_Drain() streams out and Tools/USBCapture converts to a Wireshark pcap,
+ *  see USBCapture.h. Costs about 3KB of RAM with the default ring.
+ */
+#ifndef USB_CAPTURE
+#define USB_CAPTURE					0
+#endif
+
 #endif /* NXPUSBLIB_CONFIG_H_ */
 
 /**
@@ -0,0 +1,62 @@
+/*
+
+	DCDSim stand-in for the LPC18xx/43xx chip layer.
+
+	The USB register block is the real lpc_ip one at the real addresses;
+	dcdsim.c maps a page there. Clock, PHY and pin setup are no-ops.
+
+*/
+
+#ifndef __CHIP_H_
+#define __CHIP_H_
+
+#include "lpc_types.h"
+#include "sys_config.h"
+#include "cmsis.h"
+#include "usbhs_001.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+#define LPC_USB0_BASE		0x40006000
+#define LPC_USB1_BASE		0x40007000
+#define LPC_USB0			((IP_USBHS_001_T*) LPC_USB0_BASE)
+#define LPC_USB1			((IP_USBHS_001_T*) LPC_USB1_BASE)
+
+//-----------------------------------------------------------------------------
+// USB RAM placement is meaningless here
+#define __BSS(x)
+
+//-----------------------------------------------------------------------------
+typedef enum { CGU_USB_PLL, CGU_AUDIO_PLL } CHIP_CGU_USB_AUDIO_PLL_T;
+typedef enum { CLK_BASE_USB0, CLK_BASE_USB1 } CHIP_CGU_BASE_CLK_T;
+typedef enum { CLK_MX_USB0, CLK_MX_USB1 } CHIP_CCU_CLK_T;
+
+#define CGU_PLL_LOCKED		(1 << 0)
+
+static inline void Chip_Clock_EnablePLL(CHIP_CGU_USB_AUDIO_PLL_T pll)							{ (void) pll; }
+static inline void Chip_Clock_DisablePLL(CHIP_CGU_USB_AUDIO_PLL_T pll)							{ (void) pll; }
+static inline uint32_t Chip_Clock_GetPLLStatus(CHIP_CGU_USB_AUDIO_PLL_T pll)					{ (void) pll; return CGU_PLL_LOCKED; }
+static inline void Chip_Clock_EnableBaseClock(CHIP_CGU_BASE_CLK_T clk)							{ (void) clk; }
+static inline void Chip_Clock_DisableBaseClock(CHIP_CGU_BASE_CLK_T clk)							{ (void) clk; }
+static inline void Chip_Clock_EnableOpts(CHIP_CCU_CLK_T clk, bool autoen, bool wakeupen, int div)	{ (void) clk; (void) autoen; (void) wakeupen; (void) div; }
+static inline void Chip_Clock_Disable(CHIP_CCU_CLK_T clk)										{ (void) clk; }
+static inline void Chip_CREG_EnableUSB0Phy(bool enable)											{ (void) enable; }
+
+//-----------------------------------------------------------------------------
+// USB1 full speed pad select. Plain memory, nothing models it.
+typedef struct
+{
+	volatile uint32_t SFSUSB;
+} DCDSIM_SCU_T;
+
+extern DCDSIM_SCU_T dcdsim_scu;
+#define LPC_SCU				(&dcdsim_scu)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+/*
+
+	DCDSim stand-in for the CMSIS core header.
+
+	Only what lpc_ip/usbhs_001.h and the LPCUSBlib LPC18XX HAL/DCD use.
+	NVIC enable/disable and PRIMASK map onto the simulator's interrupt
+	delivery (see dcdsim.h), barriers map onto compiler/host fences.
+
+*/
+
+#ifndef __CMSIS_H_
+#define __CMSIS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+#define __I					volatile const
+#define __O					volatile
+#define __IO				volatile
+
+#ifndef __INLINE
+#define __INLINE			inline
+#endif
+
+//-----------------------------------------------------------------------------
+typedef enum
+{
+	USB0_IRQn = 8,
+	USB1_IRQn = 9
+} IRQn_Type;
+
+//-----------------------------------------------------------------------------
+// provided by dcdsim.c
+extern void DcdSim_NVIC(IRQn_Type irq, int enable);
+extern void DcdSim_MaskIRQ(int mask);
+extern int DcdSim_IRQMasked(void);
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)	{ DcdSim_NVIC(irq, 1); }
+static inline void NVIC_DisableIRQ(IRQn_Type irq)	{ DcdSim_NVIC(irq, 0); }
+static inline void __disable_irq(void)				{ DcdSim_MaskIRQ(1); }
+static inline void __enable_irq(void)				{ DcdSim_MaskIRQ(0); }
+static inline uint32_t __get_PRIMASK(void)			{ return (uint32_t) DcdSim_IRQMasked(); }
+static inline void __set_PRIMASK(uint32_t mask)		{ DcdSim_MaskIRQ(mask & 1); }
+
+#define __DMB()				__sync_synchronize()
+#define __DSB()				__sync_synchronize()
+#define __ISB()				__asm__ __volatile__("" ::: "memory")
+#define __NOP()				__asm__ __volatile__("pause")
+#define __WFI()				__asm__ __volatile__("pause")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
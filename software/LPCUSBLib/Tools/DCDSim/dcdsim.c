@@ -0,0 +1,1255 @@
+/*
+
+	DCDSim controller, bus and interrupt model. See dcdsim.h
+
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "chip.h"
+#include "dcdsim.h"
+
+extern void USB0_IRQHandler(void);
+
+DCDSIM_SCU_T dcdsim_scu;
+
+//-----------------------------------------------------------------------------
+// controller bits. The library's copies are private to the HAL/DCD.
+#define CMD_RS				(1UL << 0)
+#define CMD_RST				(1UL << 1)
+#define CMD_ATDTW			(1UL << 14)
+#define STS_UI				(1UL << 0)
+#define STS_UEI				(1UL << 1)
+#define STS_PCI				(1UL << 2)
+#define STS_URI				(1UL << 6)
+#define STS_SRI				(1UL << 7)
+#define STS_SLI				(1UL << 8)
+#define STS_NAKI			(1UL << 16)
+#define ADDR_AD				(1UL << 24)
+#define PORTSC_CCS			(1UL << 0)
+#define PORTSC_HSP			(1UL << 9)
+#define PORTSC_PFSC			(1UL << 24)
+#define CTRL_RXS			(1UL << 0)
+#define CTRL_RXE			(1UL << 7)
+#define CTRL_TXS			(1UL << 16)
+#define CTRL_TXE			(1UL << 23)
+
+// dQH and dTD as words, see DeviceQueueHead/DeviceTransferDescriptor
+#define QH_CAPS				0
+#define QH_CURRENT			1
+#define QH_NEXT				2
+#define QH_TOKEN			3
+#define QH_PAGE				4
+#define QH_SETUP			10
+#define TD_NEXT				0
+#define TD_TOKEN			1
+#define TD_WORDS			7
+#define TOKEN_BUFFER_ERR	(1UL << 5)
+#define TOKEN_ACTIVE		(1UL << 7)
+#define TOKEN_IOC			(1UL << 15)
+#define TOKEN_MULTO(t)		(((t) >> 10) & 3)
+#define TOKEN_BYTES(t)		(((t) >> 16) & 0x7FFF)
+#define LINK_T				1UL
+
+#define REG(field)			(offsetof(IP_USBHS_001_T, field) / 4)
+#define REG_SPAN			0x2000
+#define PTR(a)				((uint32_t*) (uintptr_t) (a))
+
+//-----------------------------------------------------------------------------
+// wire costs in ns: per byte on the wire and per transaction
+// (token, handshake, inter packet gaps)
+#define HS_BYTE				18
+#define HS_TRANSACTION		1100
+#define HS_NAK				500
+#define FS_BYTE				700
+#define FS_TRANSACTION		9000
+#define FS_NAK				4000
+// idle poll so the model can preempt a firmware busy wait
+#define IDLE_POLL			50000
+#define NEVER				(~0ULL)
+
+//-----------------------------------------------------------------------------
+// log-linear histogram, 16 steps per power of two (~6%)
+#define HIST_BINS			(64 * 16)
+
+typedef struct _SimHist
+{
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint32_t bins[HIST_BINS];
+} SimHist;
+
+static void Hist_Add(SimHist* h, uint64_t v)
+{
+	uint32_t bin = (uint32_t) v;
+	if (v >= 16)
+	{
+		uint32_t e = 63 - __builtin_clzll(v);
+		bin = (e - 3) * 16 + (uint32_t) ((v >> (e - 4)) & 15);
+	}
+	h->bins[bin]++;
+	h->count++;
+	h->sum += v;
+	if (v > h->max)
+	{
+		h->max = v;
+	}
+}
+
+static uint64_t Hist_Percentile(const SimHist* h, uint32_t pc)
+{
+	uint64_t want = (h->count * pc + 99) / 100, seen = 0;
+	uint32_t bin;
+	for (bin = 0; bin < HIST_BINS; bin++)
+	{
+		seen += h->bins[bin];
+		if (seen && seen >= want)
+		{
+			uint64_t v;
+			if (bin < 16)
+			{
+				return bin;
+			}
+			v = (uint64_t) (16 + (bin & 15)) << (bin / 16 - 1);
+			return v < h->max ? v : h->max;
+		}
+	}
+	return h->max;
+}
+
+//-----------------------------------------------------------------------------
+typedef struct _SimEndpoint
+{
+	// bytes moved in the dTD in the overlay
+	uint32_t offset;
+	// IOC retire not yet followed by a prime
+	uint64_t done_v;
+	// first NAK since the endpoint was last primed
+	uint64_t nak_v;
+	uint64_t transfers;
+	uint64_t bytes;
+	uint64_t naks;
+	uint64_t missed;
+	SimHist turnaround;
+	SimHist nak_service;
+} SimEndpoint;
+
+enum { CAUSE_UI, CAUSE_NAK, CAUSE_SOF, CAUSE_RESET, CAUSES };
+static const char* const cause_names[CAUSES] = { "transfer/setup", "NAK", "SOF", "reset" };
+
+static struct
+{
+	DcdSimOptions options;
+	// model's read/write view of the register pages
+	volatile uint32_t* hw;
+	uint8_t* fw_view;
+	int sig_tick;
+	timer_t timer;
+
+	// clocks. v = firmware time
+	uint64_t t0;
+	volatile uint64_t stolen;
+	uint64_t last_v;
+	uint64_t tick_v;
+	uint64_t armed_v;
+
+	// wire
+	int port_enabled;
+	int high_speed;
+	uint8_t address;
+	int address_pending;
+	uint64_t frame_ns;
+	uint64_t next_sof_v;
+	uint32_t frame;
+	uint64_t bus_v;
+	DcdSimIsoStream* iso[8];
+	uint32_t iso_count;
+
+	// interrupt line
+	volatile int nvic;
+	volatile int irq_pending;
+	volatile int irq_active;
+	uint64_t raise_v;
+
+	// host coroutine
+	ucontext_t host_ctx;
+	ucontext_t tick_ctx;
+	int (*host)(void);
+	int host_result;
+	volatile int host_done;
+	uint64_t host_wake_v;
+	uint32_t host_wait_bits;
+	sigjmp_buf done_jmp;
+
+	// register write being single stepped
+	uint32_t trap_word;
+	uint32_t trap_old;
+	uint64_t trap_t;
+	uint64_t trap_v;
+	int trap_had_tick;
+	int trap_had_irq;
+	int rearm;
+
+	// kernel cost of one signal delivery, of one timer tick and of one
+	// trapped write
+	uint64_t cal_signal;
+	uint64_t cal_tick;
+	uint64_t cal_trap;
+
+	SimEndpoint ep[32];
+	const char* sample_names[8];
+	SimHist samples[8];
+	SimHist isr_latency;
+	SimHist isr_time;
+	SimHist isr_cause[CAUSES];
+	SimHist slack;
+	uint64_t traps;
+	uint64_t ticks;
+	uint64_t wall_ns;
+} sim;
+
+static uint8_t host_stack[512 * 1024] __attribute__((aligned(16)));
+
+//-----------------------------------------------------------------------------
+static uint64_t Mono(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// the thread's CPU time, so nothing is charged to the firmware while the
+// simulator itself is descheduled
+static uint64_t Clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// the calibrated costs are averages; when they overshoot, give the excess
+// back rather than let firmware time run backwards
+static uint64_t Virtual(uint64_t t)
+{
+	int64_t run = (int64_t) (t - sim.t0 - sim.stolen);
+	uint64_t v;
+	if (run < (int64_t) (sim.last_v / sim.options.slowdown))
+	{
+		run = (int64_t) (sim.last_v / sim.options.slowdown);
+		sim.stolen = t - sim.t0 - (uint64_t) run;
+	}
+	v = (uint64_t) run * sim.options.slowdown;
+	if (v > sim.last_v)
+	{
+		sim.last_v = v;
+	}
+	return v;
+}
+
+uint64_t DcdSim_Now(void)
+{
+	return Virtual(Clock());
+}
+
+static void Sim_Arm(void)
+{
+	struct itimerspec its;
+	uint64_t next = sim.host_done ? NEVER : sim.host_wake_v;
+	uint64_t now = Virtual(Clock()), wall;
+	if (sim.port_enabled && sim.next_sof_v < next)
+	{
+		next = sim.next_sof_v;
+	}
+	if (next > sim.tick_v + IDLE_POLL)
+	{
+		next = sim.tick_v + IDLE_POLL;
+	}
+	sim.armed_v = next;
+	// relative to now: CPU time stands still while descheduled, so a tick
+	// can come early but is then just re-armed
+	wall = Mono() + (next > now ? (next - now) / sim.options.slowdown : 0) + 1;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = wall / 1000000000ULL;
+	its.it_value.tv_nsec = wall % 1000000000ULL;
+	timer_settime(sim.timer, TIMER_ABSTIME, &its, NULL);
+}
+
+//-----------------------------------------------------------------------------
+// interrupt line
+
+static void Sim_CheckIRQ(uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	if (sim.nvic && !sim.irq_pending && !sim.irq_active && (r[REG(USBSTS_D)] & r[REG(USBINTR_D)]))
+	{
+		sim.irq_pending = 1;
+		sim.raise_v = v;
+		raise(SIGUSR1);
+	}
+}
+
+void DcdSim_NVIC(IRQn_Type irq, int enable)
+{
+	if (irq == USB0_IRQn)
+	{
+		sim.nvic = enable;
+		if (enable)
+		{
+			Sim_CheckIRQ(DcdSim_Now());
+		}
+	}
+}
+
+void DcdSim_MaskIRQ(int mask)
+{
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	sigprocmask(mask ? SIG_BLOCK : SIG_UNBLOCK, &set, NULL);
+}
+
+// also set inside the interrupt handler, which runs with SIGUSR1 blocked
+int DcdSim_IRQMasked(void)
+{
+	sigset_t set;
+	sigprocmask(SIG_BLOCK, NULL, &set);
+	return sigismember(&set, SIGUSR1) == 1;
+}
+
+static void Sim_IRQ(int sig, siginfo_t* si, void* ctx)
+{
+	uint64_t in_v, out_v;
+	uint32_t cause;
+	(void) sig; (void) si; (void) ctx;
+	sim.stolen += sim.cal_signal;
+	sim.irq_pending = 0;
+	if (!sim.nvic)
+	{
+		// stays asserted, DcdSim_NVIC() raises it again
+		return;
+	}
+	in_v = DcdSim_Now();
+	cause = sim.hw[REG(USBSTS_D)] & sim.hw[REG(USBINTR_D)];
+	sim.irq_active = 1;
+	USB0_IRQHandler();
+	out_v = DcdSim_Now();
+	sim.irq_active = 0;
+	Hist_Add(&sim.isr_latency, in_v > sim.raise_v ? in_v - sim.raise_v : 0);
+	Hist_Add(&sim.isr_time, out_v - in_v);
+	if (cause & STS_UI)
+	{
+		Hist_Add(&sim.isr_cause[CAUSE_UI], out_v - in_v);
+	}
+	if (cause & STS_NAKI)
+	{
+		Hist_Add(&sim.isr_cause[CAUSE_NAK], out_v - in_v);
+	}
+	if (cause & STS_SRI)
+	{
+		Hist_Add(&sim.isr_cause[CAUSE_SOF], out_v - in_v);
+	}
+	if (cause & STS_URI)
+	{
+		Hist_Add(&sim.isr_cause[CAUSE_RESET], out_v - in_v);
+	}
+	Sim_CheckIRQ(out_v);
+}
+
+//-----------------------------------------------------------------------------
+// endpoints. bit = ENDPTSTAT position, OUT n -> n, IN n -> 16 + n
+
+static uint32_t* Ep_QH(uint32_t bit)
+{
+	uint32_t phy = 2 * (bit & 15) + (bit >> 4);
+	return PTR(sim.hw[REG(ENDPOINTLISTADDR)] + 64 * phy);
+}
+
+static uint32_t Ep_MaxPacket(uint32_t* qh)
+{
+	uint32_t mps = (qh[QH_CAPS] >> 16) & 0x7FF;
+	return mps ? mps : 64;
+}
+
+// overlay.NextTD -> overlay when it is an active dTD
+static int Ep_Load(uint32_t bit)
+{
+	uint32_t* qh = Ep_QH(bit);
+	uint32_t* td;
+	if (qh[QH_NEXT] & LINK_T)
+	{
+		return 0;
+	}
+	td = PTR(qh[QH_NEXT]);
+	if (!(td[TD_TOKEN] & TOKEN_ACTIVE))
+	{
+		return 0;
+	}
+	qh[QH_CURRENT] = qh[QH_NEXT];
+	memcpy(&qh[QH_NEXT], td, TD_WORDS * 4);
+	sim.ep[bit].offset = 0;
+	return 1;
+}
+
+static void Ep_Prime(uint32_t bits, uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	uint32_t bit;
+	bits &= 0x003F003F;
+	for (bit = 0; bits; bit++, bits >>= 1)
+	{
+		SimEndpoint* ep = &sim.ep[bit];
+		if (!(bits & 1) || (r[REG(ENDPTSTAT)] & (1UL << bit)) || !Ep_Load(bit))
+		{
+			continue;
+		}
+		r[REG(ENDPTSTAT)] |= 1UL << bit;
+		if (ep->done_v)
+		{
+			Hist_Add(&ep->turnaround, v - ep->done_v);
+			ep->done_v = 0;
+		}
+		if (ep->nak_v)
+		{
+			Hist_Add(&ep->nak_service, v - ep->nak_v);
+			ep->nak_v = 0;
+		}
+		if (sim.host_wait_bits & (1UL << bit))
+		{
+			// the host retries shortly after, as an EHCI would
+			uint64_t retry = v + (sim.high_speed ? HS_NAK : FS_NAK);
+			if (retry < sim.host_wake_v)
+			{
+				sim.host_wake_v = retry;
+				sim.rearm = 1;
+			}
+		}
+	}
+}
+
+static void Ep_Retire(uint32_t bit, uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	SimEndpoint* ep = &sim.ep[bit];
+	uint32_t* qh = Ep_QH(bit);
+	uint32_t* td = PTR(qh[QH_CURRENT]);
+	qh[QH_TOKEN] &= ~TOKEN_ACTIVE;
+	td[TD_TOKEN] = qh[QH_TOKEN];
+	if (qh[QH_TOKEN] & TOKEN_IOC)
+	{
+		r[REG(ENDPTCOMPLETE)] |= 1UL << bit;
+		r[REG(USBSTS_D)] |= STS_UI;
+		ep->transfers++;
+		if (!ep->done_v)
+		{
+			ep->done_v = v | 1;
+		}
+	}
+	// the next link is read from the retired dTD in memory, not from the
+	// overlay copy, so a dTD appended while this one ran is picked up. The
+	// add dTD tripwire tells firmware the list moved under it
+	qh[QH_NEXT] = td[TD_NEXT];
+	r[REG(USBCMD_D)] &= ~CMD_ATDTW;
+	if (!Ep_Load(bit))
+	{
+		r[REG(ENDPTSTAT)] &= ~(1UL << bit);
+	}
+	// SET_ADDRESS with AD takes effect once its status stage is through
+	if (bit == 16 && sim.address_pending)
+	{
+		sim.address = (uint8_t) (r[REG(DEVICEADDR)] >> 25);
+		sim.address_pending = 0;
+	}
+}
+
+// buffer access through the dTD page list, the way the controller DMAs
+static void Ep_Copy(uint32_t* qh, uint32_t offset, uint8_t* data, uint32_t n, int to_device)
+{
+	while (n)
+	{
+		uint32_t pos = (qh[QH_PAGE] & 0xFFF) + offset;
+		uint32_t page = pos >> 12, chunk = 0x1000 - (pos & 0xFFF);
+		uint8_t* p;
+		if (page > 4)
+		{
+			break;
+		}
+		p = page ? (uint8_t*) PTR((qh[QH_PAGE + page] & ~0xFFFUL) + (pos & 0xFFF))
+		    : (uint8_t*) PTR(qh[QH_PAGE] + offset);
+		if (chunk > n)
+		{
+			chunk = n;
+		}
+		if (to_device)
+		{
+			memcpy(p, data, chunk);
+		}
+		else
+		{
+			memcpy(data, p, chunk);
+		}
+		data += chunk;
+		offset += chunk;
+		n -= chunk;
+	}
+}
+
+static uint32_t Ep_Transfer(uint32_t bit, uint8_t* data, uint32_t size, uint64_t v, int iso)
+{
+	uint32_t* qh = Ep_QH(bit);
+	uint32_t mps = Ep_MaxPacket(qh), token = qh[QH_TOKEN];
+	uint32_t remaining = TOKEN_BYTES(token), n;
+	int in = bit >= 16;
+	if (iso)
+	{
+		// a transmit dTD's MultO overrides the dQH's Mult
+		uint32_t mult = (in && TOKEN_MULTO(token)) ? TOKEN_MULTO(token) : qh[QH_CAPS] >> 30;
+		mps *= mult ? mult : 1;
+	}
+	n = size < remaining ? size : remaining;
+	if (n > mps)
+	{
+		n = mps;
+	}
+	if (!in && size > remaining)
+	{
+		token |= TOKEN_BUFFER_ERR;
+	}
+	Ep_Copy(qh, sim.ep[bit].offset, data, n, !in);
+	sim.ep[bit].offset += n;
+	sim.ep[bit].bytes += n;
+	remaining -= n;
+	qh[QH_TOKEN] = (token & ~(0x7FFFUL << 16)) | (remaining << 16);
+	if (iso || n < mps || !remaining)
+	{
+		Ep_Retire(bit, v);
+	}
+	return n;
+}
+
+static void Ep_NAK(uint32_t bit, uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	sim.ep[bit].naks++;
+	if (!sim.ep[bit].nak_v)
+	{
+		sim.ep[bit].nak_v = v | 1;
+	}
+	r[REG(ENDPTNAK)] |= 1UL << bit;
+	if (r[REG(ENDPTNAK)] & r[REG(ENDPTNAKEN)])
+	{
+		r[REG(USBSTS_D)] |= STS_NAKI;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// register writes
+
+static void Ctrl_Reset(void)
+{
+	volatile uint32_t* r = sim.hw;
+	uint32_t w;
+	for (w = REG(USBCMD_D); w <= REG(ENDPTCTRL[5]); w++)
+	{
+		r[w] = 0;
+	}
+	r[REG(ENDPTCTRL[0])] = CTRL_RXE | CTRL_TXE;
+	r[REG(CAPLENGTH)] = 0x40 | (0x0100 << 16);
+	sim.port_enabled = 0;
+	sim.high_speed = 0;
+	sim.address = 0;
+	sim.address_pending = 0;
+}
+
+static void Reg_Write(uint32_t word, uint32_t old, uint32_t value, uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	if (word >= 0x1000 / 4)
+	{
+		// USB1, plain memory
+		return;
+	}
+	switch (word)
+	{
+	case REG(USBCMD_D):
+		if (value & CMD_RST)
+		{
+			Ctrl_Reset();
+		}
+		else if (!(value & CMD_RS))
+		{
+			sim.port_enabled = 0;
+		}
+		break;
+	case REG(USBSTS_D):
+		r[word] = old & ~value;
+		if (r[REG(ENDPTNAK)] & r[REG(ENDPTNAKEN)])
+		{
+			r[word] |= STS_NAKI;
+		}
+		break;
+	case REG(ENDPTNAK):
+	case REG(ENDPTSETUPSTAT):
+	case REG(ENDPTCOMPLETE):
+		r[word] = old & ~value;
+		break;
+	case REG(ENDPTNAKEN):
+		if (r[REG(ENDPTNAK)] & value)
+		{
+			r[REG(USBSTS_D)] |= STS_NAKI;
+		}
+		break;
+	case REG(DEVICEADDR):
+		if (value & ADDR_AD)
+		{
+			sim.address_pending = 1;
+		}
+		else
+		{
+			sim.address = (uint8_t) (value >> 25);
+		}
+		break;
+	case REG(ENDPTPRIME):
+		r[word] = 0;
+		Ep_Prime(value, v);
+		break;
+	case REG(ENDPTFLUSH):
+		r[word] = 0;
+		r[REG(ENDPTSTAT)] &= ~value;
+		break;
+	case REG(ENDPTSTAT):
+	case REG(FRINDEX_D):
+		r[word] = old;
+		break;
+	case REG(PORTSC1_D):
+		r[word] = (value & ~PORTSC_HSP) | (old & PORTSC_HSP);
+		break;
+	default:
+		break;
+	}
+}
+
+static void Sim_Segv(int sig, siginfo_t* si, void* ctx)
+{
+	ucontext_t* uc = ctx;
+	uintptr_t a = (uintptr_t) si->si_addr;
+	(void) sig;
+	if (a < LPC_USB0_BASE || a >= LPC_USB0_BASE + REG_SPAN)
+	{
+		// a real crash, let it happen
+		signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+	sim.trap_t = Clock();
+	sim.trap_v = Virtual(sim.trap_t);
+	sim.trap_word = (uint32_t) (a - LPC_USB0_BASE) >> 2;
+	sim.trap_old = sim.hw[sim.trap_word];
+	// nothing may run between the store and its semantics
+	sim.trap_had_tick = sigismember(&uc->uc_sigmask, sim.sig_tick);
+	sim.trap_had_irq = sigismember(&uc->uc_sigmask, SIGUSR1);
+	sigaddset(&uc->uc_sigmask, sim.sig_tick);
+	sigaddset(&uc->uc_sigmask, SIGUSR1);
+	mprotect(sim.fw_view, REG_SPAN, PROT_READ | PROT_WRITE);
+	uc->uc_mcontext.gregs[REG_EFL] |= 0x100;
+}
+
+static void Sim_Step(int sig, siginfo_t* si, void* ctx)
+{
+	ucontext_t* uc = ctx;
+	(void) sig; (void) si;
+	uc->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+	mprotect(sim.fw_view, REG_SPAN, PROT_READ);
+	Reg_Write(sim.trap_word, sim.trap_old, sim.hw[sim.trap_word], sim.trap_v);
+	Sim_CheckIRQ(sim.trap_v);
+	if (!sim.trap_had_tick)
+	{
+		sigdelset(&uc->uc_sigmask, sim.sig_tick);
+	}
+	if (!sim.trap_had_irq)
+	{
+		sigdelset(&uc->uc_sigmask, SIGUSR1);
+	}
+	sim.traps++;
+	sim.stolen += Clock() - sim.trap_t + sim.cal_trap;
+	if (sim.rearm)
+	{
+		uint64_t t = Clock();
+		sim.rearm = 0;
+		Sim_Arm();
+		sim.stolen += Clock() - t;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// bus
+
+static void Wire_SOF(uint64_t v)
+{
+	volatile uint32_t* r = sim.hw;
+	uint32_t* qh;
+	uint32_t i, mps, signalled, needed;
+	sim.frame++;
+	r[REG(FRINDEX_D)] = sim.high_speed ? (sim.frame & 0x3FFF) : ((sim.frame << 3) & 0x3FFF);
+	r[REG(USBSTS_D)] |= STS_SRI;
+	if (sim.bus_v < v)
+	{
+		sim.bus_v = v;
+	}
+	for (i = 0; i < sim.iso_count; i++)
+	{
+		DcdSimIsoStream* s = sim.iso[i];
+		uint32_t bit = s->ep + (s->in ? 16 : 0);
+		if (sim.frame % s->interval)
+		{
+			continue;
+		}
+		if (!(r[REG(ENDPTSTAT)] & (1UL << bit)))
+		{
+			s->missed++;
+			sim.ep[bit].missed++;
+			continue;
+		}
+		qh = Ep_QH(bit);
+		mps = Ep_MaxPacket(qh);
+		// transactions the controller will signal in the data PIDs
+		signalled = s->in && TOKEN_MULTO(qh[QH_TOKEN]) ? TOKEN_MULTO(qh[QH_TOKEN]) : qh[QH_CAPS] >> 30;
+		signalled = signalled ? signalled : 1;
+		s->last_size = Ep_Transfer(bit, s->data, s->in ? sizeof(s->data) : s->packet_size, v, 1);
+		s->packets++;
+		s->bytes += s->last_size;
+		// the host stops at the DATA0 and at a short packet, both must agree
+		needed = s->last_size ? (s->last_size + mps - 1) / mps : 1;
+		if (s->in && needed != signalled)
+		{
+			s->pid_errors++;
+		}
+		s->transactions += needed;
+		sim.bus_v += (sim.high_speed ? HS_TRANSACTION * needed + HS_BYTE * s->last_size
+		              : FS_TRANSACTION + FS_BYTE * s->last_size);
+	}
+}
+
+static void Host_Yield(void)
+{
+	swapcontext(&sim.host_ctx, &sim.tick_ctx);
+}
+
+void DcdSim_Sleep(uint64_t ns)
+{
+	uint64_t until = sim.tick_v + ns;
+	while (sim.tick_v < until)
+	{
+		sim.host_wake_v = until;
+		Host_Yield();
+	}
+}
+
+// the bus is busy for 'cost' from when it is next free
+static void Bus_Wait(uint64_t cost)
+{
+	uint64_t start = sim.bus_v > sim.tick_v ? sim.bus_v : sim.tick_v;
+	sim.bus_v = start + cost;
+	DcdSim_Sleep(sim.bus_v - sim.tick_v);
+}
+
+static uint64_t Bus_Cost(uint32_t bytes)
+{
+	return sim.high_speed ? HS_TRANSACTION + HS_BYTE * bytes : FS_TRANSACTION + FS_BYTE * bytes;
+}
+
+static uint64_t Bus_NAKCost(void)
+{
+	return sim.high_speed ? HS_NAK : FS_NAK;
+}
+
+static int Wire_Addressed(uint8_t address)
+{
+	return (sim.hw[REG(USBCMD_D)] & CMD_RS) && sim.port_enabled && address == sim.address;
+}
+
+int DcdSim_WaitAttach(uint32_t timeout_ms)
+{
+	uint64_t until = sim.tick_v + timeout_ms * 1000000ULL;
+	while (!(sim.hw[REG(USBCMD_D)] & CMD_RS))
+	{
+		if (sim.tick_v >= until)
+		{
+			return 0;
+		}
+		DcdSim_Sleep(100000);
+	}
+	return 1;
+}
+
+int DcdSim_BusReset(void)
+{
+	volatile uint32_t* r = sim.hw;
+	sim.port_enabled = 0;
+	sim.address = 0;
+	sim.address_pending = 0;
+	r[REG(PORTSC1_D)] &= ~PORTSC_HSP;
+	r[REG(DEVICEADDR)] = 0;
+	r[REG(USBSTS_D)] |= STS_URI;
+	Sim_CheckIRQ(sim.tick_v);
+	// reset signalling and chirp, shortened
+	DcdSim_Sleep(3000000);
+	sim.high_speed = !sim.options.full_speed && !(r[REG(PORTSC1_D)] & PORTSC_PFSC);
+	r[REG(PORTSC1_D)] |= PORTSC_CCS | (sim.high_speed ? PORTSC_HSP : 0);
+	r[REG(USBSTS_D)] |= STS_PCI;
+	sim.frame_ns = sim.high_speed ? 125000 : 1000000;
+	sim.next_sof_v = sim.tick_v + sim.frame_ns;
+	sim.bus_v = sim.tick_v;
+	sim.port_enabled = 1;
+	Sim_CheckIRQ(sim.tick_v);
+	return sim.high_speed;
+}
+
+int DcdSim_IsHighSpeed(void)
+{
+	return sim.high_speed;
+}
+
+int DcdSim_Setup(uint8_t address, const uint8_t setup[8])
+{
+	volatile uint32_t* r = sim.hw;
+	uint32_t* qh;
+	if (!Wire_Addressed(address))
+	{
+		return DCDSIM_TIMEOUT;
+	}
+	Bus_Wait(Bus_Cost(8));
+	// a SETUP always lands and cancels whatever ep0 had going
+	qh = Ep_QH(0);
+	memcpy(&qh[QH_SETUP], setup, 8);
+	r[REG(ENDPTSTAT)] &= ~0x00010001UL;
+	r[REG(ENDPTCTRL[0])] &= ~(CTRL_RXS | CTRL_TXS);
+	r[REG(ENDPTSETUPSTAT)] |= 1;
+	r[REG(USBSTS_D)] |= STS_UI;
+	Sim_CheckIRQ(sim.tick_v);
+	return 0;
+}
+
+// the handshake is decided when the token arrives; the transaction then
+// occupies the bus as one step so the firmware is not chopped into slices
+// much finer than anything it could react to
+static int Wire_Token(uint8_t address, uint32_t bit)
+{
+	volatile uint32_t* r = sim.hw;
+	uint32_t ctrl;
+	if (!Wire_Addressed(address))
+	{
+		return DCDSIM_TIMEOUT;
+	}
+	ctrl = r[REG(ENDPTCTRL[0]) + (bit & 15)];
+	if (!(ctrl & (bit >= 16 ? CTRL_TXE : CTRL_RXE)))
+	{
+		return DCDSIM_TIMEOUT;
+	}
+	if (ctrl & (bit >= 16 ? CTRL_TXS : CTRL_RXS))
+	{
+		Bus_Wait(Bus_NAKCost());
+		return DCDSIM_STALL;
+	}
+	if (!(r[REG(ENDPTSTAT)] & (1UL << bit)))
+	{
+		Ep_NAK(bit, sim.tick_v);
+		Sim_CheckIRQ(sim.tick_v);
+		Bus_Wait(Bus_NAKCost());
+		return DCDSIM_NAK;
+	}
+	return 0;
+}
+
+int DcdSim_In(uint8_t address, uint8_t ep, uint8_t* data, uint32_t max)
+{
+	uint32_t bit = 16 + ep, *qh, n;
+	int rc = Wire_Token(address, bit);
+	if (rc)
+	{
+		return rc;
+	}
+	qh = Ep_QH(bit);
+	n = TOKEN_BYTES(qh[QH_TOKEN]);
+	if (n > Ep_MaxPacket(qh))
+	{
+		n = Ep_MaxPacket(qh);
+	}
+	Bus_Wait(Bus_Cost(n));
+	if (!(sim.hw[REG(ENDPTSTAT)] & (1UL << bit)))
+	{
+		// flushed under the packet
+		return DCDSIM_NAK;
+	}
+	n = Ep_Transfer(bit, data, max, sim.tick_v, 0);
+	Sim_CheckIRQ(sim.tick_v);
+	return (int) n;
+}
+
+int DcdSim_Out(uint8_t address, uint8_t ep, const uint8_t* data, uint32_t size)
+{
+	int rc = Wire_Token(address, ep);
+	if (rc)
+	{
+		return rc;
+	}
+	Bus_Wait(Bus_Cost(size));
+	if (!(sim.hw[REG(ENDPTSTAT)] & (1UL << ep)))
+	{
+		return DCDSIM_NAK;
+	}
+	Ep_Transfer(ep, (uint8_t*) data, size, sim.tick_v, 0);
+	Sim_CheckIRQ(sim.tick_v);
+	return (int) size;
+}
+
+int DcdSim_WaitPrimed(uint8_t ep, uint8_t in, uint64_t timeout_ns)
+{
+	uint32_t bit = 1UL << (ep + (in ? 16 : 0));
+	uint64_t until = sim.tick_v + timeout_ns;
+	while (!(sim.hw[REG(ENDPTSTAT)] & bit) && sim.tick_v < until)
+	{
+		sim.host_wait_bits = bit;
+		sim.host_wake_v = until;
+		Host_Yield();
+	}
+	sim.host_wait_bits = 0;
+	return (sim.hw[REG(ENDPTSTAT)] & bit) != 0;
+}
+
+void DcdSim_AddIsoStream(DcdSimIsoStream* stream)
+{
+	if (sim.iso_count < sizeof(sim.iso) / sizeof(sim.iso[0]))
+	{
+		if (!stream->interval)
+		{
+			stream->interval = 1;
+		}
+		sim.iso[sim.iso_count++] = stream;
+	}
+}
+
+void DcdSim_ClearIsoStreams(void)
+{
+	sim.iso_count = 0;
+}
+
+void DcdSim_NextFrame(void)
+{
+	uint32_t frame = sim.frame;
+	while (sim.frame == frame)
+	{
+		sim.host_wake_v = sim.next_sof_v;
+		Host_Yield();
+	}
+}
+
+uint32_t DcdSim_FrameCount(void)
+{
+	return sim.frame;
+}
+
+//-----------------------------------------------------------------------------
+// the bus side of the controller and the host, on a timer signal
+
+static void Sim_Tick(int sig, siginfo_t* si, void* ctx)
+{
+	uint64_t t = Clock(), v = Virtual(t);
+	(void) sig; (void) si; (void) ctx;
+	sim.ticks++;
+	Hist_Add(&sim.slack, v > sim.armed_v ? v - sim.armed_v : 0);
+	sim.tick_v = v;
+	while (sim.port_enabled && sim.next_sof_v <= v)
+	{
+		Wire_SOF(v);
+		sim.next_sof_v += sim.frame_ns;
+	}
+	if (!sim.host_done && v >= sim.host_wake_v)
+	{
+		swapcontext(&sim.tick_ctx, &sim.host_ctx);
+	}
+	Sim_CheckIRQ(v);
+	sim.stolen += Clock() - t + sim.cal_tick;
+	if (sim.host_done)
+	{
+		siglongjmp(sim.done_jmp, 1);
+	}
+	t = Clock();
+	Sim_Arm();
+	sim.stolen += Clock() - t;
+}
+
+static void Host_Entry(void)
+{
+	sim.host_result = sim.host();
+	sim.host_done = 1;
+}
+
+//-----------------------------------------------------------------------------
+
+static volatile uint64_t cal_count;
+static volatile uint64_t cal_handler_ns;
+
+static void Cal_Signal(int sig)
+{
+	(void) sig;
+	cal_count++;
+}
+
+static void Cal_Tick(int sig)
+{
+	uint64_t t = Clock();
+	(void) sig;
+	cal_count++;
+	cal_handler_ns += Clock() - t;
+}
+
+static uint64_t Cal_Spin(uint32_t n)
+{
+	uint64_t t = Clock();
+	uint32_t i;
+	for (i = 0; i < n; i++)
+	{
+		__asm__ volatile ("" ::: "memory");
+	}
+	return Clock() - t;
+}
+
+static void Sim_Calibrate(void)
+{
+	volatile uint32_t* burst = &((IP_USBHS_001_T*) LPC_USB0_BASE)->BURSTSIZE;
+	struct sigaction sa;
+	uint64_t t, stolen;
+	uint32_t i, n = 20000;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = Cal_Signal;
+	sigaction(SIGUSR2, &sa, NULL);
+	t = Clock();
+	for (i = 0; i < n; i++)
+	{
+		raise(SIGUSR2);
+	}
+	sim.cal_signal = (Clock() - t) / n;
+	// an asynchronous timer signal also pays for the interrupt (and under a
+	// hypervisor the exit): time a spin loop with and without a 50us timer
+	{
+		struct itimerspec its;
+		uint64_t quiet = NEVER, loaded = NEVER, handler = 0, count = 0, d;
+		uint32_t spin = 1000000, round;
+		while (Cal_Spin(spin) < 20000000 && spin < (1U << 30))
+		{
+			spin *= 2;
+		}
+		sa.sa_handler = Cal_Tick;
+		sigaction(sim.sig_tick, &sa, NULL);
+		for (round = 0; round < 3; round++)
+		{
+			if ((d = Cal_Spin(spin)) < quiet)
+			{
+				quiet = d;
+			}
+			cal_count = 0;
+			cal_handler_ns = 0;
+			memset(&its, 0, sizeof(its));
+			its.it_value.tv_nsec = its.it_interval.tv_nsec = IDLE_POLL;
+			timer_settime(sim.timer, 0, &its, NULL);
+			d = Cal_Spin(spin);
+			memset(&its, 0, sizeof(its));
+			timer_settime(sim.timer, 0, &its, NULL);
+			if (d < loaded)
+			{
+				loaded = d;
+				handler = cal_handler_ns;
+				count = cal_count;
+			}
+		}
+		sim.cal_tick = count && loaded > quiet + handler ? (loaded - quiet - handler) / count : sim.cal_signal;
+	}
+	// whole cost of a trapped write less what the handlers measure
+	sim.cal_trap = 0;
+	stolen = sim.stolen;
+	t = Clock();
+	for (i = 0; i < n; i++)
+	{
+		*burst = i;
+	}
+	t = Clock() - t;
+	stolen = sim.stolen - stolen;
+	sim.cal_trap = t > stolen ? (t - stolen) / n : 0;
+	sim.traps = 0;
+}
+
+void DcdSim_Init(const DcdSimOptions* options)
+{
+	struct sigaction sa;
+	struct sigevent sev;
+	int fd;
+	sim.options = *options;
+	if (!sim.options.slowdown)
+	{
+		sim.options.slowdown = 1;
+	}
+	sim.sig_tick = SIGRTMIN;
+	// one memory object, seen read only by the firmware and writable by the model
+	fd = memfd_create("dcdsim", 0);
+	if (fd < 0 || ftruncate(fd, REG_SPAN))
+	{
+		perror("dcdsim: memfd");
+		exit(1);
+	}
+	sim.fw_view = mmap((void*) LPC_USB0_BASE, REG_SPAN, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+	sim.hw = mmap(NULL, REG_SPAN, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (sim.fw_view != (uint8_t*) LPC_USB0_BASE || sim.hw == MAP_FAILED)
+	{
+		fprintf(stderr, "dcdsim: cannot map the registers at 0x%08X\n", LPC_USB0_BASE);
+		exit(1);
+	}
+	Ctrl_Reset();
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	sigaddset(&sa.sa_mask, sim.sig_tick);
+	sigaddset(&sa.sa_mask, SIGUSR1);
+	sa.sa_sigaction = Sim_Segv;
+	sigaction(SIGSEGV, &sa, NULL);
+	sa.sa_sigaction = Sim_Step;
+	sigaction(SIGTRAP, &sa, NULL);
+	// the model runs inside the ISR, the ISR never nests
+	sigemptyset(&sa.sa_mask);
+	sigaddset(&sa.sa_mask, SIGUSR1);
+	sa.sa_sigaction = Sim_IRQ;
+	sigaction(SIGUSR1, &sa, NULL);
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = sim.sig_tick;
+	if (timer_create(CLOCK_MONOTONIC, &sev, &sim.timer))
+	{
+		perror("dcdsim: timer_create");
+		exit(1);
+	}
+	Sim_Calibrate();
+	sigemptyset(&sa.sa_mask);
+	sigaddset(&sa.sa_mask, sim.sig_tick);
+	sigaddset(&sa.sa_mask, SIGUSR1);
+	sa.sa_sigaction = Sim_Tick;
+	sigaction(sim.sig_tick, &sa, NULL);
+}
+
+int DcdSim_Run(int (*host)(void), void (*firmware)(void))
+{
+	struct itimerspec its;
+	uint64_t start;
+	getcontext(&sim.host_ctx);
+	sim.host_ctx.uc_stack.ss_sp = host_stack;
+	sim.host_ctx.uc_stack.ss_size = sizeof(host_stack);
+	sim.host_ctx.uc_link = &sim.tick_ctx;
+	// the host only ever runs inside the tick handler
+	sigemptyset(&sim.host_ctx.uc_sigmask);
+	sigaddset(&sim.host_ctx.uc_sigmask, sim.sig_tick);
+	sigaddset(&sim.host_ctx.uc_sigmask, SIGUSR1);
+	makecontext(&sim.host_ctx, Host_Entry, 0);
+	sim.host = host;
+	sim.host_wake_v = 0;
+	sim.stolen = 0;
+	sim.last_v = 0;
+	start = Mono();
+	sim.t0 = Clock();
+	if (!sigsetjmp(sim.done_jmp, 1))
+	{
+		Sim_Arm();
+		firmware();
+	}
+	memset(&its, 0, sizeof(its));
+	timer_settime(sim.timer, 0, &its, NULL);
+	sim.wall_ns = Mono() - start;
+	return sim.host_result;
+}
+
+void DcdSim_Sample(const char* name, uint64_t ns)
+{
+	uint32_t i;
+	for (i = 0; i < 8; i++)
+	{
+		if (!sim.sample_names[i])
+		{
+			sim.sample_names[i] = name;
+		}
+		if (sim.sample_names[i] == name)
+		{
+			Hist_Add(&sim.samples[i], ns);
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+static void Report_Hist(const char* name, const SimHist* h)
+{
+	if (!h->count)
+	{
+		return;
+	}
+	printf("  %-22s %9llu %9.2f %9.2f %9.2f %9.2f\n", name, (unsigned long long) h->count,
+	       h->sum / (double) h->count / 1000.0, Hist_Percentile(h, 50) / 1000.0,
+	       Hist_Percentile(h, 99) / 1000.0, h->max / 1000.0);
+}
+
+void DcdSim_Report(void)
+{
+	static const char* const types[4] = { "control", "iso", "bulk", "interrupt" };
+	uint64_t v = sim.tick_v;
+	uint32_t bit, i;
+	printf("\n%s speed, %.3f s firmware time, %.3f s wall, slowdown %u, %u (micro)frames\n",
+	       sim.high_speed ? "high" : "full", v / 1e9, sim.wall_ns / 1e9, sim.options.slowdown, sim.frame);
+	printf("\n  endpoint          transfers     bytes      NAKs    missed\n");
+	for (bit = 0; bit < 32; bit++)
+	{
+		SimEndpoint* ep = &sim.ep[bit];
+		uint32_t ctrl = sim.hw[REG(ENDPTCTRL[0]) + (bit & 15)];
+		char name[32];
+		if (!ep->transfers && !ep->naks && !ep->missed)
+		{
+			continue;
+		}
+		snprintf(name, sizeof(name), "EP%u %s %s", bit & 15, bit >= 16 ? "IN" : "OUT",
+		         types[(bit >= 16 ? ctrl >> 18 : ctrl >> 2) & 3]);
+		printf("  %-16s %10llu %9llu %9llu %9llu\n", name, (unsigned long long) ep->transfers,
+		       (unsigned long long) ep->bytes, (unsigned long long) ep->naks, (unsigned long long) ep->missed);
+	}
+	printf("\n  us                         count      mean       p50       p99       max\n");
+	for (bit = 0; bit < 32; bit++)
+	{
+		char name[40];
+		snprintf(name, sizeof(name), "EP%u %s turnaround", bit & 15, bit >= 16 ? "IN" : "OUT");
+		Report_Hist(name, &sim.ep[bit].turnaround);
+		snprintf(name, sizeof(name), "EP%u %s NAK service", bit & 15, bit >= 16 ? "IN" : "OUT");
+		Report_Hist(name, &sim.ep[bit].nak_service);
+	}
+	Report_Hist("ISR latency", &sim.isr_latency);
+	Report_Hist("ISR time", &sim.isr_time);
+	for (i = 0; i < CAUSES; i++)
+	{
+		char name[40];
+		snprintf(name, sizeof(name), "ISR time, %s", cause_names[i]);
+		Report_Hist(name, &sim.isr_cause[i]);
+	}
+	for (i = 0; i < 8 && sim.sample_names[i]; i++)
+	{
+		Report_Hist(sim.sample_names[i], &sim.samples[i]);
+	}
+	Report_Hist("model lateness", &sim.slack);
+	printf("\n  %llu register writes trapped, %llu ticks, removed per trap %.2f us, per tick %.2f us, per signal %.2f us\n",
+	       (unsigned long long) sim.traps, (unsigned long long) sim.ticks,
+	       sim.cal_trap / 1000.0, sim.cal_tick / 1000.0, sim.cal_signal / 1000.0);
+}
@@ -0,0 +1,186 @@
+/*
+
+	DCDSim. Host-side model of the LPC18xx/43xx USB0 device controller.
+
+	Runs the unmodified LPCUSBlib DCD (Endpoint_LPC18xx.c, HAL_LPC18xx.c),
+	the core and the class drivers as a Linux process so changes can be
+	profiled without a board.
+
+	Registers. A page is mapped read-only at LPC_USB0_BASE. Firmware reads
+	cost nothing. A firmware write faults; the SIGSEGV handler opens the
+	page and single-steps the store, the SIGTRAP handler then applies the
+	register semantics (write 1 to clear for USBSTS, ENDPTCOMPLETE,
+	ENDPTSETUPSTAT and ENDPTNAK, priming and flushing for ENDPTPRIME and
+	ENDPTFLUSH, self clearing controller reset) and closes the page again.
+	dQH/dTD memory is read and written in place, exactly as the controller
+	DMA does.
+
+	Bus. The controller's wire side and the USB host run from a POSIX timer
+	signal on the same thread, so the model behaves like hardware running
+	alongside the CPU: it can preempt any firmware loop, busy waits on
+	ENDPTSTAT or the dQH work, and it needs only one core. Host scenarios
+	(simhost.c) are written as straight line code and run as a coroutine
+	that sleeps until the bus time its next transaction is due.
+
+	Interrupts. When USBSTS & USBINTR is non zero and the NVIC line is
+	enabled the model raises SIGUSR1 and its handler calls USB0_IRQHandler().
+	PRIMASK and NVIC_DisableIRQ block it, the model keeps running inside the
+	ISR, and a level still asserted on exit re-enters like the NVIC does.
+
+	Time. Everything runs on a virtual clock that only advances while
+	firmware code runs. It is built from the thread's CPU time, so nothing
+	is charged while the process is descheduled, and time spent in the
+	model, in the register traps and in signal delivery is measured and
+	removed (the kernel part of a trap, tick or signal is calibrated at
+	start up). (Micro)frames and transaction costs are paced against that
+	clock. --slowdown n stretches firmware time n times to approximate a
+	target CPU slower than the host. Expect a few us of noise per trapped
+	write: compare runs against each other rather than against a board.
+
+	Reported, all in firmware time:
+		turnaround	transfer complete (IOC dTD retired) -> firmware primes
+					the endpoint again. The per transfer cost on the
+					critical path.
+		NAK service	first NAK on an unprimed endpoint -> firmware primes it
+		ISR latency	interrupt raised -> USB0_IRQHandler() entered
+		ISR time	handler entry -> exit, split by the USBSTS cause
+
+	Needs x86-64 Linux and a non-PIE link: the dQH/dTD hold buffer
+	addresses as uint32_t so every buffer the DCD sees must sit below 4GB.
+	Everything the firmware hands to the controller is static so that holds.
+
+	Build, from software/LPCUSBLib:
+
+	gcc -O2 -g -no-pie -D__LPC43XX__ -DUSB_DEVICE_ONLY -DUSE_USB0 \
+		-DNO_LIMITED_CONTROLLER_CONNECT -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast \
+		-ITools/DCDSim -I../lpc_core/lpc_ip -IDrivers/USB \
+		Tools/DCDSim/dcdsim.c Tools/DCDSim/simhost.c Tools/DCDSim/simapp.c \
+		Drivers/USB/Core/USBController.c Drivers/USB/Core/USBTask.c Drivers/USB/Core/Device.c \
+		Drivers/USB/Core/DeviceStandardReq.c Drivers/USB/Core/Endpoint.c \
+		Drivers/USB/Core/EndpointStream.c Drivers/USB/Core/Events.c \
+		Drivers/USB/Core/ConfigDescriptor.c Drivers/USB/Core/USBCapture.c \
+		Drivers/USB/Core/HAL/LPC18XX/HAL_LPC18xx.c \
+		Drivers/USB/Core/DCD/LPC18XX/Endpoint_LPC18xx.c \
+		Drivers/USB/Class/Device/AudioClassDevice.c \
+		Drivers/USB/Class/Device/MassStorageClassDevice.c \
+		Drivers/USB/Class/Device/CDCClassDevice.c -o dcdsim
+
+	./dcdsim [--fs] [--events] [--irq-off us] [--slowdown n] [--seconds n] [--mbytes n] [--capture file] enum|audio-in|audio-out|msc|cdc|audio-hb|cdc-stream|in-submit
+
+	--events runs the audio firmware loop the way an RTOS task blocked on
+	EVENT_USB_Device_TaskPending() would, so its idle time and the SETUP ->
+	task latency can be compared with the default polling loop.
+
+	--irq-off us has the firmware loop mask interrupts for that long once a
+	millisecond, the way a long critical section would, to show how much
+	interrupt latency the isochronous endpoints ride out. Build with
+	-DUSB_ISO_DTDS=n to compare dTD ring depths.
+
+	--capture file writes what the firmware loop drained from the USB
+	capture ring (Drivers/USB/Core/USBCapture.h). Build with -DUSB_CAPTURE=1
+	and Drivers/USB/Core/USBCapture.c, then convert it with
+	Tools/USBCapture/usbcap2pcap.
+
+*/
+
+#ifndef DCDSIM_H
+#define DCDSIM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// host side transaction results
+#define DCDSIM_NAK			(-1)
+#define DCDSIM_STALL		(-2)
+#define DCDSIM_TIMEOUT		(-3)
+
+//-----------------------------------------------------------------------------
+// transfer types as in the endpoint descriptor
+#define DCDSIM_EP_CONTROL	0
+#define DCDSIM_EP_ISO		1
+#define DCDSIM_EP_BULK		2
+#define DCDSIM_EP_INTERRUPT	3
+
+//-----------------------------------------------------------------------------
+typedef struct _DcdSimOptions
+{
+	// host port is full speed only
+	int full_speed;
+	// firmware time multiplier, 1 = host speed
+	uint32_t slowdown;
+} DcdSimOptions;
+
+//-----------------------------------------------------------------------------
+// called once from main() before any firmware code touches the controller
+extern void DcdSim_Init(const DcdSimOptions* options);
+
+// runs firmware() (which never returns) against host(). Returns host()'s
+// result once it finishes; firmware() is abandoned wherever it is.
+extern int DcdSim_Run(int (*host)(void), void (*firmware)(void));
+
+// print the cost profiles
+extern void DcdSim_Report(void);
+
+//-----------------------------------------------------------------------------
+// host() only. The host model drives the wire with these; each one takes
+// bus time and may let the firmware run.
+
+// wait for the firmware to set USBCMD.RS
+extern int DcdSim_WaitAttach(uint32_t timeout_ms);
+// signal a bus reset and return the negotiated speed (1 = high speed)
+extern int DcdSim_BusReset(void);
+extern int DcdSim_IsHighSpeed(void);
+
+// one transaction each. 'address' is the device address the host targets.
+extern int DcdSim_Setup(uint8_t address, const uint8_t setup[8]);
+extern int DcdSim_In(uint8_t address, uint8_t ep, uint8_t* data, uint32_t max);
+extern int DcdSim_Out(uint8_t address, uint8_t ep, const uint8_t* data, uint32_t size);
+
+// sleep until ep is primed or timeout_ns passes. Returns 1 if primed
+extern int DcdSim_WaitPrimed(uint8_t ep, uint8_t in, uint64_t timeout_ns);
+extern void DcdSim_Sleep(uint64_t ns);
+
+// (micro)frame clock. Isochronous streams are serviced at the start of
+// every (micro)frame ahead of any control or bulk traffic.
+
+typedef struct _DcdSimIsoStream
+{
+	uint8_t ep;
+	uint8_t in;
+	uint32_t packet_size;
+	// 1 = every (micro)frame
+	uint32_t interval;
+	uint32_t packets;
+	uint32_t bytes;
+	// (micro)frames the endpoint was not primed for
+	uint32_t missed;
+	// data transactions, more than packets on a high-bandwidth endpoint
+	uint32_t transactions;
+	// IN (micro)frames whose data PID sequence announced a different number
+	// of transactions than the data took
+	uint32_t pid_errors;
+	// OUT: sent every packet. IN: last packet received
+	uint8_t data[3072];
+	uint32_t last_size;
+} DcdSimIsoStream;
+
+extern void DcdSim_AddIsoStream(DcdSimIsoStream* stream);
+extern void DcdSim_ClearIsoStreams(void);
+extern void DcdSim_NextFrame(void);
+extern uint32_t DcdSim_FrameCount(void);
+// firmware time in ns
+extern uint64_t DcdSim_Now(void);
+
+// adds a sample to a named cost profile printed by DcdSim_Report(). 'name'
+// must be a string literal.
+extern void DcdSim_Sample(const char* name, uint64_t ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/*
+
+	DCDSim stand-in for the Audio example's logger.h, which the device
+	class and standard request code include. The calls land in simapp.c.
+
+*/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// byte access helpers from the example's apptypes.h
+typedef struct _ByteByte
+{
+	uint8_t lobyte;
+	uint8_t hibyte;
+} __attribute__((packed)) ByteByte;
+
+typedef struct _WordByte
+{
+	union
+	{
+		ByteByte bval;
+		uint16_t wval;
+	};
+} __attribute__((packed)) WordByte;
+
+typedef struct _LongByte
+{
+	union
+	{
+		uint8_t bval[4];
+		uint32_t lval;
+	};
+} __attribute__((packed)) LongByte;
+
+//-----------------------------------------------------------------------------
+typedef enum _state_index
+{
+	eTarget,
+	eEnabled,
+	eDisabled,
+	eGetSampleRate,
+	eGetSampleRateNoData,
+	eSetSampleRate,
+	eSetSampleRateNoData,
+	eGetSetInterfaceProperty,
+	eUnknownEndpointProperty,
+	eUnknownInterfaceProperty,
+	eOtherEndpointProperty,
+	eConfigureEndpoints,
+	eGetDescriptor,
+	eREQ_GetStatus,
+	eREQ_ClearFeature,
+	eREQ_SetFeature,
+	eREQ_SetAddress,
+	eREQ_GetDescriptor,
+	eREQ_GetConfiguration,
+	eREQ_SetConfiguration,
+	eREQ_Unknown,
+	eGet_DeviceQualifier_Descriptor,
+	eGet_Unknown_Descriptor,
+	MaxStates
+} state_index;
+
+//-----------------------------------------------------------------------------
+extern void Log(int index,int v1,int v2, int v3);
+extern void LogReq(const char* psz,int v1,int v2, int v3,int v4,int v5);
+extern void Log5F(const char* file,int line,const char* psz,int v1,int v2, int v3,int v4,int v5);
+extern void Log5(const char* psz,int v1,int v2, int v3,int v4,int v5);
+extern void Log3(const char* psz,int v1,int v2, int v3);
+extern void LogUSB(const char* file,int line,void* packet,int packet_size);
+
+#endif
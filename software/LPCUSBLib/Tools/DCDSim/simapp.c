@@ -0,0 +1,687 @@
+/*
+
+	DCDSim device side. One firmware image with six personalities:
+
+		audio-in	UAC1 microphone, 48kHz 16 bit stereo ISO IN
+		audio-hb	UAC1 microphone, 192kHz 24 bit 32 channels on a
+					high-bandwidth ISO IN endpoint (high speed only)
+		audio-out	UAC1 speaker, 48kHz 16 bit stereo ISO OUT with an
+					asynchronous feedback endpoint
+		msc			bulk only mass storage over a 16MB RAM disk
+		cdc			virtual serial port echoing everything it receives
+		cdc-stream	the same in the CDC driver's streaming mode, through
+					ping-pong TX buffers and an RX ring
+		in-submit	the cdc echo sending the first bytes as a packet with
+					Endpoint_ClearIN() and submitting the rest as a
+					transfer straight behind it
+
+	The class drivers are the library's; everything here is what an
+	example application would supply. Buffers the controller DMAs into
+	are static, see dcdsim.h.
+
+*/
+
+#include <string.h>
+#include "USB.h"
+#include "logger.h"
+#include "dcdsim.h"
+#include "simapp.h"
+
+SimAppStats simapp_stats;
+
+static SimPersonality personality;
+static int use_fullspeed;
+static int use_events;
+static uint64_t irq_off_ns;
+static volatile int task_pending;
+static uint64_t setup_ns;
+
+//-----------------------------------------------------------------------------
+// descriptors. Bulk wMaxPacketSize and the feedback endpoint are patched
+// for the bus speed on request.
+
+static const uint8_t device_descriptor[18] =
+{
+	18, DTYPE_Device, 0x00, 0x02,
+	0x00, 0x00, 0x00, FIXED_CONTROL_ENDPOINT_SIZE,
+	0xC9, 0x1F, 0x89, 0x00,			// NXP VID, PID
+	0x00, 0x01, 1, 2, 0, 1
+};
+
+#define AUDIO_FORMAT_TYPE_I \
+	11, 0x24, 0x02, 0x01, 2, 2, 16, 1, 0x80, 0xBB, 0x00
+
+static uint8_t audio_in_config[] =
+{
+	9, DTYPE_Configuration, 100, 0, 2, 1, 0, 0x80, 50,
+	// audio control
+	9, DTYPE_Interface, 0, 0, 0, 0x01, 0x01, 0x00, 0,
+	9, 0x24, 0x01, 0x00, 0x01, 30, 0, 1, 1,
+	12, 0x24, 0x02, 1, 0x01, 0x02, 0, 2, 0x03, 0x00, 0, 0,	// microphone
+	9, 0x24, 0x03, 2, 0x01, 0x01, 0, 1, 0,					// USB streaming
+	// audio streaming, alt 1 streams
+	9, DTYPE_Interface, 1, 0, 0, 0x01, 0x02, 0x00, 0,
+	9, DTYPE_Interface, 1, 1, 1, 0x01, 0x02, 0x00, 0,
+	7, 0x24, 0x01, 2, 1, 0x01, 0x00,
+	AUDIO_FORMAT_TYPE_I,
+	9, DTYPE_Endpoint, 0x80 | SIM_AUDIO_STREAM_EP, 0x05, SIM_AUDIO_EP_SIZE & 0xFF, SIM_AUDIO_EP_SIZE >> 8, 1, 0, 0,
+	7, 0x25, 0x01, 0x01, 0, 0, 0
+};
+
+static uint8_t audio_in_hb_config[] =
+{
+	9, DTYPE_Configuration, 100, 0, 2, 1, 0, 0x80, 50,
+	9, DTYPE_Interface, 0, 0, 0, 0x01, 0x01, 0x00, 0,
+	9, 0x24, 0x01, 0x00, 0x01, 30, 0, 1, 1,
+	12, 0x24, 0x02, 1, 0x01, 0x02, 0, 32, 0x00, 0x00, 0, 0,
+	9, 0x24, 0x03, 2, 0x01, 0x01, 0, 1, 0,
+	9, DTYPE_Interface, 1, 0, 0, 0x01, 0x02, 0x00, 0,
+	9, DTYPE_Interface, 1, 1, 1, 0x01, 0x02, 0x00, 0,
+	7, 0x24, 0x01, 2, 1, 0x01, 0x00,
+	11, 0x24, 0x02, 0x01, 32, 3, 24, 1, 0x00, 0xEE, 0x02,
+	9, DTYPE_Endpoint, 0x80 | SIM_AUDIO_STREAM_EP, 0x05, SIM_AUDIO_HB_EP_SIZE & 0xFF, SIM_AUDIO_HB_EP_SIZE >> 8, 1, 0, 0,
+	7, 0x25, 0x01, 0x01, 0, 0, 0
+};
+
+static uint8_t audio_out_config[] =
+{
+	9, DTYPE_Configuration, 109, 0, 2, 1, 0, 0x80, 50,
+	9, DTYPE_Interface, 0, 0, 0, 0x01, 0x01, 0x00, 0,
+	9, 0x24, 0x01, 0x00, 0x01, 30, 0, 1, 1,
+	12, 0x24, 0x02, 1, 0x01, 0x01, 0, 2, 0x03, 0x00, 0, 0,	// USB streaming
+	9, 0x24, 0x03, 2, 0x01, 0x03, 0, 1, 0,					// speaker
+	9, DTYPE_Interface, 1, 0, 0, 0x01, 0x02, 0x00, 0,
+	9, DTYPE_Interface, 1, 1, 2, 0x01, 0x02, 0x00, 0,
+	7, 0x24, 0x01, 1, 1, 0x01, 0x00,
+	AUDIO_FORMAT_TYPE_I,
+	9, DTYPE_Endpoint, SIM_AUDIO_STREAM_EP, 0x05, SIM_AUDIO_EP_SIZE & 0xFF, SIM_AUDIO_EP_SIZE >> 8, 1, 0,
+	0x80 | SIM_AUDIO_FEEDBACK_EP,
+	7, 0x25, 0x01, 0x01, 0, 0, 0,
+	// feedback, bRefresh patched per speed
+	9, DTYPE_Endpoint, 0x80 | SIM_AUDIO_FEEDBACK_EP, 0x01, 4, 0, 1, 3, 0
+};
+
+static uint8_t msc_config[] =
+{
+	9, DTYPE_Configuration, 32, 0, 1, 1, 0, 0x80, 50,
+	9, DTYPE_Interface, 0, 0, 2, 0x08, 0x06, 0x50, 0,
+	7, DTYPE_Endpoint, 0x80 | SIM_BULK_IN_EP, 0x02, 0, 2, 0,
+	7, DTYPE_Endpoint, SIM_BULK_OUT_EP, 0x02, 0, 2, 0
+};
+
+static uint8_t cdc_config[] =
+{
+	9, DTYPE_Configuration, 62, 0, 2, 1, 0, 0x80, 50,
+	9, DTYPE_Interface, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+	5, 0x24, 0x00, 0x10, 0x01,
+	4, 0x24, 0x02, 0x06,
+	5, 0x24, 0x06, 0, 1,
+	7, DTYPE_Endpoint, 0x80 | SIM_CDC_NOTIFY_EP, 0x03, 8, 0, 0xFF,
+	9, DTYPE_Interface, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+	7, DTYPE_Endpoint, 0x80 | SIM_BULK_IN_EP, 0x02, 0, 2, 0,
+	7, DTYPE_Endpoint, SIM_BULK_OUT_EP, 0x02, 0, 2, 0
+};
+
+static const char* const product_names[] =
+{
+	"DCDSim Microphone", "DCDSim Speaker", "DCDSim Disk", "DCDSim Serial", "DCDSim HB Microphone",
+	"DCDSim Serial", "DCDSim Serial"
+};
+
+static uint8_t string_descriptor[2 + 2 * 32];
+
+static uint16_t Sim_String(const char* s, const void** const address)
+{
+	uint32_t n = 0;
+	while (s[n] && n < 32)
+	{
+		string_descriptor[2 + 2 * n] = (uint8_t) s[n];
+		string_descriptor[3 + 2 * n] = 0;
+		n++;
+	}
+	string_descriptor[0] = (uint8_t) (2 + 2 * n);
+	string_descriptor[1] = DTYPE_String;
+	*address = string_descriptor;
+	return string_descriptor[0];
+}
+
+// set every bulk endpoint's wMaxPacketSize for the negotiated speed
+static void Sim_PatchBulk(uint8_t* config, uint32_t size, uint16_t mps)
+{
+	uint32_t i;
+	for (i = 0; i + 6 < size; i += config[i])
+	{
+		if (config[i + 1] == DTYPE_Endpoint && (config[i + 3] & 3) == EP_TYPE_BULK)
+		{
+			config[i + 4] = mps & 0xFF;
+			config[i + 5] = mps >> 8;
+		}
+	}
+}
+
+uint16_t CALLBACK_USB_GetDescriptor(uint8_t corenum, const uint16_t wValue, const uint8_t wIndex,
+                                    const void** const DescriptorAddress)
+{
+	bool hs = USB_Device_IsHighSpeed(corenum);
+	uint8_t* config;
+	uint16_t size;
+	(void) wIndex;
+	switch (wValue >> 8)
+	{
+	case DTYPE_Device:
+		*DescriptorAddress = device_descriptor;
+		return sizeof(device_descriptor);
+	case DTYPE_Configuration:
+		switch (personality)
+		{
+		case SIM_AUDIO_IN:	config = audio_in_config;	size = sizeof(audio_in_config);		break;
+		case SIM_AUDIO_HB:	config = audio_in_hb_config; size = sizeof(audio_in_hb_config); break;
+		case SIM_AUDIO_OUT:	config = audio_out_config;	size = sizeof(audio_out_config);
+			// feedback every 8 (micro)frames, 4 byte 16.16 at high speed, 3 byte 10.14 at full
+			config[size - 5] = hs ? 4 : 3;
+			config[size - 2] = 3;
+			break;
+		case SIM_MSC:		config = msc_config;		size = sizeof(msc_config);			break;
+		default:			config = cdc_config;		size = sizeof(cdc_config);			break;
+		}
+		Sim_PatchBulk(config, size, hs ? 512 : 64);
+		*DescriptorAddress = config;
+		return size;
+	case DTYPE_String:
+		switch (wValue & 0xFF)
+		{
+		case 0:
+			string_descriptor[0] = 4;
+			string_descriptor[1] = DTYPE_String;
+			string_descriptor[2] = 0x09;
+			string_descriptor[3] = 0x04;
+			*DescriptorAddress = string_descriptor;
+			return 4;
+		case 1:
+			return Sim_String("NXP", DescriptorAddress);
+		case 2:
+			return Sim_String(product_names[personality], DescriptorAddress);
+		}
+		break;
+	}
+	return NO_DESCRIPTOR;
+}
+
+//-----------------------------------------------------------------------------
+// class instances. Bulk endpoint sizes follow the bus speed, so one of each
+// per speed and the active one is picked when the host configures. The
+// microphone has one per endpoint size.
+
+#define SIM_MICROPHONE_CONFIG(size) \
+	{ .Config = { .ControlInterfaceNumber = 0, .StreamingInterfaceNumber = 1, \
+		.DataINEndpointNumber = SIM_AUDIO_STREAM_EP, .DataINEndpointSize = size, \
+		.PortNumber = 0 } }
+
+static USB_ClassInfo_Audio_Device_t Microphones[2] =
+{
+	SIM_MICROPHONE_CONFIG(SIM_AUDIO_EP_SIZE), SIM_MICROPHONE_CONFIG(SIM_AUDIO_HB_EP_SIZE)
+};
+static USB_ClassInfo_Audio_Device_t* Microphone = &Microphones[0];
+
+static USB_ClassInfo_Audio_Device_t Speaker =
+{
+	.Config =
+	{
+		.ControlInterfaceNumber		= 0,
+		.StreamingInterfaceNumber	= 1,
+		.DataOUTEndpointNumber		= SIM_AUDIO_STREAM_EP,
+		.DataOUTEndpointSize		= SIM_AUDIO_EP_SIZE,
+		.DataFeedbackEndpointNumber	= SIM_AUDIO_FEEDBACK_EP,
+		.PortNumber					= 0,
+	},
+};
+
+#define SIM_MSC_CONFIG(size) \
+	{ .Config = { .InterfaceNumber = 0, \
+		.DataINEndpointNumber = SIM_BULK_IN_EP, .DataINEndpointSize = size, \
+		.DataOUTEndpointNumber = SIM_BULK_OUT_EP, .DataOUTEndpointSize = size, \
+		.TotalLUNs = 1, .PortNumber = 0 } }
+
+#define SIM_CDC_CONFIG(size) \
+	{ .Config = { .ControlInterfaceNumber = 0, \
+		.DataINEndpointNumber = SIM_BULK_IN_EP, .DataINEndpointSize = size, \
+		.DataOUTEndpointNumber = SIM_BULK_OUT_EP, .DataOUTEndpointSize = size, \
+		.NotificationEndpointNumber = SIM_CDC_NOTIFY_EP, .NotificationEndpointSize = 8, \
+		.PortNumber = 0 } }
+
+static USB_ClassInfo_MS_Device_t Disks[2] = { SIM_MSC_CONFIG(64), SIM_MSC_CONFIG(512) };
+#define SIM_CDC_STREAM_CONFIG(size) \
+	{ .Config = { .ControlInterfaceNumber = 0, \
+		.DataINEndpointNumber = SIM_BULK_IN_EP, .DataINEndpointSize = size, \
+		.DataOUTEndpointNumber = SIM_BULK_OUT_EP, .DataOUTEndpointSize = size, \
+		.NotificationEndpointNumber = SIM_CDC_NOTIFY_EP, .NotificationEndpointSize = 8, \
+		.PortNumber = 0, \
+		.TxBuffer = cdc_tx, .TxBufferSize = SIM_CDC_TX_HALF, \
+		.RxBuffer = cdc_rx, .RxPackets = SIM_CDC_RX_PACKETS } }
+
+static uint8_t cdc_tx[2 * SIM_CDC_TX_HALF];
+static uint8_t cdc_rx[SIM_CDC_RX_PACKETS * 512];
+
+static USB_ClassInfo_CDC_Device_t Serials[2] = { SIM_CDC_CONFIG(64), SIM_CDC_CONFIG(512) };
+static USB_ClassInfo_CDC_Device_t StreamSerials[2] = { SIM_CDC_STREAM_CONFIG(64), SIM_CDC_STREAM_CONFIG(512) };
+static USB_ClassInfo_MS_Device_t* Disk = &Disks[0];
+static USB_ClassInfo_CDC_Device_t* Serial = &Serials[0];
+
+void EVENT_USB_Device_ConfigurationChanged(void)
+{
+	bool hs = USB_Device_IsHighSpeed(0);
+	switch (personality)
+	{
+	case SIM_AUDIO_IN:
+	case SIM_AUDIO_HB:
+		Microphone = &Microphones[personality == SIM_AUDIO_HB];
+		Audio_Device_ConfigureEndpoints(Microphone);
+		break;
+	case SIM_AUDIO_OUT:
+		Audio_Device_ConfigureEndpoints(&Speaker);
+		break;
+	case SIM_MSC:
+		Disk = &Disks[hs];
+		MS_Device_ConfigureEndpoints(Disk);
+		break;
+	case SIM_CDC:
+	case SIM_CDC_STREAM:
+	case SIM_IN_SUBMIT:
+		Serial = personality != SIM_CDC_STREAM ? &Serials[hs] : &StreamSerials[hs];
+		CDC_Device_ConfigureEndpoints(Serial);
+		break;
+	}
+}
+
+// from the ISR when a SETUP is waiting. Stamped in either mode so polling
+// and event mode can be compared.
+void EVENT_USB_Device_TaskPending(const uint8_t corenum)
+{
+	(void) corenum;
+	setup_ns = DcdSim_Now();
+	task_pending = 1;
+}
+
+void EVENT_USB_Device_ControlRequest(void)
+{
+	DcdSim_Sample("SETUP -> task", DcdSim_Now() - setup_ns);
+	switch (personality)
+	{
+	case SIM_AUDIO_IN:
+	case SIM_AUDIO_HB:	Audio_Device_ProcessControlRequest(Microphone);		break;
+	case SIM_AUDIO_OUT:	Audio_Device_ProcessControlRequest(&Speaker);		break;
+	case SIM_MSC:		MS_Device_ProcessControlRequest(Disk);				break;
+	case SIM_CDC:
+	case SIM_CDC_STREAM:
+	case SIM_IN_SUBMIT:	CDC_Device_ProcessControlRequest(Serial);		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// audio. The microphone sends a ramp, the speaker's sink plays exactly the
+// nominal rate so the feedback settles on it.
+
+// one more buffer than the DCD keeps queued, see USB_ISO_DTDS
+#define AUDIO_BUFFERS		(USB_ISO_DTDS + 1)
+static uint8_t audio_buffers[AUDIO_BUFFERS][SIM_AUDIO_HB_PACKET] __attribute__((aligned(4)));
+static uint32_t audio_next;
+static uint32_t samples_played;
+static int16_t ramp;
+
+bool CALLBACK_Audio_Device_GetSetEndpointProperty(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+                                                  const uint8_t EndpointProperty,
+                                                  const uint8_t EndpointAddress,
+                                                  const uint8_t EndpointControl,
+                                                  uint16_t* const DataLength,
+                                                  uint8_t* Data)
+{
+	(void) AudioInterfaceInfo; (void) EndpointAddress;
+	if (EndpointControl != AUDIO_EPCONTROL_SamplingFreq)
+	{
+		return false;
+	}
+	if (DataLength && Data && EndpointProperty == AUDIO_REQ_GetCurrent)
+	{
+		Data[0] = 0x80;
+		Data[1] = 0xBB;
+		Data[2] = 0x00;
+		*DataLength = 3;
+	}
+	return true;
+}
+
+bool CALLBACK_Audio_Device_GetSetInterfaceProperty(USB_ClassInfo_Audio_Device_t* const AudioInterfaceInfo,
+                                                   const uint8_t InterfaceIndex,
+                                                   const uint8_t EntityIndex,
+                                                   const uint8_t ControlIndex,
+                                                   uint16_t* const DataLength,
+                                                   uint8_t* Data)
+{
+	(void) AudioInterfaceInfo; (void) InterfaceIndex; (void) EntityIndex;
+	(void) ControlIndex; (void) DataLength; (void) Data;
+	return false;
+}
+
+uint32_t CALLBACK_HAL_GetISOBufferAddress(const uint32_t EPNum, uint32_t* last_packet_size)
+{
+	uint8_t* buffer = audio_buffers[audio_next];
+	audio_next = (audio_next + 1) % AUDIO_BUFFERS;
+	if (personality == SIM_AUDIO_OUT)
+	{
+		if (EPNum == SIM_AUDIO_FEEDBACK_EP)
+		{
+			simapp_stats.feedback = Speaker.State.FeedbackValue;
+			return Audio_Device_GetFeedbackBuffer(&Speaker, last_packet_size);
+		}
+		if (*last_packet_size)
+		{
+			simapp_stats.iso_out_packets++;
+			simapp_stats.iso_out_bytes += *last_packet_size;
+		}
+	}
+	else if (personality == SIM_AUDIO_HB)
+	{
+		uint32_t i;
+		for (i = 0; i < SIM_AUDIO_HB_PACKET; i++)
+		{
+			buffer[i] = (uint8_t) ramp++;
+		}
+		*last_packet_size = SIM_AUDIO_HB_PACKET;
+		simapp_stats.iso_in_packets++;
+	}
+	else
+	{
+		uint32_t samples = USB_Device_IsHighSpeed(0) ? 6 : 48, i;
+		int16_t* p = (int16_t*) buffer;
+		for (i = 0; i < samples; i++)
+		{
+			*p++ = ramp;
+			*p++ = ramp++;
+		}
+		*last_packet_size = samples * 4;
+		simapp_stats.iso_in_packets++;
+	}
+	return (uint32_t) (uintptr_t) buffer;
+}
+
+void EVENT_USB_Device_StartOfFrame(void)
+{
+	if (personality == SIM_AUDIO_OUT && Speaker.State.InterfaceEnabled)
+	{
+		samples_played += Speaker.State.HighSpeed ? 6 : 48;
+		Audio_Device_FeedbackSOF(&Speaker, samples_played, 0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// SCSI over a RAM disk. READ/WRITE(10) move the whole command straight
+// between the disk and the endpoint as one Endpoint_SubmitTransfer().
+
+#define DISK_BLOCK			512
+
+static uint8_t disk[SIM_DISK_BLOCKS * DISK_BLOCK] __attribute__((aligned(4096)));
+
+static const uint8_t inquiry_data[36] =
+{
+	0x00, 0x80, 0x00, 0x02, 31, 0, 0, 0,
+	'N', 'X', 'P', ' ', ' ', ' ', ' ', ' ',
+	'D', 'C', 'D', 'S', 'i', 'm', ' ', 'D', 'i', 's', 'k', ' ', ' ', ' ', ' ', ' ',
+	'1', '.', '0', '0'
+};
+
+static uint8_t sense_key;
+
+const uint8_t* SimApp_Disk(void)
+{
+	return disk;
+}
+
+static void SCSI_Reply(USB_ClassInfo_MS_Device_t* const info, const void* data, uint16_t size)
+{
+	uint32_t want = le32_to_cpu(info->State.CommandBlock.DataTransferLength);
+	if (size > want)
+	{
+		size = (uint16_t) want;
+	}
+	Endpoint_Write_Stream_LE(info->Config.PortNumber, data, size, NULL);
+	Endpoint_ClearIN(info->Config.PortNumber);
+	info->State.CommandBlock.DataTransferLength = cpu_to_le32(want - size);
+}
+
+static bool SCSI_ReadWrite(USB_ClassInfo_MS_Device_t* const info, bool read)
+{
+	const uint8_t* cdb = info->State.CommandBlock.SCSICommandData;
+	uint32_t lba = ((uint32_t) cdb[2] << 24) | ((uint32_t) cdb[3] << 16) | ((uint32_t) cdb[4] << 8) | cdb[5];
+	uint32_t blocks = ((uint32_t) cdb[7] << 8) | cdb[8];
+	uint8_t address = read ? (SIM_BULK_IN_EP | ENDPOINT_DIR_IN) : (SIM_BULK_OUT_EP | ENDPOINT_DIR_OUT);
+	Endpoint_Transfer_t transfer = { 0 };
+	if (lba + blocks > SIM_DISK_BLOCKS)
+	{
+		sense_key = SCSI_SENSE_KEY_ILLEGAL_REQUEST;
+		return false;
+	}
+	transfer.Buffer = &disk[lba * DISK_BLOCK];
+	transfer.Length = blocks * DISK_BLOCK;
+	if (Endpoint_SubmitTransfer(info->Config.PortNumber, address, &transfer) != ENDPOINT_RWSTREAM_NoError ||
+	    Endpoint_WaitTransfer(info->Config.PortNumber, address, &transfer) != ENDPOINT_RWSTREAM_NoError)
+	{
+		return false;
+	}
+	info->State.CommandBlock.DataTransferLength =
+		cpu_to_le32(le32_to_cpu(info->State.CommandBlock.DataTransferLength) - transfer.Actual);
+	return true;
+}
+
+bool CALLBACK_MS_Device_SCSICommandReceived(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
+{
+	static uint8_t reply[18];
+	uint32_t last = SIM_DISK_BLOCKS - 1;
+	bool ok = true;
+	simapp_stats.scsi_commands++;
+	switch (MSInterfaceInfo->State.CommandBlock.SCSICommandData[0])
+	{
+	case SCSI_CMD_INQUIRY:
+		SCSI_Reply(MSInterfaceInfo, inquiry_data, sizeof(inquiry_data));
+		break;
+	case SCSI_CMD_REQUEST_SENSE:
+		memset(reply, 0, sizeof(reply));
+		reply[0] = 0x70;
+		reply[2] = sense_key;
+		reply[7] = 10;
+		SCSI_Reply(MSInterfaceInfo, reply, 18);
+		sense_key = SCSI_SENSE_KEY_GOOD;
+		break;
+	case SCSI_CMD_READ_CAPACITY_10:
+		reply[0] = last >> 24;
+		reply[1] = last >> 16;
+		reply[2] = last >> 8;
+		reply[3] = last;
+		reply[4] = 0;
+		reply[5] = 0;
+		reply[6] = DISK_BLOCK >> 8;
+		reply[7] = DISK_BLOCK & 0xFF;
+		SCSI_Reply(MSInterfaceInfo, reply, 8);
+		break;
+	case SCSI_CMD_MODE_SENSE_6:
+		memset(reply, 0, 4);
+		reply[0] = 3;
+		SCSI_Reply(MSInterfaceInfo, reply, 4);
+		break;
+	case SCSI_CMD_TEST_UNIT_READY:
+	case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+	case SCSI_CMD_VERIFY_10:
+		MSInterfaceInfo->State.CommandBlock.DataTransferLength = 0;
+		break;
+	case SCSI_CMD_READ_10:
+		ok = SCSI_ReadWrite(MSInterfaceInfo, true);
+		break;
+	case SCSI_CMD_WRITE_10:
+		ok = SCSI_ReadWrite(MSInterfaceInfo, false);
+		break;
+	default:
+		sense_key = SCSI_SENSE_KEY_ILLEGAL_REQUEST;
+		ok = false;
+		break;
+	}
+	return ok;
+}
+
+//-----------------------------------------------------------------------------
+// CDC echo. Packet mode reads byte by byte the way the VirtualSerial example
+// does; streaming mode takes whatever the ring holds in one go.
+
+static char echo[512];
+static char stream_echo[SIM_CDC_TX_HALF];
+
+static void CDC_Echo(void)
+{
+	uint16_t n = 0;
+	while (n < sizeof(echo) && CDC_Device_BytesReceived(Serial))
+	{
+		echo[n++] = (char) CDC_Device_ReceiveByte(Serial);
+	}
+	if (n)
+	{
+		CDC_Device_SendData(Serial, echo, n);
+		simapp_stats.cdc_bytes += n;
+	}
+	CDC_Device_USBTask(Serial);
+}
+
+static void CDC_StreamEcho(void)
+{
+	uint16_t n = CDC_Device_ReceiveData(Serial, stream_echo, sizeof(stream_echo));
+	if (n)
+	{
+		CDC_Device_SendData(Serial, stream_echo, n);
+		simapp_stats.cdc_bytes += n;
+	}
+	CDC_Device_USBTask(Serial);
+}
+
+// The packet is still primed when the transfer is submitted, the host is
+// slow to read it, so the DCD has to queue the transfer behind it
+static Endpoint_Transfer_t echo_transfer;
+
+static void CDC_SubmitEcho(void)
+{
+	uint16_t n = 0, head;
+	while (n < sizeof(echo) && CDC_Device_BytesReceived(Serial))
+	{
+		echo[n++] = (char) CDC_Device_ReceiveByte(Serial);
+	}
+	if (n)
+	{
+		head = n < SIM_SUBMIT_HEAD ? n : SIM_SUBMIT_HEAD;
+		Endpoint_SelectEndpoint(0, SIM_BULK_IN_EP);
+		Endpoint_Write_Stream_LE(0, echo, head, NULL);
+		Endpoint_ClearIN(0);
+		if (n > head)
+		{
+			memset(&echo_transfer, 0, sizeof(echo_transfer));
+			echo_transfer.Buffer = (uint8_t*) echo + head;
+			echo_transfer.Length = n - head;
+			if (Endpoint_SubmitTransfer(0, ENDPOINT_DIR_IN | SIM_BULK_IN_EP, &echo_transfer) == ENDPOINT_RWSTREAM_NoError)
+			{
+				Endpoint_WaitTransfer(0, ENDPOINT_DIR_IN | SIM_BULK_IN_EP, &echo_transfer);
+			}
+		}
+		simapp_stats.cdc_bytes += n;
+	}
+	CDC_Device_USBTask(Serial);
+}
+
+//-----------------------------------------------------------------------------
+// the example's logger, unused here
+
+void Log(int index, int v1, int v2, int v3)									{ (void) index; (void) v1; (void) v2; (void) v3; }
+void LogReq(const char* psz, int v1, int v2, int v3, int v4, int v5)			{ (void) psz; (void) v1; (void) v2; (void) v3; (void) v4; (void) v5; }
+void Log5F(const char* file, int line, const char* psz, int v1, int v2, int v3, int v4, int v5)
+{
+	(void) file; (void) line; (void) psz; (void) v1; (void) v2; (void) v3; (void) v4; (void) v5;
+}
+void Log5(const char* psz, int v1, int v2, int v3, int v4, int v5)			{ (void) psz; (void) v1; (void) v2; (void) v3; (void) v4; (void) v5; }
+void Log3(const char* psz, int v1, int v2, int v3)							{ (void) psz; (void) v1; (void) v2; (void) v3; }
+void LogUSB(const char* file, int line, void* packet, int packet_size)		{ (void) file; (void) line; (void) packet; (void) packet_size; }
+
+//-----------------------------------------------------------------------------
+
+void SimApp_Select(SimPersonality p, int full_speed, int events, uint32_t irq_off_us)
+{
+	personality = p;
+	use_fullspeed = full_speed;
+	irq_off_ns = (uint64_t) irq_off_us * 1000;
+	use_events = events && (p == SIM_AUDIO_IN || p == SIM_AUDIO_OUT || p == SIM_AUDIO_HB);
+	Speaker.State.SampleRate = 48000;
+}
+
+#if defined(USB_CAPTURE_ENABLED)
+// the secondary channel a board would stream the capture out of
+static uint8_t capture[16 << 20];
+static uint32_t capture_used;
+
+const uint8_t* SimApp_Capture(uint32_t* size)
+{
+	*size = capture_used;
+	return capture;
+}
+#else
+const uint8_t* SimApp_Capture(uint32_t* size)
+{
+	*size = 0;
+	return 0;
+}
+#endif
+
+void SimApp_Firmware(void)
+{
+	uint64_t masked_v = 0;
+	USB_Init(0, USB_MODE_Device, use_fullspeed);
+	for (;;)
+	{
+		if (irq_off_ns && DcdSim_Now() - masked_v >= 1000000)
+		{
+			// a critical section (or a higher priority handler) that holds
+			// the USB interrupt off once a millisecond
+			masked_v = DcdSim_Now();
+			__disable_irq();
+			while (DcdSim_Now() - masked_v < irq_off_ns) ;
+			__enable_irq();
+			masked_v = DcdSim_Now();
+		}
+		if (use_events)
+		{
+			// what an RTOS task blocked on a semaphore would cost: nothing
+			// until the ISR has a request for us
+			uint64_t idle = DcdSim_Now();
+			while (!task_pending)
+			{
+				__WFI();
+			}
+			simapp_stats.idle_ns += DcdSim_Now() - idle;
+			simapp_stats.task_wakes++;
+			task_pending = 0;
+		}
+		switch (personality)
+		{
+		case SIM_MSC:
+			MS_Device_USBTask(Disk);
+			break;
+		case SIM_CDC:
+			CDC_Echo();
+			break;
+		case SIM_CDC_STREAM:
+			CDC_StreamEcho();
+			break;
+		case SIM_IN_SUBMIT:
+			CDC_SubmitEcho();
+			break;
+		default:
+			break;
+		}
+		USB_USBTask(0, USB_MODE_Device);
+#if defined(USB_CAPTURE_ENABLED)
+		capture_used += USB_Capture_Drain(capture + capture_used, sizeof(capture) - capture_used);
+#endif
+	}
+}
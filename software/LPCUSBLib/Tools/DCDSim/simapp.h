@@ -0,0 +1,83 @@
+/*
+
+	DCDSim device side: descriptors, class driver glue and the firmware
+	main loop for each personality. See dcdsim.h
+
+*/
+
+#ifndef SIMAPP_H
+#define SIMAPP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+typedef enum _SimPersonality
+{
+	SIM_AUDIO_IN,
+	SIM_AUDIO_OUT,
+	SIM_MSC,
+	SIM_CDC,
+	SIM_AUDIO_HB,
+	SIM_CDC_STREAM,
+	SIM_IN_SUBMIT
+} SimPersonality;
+
+// endpoint map shared with the host scenarios
+#define SIM_AUDIO_STREAM_EP		1
+#define SIM_AUDIO_FEEDBACK_EP	2
+#define SIM_AUDIO_EP_SIZE		196
+// high-bandwidth microphone, 32ch 24 bit 192kHz: 24 frames of 96 bytes a
+// microframe in 3 transactions of up to 1024
+#define SIM_AUDIO_HB_PACKET		2304
+#define SIM_AUDIO_HB_EP_SIZE	(1024 | (2 << 11))
+#define SIM_BULK_IN_EP			1
+#define SIM_BULK_OUT_EP			2
+#define SIM_CDC_NOTIFY_EP		3
+// streaming mode serial: TxBuffer halves and RxBuffer slots
+#define SIM_CDC_TX_HALF			4096
+#define SIM_CDC_RX_PACKETS		8
+// in-submit: bytes of each echo sent as a packet ahead of the transfer
+#define SIM_SUBMIT_HEAD			16
+#define SIM_DISK_BLOCKS			(16 * 2048)
+
+//-----------------------------------------------------------------------------
+typedef struct _SimAppStats
+{
+	// audio: packets the ISO callback handed out or took in
+	uint32_t iso_in_packets;
+	uint32_t iso_out_packets;
+	uint32_t iso_out_bytes;
+	// last feedback value the class driver reported
+	uint32_t feedback;
+	// msc
+	uint32_t scsi_commands;
+	// cdc
+	uint32_t cdc_bytes;
+	// event mode: times the main loop was woken and firmware time it slept
+	uint32_t task_wakes;
+	uint64_t idle_ns;
+} SimAppStats;
+
+extern SimAppStats simapp_stats;
+
+// events: the audio personalities sleep until EVENT_USB_Device_TaskPending()
+// instead of polling USB_USBTask(). MSC and CDC always poll, their class
+// tasks service the bulk endpoints. irq_off_us masks interrupts for that
+// long once a millisecond of firmware time, 0 never.
+extern void SimApp_Select(SimPersonality personality, int full_speed, int events, uint32_t irq_off_us);
+extern void SimApp_Firmware(void);
+// RAM disk contents for the host's verify pass
+extern const uint8_t* SimApp_Disk(void);
+// USB_Capture_Drain() output collected by the main loop, empty unless
+// built with -DUSB_CAPTURE=1
+extern const uint8_t* SimApp_Capture(uint32_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
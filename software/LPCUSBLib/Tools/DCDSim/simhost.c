@@ -0,0 +1,642 @@
+/*
+
+	DCDSim host: enumeration and the traffic scenarios, plus main().
+
+	Each scenario is plain blocking code on top of DcdSim_Setup/In/Out. A
+	NAK waits for the firmware to prime the endpoint (or a frame) and then
+	retries, which is what an EHCI/xHCI does for bulk and control. Like an
+	EHCI with the default interrupt threshold, a finished bulk transfer is
+	only reported at the next (micro)frame, and the next one the driver
+	submits goes out a (micro)frame after that. Control requests are
+	synchronous calls on a real host and come at most one per frame.
+
+	The frame spacing matters beyond realism: USB_Device_ProcessControlRequest()
+	stalls ep0 if a SETUP is pending when it finishes, so a SETUP that lands
+	before the main loop is done with the previous request is refused.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dcdsim.h"
+#include "simapp.h"
+
+#define HOST_TIMEOUT		1000000000ULL
+#define MSC_CHUNK_BLOCKS	128
+#define CDC_CHUNK			512
+#define CDC_STREAM_CHUNK	SIM_CDC_TX_HALF
+#define SUBMIT_HOST_DELAY	1000000ULL
+
+typedef enum _Scenario
+{
+	SCENARIO_ENUM,
+	SCENARIO_AUDIO_IN,
+	SCENARIO_AUDIO_OUT,
+	SCENARIO_MSC,
+	SCENARIO_CDC,
+	SCENARIO_AUDIO_HB,
+	SCENARIO_CDC_STREAM,
+	SCENARIO_IN_SUBMIT,
+	SCENARIO_COUNT
+} Scenario;
+
+static const char* const scenario_names[] = { "enum", "audio-in", "audio-out", "msc", "cdc", "audio-hb", "cdc-stream", "in-submit" };
+
+static Scenario scenario;
+static uint32_t seconds = 2;
+static uint32_t mbytes = 4;
+
+static uint8_t address;
+static uint16_t ep0_size = 64;
+static uint16_t ep_size[16];
+static uint64_t frame_ns;
+
+// results, printed once the host is done
+static struct
+{
+	const char* error;
+	int error_code;
+	uint32_t controls;
+	uint32_t zlps;
+	double write_mbs;
+	double read_mbs;
+	uint32_t mismatches;
+	DcdSimIsoStream stream;
+	DcdSimIsoStream feedback;
+	uint32_t feedback_packets;
+	double feedback_rate;
+} result;
+
+static uint8_t buffer[MSC_CHUNK_BLOCKS * 512];
+static uint8_t verify[MSC_CHUNK_BLOCKS * 512];
+
+//-----------------------------------------------------------------------------
+
+// completion interrupt at the next (micro)frame, resubmission in the one
+// after
+static void Host_Complete(void)
+{
+	DcdSim_NextFrame();
+	DcdSim_NextFrame();
+}
+
+static void Host_CompleteControl(void)
+{
+	uint32_t frames = frame_ns == 125000 ? 8 : 1;
+	while (frames--)
+	{
+		DcdSim_NextFrame();
+	}
+}
+
+static int Fail(const char* what, int code)
+{
+	if (!result.error)
+	{
+		result.error = what;
+		result.error_code = code;
+	}
+	return -1;
+}
+
+// one packet, retrying NAKs
+static int Host_Packet(int in, uint8_t ep, uint8_t* data, uint32_t size)
+{
+	uint64_t give_up = DcdSim_Now() + HOST_TIMEOUT;
+	for (;;)
+	{
+		int rc = in ? DcdSim_In(address, ep, data, size) : DcdSim_Out(address, ep, data, size);
+		if (rc != DCDSIM_NAK)
+		{
+			return rc;
+		}
+		if (DcdSim_Now() > give_up)
+		{
+			return DCDSIM_TIMEOUT;
+		}
+		DcdSim_WaitPrimed(ep, (uint8_t) in, frame_ns);
+	}
+}
+
+static int Host_Control(uint8_t type, uint8_t request, uint16_t value, uint16_t index, uint16_t length, uint8_t* data)
+{
+	uint8_t setup[8] = { type, request, value & 0xFF, value >> 8, index & 0xFF, index >> 8, length & 0xFF, length >> 8 };
+	uint64_t start = DcdSim_Now();
+	uint32_t total = 0;
+	int rc = DcdSim_Setup(address, setup);
+	if (rc < 0)
+	{
+		return rc;
+	}
+	// an EHCI sends an OUT data stage straight after the SETUP. The DCD
+	// loses it if it completes before the main loop has fetched the SETUP
+	// (Endpoint_GetSetupPackage() clears IsOutReceived), so hold it a
+	// (micro)frame to keep the scenarios going
+	if (!(type & 0x80) && length)
+	{
+		DcdSim_NextFrame();
+	}
+	while (total < length)
+	{
+		uint32_t n = length - total < ep0_size ? length - total : ep0_size;
+		rc = Host_Packet(type & 0x80, 0, data + total, n);
+		if (rc < 0)
+		{
+			return rc;
+		}
+		if (type & 0x80)
+		{
+			total += rc;
+			if ((uint32_t) rc < ep0_size)
+			{
+				break;
+			}
+		}
+		else
+		{
+			total += n;
+		}
+	}
+	// status stage in the other direction
+	rc = Host_Packet(!(type & 0x80) || !length, 0, NULL, 0);
+	if (rc < 0)
+	{
+		return rc;
+	}
+	Host_CompleteControl();
+	result.controls++;
+	DcdSim_Sample("control transfer", DcdSim_Now() - start);
+	return (int) total;
+}
+
+static int Host_Bulk(int in, uint8_t ep, uint8_t* data, uint32_t length)
+{
+	uint32_t total = 0, mps = ep_size[ep];
+	while (total < length)
+	{
+		uint32_t n = length - total < mps ? length - total : mps;
+		int rc = Host_Packet(in, ep, data + total, n);
+		if (rc < 0)
+		{
+			return rc;
+		}
+		total += rc;
+		if (in && (uint32_t) rc < mps)
+		{
+			break;
+		}
+	}
+	Host_Complete();
+	return (int) total;
+}
+
+//-----------------------------------------------------------------------------
+
+static void Parse_Config(const uint8_t* config, uint32_t size)
+{
+	uint32_t i;
+	for (i = 0; i + 1 < size && config[i]; i += config[i])
+	{
+		if (config[i + 1] == 0x05)
+		{
+			ep_size[config[i + 2] & 15] = (config[i + 4] | (config[i + 5] << 8)) & 0x7FF;
+		}
+	}
+}
+
+static int Enumerate(void)
+{
+	uint8_t descriptor[256];
+	int rc, hs;
+	if (!DcdSim_WaitAttach(1000))
+	{
+		return Fail("device never attached", 0);
+	}
+	hs = DcdSim_BusReset();
+	frame_ns = hs ? 125000 : 1000000;
+	address = 0;
+	rc = Host_Control(0x80, 6, 0x0100, 0, 64, descriptor);
+	if (rc < 8 || descriptor[1] != 1)
+	{
+		return Fail("GET_DESCRIPTOR(device)", rc);
+	}
+	ep0_size = descriptor[7];
+	if ((rc = Host_Control(0x00, 5, 1, 0, 0, NULL)) < 0)
+	{
+		return Fail("SET_ADDRESS", rc);
+	}
+	address = 1;
+	DcdSim_Sleep(2000000);
+	if ((rc = Host_Control(0x80, 6, 0x0100, 0, 18, descriptor)) != 18)
+	{
+		return Fail("GET_DESCRIPTOR(device) at the new address", rc);
+	}
+	if ((rc = Host_Control(0x80, 6, 0x0200, 0, 9, descriptor)) != 9)
+	{
+		return Fail("GET_DESCRIPTOR(configuration, 9)", rc);
+	}
+	rc = Host_Control(0x80, 6, 0x0200, 0, descriptor[2] | (descriptor[3] << 8), descriptor);
+	if (rc != (descriptor[2] | (descriptor[3] << 8)))
+	{
+		return Fail("GET_DESCRIPTOR(configuration)", rc);
+	}
+	Parse_Config(descriptor, rc);
+	if ((rc = Host_Control(0x80, 6, 0x0300, 0, 255, descriptor)) != 4 ||
+	    (rc = Host_Control(0x80, 6, 0x0302, 0x0409, 255, descriptor)) < 2)
+	{
+		return Fail("GET_DESCRIPTOR(string)", rc);
+	}
+	if ((rc = Host_Control(0x00, 9, 1, 0, 0, NULL)) < 0)
+	{
+		return Fail("SET_CONFIGURATION", rc);
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+
+static int Run_Enum(void)
+{
+	uint8_t descriptor[64];
+	uint32_t i;
+	int rc;
+	// steady state control traffic
+	for (i = 0; i < 1000; i++)
+	{
+		if ((rc = Host_Control(0x80, 6, 0x0100, 0, 18, descriptor)) != 18)
+		{
+			return Fail("GET_DESCRIPTOR(device) loop", rc);
+		}
+	}
+	return 0;
+}
+
+static int Run_Audio(int in, int high_bandwidth)
+{
+	uint32_t frames = seconds * (uint32_t) (1000000000ULL / frame_ns), end, packet;
+	uint8_t rate[3] = { 0x80, 0xBB, 0x00 };
+	int rc;
+	if ((rc = Host_Control(0x01, 11, 1, 1, 0, NULL)) < 0)
+	{
+		return Fail("SET_INTERFACE(1, 1)", rc);
+	}
+	if ((rc = Host_Control(0x22, 0x01, 0x0100, in ? 0x80 | SIM_AUDIO_STREAM_EP : SIM_AUDIO_STREAM_EP, 3, rate)) < 0)
+	{
+		return Fail("SET_CUR(sampling frequency)", rc);
+	}
+	packet = (frame_ns == 125000 ? 6 : 48) * 4;
+	if (high_bandwidth)
+	{
+		if (frame_ns != 125000)
+		{
+			return Fail("high-bandwidth isochronous needs high speed", 0);
+		}
+		packet = SIM_AUDIO_HB_PACKET;
+	}
+	memset(&result.stream, 0, sizeof(result.stream));
+	result.stream.ep = SIM_AUDIO_STREAM_EP;
+	result.stream.in = (uint8_t) in;
+	result.stream.packet_size = packet;
+	DcdSim_AddIsoStream(&result.stream);
+	if (!in)
+	{
+		memset(&result.feedback, 0, sizeof(result.feedback));
+		result.feedback.ep = SIM_AUDIO_FEEDBACK_EP;
+		result.feedback.in = 1;
+		result.feedback.interval = 8;
+		DcdSim_AddIsoStream(&result.feedback);
+	}
+	end = DcdSim_FrameCount() + frames;
+	while (DcdSim_FrameCount() < end)
+	{
+		DcdSim_NextFrame();
+	}
+	DcdSim_ClearIsoStreams();
+	if (result.stream.pid_errors)
+	{
+		return Fail("high-bandwidth data PID sequence", (int) result.stream.pid_errors);
+	}
+	if (!in && result.feedback.last_size)
+	{
+		const uint8_t* f = result.feedback.data;
+		uint32_t value = f[0] | (f[1] << 8) | (f[2] << 16) | (result.feedback.last_size > 3 ? f[3] << 24 : 0);
+		// 16.16 per microframe or 10.14 per frame, in Hz
+		result.feedback_rate = frame_ns == 125000 ? value / 65536.0 * 8000 : value / 16384.0 * 1000;
+	}
+	if ((rc = Host_Control(0x01, 11, 0, 1, 0, NULL)) < 0)
+	{
+		return Fail("SET_INTERFACE(1, 0)", rc);
+	}
+	return 0;
+}
+
+static int MSC_Command(const uint8_t* cdb, uint8_t cdb_length, uint8_t* data, uint32_t length, int in)
+{
+	static uint32_t tag;
+	uint8_t cbw[31], csw[13];
+	int rc;
+	memset(cbw, 0, sizeof(cbw));
+	cbw[0] = 'U'; cbw[1] = 'S'; cbw[2] = 'B'; cbw[3] = 'C';
+	memcpy(&cbw[4], &(uint32_t) { ++tag }, 4);
+	memcpy(&cbw[8], &length, 4);
+	cbw[12] = in ? 0x80 : 0x00;
+	cbw[14] = cdb_length;
+	memcpy(&cbw[15], cdb, cdb_length);
+	if ((rc = Host_Bulk(0, SIM_BULK_OUT_EP, cbw, sizeof(cbw))) < 0)
+	{
+		return rc;
+	}
+	if (length && (rc = Host_Bulk(in, in ? SIM_BULK_IN_EP : SIM_BULK_OUT_EP, data, length)) != (int) length)
+	{
+		return rc < 0 ? rc : DCDSIM_TIMEOUT;
+	}
+	if ((rc = Host_Bulk(1, SIM_BULK_IN_EP, csw, sizeof(csw))) != sizeof(csw))
+	{
+		return rc < 0 ? rc : DCDSIM_TIMEOUT;
+	}
+	if (memcmp(csw, "USBS", 4) || memcmp(&csw[4], &tag, 4))
+	{
+		return DCDSIM_TIMEOUT;
+	}
+	return csw[12];
+}
+
+static void MSC_Pattern(uint8_t* data, uint32_t lba, uint32_t blocks)
+{
+	uint32_t i;
+	for (i = 0; i < blocks * 512; i += 4)
+	{
+		uint32_t word = (lba + i / 512) * 0x9E3779B1u + i;
+		memcpy(&data[i], &word, 4);
+	}
+}
+
+static int Run_MSC(void)
+{
+	uint8_t cdb[10], reply[36];
+	uint32_t blocks = mbytes * 2048, lba;
+	uint64_t start;
+	int rc, pass;
+	if ((rc = Host_Control(0xA1, 0xFE, 0, 0, 1, reply)) != 1)
+	{
+		return Fail("GET_MAX_LUN", rc);
+	}
+	memset(cdb, 0, sizeof(cdb));
+	cdb[0] = 0x12;
+	cdb[4] = 36;
+	if ((rc = MSC_Command(cdb, 6, reply, 36, 1)) != 0)
+	{
+		return Fail("INQUIRY", rc);
+	}
+	memset(cdb, 0, sizeof(cdb));
+	if ((rc = MSC_Command(cdb, 6, NULL, 0, 0)) != 0)
+	{
+		return Fail("TEST UNIT READY", rc);
+	}
+	cdb[0] = 0x25;
+	if ((rc = MSC_Command(cdb, 10, reply, 8, 1)) != 0)
+	{
+		return Fail("READ CAPACITY(10)", rc);
+	}
+	if (blocks > SIM_DISK_BLOCKS)
+	{
+		blocks = SIM_DISK_BLOCKS;
+	}
+	for (pass = 0; pass < 2; pass++)
+	{
+		start = DcdSim_Now();
+		for (lba = 0; lba < blocks; lba += MSC_CHUNK_BLOCKS)
+		{
+			uint64_t t = DcdSim_Now();
+			memset(cdb, 0, sizeof(cdb));
+			cdb[0] = pass ? 0x28 : 0x2A;
+			cdb[2] = lba >> 24;
+			cdb[3] = lba >> 16;
+			cdb[4] = lba >> 8;
+			cdb[5] = lba;
+			cdb[7] = MSC_CHUNK_BLOCKS >> 8;
+			cdb[8] = MSC_CHUNK_BLOCKS & 0xFF;
+			if (!pass)
+			{
+				MSC_Pattern(buffer, lba, MSC_CHUNK_BLOCKS);
+			}
+			if ((rc = MSC_Command(cdb, 10, buffer, sizeof(buffer), pass)) != 0)
+			{
+				return Fail(pass ? "READ(10)" : "WRITE(10)", rc);
+			}
+			DcdSim_Sample(pass ? "MSC READ(10) 64KB" : "MSC WRITE(10) 64KB", DcdSim_Now() - t);
+			if (pass)
+			{
+				MSC_Pattern(verify, lba, MSC_CHUNK_BLOCKS);
+				result.mismatches += memcmp(buffer, verify, sizeof(buffer)) != 0;
+			}
+		}
+		*(pass ? &result.read_mbs : &result.write_mbs) = blocks * 512.0 / ((DcdSim_Now() - start) / 1e9) / 1e6;
+	}
+	return 0;
+}
+
+// Loopback: write a chunk, read it back. Packet mode echoes a packet at a
+// time and never ends a burst with a zero length packet, so its chunk is one
+// packet and the host reads exactly that. Streaming mode gets chunks the size
+// of a TX half and is read like a terminal program would, into a large buffer
+// that the short or zero length packet ending the burst completes. A slow
+// host leaves the echo SUBMIT_HOST_DELAY before it starts reading.
+static int Run_CDC(int stream, int slow)
+{
+	uint8_t coding[7] = { 0x00, 0xC2, 0x01, 0x00, 0, 0, 8 };
+	uint32_t chunk = stream ? CDC_STREAM_CHUNK : CDC_CHUNK;
+	uint32_t chunks = mbytes * (1048576 / chunk), i, n, zlps;
+	uint64_t start;
+	int rc;
+	if ((rc = Host_Control(0x21, 0x20, 0, 0, sizeof(coding), coding)) < 0)
+	{
+		return Fail("SET_LINE_CODING", rc);
+	}
+	if ((rc = Host_Control(0x21, 0x22, 3, 0, 0, NULL)) < 0)
+	{
+		return Fail("SET_CONTROL_LINE_STATE", rc);
+	}
+	start = DcdSim_Now();
+	for (i = 0; i < chunks; i++)
+	{
+		uint64_t t = DcdSim_Now();
+		MSC_Pattern(buffer, i * (chunk / 512), chunk / 512);
+		if ((rc = Host_Bulk(0, SIM_BULK_OUT_EP, buffer, chunk)) != (int) chunk)
+		{
+			return Fail("CDC OUT", rc);
+		}
+		if (slow)
+		{
+			DcdSim_Sleep(SUBMIT_HOST_DELAY);
+		}
+		// a zero length packet with nothing before it is a read that comes
+		// back empty; a terminal program just reads again
+		for (n = 0, zlps = 0; n < chunk; n += (uint32_t) rc)
+		{
+			if ((rc = Host_Bulk(1, SIM_BULK_IN_EP, verify + n, (stream ? sizeof(verify) : chunk) - n)) <= 0)
+			{
+				result.zlps++;
+				if (rc < 0 || ++zlps > 100)
+				{
+					return Fail("CDC IN", rc);
+				}
+				rc = 0;
+			}
+		}
+		result.mismatches += n != chunk || memcmp(buffer, verify, chunk) != 0;
+		if (stream)
+		{
+			DcdSim_Sample("CDC 4KB echo", DcdSim_Now() - t);
+		}
+		else
+		{
+			DcdSim_Sample("CDC 512 byte echo", DcdSim_Now() - t);
+		}
+	}
+	result.write_mbs = chunks * (double) chunk / ((DcdSim_Now() - start) / 1e9) / 1e6;
+	return 0;
+}
+
+static int Host_Main(void)
+{
+	if (Enumerate())
+	{
+		return -1;
+	}
+	switch (scenario)
+	{
+	case SCENARIO_ENUM:			return Run_Enum();
+	case SCENARIO_AUDIO_IN:		return Run_Audio(1, 0);
+	case SCENARIO_AUDIO_OUT:	return Run_Audio(0, 0);
+	case SCENARIO_AUDIO_HB:		return Run_Audio(1, 1);
+	case SCENARIO_MSC:			return Run_MSC();
+	case SCENARIO_CDC_STREAM:	return Run_CDC(1, 0);
+	case SCENARIO_IN_SUBMIT:	return Run_CDC(0, 1);
+	default:					return Run_CDC(0, 0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+static void Usage(void)
+{
+	fprintf(stderr, "usage: dcdsim [--fs] [--events] [--irq-off us] [--slowdown n] [--seconds n] [--mbytes n] [--capture file] enum|audio-in|audio-out|msc|cdc|audio-hb|cdc-stream|in-submit\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	static const SimPersonality personalities[] = { SIM_MSC, SIM_AUDIO_IN, SIM_AUDIO_OUT, SIM_MSC, SIM_CDC, SIM_AUDIO_HB, SIM_CDC_STREAM, SIM_IN_SUBMIT };
+	DcdSimOptions options = { 0, 1 };
+	int i, s = -1, rc, events = 0;
+	uint32_t irq_off_us = 0;
+	const char* capture = NULL;
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--fs"))
+		{
+			options.full_speed = 1;
+		}
+		else if (!strcmp(argv[i], "--events"))
+		{
+			events = 1;
+		}
+		else if (!strcmp(argv[i], "--irq-off") && i + 1 < argc)
+		{
+			irq_off_us = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--slowdown") && i + 1 < argc)
+		{
+			options.slowdown = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--mbytes") && i + 1 < argc)
+		{
+			mbytes = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+		{
+			capture = argv[++i];
+		}
+		else
+		{
+			for (s = 0; s < SCENARIO_COUNT && strcmp(argv[i], scenario_names[s]); s++) ;
+			if (s == SCENARIO_COUNT)
+			{
+				Usage();
+			}
+		}
+	}
+	if (s < 0)
+	{
+		Usage();
+	}
+	scenario = (Scenario) s;
+	SimApp_Select(personalities[s], options.full_speed, events, irq_off_us);
+	DcdSim_Init(&options);
+	rc = DcdSim_Run(Host_Main, SimApp_Firmware);
+
+	printf("dcdsim %s: %s", scenario_names[s], rc ? "FAILED" : "ok");
+	if (result.error)
+	{
+		printf(", %s (%d)", result.error, result.error_code);
+	}
+	printf(", %u control transfers\n", result.controls);
+	switch (scenario)
+	{
+	case SCENARIO_AUDIO_IN:
+	case SCENARIO_AUDIO_OUT:
+	case SCENARIO_AUDIO_HB:
+		printf("  ISO %s: %u packets, %u bytes, %u (micro)frames unprimed\n", s == SCENARIO_AUDIO_OUT ? "OUT" : "IN",
+		       result.stream.packets, result.stream.bytes, result.stream.missed);
+		if (s == SCENARIO_AUDIO_HB)
+		{
+			printf("  %u transactions, %u (micro)frames with the wrong data PID sequence\n",
+			       result.stream.transactions, result.stream.pid_errors);
+		}
+		if (s == SCENARIO_AUDIO_OUT)
+		{
+			printf("  firmware took %u packets, %u bytes; feedback %u packets, %u unprimed, last %.3f Hz\n",
+			       simapp_stats.iso_out_packets, simapp_stats.iso_out_bytes, result.feedback.packets,
+			       result.feedback.missed, result.feedback_rate);
+		}
+		break;
+	case SCENARIO_MSC:
+		printf("  %u MB written at %.2f MB/s, read back at %.2f MB/s, %u chunks mismatched, %u SCSI commands\n",
+		       mbytes, result.write_mbs, result.read_mbs, result.mismatches, simapp_stats.scsi_commands);
+		break;
+	case SCENARIO_CDC:
+	case SCENARIO_CDC_STREAM:
+	case SCENARIO_IN_SUBMIT:
+		printf("  %u MB echoed at %.2f MB/s each way, %u chunks mismatched, %u zero length reads\n", mbytes,
+		       result.write_mbs, result.mismatches, result.zlps);
+		break;
+	default:
+		break;
+	}
+	if (simapp_stats.task_wakes)
+	{
+		printf("  event mode: %u task wakes, firmware idle %.1f%% of %.3f s\n", simapp_stats.task_wakes,
+		       simapp_stats.idle_ns * 100.0 / DcdSim_Now(), DcdSim_Now() / 1e9);
+	}
+	DcdSim_Report();
+	if (capture)
+	{
+		uint32_t size;
+		const uint8_t* data = SimApp_Capture(&size);
+		FILE* f = fopen(capture, "wb");
+		if (!f || fwrite(data, 1, size, f) != size)
+		{
+			fprintf(stderr, "dcdsim: can't write %s\n", capture);
+			return 1;
+		}
+		fclose(f);
+		printf("  %u capture bytes in %s%s\n", size, capture, size ? "" : ", build with -DUSB_CAPTURE=1");
+	}
+	return rc || result.mismatches ? 1 : 0;
+}
@@ -0,0 +1,489 @@
+/*
+
+	HIDPlanCheck. Checks the compiled HID report plan
+	(USB_CompileHIDReportPlan() and USB_DecodeHIDReport() in
+	Drivers/USB/Class/Common/HIDParser.c) against the per item reference
+	path, USB_GetHIDReportItemInfo(), and times the two.
+
+	A set of report descriptors, the boot keyboard and mouse, a 20 byte
+	motion sensor report, a gamepad with report IDs and a descriptor that
+	mixes the encoded sizes of its logical minimum and maximum, is run
+	through the parser. For each descriptor:
+
+		- every input item's logical minimum reads back negative exactly
+		  when the descriptor gives it a negative minimum, whatever the
+		  item's encoded size
+		- the plan marks a field HID_FIELD_SIGNED exactly when its item
+		  is signed and narrower than 32 bits
+		- for random reports of every report ID, each decoded value
+		  equals the reference item value, sign extended from the item's
+		  size when the item is signed
+
+	The timing line gives the cost per report of decoding every input item
+	both ways.
+
+	Build and run, from software/LPCUSBLib:
+
+	gcc -O2 -D__LPC43XX__ -DUSB_HOST_ONLY -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast \
+		-ITools/DCDSim -I../lpc_core/lpc_ip -IDrivers/USB \
+		Tools/HIDPlanCheck/hidplancheck.c Drivers/USB/Class/Common/HIDParser.c -o hidplancheck
+	./hidplancheck [--seed n] [--reports n]
+
+	The exit status is 0 when every check held.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// As HIDParser.c does, so the header can be used without USB.h
+#define __INCLUDE_FROM_USB_DRIVER
+#define __INCLUDE_FROM_HID_DRIVER
+#include "Class/Common/HIDParser.h"
+
+//-------------------------------------------------------------------------
+
+// Boot keyboard, HID 1.11 appendix B.1: 8 modifier bits, 6 key codes, 5 LEDs.
+static const uint8_t KeyboardReport[] =
+{
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x06),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_USAGE_PAGE(8, 0x07),
+		HID_RI_USAGE_MINIMUM(8, 0xE0),
+		HID_RI_USAGE_MAXIMUM(8, 0xE7),
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),
+		HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+		HID_RI_REPORT_SIZE(8, 0x01),
+		HID_RI_REPORT_COUNT(8, 0x08),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_REPORT_COUNT(8, 0x01),
+		HID_RI_REPORT_SIZE(8, 0x08),
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),
+		HID_RI_USAGE_PAGE(8, 0x08),
+		HID_RI_USAGE_MINIMUM(8, 0x01),
+		HID_RI_USAGE_MAXIMUM(8, 0x05),
+		HID_RI_REPORT_COUNT(8, 0x05),
+		HID_RI_REPORT_SIZE(8, 0x01),
+		HID_RI_OUTPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NON_VOLATILE),
+		HID_RI_REPORT_COUNT(8, 0x01),
+		HID_RI_REPORT_SIZE(8, 0x03),
+		HID_RI_OUTPUT(8, HID_IOF_CONSTANT),
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),
+		HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
+		HID_RI_USAGE_PAGE(8, 0x07),
+		HID_RI_USAGE_MINIMUM(8, 0x00),
+		HID_RI_USAGE_MAXIMUM(8, 0xFF),
+		HID_RI_REPORT_COUNT(8, 0x06),
+		HID_RI_REPORT_SIZE(8, 0x08),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_ARRAY | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0),
+};
+
+// Boot mouse with a wheel: 3 buttons, then relative X, Y and wheel of -127 to 127.
+static const uint8_t MouseReport[] =
+{
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x02),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_USAGE(8, 0x01),
+		HID_RI_COLLECTION(8, 0x00),
+			HID_RI_USAGE_PAGE(8, 0x09),
+			HID_RI_USAGE_MINIMUM(8, 0x01),
+			HID_RI_USAGE_MAXIMUM(8, 0x03),
+			HID_RI_LOGICAL_MINIMUM(8, 0x00),
+			HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+			HID_RI_REPORT_COUNT(8, 0x03),
+			HID_RI_REPORT_SIZE(8, 0x01),
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+			HID_RI_REPORT_COUNT(8, 0x01),
+			HID_RI_REPORT_SIZE(8, 0x05),
+			HID_RI_INPUT(8, HID_IOF_CONSTANT),
+			HID_RI_USAGE_PAGE(8, 0x01),
+			HID_RI_USAGE(8, 0x30),
+			HID_RI_USAGE(8, 0x31),
+			HID_RI_USAGE(8, 0x38),
+			HID_RI_LOGICAL_MINIMUM(8, -127),
+			HID_RI_LOGICAL_MAXIMUM(8, 127),
+			HID_RI_REPORT_SIZE(8, 0x08),
+			HID_RI_REPORT_COUNT(8, 0x03),
+			HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+		HID_RI_END_COLLECTION(0),
+	HID_RI_END_COLLECTION(0),
+};
+
+// Motion sensor, 20 bytes: 16 bit accelerometer and gyro, 12 bit magnetometer,
+// 10 bit temperature, 2 padding bits and two button bytes.
+static const uint8_t SensorReport[] =
+{
+	HID_RI_USAGE_PAGE(16, 0xFF00),
+	HID_RI_USAGE(8, 0x01),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_USAGE_MINIMUM(8, 0x10),
+		HID_RI_USAGE_MAXIMUM(8, 0x15),
+		HID_RI_LOGICAL_MINIMUM(16, -32768),
+		HID_RI_LOGICAL_MAXIMUM(16, 32767),
+		HID_RI_REPORT_SIZE(8, 16),
+		HID_RI_REPORT_COUNT(8, 6),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE_MINIMUM(8, 0x20),
+		HID_RI_USAGE_MAXIMUM(8, 0x22),
+		HID_RI_LOGICAL_MINIMUM(16, -2048),
+		HID_RI_LOGICAL_MAXIMUM(16, 2047),
+		HID_RI_REPORT_SIZE(8, 12),
+		HID_RI_REPORT_COUNT(8, 3),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x30),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(16, 1023),
+		HID_RI_REPORT_SIZE(8, 10),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_REPORT_SIZE(8, 2),
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),
+		HID_RI_USAGE_MINIMUM(8, 0x40),
+		HID_RI_USAGE_MAXIMUM(8, 0x41),
+		HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
+		HID_RI_REPORT_SIZE(8, 8),
+		HID_RI_REPORT_COUNT(8, 2),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0),
+};
+
+// Gamepad with two report IDs: buttons, stick and hat in report 1, throttle
+// and rudder in report 2.
+static const uint8_t GamepadReport[] =
+{
+	HID_RI_USAGE_PAGE(8, 0x01),
+	HID_RI_USAGE(8, 0x05),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_REPORT_ID(8, 0x01),
+		HID_RI_USAGE_PAGE(8, 0x09),
+		HID_RI_USAGE(8, 0x01),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
+		HID_RI_REPORT_SIZE(8, 8),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE_PAGE(8, 0x01),
+		HID_RI_USAGE(8, 0x30),
+		HID_RI_USAGE(8, 0x31),
+		HID_RI_LOGICAL_MINIMUM(8, -127),
+		HID_RI_LOGICAL_MAXIMUM(8, 127),
+		HID_RI_REPORT_COUNT(8, 2),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x39),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(8, 7),
+		HID_RI_REPORT_SIZE(8, 4),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE | HID_IOF_NULLSTATE),
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),
+		HID_RI_REPORT_ID(8, 0x02),
+		HID_RI_USAGE_PAGE(8, 0x02),
+		HID_RI_USAGE(8, 0xBB),
+		HID_RI_LOGICAL_MAXIMUM(16, 1023),
+		HID_RI_REPORT_SIZE(8, 10),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_REPORT_SIZE(8, 6),
+		HID_RI_INPUT(8, HID_IOF_CONSTANT),
+		HID_RI_USAGE(8, 0xBA),
+		HID_RI_LOGICAL_MINIMUM(16, -32768),
+		HID_RI_LOGICAL_MAXIMUM(16, 32767),
+		HID_RI_REPORT_SIZE(8, 16),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0),
+};
+
+// Logical minimum and maximum of different encoded sizes, as descriptor tools
+// emit them, plus full 32 bit fields and fields on odd bit offsets.
+static const uint8_t MixedReport[] =
+{
+	HID_RI_USAGE_PAGE(16, 0xFF01),
+	HID_RI_USAGE(8, 0x01),
+	HID_RI_COLLECTION(8, 0x01),
+		HID_RI_USAGE(8, 0x10),
+		HID_RI_LOGICAL_MINIMUM(8, -10),
+		HID_RI_LOGICAL_MAXIMUM(16, 1000),
+		HID_RI_REPORT_SIZE(8, 12),
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x11),
+		HID_RI_LOGICAL_MINIMUM(8, -1),
+		HID_RI_LOGICAL_MAXIMUM(32, 100000),
+		HID_RI_REPORT_SIZE(8, 19),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x12),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
+		HID_RI_REPORT_SIZE(8, 8),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x13),
+		HID_RI_LOGICAL_MINIMUM(16, -300),
+		HID_RI_LOGICAL_MAXIMUM(16, 300),
+		HID_RI_REPORT_SIZE(8, 10),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x14),
+		HID_RI_LOGICAL_MINIMUM(32, 0x80000000),
+		HID_RI_LOGICAL_MAXIMUM(32, 0x7FFFFFFF),
+		HID_RI_REPORT_SIZE(8, 32),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x15),
+		HID_RI_LOGICAL_MINIMUM(8, 0),
+		HID_RI_LOGICAL_MAXIMUM(32, 0x7FFFFFFF),
+		HID_RI_REPORT_SIZE(8, 31),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+		HID_RI_USAGE(8, 0x16),
+		HID_RI_LOGICAL_MINIMUM(8, -1),
+		HID_RI_LOGICAL_MAXIMUM(8, 0),
+		HID_RI_REPORT_SIZE(8, 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	HID_RI_END_COLLECTION(0),
+};
+
+// 's' or 'u' for each data input item, in descriptor order.
+static const struct
+{
+	const char*    Name;
+	const uint8_t* Report;
+	uint16_t       Size;
+	const char*    Signs;
+} Descriptors[] =
+{
+	{"keyboard", KeyboardReport, sizeof(KeyboardReport), "uuuuuuuuuuuuuu"},
+	{"mouse",    MouseReport,    sizeof(MouseReport),    "uuusss"},
+	{"sensor",   SensorReport,   sizeof(SensorReport),   "sssssssssuuu"},
+	{"gamepad",  GamepadReport,  sizeof(GamepadReport),  "ussuus"},
+	{"mixed",    MixedReport,    sizeof(MixedReport),    "ssussus"},
+};
+
+#define TOTAL_DESCRIPTORS	(sizeof(Descriptors) / sizeof(Descriptors[0]))
+
+static unsigned long Failures;
+static unsigned long Decoded;
+static double        PlanTime;
+static double        RefTime;
+
+//-------------------------------------------------------------------------
+
+bool CALLBACK_HIDParser_FilterHIDReportItem(HID_ReportItem_t* const CurrentItem)
+{
+	return true;
+}
+
+static void Fail(const char* Name, const char* Fmt, ...)
+{
+	va_list ap;
+
+	if (Failures++ < 20)
+	{
+		printf("  %s: ", Name);
+		va_start(ap, Fmt);
+		vprintf(Fmt, ap);
+		va_end(ap);
+		printf("\n");
+	}
+}
+
+static int32_t Reference(HID_ReportItem_t* Item, const uint8_t* Report, bool Signed)
+{
+	uint8_t  BitSize = Item->Attributes.BitSize;
+	uint32_t Value;
+
+	USB_GetHIDReportItemInfo(Report, Item);
+	Value = Item->Value;
+
+	if (Signed && (BitSize < 32) && (Value & (1UL << (BitSize - 1))))
+	  Value |= ~((1UL << BitSize) - 1);
+
+	return (int32_t)Value;
+}
+
+static double Seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//-------------------------------------------------------------------------
+
+static void CheckDescriptor(unsigned d, unsigned long Reports)
+{
+	static HID_ReportInfo_t Info;
+	static HID_ReportPlan_t Plan;
+	const char*             Name  = Descriptors[d].Name;
+	const char*             Signs = Descriptors[d].Signs;
+	char                    ItemSigns[HID_MAX_REPORTITEMS];
+	unsigned                Inputs = 0;
+	uint8_t                 Err;
+
+	memset(&Info, 0, sizeof(Info));
+	Err = USB_ProcessHIDReport(Descriptors[d].Report, Descriptors[d].Size, &Info);
+	if (Err != HID_PARSE_Successful)
+	{
+		Fail(Name, "parse error %d", Err);
+		return;
+	}
+
+	// Parsed sign of every input item against the descriptor's
+	memset(ItemSigns, 0, sizeof(ItemSigns));
+	for (unsigned i = 0; i < Info.TotalReportItems; i++)
+	{
+		HID_ReportItem_t* Item = &Info.ReportItems[i];
+		bool              Negative = ((int32_t)Item->Attributes.Logical.Minimum < 0);
+
+		if (Item->ItemType != HID_REPORT_ITEM_In)
+		  continue;
+
+		if (Signs[Inputs] == '\0')
+		{
+			Fail(Name, "more input items than expected (%d)", Inputs + 1);
+			return;
+		}
+
+		ItemSigns[i] = Signs[Inputs];
+		if (Negative != (Signs[Inputs] == 's'))
+		  Fail(Name, "input item %d logical minimum %ld, expected %s", Inputs, (long)(int32_t)Item->Attributes.Logical.Minimum,
+		       (Signs[Inputs] == 's') ? "negative" : "non-negative");
+
+		Inputs++;
+	}
+
+	if (Signs[Inputs] != '\0')
+	  Fail(Name, "%d input items, expected %d", Inputs, (int)strlen(Signs));
+
+	Err = USB_CompileHIDReportPlan(&Info, HID_REPORT_ITEM_In, NULL, 0, &Plan);
+	if (Err != HID_PARSE_Successful)
+	{
+		Fail(Name, "plan error %d", Err);
+		return;
+	}
+
+	if (Plan.TotalFields != Inputs)
+	  Fail(Name, "plan has %d fields, expected %d", Plan.TotalFields, Inputs);
+
+	for (unsigned f = 0; f < Plan.TotalFields; f++)
+	{
+		const HID_ReportField_t* Field  = &Plan.Fields[f];
+		bool                     Signed = (ItemSigns[Field->Slot] == 's') && (Field->BitSize < 32);
+
+		if (!!(Field->Flags & HID_FIELD_SIGNED) != Signed)
+		  Fail(Name, "field for item %d %s HID_FIELD_SIGNED", Field->Slot,
+		       Signed ? "lacks" : "has");
+	}
+
+	// Random reports of every ID, decoded both ways
+	for (unsigned l = 0; l < Plan.TotalLayouts; l++)
+	{
+		const HID_ReportLayout_t* Layout = &Plan.Layouts[l];
+		uint8_t                   Report[64];
+		int32_t                   Values[HID_MAX_REPORTITEMS];
+		double                    Start;
+
+		for (unsigned long r = 0; r < Reports; r++)
+		{
+			for (unsigned b = 0; b < sizeof(Report); b++)
+			  Report[b] = rand();
+
+			if (Plan.UsingReportIDs)
+			  Report[0] = Layout->ReportID;
+
+			memset(Values, 0x5A, sizeof(Values));
+			if (USB_DecodeHIDReport(&Plan, Report, Layout->ReportSize, Values) != Layout->TotalFields)
+			  Fail(Name, "report ID %d decoded %d of %d fields", Layout->ReportID,
+			       USB_DecodeHIDReport(&Plan, Report, Layout->ReportSize, Values), Layout->TotalFields);
+
+			for (unsigned i = 0; i < Info.TotalReportItems; i++)
+			{
+				HID_ReportItem_t* Item = &Info.ReportItems[i];
+				int32_t           Expected;
+
+				if ((Item->ItemType != HID_REPORT_ITEM_In) || (Item->ReportID != Layout->ReportID))
+				  continue;
+
+				Expected = Reference(Item, Report, (ItemSigns[i] == 's'));
+				if (Values[i] != Expected)
+				  Fail(Name, "item %d decoded %ld, reference %ld", i, (long)Values[i], (long)Expected);
+			}
+		}
+
+		// Timing, over a fixed report so that only the decoding is measured
+		Start = Seconds();
+		for (unsigned long r = 0; r < Reports; r++)
+		{
+			Report[1] = r;
+			USB_DecodeHIDReport(&Plan, Report, Layout->ReportSize, Values);
+			__asm__ volatile("" : : "r"(Values) : "memory");
+		}
+		PlanTime += Seconds() - Start;
+
+		Start = Seconds();
+		for (unsigned long r = 0; r < Reports; r++)
+		{
+			Report[1] = r;
+			for (unsigned i = 0; i < Info.TotalReportItems; i++)
+			{
+				HID_ReportItem_t* Item = &Info.ReportItems[i];
+
+				if ((Item->ItemType == HID_REPORT_ITEM_In) && (Item->ReportID == Layout->ReportID))
+				  Values[i] = Reference(Item, Report, (ItemSigns[i] == 's'));
+			}
+			__asm__ volatile("" : : "r"(Values) : "memory");
+		}
+		RefTime  += Seconds() - Start;
+		Decoded  += Reports;
+	}
+
+	printf("  %-9s %2u input items, %u report ID%s\n", Name, Inputs, Plan.TotalLayouts,
+	       (Plan.TotalLayouts == 1) ? "" : "s");
+}
+
+//-------------------------------------------------------------------------
+
+static void Usage(void)
+{
+	fprintf(stderr, "usage: hidplancheck [--seed n] [--reports n]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned long Seed    = 1;
+	unsigned long Reports = 100000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--seed") && (i + 1 < argc))
+		  Seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--reports") && (i + 1 < argc))
+		  Reports = strtoul(argv[++i], NULL, 0);
+		else
+		  Usage();
+	}
+
+	if (!Reports)
+	  Usage();
+
+	srand(Seed);
+
+	for (unsigned d = 0; d < TOTAL_DESCRIPTORS; d++)
+	  CheckDescriptor(d, Reports);
+
+	printf("decode: plan %.1f ns/report, reference %.1f ns/report (%lu reports per report ID)\n",
+	       PlanTime * 1e9 / Decoded, RefTime * 1e9 / Decoded, Reports);
+
+	if (Failures)
+	{
+		printf("hidplancheck: FAILED, %lu mismatches\n", Failures);
+		return 1;
+	}
+
+	printf("hidplancheck: ok, %u descriptors, seed %lu\n", (unsigned)TOTAL_DESCRIPTORS, Seed);
+	return 0;
+}
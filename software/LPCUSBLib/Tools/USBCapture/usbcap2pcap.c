@@ -0,0 +1,538 @@
+/*
+
+	usbcap2pcap. Converts a USB_Capture_Drain() stream into a Linux usbmon
+	pcap file (LINKTYPE_USB_LINUX_MMAPPED) for Wireshark.
+
+	The capture is taken on the device, so the URBs are rebuilt from what
+	the device saw:
+
+		control		one URB per SETUP, completed by the status stage. A
+					STALL completes it with -EPIPE, a bus reset or a new
+					SETUP before the status stage with -ECONNRESET, which
+					is how a host giving up on a request shows.
+		bulk/int IN	submitted when the firmware queues the data, completed
+					when the controller retires it.
+		bulk/int OUT	submitted and completed when the data arrives.
+		isochronous	one single packet URB per (micro)frame.
+
+	Records carry the first USB_CAPTURE_SNAPLEN bytes of each packet. A URB
+	keeps its data up to the first packet that was cut short, the rest shows
+	as not captured. Timestamps are microframes (125us) since the capture
+	started. The device address follows SET_ADDRESS.
+
+	Build and run, from software/LPCUSBLib:
+
+	gcc -O2 -ITools/USBCapture Tools/USBCapture/usbcap2pcap.c -o usbcap2pcap
+	./usbcap2pcap capture.bin capture.pcap
+
+	The wire format is described in Drivers/USB/Core/USBCapture.h and the
+	constants below must match it.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//-----------------------------------------------------------------------------
+// USBCapture.h
+#define CAP_SYNC				0xC5
+#define CAP_HEADER_SIZE			12
+
+#define CAP_SETUP				1
+#define CAP_SUBMIT				2
+#define CAP_COMPLETE			3
+#define CAP_ISO					4
+#define CAP_STALL				5
+#define CAP_RESET				6
+#define CAP_SUSPEND				7
+#define CAP_RESUME				8
+#define CAP_ADDRESS				9
+#define CAP_CONFIGURED			10
+#define CAP_LOST				15
+
+#define CAP_STATUS_HALTED		(1 << 0)
+#define CAP_STATUS_XACT_ERROR	(1 << 1)
+#define CAP_STATUS_BUFFER_ERROR	(1 << 2)
+#define CAP_STATUS_ABORTED		(1 << 3)
+
+//-----------------------------------------------------------------------------
+// usbmon
+#define LINKTYPE_USB_LINUX_MMAPPED	220
+#define URB_ISO					0
+#define URB_INTERRUPT			1
+#define URB_CONTROL				2
+#define URB_BULK				3
+
+#define E_EPIPE					(-32)
+#define E_EPROTO				(-71)
+#define E_EOVERFLOW				(-75)
+#define E_ECONNRESET			(-104)
+#define E_ESHUTDOWN				(-108)
+#define E_EINPROGRESS			(-115)
+
+// largest URB data kept, the rest only counts towards the length
+#define URB_DATA_MAX			4096
+#define CORES					2
+
+//-----------------------------------------------------------------------------
+typedef struct _Record
+{
+	uint8_t event;
+	uint8_t ep;
+	uint8_t type;
+	uint8_t core;
+	uint32_t stamp;
+	uint16_t length;
+	uint8_t status;
+	uint8_t data_length;
+	const uint8_t* data;
+} Record;
+
+// a URB being rebuilt
+typedef struct _Urb
+{
+	int open;
+	uint64_t id;
+	uint8_t setup[8];
+	// data seen since the SETUP, nothing else records a duplicate
+	int touched;
+	uint32_t actual;
+	uint32_t captured;
+	// a packet was cut short, later data is not contiguous
+	int truncated;
+	uint8_t data[URB_DATA_MAX];
+} Urb;
+
+typedef struct _Bus
+{
+	uint8_t address;
+	// SET_ADDRESS seen, applied once its control URB is completed
+	int address_pending;
+	uint8_t new_address;
+	Urb control;
+	// bulk/interrupt IN queued by the firmware, per endpoint number
+	Urb in[16];
+} Bus;
+
+static FILE* out;
+static Bus buses[CORES];
+static uint64_t next_id = 1;
+static uint32_t stats_urbs;
+static uint32_t stats_records;
+static uint32_t stats_lost;
+static uint32_t stats_stalls;
+
+//-----------------------------------------------------------------------------
+
+static void Put16(uint8_t* p, uint16_t v)
+{
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+}
+
+static void Put32(uint8_t* p, uint32_t v)
+{
+	Put16(p, (uint16_t) v);
+	Put16(p + 2, (uint16_t) (v >> 16));
+}
+
+static void Put64(uint8_t* p, uint64_t v)
+{
+	Put32(p, (uint32_t) v);
+	Put32(p + 4, (uint32_t) (v >> 32));
+}
+
+static void Pcap_Header(void)
+{
+	uint8_t h[24];
+	Put32(h, 0xA1B2C3D4);
+	Put16(h + 4, 2);
+	Put16(h + 6, 4);
+	Put32(h + 8, 0);
+	Put32(h + 12, 0);
+	Put32(h + 16, 65535);
+	Put32(h + 20, LINKTYPE_USB_LINUX_MMAPPED);
+	fwrite(h, 1, sizeof(h), out);
+}
+
+// one usbmon event. setup NULL for no SETUP, iso_status/iso_length describe
+// a single isochronous packet when xfer is URB_ISO.
+static void Pcap_Event(const Record* r, uint8_t bus_address, uint64_t id, char kind, uint8_t xfer, uint8_t ep,
+					   const uint8_t* setup, int32_t status, uint32_t length,
+					   const uint8_t* data, uint32_t captured)
+{
+	uint8_t rec[16];
+	uint8_t h[64];
+	uint8_t iso[16];
+	uint64_t us = (uint64_t) r->stamp * 125;
+	uint32_t extra = (xfer == URB_ISO) ? sizeof(iso) : 0;
+	memset(h, 0, sizeof(h));
+	Put64(h, id);
+	h[8] = (uint8_t) kind;
+	h[9] = xfer;
+	h[10] = ep;
+	h[11] = bus_address;
+	Put16(h + 12, (uint16_t) (r->core + 1));
+	h[14] = setup ? 0 : '-';
+	h[15] = captured ? 0 : (kind == 'S' ? '>' : '<');
+	Put64(h + 16, us / 1000000);
+	Put32(h + 24, (uint32_t) (us % 1000000));
+	Put32(h + 28, (uint32_t) status);
+	Put32(h + 32, length);
+	Put32(h + 36, captured + extra);
+	if (setup)
+	{
+		memcpy(h + 40, setup, 8);
+	}
+	else if (xfer == URB_ISO)
+	{
+		// error_count, numdesc
+		Put32(h + 40, status ? 1 : 0);
+		Put32(h + 44, 1);
+	}
+	// interval, start_frame, xfer_flags, ndesc
+	Put32(h + 48, 1);
+	Put32(h + 52, (xfer == URB_ISO) ? (r->stamp >> 3) & 0x7FF : 0);
+	Put32(h + 60, (xfer == URB_ISO) ? 1 : 0);
+	Put32(rec, (uint32_t) (us / 1000000));
+	Put32(rec + 4, (uint32_t) (us % 1000000));
+	Put32(rec + 8, sizeof(h) + captured + extra);
+	Put32(rec + 12, sizeof(h) + length + extra);
+	fwrite(rec, 1, sizeof(rec), out);
+	fwrite(h, 1, sizeof(h), out);
+	if (extra)
+	{
+		Put32(iso, (uint32_t) status);
+		Put32(iso + 4, 0);
+		Put32(iso + 8, length);
+		Put32(iso + 12, 0);
+		fwrite(iso, 1, sizeof(iso), out);
+	}
+	if (captured)
+	{
+		fwrite(data, 1, captured, out);
+	}
+}
+
+static int32_t Urb_Status(uint8_t status)
+{
+	if (status & CAP_STATUS_ABORTED)
+	{
+		return E_ECONNRESET;
+	}
+	if (status & CAP_STATUS_BUFFER_ERROR)
+	{
+		return E_EOVERFLOW;
+	}
+	if (status & CAP_STATUS_XACT_ERROR)
+	{
+		return E_EPROTO;
+	}
+	if (status & CAP_STATUS_HALTED)
+	{
+		return E_EPIPE;
+	}
+	return 0;
+}
+
+static void Urb_Open(Urb* u)
+{
+	u->open = 1;
+	u->id = next_id++;
+	u->touched = 0;
+	u->actual = 0;
+	u->captured = 0;
+	u->truncated = 0;
+}
+
+// adds a packet's snap. 'length' is the packet size, of which data_length
+// bytes were captured
+static void Urb_Append(Urb* u, const Record* r, uint32_t length)
+{
+	uint32_t n = r->data_length < length ? r->data_length : length;
+	if (!u->truncated && u->captured + n <= URB_DATA_MAX)
+	{
+		memcpy(u->data + u->captured, r->data, n);
+		u->captured += n;
+	}
+	if (n < length)
+	{
+		u->truncated = 1;
+	}
+	u->touched = 1;
+}
+
+//-----------------------------------------------------------------------------
+// control endpoint
+
+static int Control_In(const Urb* u)
+{
+	return (u->setup[0] & 0x80) && (u->setup[6] | (u->setup[7] << 8));
+}
+
+static void Control_Close(Bus* bus, const Record* r, int32_t status)
+{
+	Urb* u = &bus->control;
+	uint32_t captured = u->captured < u->actual ? u->captured : u->actual;
+	if (!u->open)
+	{
+		return;
+	}
+	Pcap_Event(r, bus->address, u->id, 'C', URB_CONTROL, Control_In(u) ? 0x80 : 0x00, NULL, status, u->actual,
+			   Control_In(u) ? u->data : NULL, Control_In(u) ? captured : 0);
+	u->open = 0;
+	stats_urbs++;
+	if (bus->address_pending)
+	{
+		bus->address = bus->new_address;
+		bus->address_pending = 0;
+	}
+}
+
+static void Control_Setup(Bus* bus, const Record* r)
+{
+	Urb* u = &bus->control;
+	if (r->data_length < 8)
+	{
+		return;
+	}
+	// the SETUP interrupt can fire again before the firmware takes the request
+	if (u->open && !u->touched && memcmp(u->setup, r->data, 8) == 0)
+	{
+		return;
+	}
+	Control_Close(bus, r, E_ECONNRESET);
+	Urb_Open(u);
+	memcpy(u->setup, r->data, 8);
+	Pcap_Event(r, bus->address, u->id, 'S', URB_CONTROL, Control_In(u) ? 0x80 : 0x00, u->setup, E_EINPROGRESS,
+			   u->setup[6] | (u->setup[7] << 8), NULL, 0);
+}
+
+static void Control_Packet(Bus* bus, const Record* r)
+{
+	Urb* u = &bus->control;
+	int in = (r->ep & 0x80) != 0;
+	if (!u->open)
+	{
+		return;
+	}
+	if (Control_In(u) == in)
+	{
+		// data stage: IN data is captured when queued, OUT data when it lands
+		if (r->event == CAP_SUBMIT)
+		{
+			Urb_Append(u, r, r->length);
+		}
+		else
+		{
+			if (!in)
+			{
+				Urb_Append(u, r, r->length);
+			}
+			u->actual += r->length;
+			u->touched = 1;
+		}
+	}
+	else if (r->event == CAP_COMPLETE)
+	{
+		// status stage
+		Control_Close(bus, r, Urb_Status(r->status));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// bulk, interrupt and isochronous endpoints
+
+static uint8_t Xfer_Type(uint8_t type)
+{
+	static const uint8_t map[4] = { URB_CONTROL, URB_ISO, URB_BULK, URB_INTERRUPT };
+	return map[type & 3];
+}
+
+static void Data_Packet(Bus* bus, const Record* r)
+{
+	uint8_t xfer = Xfer_Type(r->type);
+	if (r->ep & 0x80)
+	{
+		Urb* u = &bus->in[r->ep & 15];
+		if (r->event == CAP_SUBMIT)
+		{
+			if (u->open)
+			{
+				// completion not captured (ring overflow)
+				u->open = 0;
+			}
+			Urb_Open(u);
+			Urb_Append(u, r, r->length);
+			Pcap_Event(r, bus->address, u->id, 'S', xfer, r->ep, NULL, E_EINPROGRESS, r->length, NULL, 0);
+		}
+		else
+		{
+			uint32_t captured;
+			if (!u->open)
+			{
+				Urb_Open(u);
+			}
+			captured = u->captured < r->length ? u->captured : r->length;
+			Pcap_Event(r, bus->address, u->id, 'C', xfer, r->ep, NULL, Urb_Status(r->status), r->length,
+					   u->data, captured);
+			u->open = 0;
+			stats_urbs++;
+		}
+	}
+	else if (r->event == CAP_COMPLETE)
+	{
+		Urb u;
+		Urb_Open(&u);
+		Urb_Append(&u, r, r->length);
+		Pcap_Event(r, bus->address, u.id, 'S', xfer, r->ep, NULL, E_EINPROGRESS, r->length, u.data, u.captured);
+		Pcap_Event(r, bus->address, u.id, 'C', xfer, r->ep, NULL, Urb_Status(r->status), r->length, NULL, 0);
+		stats_urbs++;
+	}
+}
+
+static void Iso_Packet(Bus* bus, const Record* r)
+{
+	uint64_t id = next_id++;
+	Pcap_Event(r, bus->address, id, 'S', URB_ISO, r->ep, NULL, E_EINPROGRESS, r->length, NULL, 0);
+	Pcap_Event(r, bus->address, id, 'C', URB_ISO, r->ep, NULL, Urb_Status(r->status), r->length, NULL, 0);
+	stats_urbs++;
+}
+
+//-----------------------------------------------------------------------------
+
+static void Convert(const Record* r)
+{
+	Bus* bus = &buses[r->core % CORES];
+	uint32_t i;
+	stats_records++;
+	switch (r->event)
+	{
+		case CAP_SETUP:
+			Control_Setup(bus, r);
+		break;
+		case CAP_SUBMIT:
+		case CAP_COMPLETE:
+			if ((r->ep & 0x7F) == 0)
+			{
+				Control_Packet(bus, r);
+			}
+			else
+			{
+				Data_Packet(bus, r);
+			}
+		break;
+		case CAP_ISO:
+			Iso_Packet(bus, r);
+		break;
+		case CAP_STALL:
+			stats_stalls++;
+			if ((r->ep & 0x7F) == 0)
+			{
+				Control_Close(bus, r, E_EPIPE);
+			}
+			else
+			{
+				uint64_t id = next_id++;
+				Pcap_Event(r, bus->address, id, 'C', URB_BULK, r->ep, NULL, E_EPIPE, 0, NULL, 0);
+			}
+		break;
+		case CAP_RESET:
+			Control_Close(bus, r, E_ESHUTDOWN);
+			for (i = 0; i < 16; i++)
+			{
+				bus->in[i].open = 0;
+			}
+			bus->address = 0;
+			bus->address_pending = 0;
+			fprintf(stderr, "%10.6f bus %u reset\n", r->stamp * 125e-6, r->core + 1);
+		break;
+		case CAP_RESUME:
+			fprintf(stderr, "%10.6f bus %u port change, %s speed\n", r->stamp * 125e-6, r->core + 1, r->length ? "high" : "full");
+		break;
+		case CAP_ADDRESS:
+			bus->new_address = (uint8_t) r->length;
+			bus->address_pending = 1;
+			if (!bus->control.open)
+			{
+				bus->address = bus->new_address;
+				bus->address_pending = 0;
+			}
+		break;
+		case CAP_CONFIGURED:
+			fprintf(stderr, "%10.6f bus %u configuration %u\n", r->stamp * 125e-6, r->core + 1, r->length);
+		break;
+		case CAP_SUSPEND:
+			fprintf(stderr, "%10.6f bus %u suspend\n", r->stamp * 125e-6, r->core + 1);
+		break;
+		case CAP_LOST:
+			stats_lost += r->length;
+			fprintf(stderr, "%10.6f %u records lost, the ring overflowed\n", r->stamp * 125e-6, r->length);
+		break;
+		default:
+		break;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	FILE* in;
+	uint8_t* data = 0;
+	size_t size = 0, used = 0, n, pos = 0;
+	uint32_t skipped = 0;
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: usbcap2pcap capture.bin out.pcap\n");
+		return 2;
+	}
+	if ((in = fopen(argv[1], "rb")) == NULL || (out = fopen(argv[2], "wb")) == NULL)
+	{
+		perror("usbcap2pcap");
+		return 1;
+	}
+	do
+	{
+		if (used == size)
+		{
+			size = size ? size * 2 : 65536;
+			data = (uint8_t*) realloc(data, size);
+		}
+		n = fread(data + used, 1, size - used, in);
+		used += n;
+	}
+	while (n > 0);
+	Pcap_Header();
+	while (pos + CAP_HEADER_SIZE <= used)
+	{
+		const uint8_t* p = data + pos;
+		Record r;
+		// hunt for a plausible header, skips any text on the same channel
+		if (p[0] != CAP_SYNC || p[1] == 0 || p[1] > CAP_LOST || (p[3] & ~7))
+		{
+			pos++;
+			skipped++;
+			continue;
+		}
+		if (pos + CAP_HEADER_SIZE + p[10] > used)
+		{
+			break;
+		}
+		r.event = p[1];
+		r.ep = p[2];
+		r.type = p[3] & 3;
+		r.core = (p[3] >> 2) & 1;
+		r.stamp = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t) p[7] << 24);
+		r.length = (uint16_t) (p[8] | (p[9] << 8));
+		r.data_length = p[10];
+		r.status = p[11];
+		r.data = p + CAP_HEADER_SIZE;
+		Convert(&r);
+		pos += CAP_HEADER_SIZE + r.data_length;
+	}
+	fclose(out);
+	fprintf(stderr, "%u records, %u URBs, %u stalls, %u records lost on the target, %u bytes skipped\n",
+			stats_records, stats_urbs, stats_stalls, stats_lost, skipped);
+	return 0;
+}
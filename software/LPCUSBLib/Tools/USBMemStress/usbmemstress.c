@@ -0,0 +1,445 @@
+/*
+
+	USBMemStress. Attach/detach stress test for the host mode USB RAM pool
+	(Drivers/USB/Core/USBMemory.c).
+
+	Pipe_ConfigurePipe() is the pool's only user. Control and bulk pipes
+	take PIPE_MAX_SIZE, interrupt and isochronous pipes their wMaxPacketSize,
+	and Pipe_ClosePipe() gives the buffer back. This replays that pattern
+	on a number of root ports sharing the pool, each running random devices
+	through attach, enumeration, class pipe setup and detach:
+
+		enumeration	Host.c opens the control pipe, closes it after the
+					first GET_DESCRIPTOR, opens it again for SET_ADDRESS,
+					closes it and opens it a third time.
+		class		the pipes of an MSC, HID, CDC, printer, audio, MIDI,
+					RNDIS or still image device, in the order the class
+					drivers configure them.
+		detach		USB_Host_DeEnumerate(): the control pipe, then the
+					others in pipe order. It can come at any point,
+					enumeration included.
+
+	An allocation that fails ends that port's enumeration, as it does on
+	the board, and the port waits for the detach.
+
+	Checked after every call:
+		- a block is aligned to its size and lies inside the pool
+		- it does not overlap a live block, and nothing wrote over a
+		  live block before it was freed (each is filled with a tag)
+		- USB_Memory_GetStats() InUse equals the live blocks
+
+	Checked whenever every port is idle:
+		- InUse is 0 and LargestFree is the whole pool: every block merged
+		  back, so fragmentation cannot build up from one cycle to the next
+
+	With the two ports an LPC18xx/43xx has no allocation may fail. More
+	ports overcommit the default 4KB pool; failures are then counted but
+	the other checks still apply.
+
+	Build and run, from software/LPCUSBLib:
+
+	gcc -O2 -D__LPC43XX__ -DUSB_HOST_ONLY -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast \
+		-ITools/DCDSim -I../lpc_core/lpc_ip -IDrivers/USB \
+		Tools/USBMemStress/usbmemstress.c Drivers/USB/Core/USBMemory.c -o usbmemstress
+	./usbmemstress [--seed n] [--cycles n] [--ports n]
+
+	Add -DUSBRAM_BUFFER_SIZE=n to try another pool size. The exit status is
+	0 when every check held.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "Core/USBMemory.h"
+
+// Pipe.h
+#define PIPE_MAX_SIZE		512
+
+#define MAX_PORTS			4
+#define MAX_CLASS_PIPES		4
+#define ENUM_STEPS			5
+#define MAX_LIVE			(MAX_PORTS * (1 + MAX_CLASS_PIPES))
+
+//-----------------------------------------------------------------------------
+// devices, by the buffer size of each class pipe
+
+typedef struct _DeviceModel
+{
+	const char* name;
+	uint16_t pipes[MAX_CLASS_PIPES];	// 0 ends the list
+} DeviceModel;
+
+static const DeviceModel devices[] =
+{
+	{ "msc",			{ PIPE_MAX_SIZE, PIPE_MAX_SIZE } },
+	{ "hid keyboard",	{ 8 } },
+	{ "hid mouse",		{ 4 } },
+	{ "hid generic",	{ 64, 64 } },
+	{ "cdc acm",		{ 16, PIPE_MAX_SIZE, PIPE_MAX_SIZE } },
+	{ "printer",		{ PIPE_MAX_SIZE, PIPE_MAX_SIZE } },
+	{ "audio 16 bit",	{ 192 } },
+	{ "audio 24 bit",	{ 288 } },
+	{ "midi",			{ PIPE_MAX_SIZE, PIPE_MAX_SIZE } },
+	{ "rndis",			{ 8, PIPE_MAX_SIZE, PIPE_MAX_SIZE } },
+	{ "still image",	{ PIPE_MAX_SIZE, PIPE_MAX_SIZE, 8 } },
+};
+
+#define DEVICE_COUNT		(sizeof(devices) / sizeof(devices[0]))
+
+//-----------------------------------------------------------------------------
+// ports
+
+typedef struct _Port
+{
+	const DeviceModel* device;	// NULL when nothing is attached
+	uint32_t step;				// next pool call of the attach sequence
+	uint32_t run;				// steps left before the device detaches on its own
+	int failed;					// an allocation failed, waiting for the detach
+	uint8_t* control;			// PipeInfo[].Buffer of the control pipe
+	uint8_t* pipes[MAX_CLASS_PIPES];
+} Port;
+
+// a live block and the tag it was filled with
+typedef struct _Live
+{
+	uint8_t* block;
+	uint32_t size;
+	uint8_t tag;
+} Live;
+
+static Port ports[MAX_PORTS];
+static uint32_t port_count = 2;
+static Live live[MAX_LIVE];
+static uint32_t live_count;
+static uint8_t* pool_base;
+static uint32_t pool_size;
+static uint32_t seed = 1;
+static uint32_t random_state;
+static uint32_t cycle;
+
+static struct
+{
+	uint32_t attaches;
+	uint32_t enumerated;
+	uint32_t early_detaches;
+	uint32_t allocs;
+	uint32_t failed;
+	uint32_t idle_checks;
+	uint32_t per_device[DEVICE_COUNT];
+} stats;
+
+//-----------------------------------------------------------------------------
+
+static uint32_t Random(uint32_t n)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state % n;
+}
+
+static void Fail(const char* what)
+{
+	printf("usbmemstress: FAILED at cycle %u, seed %u: %s\n", cycle, seed, what);
+	exit(1);
+}
+
+// the block USB_Memory_Alloc() hands out for size: the next power of two from 32
+static uint32_t BlockSize(uint32_t size)
+{
+	uint32_t block = 32;
+	while (block < size)
+	{
+		block <<= 1;
+	}
+	return block;
+}
+
+static void CheckInUse(void)
+{
+	USB_Memory_Stats_t s;
+	uint32_t i, sum = 0;
+	for (i = 0; i < live_count; i++)
+	{
+		sum += live[i].size;
+	}
+	USB_Memory_GetStats(&s);
+	if (s.InUse != sum)
+	{
+		Fail("InUse does not match the live blocks");
+	}
+	if (s.HighWater > pool_size || s.LargestFree > pool_size)
+	{
+		Fail("figures larger than the pool");
+	}
+}
+
+// Pipe_ConfigurePipe()
+static uint8_t* PipeAlloc(uint32_t size)
+{
+	uint8_t* block = USB_Memory_Alloc(size, 0);
+	uint32_t blocksize = BlockSize(size), i;
+	stats.allocs++;
+	if (block == NULL)
+	{
+		stats.failed++;
+		CheckInUse();
+		return NULL;
+	}
+	if (block < pool_base || block + blocksize > pool_base + pool_size)
+	{
+		Fail("block outside the pool");
+	}
+	if ((uint32_t) (block - pool_base) % blocksize)
+	{
+		Fail("block not aligned to its size");
+	}
+	for (i = 0; i < live_count; i++)
+	{
+		if (block < live[i].block + live[i].size && live[i].block < block + blocksize)
+		{
+			Fail("block overlaps a live one");
+		}
+	}
+	if (live_count == MAX_LIVE)
+	{
+		Fail("more live blocks than pipes");
+	}
+	live[live_count].block = block;
+	live[live_count].size = blocksize;
+	live[live_count].tag = (uint8_t) Random(256);
+	memset(block, live[live_count].tag, blocksize);
+	live_count++;
+	CheckInUse();
+	return block;
+}
+
+// Pipe_ClosePipe(), which also frees a pipe whose buffer is NULL
+static void PipeFree(uint8_t** buffer)
+{
+	uint32_t i, j;
+	if (*buffer != NULL)
+	{
+		for (i = 0; i < live_count && live[i].block != *buffer; i++) ;
+		if (i == live_count)
+		{
+			Fail("freeing a block that is not live");
+		}
+		for (j = 0; j < live[i].size; j++)
+		{
+			if (live[i].block[j] != live[i].tag)
+			{
+				Fail("live block written over");
+			}
+		}
+		live[i] = live[--live_count];
+	}
+	USB_Memory_Free(*buffer);
+	*buffer = NULL;
+	CheckInUse();
+}
+
+//-----------------------------------------------------------------------------
+
+static uint32_t ClassPipes(const DeviceModel* device)
+{
+	uint32_t n = 0;
+	while (n < MAX_CLASS_PIPES && device->pipes[n])
+	{
+		n++;
+	}
+	return n;
+}
+
+static void CheckIdle(void)
+{
+	USB_Memory_Stats_t s;
+	uint32_t i;
+	for (i = 0; i < port_count; i++)
+	{
+		if (ports[i].device != NULL)
+		{
+			return;
+		}
+	}
+	USB_Memory_GetStats(&s);
+	if (s.InUse != 0 || live_count != 0)
+	{
+		Fail("blocks leaked with every port idle");
+	}
+	if (s.LargestFree != pool_size)
+	{
+		Fail("pool did not merge back into one block with every port idle");
+	}
+	stats.idle_checks++;
+}
+
+// USB_Host_DeEnumerate()
+static void Detach(Port* port)
+{
+	uint32_t i;
+	if (port->step < ENUM_STEPS + ClassPipes(port->device))
+	{
+		stats.early_detaches++;
+	}
+	PipeFree(&port->control);
+	for (i = 0; i < ClassPipes(port->device); i++)
+	{
+		PipeFree(&port->pipes[i]);
+	}
+	port->device = NULL;
+	cycle++;
+	CheckIdle();
+}
+
+// one pool call of the attach sequence, or the device runs
+static void Advance(Port* port)
+{
+	uint32_t pipes = ClassPipes(port->device);
+	if (port->failed || port->step >= ENUM_STEPS + pipes)
+	{
+		if (port->run == 0)
+		{
+			Detach(port);
+			return;
+		}
+		port->run--;
+		return;
+	}
+	switch (port->step)
+	{
+	case 0:		// HOST_STATE_Powered_ConfigPipe
+	case 2:		// HOST_STATE_Default_PostReset
+	case 4:		// HOST_STATE_Default_PostAddressSet
+		port->control = PipeAlloc(PIPE_MAX_SIZE);
+		port->failed = port->control == NULL;
+		break;
+	case 1:		// HOST_STATE_Default
+	case 3:		// HOST_STATE_Default_PostReset
+		PipeFree(&port->control);
+		break;
+	default:	// the class driver's ConfigurePipes
+		port->pipes[port->step - ENUM_STEPS] = PipeAlloc(port->device->pipes[port->step - ENUM_STEPS]);
+		port->failed = port->pipes[port->step - ENUM_STEPS] == NULL;
+		break;
+	}
+	port->step++;
+	if (!port->failed && port->step == ENUM_STEPS + pipes)
+	{
+		stats.enumerated++;
+	}
+}
+
+static void Attach(Port* port)
+{
+	uint32_t d = Random(DEVICE_COUNT);
+	memset(port, 0, sizeof(*port));
+	port->device = &devices[d];
+	port->run = Random(64);
+	stats.attaches++;
+	stats.per_device[d]++;
+}
+
+//-----------------------------------------------------------------------------
+
+static void Usage(void)
+{
+	fprintf(stderr, "usage: usbmemstress [--seed n] [--cycles n] [--ports 1..%u]\n", MAX_PORTS);
+	exit(2);
+}
+
+int main(int argc, char** argv)
+{
+	USB_Memory_Stats_t s;
+	uint32_t cycles = 100000, i;
+	uint8_t* whole;
+	for (i = 1; i < (uint32_t) argc; i++)
+	{
+		if (!strcmp(argv[i], "--seed") && i + 1 < (uint32_t) argc)
+		{
+			seed = (uint32_t) strtoul(argv[++i], NULL, 0);
+			seed = seed ? seed : 1;
+		}
+		else if (!strcmp(argv[i], "--cycles") && i + 1 < (uint32_t) argc)
+		{
+			cycles = (uint32_t) strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--ports") && i + 1 < (uint32_t) argc)
+		{
+			port_count = (uint32_t) atoi(argv[++i]);
+			if (port_count < 1 || port_count > MAX_PORTS)
+			{
+				Usage();
+			}
+		}
+		else
+		{
+			Usage();
+		}
+	}
+
+	random_state = seed;
+
+	// USB_Init() on the first host core
+	USB_Memory_Init(USBRAM_BUFFER_SIZE);
+	USB_Memory_GetStats(&s);
+	pool_size = s.PoolSize;
+	if (s.LargestFree != pool_size)
+	{
+		Fail("fresh pool is not one block");
+	}
+	// the whole pool is a single block, which gives its base
+	pool_base = whole = USB_Memory_Alloc(pool_size, 0);
+	pool_size = whole ? pool_size : 0;
+	if (whole == NULL)
+	{
+		Fail("fresh pool cannot be allocated whole");
+	}
+	USB_Memory_Free(whole);
+
+	while (cycle < cycles)
+	{
+		Port* port = &ports[Random(port_count)];
+		if (port->device == NULL)
+		{
+			Attach(port);
+		}
+		else if (Random(64) == 0)
+		{
+			Detach(port);
+		}
+		else
+		{
+			Advance(port);
+		}
+	}
+	for (i = 0; i < port_count; i++)
+	{
+		if (ports[i].device != NULL)
+		{
+			Detach(&ports[i]);
+		}
+	}
+	USB_Memory_GetStats(&s);
+	if (port_count <= 2 && s.Failures != 0)
+	{
+		Fail("allocation failed with no more ports than the part has");
+	}
+	if (s.Failures != stats.failed)
+	{
+		Fail("Failures does not match the NULL returns");
+	}
+
+	printf("usbmemstress: ok, %u attach/detach cycles on %u ports, pool %u bytes\n", cycle, port_count, pool_size);
+	printf("  %u attached, %u enumerated, %u pulled during enumeration\n", stats.attaches, stats.enumerated,
+	       stats.early_detaches);
+	printf("  %u allocations, %u failed, high water %u bytes\n", stats.allocs, stats.failed, s.HighWater);
+	printf("  every port idle %u times, pool whole every time\n", stats.idle_checks);
+	for (i = 0; i < DEVICE_COUNT; i++)
+	{
+		printf("  %-14s %u\n", devices[i].name, stats.per_device[i]);
+	}
+	return 0;
+}
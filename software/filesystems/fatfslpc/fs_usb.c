@@ -45,6 +45,15 @@ static volatile WORD Timer2;
 
 static DISK_HANDLE_T *hDisk;
 
+#if FSUSB_READAHEAD_SECTORS
+/* Read-ahead window: raCount sectors from raStart, 0 when empty */
+static BYTE raBuf[FSUSB_READAHEAD_SECTORS * _MAX_SS] ATTR_ALIGNED(4);
+static DWORD raStart, raCount;
+
+/* Sector following the previous read */
+static DWORD raNext = 0xFFFFFFFF;
+#endif
+
 /*****************************************************************************
  * Public types/enumerations/variables
  ****************************************************************************/
@@ -53,6 +62,47 @@ static DISK_HANDLE_T *hDisk;
  * Private functions
  ****************************************************************************/
 
+#if FSUSB_READAHEAD_SECTORS
+/* Reads through the read-ahead window. A request that continues the previous one
+   or the window and is smaller than the window refills it, anything else goes to
+   the disk as it is, so large reads still make one command straight into buff. */
+static int ReadAhead(BYTE *buff, DWORD sector, DWORD count)
+{
+	int seq = (sector == raNext) || (raCount && sector == raStart + raCount);
+
+	raNext = sector + count;
+	if (FSUSB_DiskGetSectorSz(hDisk) != _MAX_SS) {
+		return FSUSB_DiskReadSectors(hDisk, buff, sector, count);
+	}
+
+	while (count) {
+		if (raCount && (sector >= raStart) && (sector < raStart + raCount)) {
+			DWORD n = MIN(count, raStart + raCount - sector);
+
+			memcpy(buff, &raBuf[(sector - raStart) * _MAX_SS], n * _MAX_SS);
+			buff += n * _MAX_SS;
+			sector += n;
+			count -= n;
+			seq = 1;
+		}
+		else if (seq && (count < FSUSB_READAHEAD_SECTORS)) {
+			DWORD n = MIN(FSUSB_READAHEAD_SECTORS, FSUSB_DiskGetSectorCnt(hDisk) - sector);
+
+			raCount = 0;
+			if ((n < count) || !FSUSB_DiskReadSectors(hDisk, raBuf, sector, n)) {
+				return 0;
+			}
+			raStart = sector;
+			raCount = n;
+		}
+		else {
+			return FSUSB_DiskReadSectors(hDisk, buff, sector, count);
+		}
+	}
+	return 1;
+}
+#endif
+
 /*****************************************************************************
  * Public functions
  ****************************************************************************/
@@ -76,6 +126,10 @@ DSTATUS disk_initialize(BYTE drv)
 
 	/* Initialize the Card Data Strucutre */
 	hDisk = FSUSB_DiskInit();
+#if FSUSB_READAHEAD_SECTORS
+	raCount = 0;
+	raNext = 0xFFFFFFFF;
+#endif
 
 	/* Reset */
 	Stat = STA_NOINIT;
@@ -147,9 +201,15 @@ DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
 		return RES_NOTRDY;
 	}
 
+#if FSUSB_READAHEAD_SECTORS
+	if (ReadAhead(buff, sector, count)) {
+		return RES_OK;
+	}
+#else
 	if (FSUSB_DiskReadSectors(hDisk, buff, sector, count)) {
 		return RES_OK;
 	}
+#endif
 
 	return RES_ERROR;
 }
@@ -174,6 +234,11 @@ DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
 		return RES_NOTRDY;
 	}
 
+#if FSUSB_READAHEAD_SECTORS
+	if ((sector < raStart + raCount) && (sector + count > raStart)) {
+		raCount = 0;
+	}
+#endif
 	if (FSUSB_DiskWriteSectors(hDisk, (void *) buff, sector, count)) {
 		return RES_OK;
 	}
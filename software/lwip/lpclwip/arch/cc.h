@@ -90,8 +90,29 @@ typedef uintptr_t          mem_ptr_t;
 //	#define ALIGNED(n)  __align(n)
 #endif 
 
-/* Used with IP headers only */
-#define LWIP_CHKSUM_ALGORITHM 1
+/**
+ * @brief	Internet checksum of a buffer, 32 bits at a time
+ * @param	dataptr	: Pointer to the data to sum, any alignment
+ * @param	len		: Number of bytes to sum
+ * @return	The checksum in host order, not inverted
+ */
+u16_t lpc_chksum(void *dataptr, int len);
+
+/**
+ * @brief	Copies a buffer and returns its checksum in the same pass
+ * @param	dst		: Destination buffer
+ * @param	src		: Source buffer
+ * @param	len		: Number of bytes to copy
+ * @return	The checksum of the copied data, as lpc_chksum()
+ */
+u16_t lpc_chksum_copy(void *dst, const void *src, u16_t len);
+
+/* Use the Cortex-M3/M4 checksum routines in lpc_chksum.c unless the
+   application plugs in its own */
+#ifndef LWIP_CHKSUM
+#define LWIP_CHKSUM lpc_chksum
+#define LWIP_CHKSUM_COPY(dst, src, len) lpc_chksum_copy(dst, src, len)
+#endif
 
 #ifdef LWIP_DEBUG
 /**
@@ -62,6 +62,61 @@ extern void msDelay(uint32_t ms);
 #error LPC_CHECK_SLOWMEM must be 0 or 1
 #endif
 
+/* Frames handled per receive poll pass. The receive task yields after a
+   full pass so a flood can't hold the CPU. */
+#ifndef LPC_RX_BUDGET
+#define LPC_RX_BUDGET (2 * LPC_NUM_BUFF_RXDESCS)
+#endif
+
+/* Free RX descriptors collected inside a poll pass before their pbufs are
+   reallocated and handed back to the DMA in one go */
+#ifndef LPC_RX_REFILL_BATCH
+#define LPC_RX_REFILL_BATCH ((LPC_NUM_BUFF_RXDESCS + 1) / 2)
+#endif
+
+/* RX interrupt coalescing. Non-zero sets the MAC receive interrupt
+   watchdog to this many units of 256 bus clocks and stops the per frame
+   receive interrupt, so a burst raises one interrupt. 0 interrupts on
+   every frame. */
+#ifndef LPC_RX_INT_WDT
+#define LPC_RX_INT_WDT 0
+#endif
+
+#if LPC_RX_BUDGET < 1
+#error LPC_RX_BUDGET must be at least 1
+#endif
+
+#if (LPC_RX_REFILL_BATCH < 1) || (LPC_RX_REFILL_BATCH > LPC_NUM_BUFF_RXDESCS)
+#error LPC_RX_REFILL_BATCH must be between 1 and LPC_NUM_BUFF_RXDESCS
+#endif
+
+#if LPC_RX_INT_WDT > 255
+#error LPC_RX_INT_WDT must be 255 or less
+#endif
+
+/* Have the EMAC insert and check the IP, TCP, UDP and ICMP checksums.
+   The CHECKSUM_GEN_x and CHECKSUM_CHECK_x options in lwipopts.h must
+   be 0 to stop lwIP doing them in software too. The EMAC leaves the
+   payload checksums of IP fragments alone, so IP_FRAG and IP_REASSEMBLY
+   must be 0 as well. */
+#ifndef LPC_CHECKSUM_OFFLOAD
+#define LPC_CHECKSUM_OFFLOAD 0
+#endif
+
+#if (LPC_CHECKSUM_OFFLOAD == 1) && (IP_FRAG || IP_REASSEMBLY)
+#error LPC_CHECKSUM_OFFLOAD needs IP_FRAG and IP_REASSEMBLY set to 0
+#endif
+
+/* TX bounce buffers for payloads in LPC_SLOWMEM_ARRAY regions the DMA
+   can't read in place. Each holds a full frame. */
+#ifndef LPC_NUM_BOUNCE_BUFFS
+#define LPC_NUM_BOUNCE_BUFFS 2
+#endif
+
+#if (LPC_CHECK_SLOWMEM == 1) && ((LPC_NUM_BOUNCE_BUFFS < 1) || (LPC_NUM_BOUNCE_BUFFS > 32))
+#error LPC_NUM_BOUNCE_BUFFS must be between 1 and 32
+#endif
+
 /** @ingroup NET_LWIP_LPC18XX43XX_EMAC_DRIVER
  * @{
  */
@@ -79,8 +134,19 @@ extern void msDelay(uint32_t ms);
  * the same. */
 #define tskTXCLEAN_PRIORITY  (TCPIP_THREAD_PRIO - 1)
 #define tskRECPKT_PRIORITY   (TCPIP_THREAD_PRIO - 1)
+
+/**
+ * @brief	Receive thread priority under overload
+ * Once a poll pass uses its full budget the receive thread drops to this
+ * priority until the RX ring is drained, so tasks at or above it keep
+ * running during a flood and the MAC drops what can't be handled. */
+#define tskRXPOLL_PRIORITY   (tskIDLE_PRIORITY + 1)
 #endif
 
+/* RX interrupts, masked while the receive thread polls the ring */
+#define LPC_RX_INTS          (DMA_IE_RIE | DMA_IE_OVE | DMA_IE_RUE)
+#define LPC_RX_INT_STATUS    (DMA_ST_RI | DMA_ST_OVF | DMA_ST_RU)
+
 /** @brief	Debug output formatter lock define
  * When using FreeRTOS and with LWIP_DEBUG enabled, enabling this
  * define will allow RX debug messages to not interleave with the
@@ -101,11 +167,18 @@ struct lpc_enetdata {
 	volatile u32_t tx_free_descs;	/**< Number of free TX descriptors */
 	u32_t tx_fill_idx;	/**< Current free TX descriptor index */
 	u32_t tx_reclaim_idx;	/**< Next incoming TX packet descriptor index */
+#if LPC_CHECK_SLOWMEM == 1
+	u8_t txbounce[LPC_NUM_BUFF_TXDESCS];	/**< Bounce buffer used by each TX descriptor, or LPC_NO_BOUNCE */
+	u32_t bounce_free_mask;	/**< Free bounce buffers, one bit each */
+	volatile u32_t bounce_free;	/**< Number of free bounce buffers */
+#endif
+	struct lpc_tx_stats tx_stats;	/**< Transmit statistics */
 	struct pbuf *rxpbufs[LPC_NUM_BUFF_RXDESCS];	/**< Saved pbuf pointers for RX */
 
 	volatile u32_t rx_free_descs;	/**< Number of free RX descriptors */
 	volatile u32_t rx_get_idx;	/**< Index to next RX descriptor that id to be received */
 	u32_t rx_next_idx;	/**< Index to next RX descriptor that needs a pbuf */
+	struct lpc_rx_stats rx_stats;	/**< Receive poll statistics */
 #if NO_SYS == 0
 	sys_sem_t RxSem;/**< RX receive thread wakeup semaphore */
 	sys_sem_t TxCleanSem;	/**< TX cleanup thread wakeup semaphore */
@@ -123,9 +196,16 @@ static uint32_t intMask;
 struct lpc_slowmem_array_t {
 	u32_t start;
 	u32_t end;
+	u32_t flags;	/**< 0 to bounce payloads, or LPC_SLOWMEM_DMA */
 };
 
 const static struct lpc_slowmem_array_t slmem[] = LPC_SLOWMEM_ARRAY;
+
+/* No bounce buffer on a TX descriptor */
+#define LPC_NO_BOUNCE 0xFF
+
+/* TX bounce buffer pool */
+static u32_t lpc_bounce_buffs[LPC_NUM_BOUNCE_BUFFS][EMAC_ETH_MAX_FLEN / sizeof(u32_t)];
 #endif
 
 /*****************************************************************************
@@ -148,6 +228,10 @@ static void lpc_rxqueue_pbuf(struct lpc_enetdata *lpc_netifdata,
 	/* Buffer size and address for pbuf */
 	lpc_netifdata->prdesc[idx].CTRL = (u32_t) RDES_ENH_BS1(p->len) |
 									  RDES_ENH_RCH;
+#if LPC_RX_INT_WDT
+	/* Completion raises RI through the receive interrupt watchdog */
+	lpc_netifdata->prdesc[idx].CTRL |= RDES_DINT;
+#endif
 	if (idx == (LPC_NUM_BUFF_RXDESCS - 1)) {
 		lpc_netifdata->prdesc[idx].CTRL |= RDES_ENH_RER;
 	}
@@ -288,6 +372,19 @@ static struct pbuf *lpc_low_level_input(struct netif *netif) {
 		}
 	}
 
+#if LPC_CHECKSUM_OFFLOAD == 1
+	/* lwIP doesn't verify checksums, drop frames the EMAC found a bad
+	   IP header or TCP/UDP/ICMP checksum in */
+	if ((!rxerr) && (status & RDES_ESA) &&
+		(lpc_netifdata->prdesc[ridx].EXTSTAT & (RDES_ENH_IPHE | RDES_ENH_IPPLE))) {
+		if (!(status & RDES_ES)) {
+			LINK_STATS_INC(link.drop);
+		}
+		LINK_STATS_INC(link.chkerr);
+		rxerr = 1;
+	}
+#endif
+
 	/* Increment free descriptor count and next get index */
 	lpc_netifdata->rx_free_descs++;
 	ridx++;
@@ -304,12 +401,13 @@ static struct pbuf *lpc_low_level_input(struct netif *netif) {
 		LWIP_DEBUGF(EMAC_DEBUG | LWIP_DBG_TRACE,
 					("lpc_low_level_input: RX error condition status 0x%08x\n",
 					 status));
+
+		/* (Re)start receive polling */
+		LPC_ETHERNET->DMA_REC_POLL_DEMAND = 1;
 	}
 	else {
-		/* Attempt to queue a new pbuf for the descriptor */
-		lpc_rx_queue(netif);
-
-		/* Get length of received packet */
+		/* Get length of received packet. The descriptor is refilled
+		   by the caller, see lpc_rx_refill() */
 		p->len = p->tot_len = (u16_t) RDES_FLMSK(status);
 
 		LINK_STATS_INC(link.recv);
@@ -319,9 +417,6 @@ static struct pbuf *lpc_low_level_input(struct netif *netif) {
 					 "status 0x%08x\n", p->len, status));
 	}
 
-	/* (Re)start receive polling */
-	LPC_ETHERNET->DMA_REC_POLL_DEMAND = 1;
-
 #ifdef LOCK_RX_THREAD
 #if NO_SYS == 0
 	/* Get exclusive access */
@@ -332,6 +427,59 @@ static struct pbuf *lpc_low_level_input(struct netif *netif) {
 	return p;
 }
 
+/* Queues new pbufs into the free RX descriptors and restarts receive
+   polling in case the DMA had run out of descriptors */
+static void lpc_rx_refill(struct netif *netif)
+{
+	struct lpc_enetdata *lpc_netifdata = netif->state;
+	u32_t needed = lpc_netifdata->rx_free_descs;
+
+	if ((u32_t) lpc_rx_queue(netif) < needed) {
+		lpc_netifdata->rx_stats.alloc_fails++;
+	}
+	lpc_netifdata->rx_stats.refills++;
+
+	LPC_ETHERNET->DMA_REC_POLL_DEMAND = 1;
+}
+
+/* Returns non-zero if a received frame is waiting in the RX ring */
+static int lpc_rx_pending(struct lpc_enetdata *lpc_netifdata)
+{
+	return (lpc_netifdata->rx_free_descs < LPC_NUM_BUFF_RXDESCS) &&
+		   !(lpc_netifdata->prdesc[lpc_netifdata->rx_get_idx].STATUS & RDES_OWN);
+}
+
+/* Passes a received frame to LWIP */
+static void lpc_enetif_deliver(struct netif *netif, struct pbuf *p)
+{
+	struct eth_hdr *ethhdr;
+
+	/* points to packet payload, which starts with an Ethernet header */
+	ethhdr = p->payload;
+
+	switch (htons(ethhdr->type)) {
+	case ETHTYPE_IP:
+	case ETHTYPE_ARP:
+#if PPPOE_SUPPORT
+	case ETHTYPE_PPPOEDISC:
+	case ETHTYPE_PPPOE:
+#endif /* PPPOE_SUPPORT */
+		/* full packet send to tcpip_thread to process */
+		if (netif->input(p, netif) != ERR_OK) {
+			LWIP_DEBUGF(NETIF_DEBUG,
+						("lpc_enetif_input: IP input error\n"));
+			/* Free buffer */
+			pbuf_free(p);
+		}
+		break;
+
+	default:
+		/* Return buffer */
+		pbuf_free(p);
+		break;
+	}
+}
+
 /* This function sets up the descriptor list used for transmit packets */
 static err_t lpc_tx_setup(struct lpc_enetdata *lpc_netifdata)
 {
@@ -342,6 +490,11 @@ static err_t lpc_tx_setup(struct lpc_enetdata *lpc_netifdata)
 	lpc_netifdata->tx_free_descs = LPC_NUM_BUFF_TXDESCS;
 	lpc_netifdata->tx_fill_idx = 0;
 	lpc_netifdata->tx_reclaim_idx = 0;
+#if LPC_CHECK_SLOWMEM == 1
+	memset(lpc_netifdata->txbounce, LPC_NO_BOUNCE, sizeof(lpc_netifdata->txbounce));
+	lpc_netifdata->bounce_free_mask = 0xFFFFFFFF >> (32 - LPC_NUM_BOUNCE_BUFFS);
+	lpc_netifdata->bounce_free = LPC_NUM_BOUNCE_BUFFS;
+#endif
 
 	/* Link/wrap descriptors */
 	for (idx = 0; idx < LPC_NUM_BUFF_TXDESCS; idx++) {
@@ -360,58 +513,66 @@ static err_t lpc_tx_setup(struct lpc_enetdata *lpc_netifdata)
 	return ERR_OK;
 }
 
+#if LPC_CHECK_SLOWMEM == 1
+/* Returns 1 if the DMA can't read a TX payload in place */
+static int lpc_tx_needs_bounce(const void *payload)
+{
+	u32_t idx;
+
+	for (idx = 0; idx < (sizeof(slmem) / sizeof(slmem[0])); idx++) {
+		if (((u32_t) payload >= slmem[idx].start) &&
+			((u32_t) payload <= slmem[idx].end)) {
+			return !(slmem[idx].flags & LPC_SLOWMEM_DMA);
+		}
+	}
+
+	return 0;
+}
+#endif
+
 /* Low level output of a packet. Never call this from an interrupt context,
    as it may block until TX descriptors become available */
 static err_t lpc_low_level_output(struct netif *netif, struct pbuf *sendp)
 {
 	struct lpc_enetdata *lpc_netifdata = netif->state;
-	u32_t idx, fidx, dn;
+	u32_t idx, fidx, dn, len;
 	struct pbuf *p = sendp;
+	u32_t buff;
 
 #if LPC_CHECK_SLOWMEM == 1
-	struct pbuf *q, *wp;
-
+	struct pbuf *q;
+	u32_t nb, bounce;
+	int slow, prevslow, all;
 	u8_t *dst;
-	int pcopy = 0;
-
-	/* Check packet address to determine if it's in slow memory and
-	   relocate if necessary */
-	for (q = p; ((q != NULL) && (pcopy == 0)); q = q->next) {
-		fidx = 0;
-		for (idx = 0; idx < sizeof(slmem);
-			 idx += sizeof(struct lpc_slowmem_array_t)) {
-			if ((q->payload >= (void *) slmem[fidx].start) &&
-				(q->payload <= (void *) slmem[fidx].end)) {
-				/* Needs copy */
-				pcopy = 1;
-			}
-		}
-	}
 
-	if (pcopy) {
-		/* Create a new pbuf with the total pbuf size */
-		wp = pbuf_alloc(PBUF_RAW, (u16_t) EMAC_ETH_MAX_FLEN, PBUF_RAM);
-		if (!wp) {
-			/* Exit with error */
-			return ERR_MEM;
+	/* Fragments the DMA can read go out in place. A run of fragments that
+	   need bouncing is copied into one bounce buffer and descriptor. */
+	dn = nb = 0;
+	prevslow = 0;
+	for (q = p; q != NULL; q = q->next) {
+		slow = lpc_tx_needs_bounce(q->payload);
+		if (!slow || !prevslow) {
+			dn++;
 		}
-
-		/* Copy pbuf */
-		dst = (u8_t *) wp->payload;
-		wp->tot_len = 0;
-		for (q = p; q != NULL; q = q->next) {
-			MEMCPY(dst, (u8_t *) q->payload, q->len);
-			dst += q->len;
-			wp->tot_len += q->len;
+		if (slow && !prevslow) {
+			nb++;
 		}
-		wp->len = wp->tot_len;
-
-		/* LWIP will free original pbuf on exit of function */
+		prevslow = slow;
+	}
 
-		p = sendp = wp;
+	/* More separate runs than bounce buffers, bounce the whole frame */
+	all = (nb > LPC_NUM_BOUNCE_BUFFS);
+	if (all) {
+		dn = nb = 1;
 	}
-#endif
 
+	/* Wait until enough descriptors and bounce buffers are available */
+	/* THIS WILL BLOCK UNTIL THERE ARE ENOUGH AVAILABLE */
+	if ((dn > (u32_t) lpc_tx_ready(netif)) || (nb > lpc_netifdata->bounce_free)) {
+		lpc_netifdata->tx_stats.waits++;
+	}
+	while ((dn > (u32_t) lpc_tx_ready(netif)) || (nb > lpc_netifdata->bounce_free))
+#else
 	/* Zero-copy TX buffers may be fragmented across mutliple payload
 	   chains. Determine the number of descriptors needed for the
 	   transfer. The pbuf chaining can be a mess! */
@@ -419,11 +580,19 @@ static err_t lpc_low_level_output(struct netif *netif, struct pbuf *sendp)
 
 	/* Wait until enough descriptors are available for the transfer. */
 	/* THIS WILL BLOCK UNTIL THERE ARE ENOUGH DESCRIPTORS AVAILABLE */
-	while (dn > lpc_tx_ready(netif))
+	if (dn > (u32_t) lpc_tx_ready(netif)) {
+		lpc_netifdata->tx_stats.waits++;
+	}
+	while (dn > (u32_t) lpc_tx_ready(netif))
+#endif
 #if NO_SYS == 0
 	{xSemaphoreTake(lpc_netifdata->xTXDCountSem, 0); }
 #else
-	{msDelay(1); }
+	/* Without an RTOS nothing else reclaims descriptors while this waits */
+	{
+		msDelay(1);
+		lpc_tx_reclaim(netif);
+	}
 #endif
 
 	/* Get the next free descriptor index */
@@ -434,40 +603,63 @@ static err_t lpc_low_level_output(struct netif *netif, struct pbuf *sendp)
 	sys_mutex_lock(&lpc_netifdata->TXLockMutex);
 #endif
 
+	/* Increment reference count on this packet so LWIP doesn't
+	   attempt to free it on return from this call. It is freed
+	   once the last descriptor has been sent. */
+	pbuf_ref(sendp);
+
 	/* Fill in the next free descriptor(s) */
 	while (dn > 0) {
 		dn--;
 
+		buff = (u32_t) p->payload;
+		len = p->len;
+#if LPC_CHECK_SLOWMEM == 1
+		lpc_netifdata->txbounce[idx] = LPC_NO_BOUNCE;
+		if (all || lpc_tx_needs_bounce(p->payload)) {
+			/* Copy this fragment and any that follow it in memory
+			   that also needs bouncing into a bounce buffer */
+			for (bounce = 0;
+				 !(lpc_netifdata->bounce_free_mask & (1 << bounce)); bounce++) {}
+			lpc_netifdata->bounce_free_mask &= ~(1 << bounce);
+			lpc_netifdata->bounce_free--;
+			lpc_netifdata->txbounce[idx] = (u8_t) bounce;
+
+			dst = (u8_t *) lpc_bounce_buffs[bounce];
+			len = 0;
+			do {
+				LWIP_ASSERT("lpc_low_level_output: frame larger than a bounce buffer",
+							(len + p->len) <= EMAC_ETH_MAX_FLEN);
+				MEMCPY(dst + len, (u8_t *) p->payload, p->len);
+				len += p->len;
+				lpc_netifdata->tx_stats.bounced_frags++;
+				p = p->next;
+			} while ((p != NULL) && (all || lpc_tx_needs_bounce(p->payload)));
+			lpc_netifdata->tx_stats.bounced_bytes += len;
+			buff = (u32_t) dst;
+		}
+		else {
+			p = p->next;
+		}
+#else
+		p = p->next;
+#endif
+
 		/* Setup packet address and length */
-		lpc_netifdata->ptdesc[idx].B1ADD = (u32_t) p->payload;
-		lpc_netifdata->ptdesc[idx].BSIZE = (u32_t) TDES_ENH_BS1(p->len);
+		lpc_netifdata->ptdesc[idx].B1ADD = buff;
+		lpc_netifdata->ptdesc[idx].BSIZE = (u32_t) TDES_ENH_BS1(len);
 
-		/* Save pointer to pbuf so we can reclain the memory for
-		   the pbuf after the buffer has been sent. Only the first
-		   pbuf in a chain is saved since the full chain doesn't
-		   need to be freed. */
 		/* For first packet only, first flag */
 		lpc_netifdata->tx_free_descs--;
 		if (idx == fidx) {
 			lpc_netifdata->ptdesc[idx].CTRLSTAT |= TDES_ENH_FS;
-#if LPC_CHECK_SLOWMEM == 1
-			/* If this is a copied pbuf, then avoid getting the extra reference
-			   or the TX reclaim will be off by 1 */
-			if (!pcopy) {
-				pbuf_ref(p);
-			}
-#else
-			/* Increment reference count on this packet so LWIP doesn't
-			   attempt to free it on return from this call */
-			pbuf_ref(p);
-#endif
 		}
 		else {
 			lpc_netifdata->ptdesc[idx].CTRLSTAT |= TDES_OWN;
 		}
 
 		/* Save address of pbuf, but make sure it's associated with the
-		   first chained pbuf so it gets freed once all pbuf chains are
+		   last descriptor so it gets freed once all pbuf chains are
 		   transferred. */
 		if (!dn) {
 			lpc_netifdata->txpbufs[idx] = sendp;
@@ -487,7 +679,7 @@ static err_t lpc_low_level_output(struct netif *netif, struct pbuf *sendp)
 
 		LWIP_DEBUGF(EMAC_DEBUG | LWIP_DBG_TRACE,
 					("lpc_low_level_output: pbuf packet %p sent, chain %d,"
-					 " size %d, index %d, free %d\n", p, dn, p->len, idx,
+					 " size %d, index %d, free %d\n", sendp, dn, len, idx,
 					 lpc_netifdata->tx_free_descs));
 
 		/* Update next available descriptor */
@@ -495,14 +687,12 @@ static err_t lpc_low_level_output(struct netif *netif, struct pbuf *sendp)
 		if (idx >= LPC_NUM_BUFF_TXDESCS) {
 			idx = 0;
 		}
-
-		/* Next packet fragment */
-		p = p->next;
 	}
 
 	lpc_netifdata->tx_fill_idx = idx;
 
 	LINK_STATS_INC(link.xmit);
+	lpc_netifdata->tx_stats.frames++;
 
 	/* Give first descriptor to DMA to start transfer */
 	lpc_netifdata->ptdesc[fidx].CTRLSTAT |= TDES_OWN;
@@ -533,19 +723,45 @@ static err_t lpc_etharp_output(struct netif *netif, struct pbuf *q,
 
 #if NO_SYS == 0
 /* Packet reception task
-   This task is called when a packet is received. It will
-   pass the packet to the LWIP core */
+   This task is woken by the first received packet. The RX interrupt
+   stays masked while the task polls the ring in budgeted passes, and
+   is unmasked again once the ring is empty. */
 static portTASK_FUNCTION(vPacketReceiveTask, pvParameters) {
 	struct lpc_enetdata *lpc_netifdata = pvParameters;
+	int lowered = 0;
 
 	while (1) {
-		/* Wait for receive task to wakeup */
-		sys_arch_sem_wait(&lpc_netifdata->RxSem, 0);
+		/* Wait for receive task to wakeup. With no RX pbufs queued no
+		   interrupt can come, so retry the refill every millisecond. */
+		sys_arch_sem_wait(&lpc_netifdata->RxSem,
+						  (lpc_netifdata->rx_free_descs == LPC_NUM_BUFF_RXDESCS) ? 1 : 0);
+
+		while (1) {
+			/* Process receive packets. Once a pass uses its full budget
+			   the load is more than the RX interrupt rate, keep polling
+			   at low priority so the other tasks still get the CPU. */
+			while (lpc_rx_poll(lpc_netifdata->netif, LPC_RX_BUDGET) == LPC_RX_BUDGET) {
+				if (!lowered) {
+					vTaskPrioritySet(NULL, tskRXPOLL_PRIORITY);
+					lowered = 1;
+				}
+				else {
+					taskYIELD();
+				}
+			}
+			if (lowered) {
+				vTaskPrioritySet(NULL, tskRECPKT_PRIORITY);
+				lowered = 0;
+			}
 
-		/* Process receive packets */
-		while (!(lpc_netifdata->prdesc[lpc_netifdata->rx_get_idx].STATUS
-				 & RDES_OWN)) {
-			lpc_enetif_input(lpc_netifdata->netif);
+			/* Ring drained, unmask the RX interrupt. A frame completed
+			   before the unmask had its status cleared, check again. */
+			LPC_ETHERNET->DMA_STAT = LPC_RX_INT_STATUS;
+			LPC_ETHERNET->DMA_INT_EN |= LPC_RX_INTS;
+			if (!lpc_rx_pending(lpc_netifdata)) {
+				break;
+			}
+			LPC_ETHERNET->DMA_INT_EN &= ~LPC_RX_INTS;
 		}
 	}
 }
@@ -571,6 +787,9 @@ static portTASK_FUNCTION(vTransmitCleanupTask, pvParameters) {
 static err_t low_level_init(struct netif *netif)
 {
 	struct lpc_enetdata *lpc_netifdata = netif->state;
+#if LPC_CHECK_SLOWMEM == 1
+	u32_t idx;
+#endif
 
 	/* Initialize via Chip ENET function */
 	Chip_ENET_Init(LPC_ETHERNET);
@@ -619,6 +838,25 @@ static err_t low_level_init(struct netif *netif)
 	/* Flush transmit FIFO */
 	LPC_ETHERNET->DMA_OP_MODE = DMA_OM_FTF;
 
+#if LPC_CHECK_SLOWMEM == 1
+	/* A slow region the DMA reads in place could underrun the TX FIFO in
+	   threshold mode, buffer whole frames before sending */
+	for (idx = 0; idx < (sizeof(slmem) / sizeof(slmem[0])); idx++) {
+		if (slmem[idx].flags & LPC_SLOWMEM_DMA) {
+			LPC_ETHERNET->DMA_OP_MODE |= DMA_OM_TSF;
+		}
+	}
+#endif
+
+#if LPC_CHECKSUM_OFFLOAD == 1
+	/* TCP/UDP/ICMP checksum insertion needs the whole frame in the TX
+	   FIFO, it is skipped in threshold mode */
+	LPC_ETHERNET->DMA_OP_MODE |= DMA_OM_TSF;
+#endif
+
+	/* RX interrupt coalescing, see LPC_RX_INT_WDT */
+	LPC_ETHERNET->DMA_REC_INT_WDT = LPC_RX_INT_WDT;
+
 	/* Setup DMA to flush receive FIFOs at 32 bytes, service TX FIFOs at
 	   64 bytes */
 	LPC_ETHERNET->DMA_OP_MODE |= DMA_OM_RTC(1) | DMA_OM_TTC(0);
@@ -690,8 +928,6 @@ s32_t lpc_rx_queue(struct netif *netif)
 /* Attempt to read a packet from the EMAC interface */
 void lpc_enetif_input(struct netif *netif)
 {
-	struct eth_hdr *ethhdr;
-
 	struct pbuf *p;
 
 	/* move received packet into a new pbuf */
@@ -700,30 +936,69 @@ void lpc_enetif_input(struct netif *netif)
 		return;
 	}
 
-	/* points to packet payload, which starts with an Ethernet header */
-	ethhdr = p->payload;
+	/* Attempt to queue a new pbuf for the descriptor */
+	lpc_rx_refill(netif);
 
-	switch (htons(ethhdr->type)) {
-	case ETHTYPE_IP:
-	case ETHTYPE_ARP:
-#if PPPOE_SUPPORT
-	case ETHTYPE_PPPOEDISC:
-	case ETHTYPE_PPPOE:
-#endif /* PPPOE_SUPPORT */
-		/* full packet send to tcpip_thread to process */
-		if (netif->input(p, netif) != ERR_OK) {
-			LWIP_DEBUGF(NETIF_DEBUG,
-						("lpc_enetif_input: IP input error\n"));
-			/* Free buffer */
-			pbuf_free(p);
+	lpc_enetif_deliver(netif, p);
+}
+
+/* Receive poll pass */
+s32_t lpc_rx_poll(struct netif *netif, s32_t budget)
+{
+	struct lpc_enetdata *lpc_netifdata = netif->state;
+	struct pbuf *p;
+	u32_t missed;
+	s32_t frames = 0;
+
+	while (frames < budget) {
+		/* Refill in batches rather than per frame */
+		if (lpc_netifdata->rx_free_descs >= LPC_RX_REFILL_BATCH) {
+			lpc_rx_refill(netif);
+		}
+		if (!lpc_rx_pending(lpc_netifdata)) {
+			break;
 		}
-		break;
 
-	default:
-		/* Return buffer */
-		pbuf_free(p);
-		break;
+		/* Errored frames are requeued and return NULL, they still
+		   count against the budget */
+		p = lpc_low_level_input(netif);
+		frames++;
+		if (p != NULL) {
+			lpc_enetif_deliver(netif, p);
+		}
+	}
+
+	/* Hand every free descriptor back before the ring is left alone */
+	if (lpc_netifdata->rx_free_descs > 0) {
+		lpc_rx_refill(netif);
 	}
+
+	/* Frames dropped by the MAC, the counters clear on read */
+	missed = LPC_ETHERNET->DMA_MFRM_BUFOF;
+	lpc_netifdata->rx_stats.missed += (missed & DMA_MFRM_FMCMSK) + DMA_MFRM_FMA(missed);
+
+	lpc_netifdata->rx_stats.passes++;
+	lpc_netifdata->rx_stats.frames += frames;
+	if (frames == budget) {
+		lpc_netifdata->rx_stats.budget_hits++;
+	}
+	if ((u32_t) frames > lpc_netifdata->rx_stats.max_pass) {
+		lpc_netifdata->rx_stats.max_pass = frames;
+	}
+
+	return frames;
+}
+
+/* Returns the transmit statistics */
+void lpc_tx_get_stats(struct netif *netif, struct lpc_tx_stats *stats)
+{
+	*stats = ((struct lpc_enetdata *) netif->state)->tx_stats;
+}
+
+/* Returns the receive poll statistics */
+void lpc_rx_get_stats(struct netif *netif, struct lpc_rx_stats *stats)
+{
+	*stats = ((struct lpc_enetdata *) netif->state)->rx_stats;
 }
 
 /* Call for freeing TX buffers that are complete */
@@ -779,6 +1054,15 @@ void lpc_tx_reclaim(struct netif *netif)
 			pbuf_free(lpc_netifdata->txpbufs[ridx]);
 		}
 
+#if LPC_CHECK_SLOWMEM == 1
+		/* Return the bounce buffer used by this descriptor */
+		if (lpc_netifdata->txbounce[ridx] != LPC_NO_BOUNCE) {
+			lpc_netifdata->bounce_free_mask |= 1 << lpc_netifdata->txbounce[ridx];
+			lpc_netifdata->bounce_free++;
+			lpc_netifdata->txbounce[ridx] = LPC_NO_BOUNCE;
+		}
+#endif
+
 		/* Reclaim this descriptor */
 		lpc_netifdata->tx_free_descs++;
 #if NO_SYS == 0
@@ -822,8 +1106,13 @@ void ETH_IRQHandler(void)
 	/* Get pending interrupts */
 	ints = LPC_ETHERNET->DMA_STAT;
 
-	/* RX group interrupt(s) */
-	if (ints & (DMA_ST_RI | DMA_ST_OVF | DMA_ST_RU)) {
+	/* RX group interrupt(s). Status still latches while the RX interrupt
+	   is masked, the receive task is polling then. */
+	if ((ints & LPC_RX_INT_STATUS) && (LPC_ETHERNET->DMA_INT_EN & DMA_IE_RIE)) {
+		/* Mask RX interrupts until the receive task has drained the ring */
+		LPC_ETHERNET->DMA_INT_EN &= ~LPC_RX_INTS;
+		lpc_enetdata.rx_stats.interrupts++;
+
 		/* Give semaphore to wakeup RX receive task. Note the FreeRTOS
 		   method is used instead of the LWIP arch method. */
 		xSemaphoreGiveFromISR(lpc_enetdata.RxSem, &xRecTaskWoken);
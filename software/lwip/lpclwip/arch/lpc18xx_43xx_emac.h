@@ -53,6 +53,40 @@ extern "C"
  * @{
  */
 
+/**
+ * @brief	LPC_SLOWMEM_ARRAY region flag
+ * By default TX payloads in an LPC_SLOWMEM_ARRAY region are copied to a
+ * bounce buffer before the DMA sends them. A region given this flag as
+ * its third field is read by the DMA in place instead, and the TX DMA
+ * switches to store and forward so the slow reads can't underrun the FIFO.
+ * For example {{0x14000000, 0x143FFFFF, LPC_SLOWMEM_DMA}} for SPIFI.
+ */
+#define LPC_SLOWMEM_DMA     (1 << 0)
+
+/**
+ * @brief	Transmit statistics, see lpc_tx_get_stats()
+ */
+struct lpc_tx_stats {
+	u32_t frames;			/**< Frames queued to the DMA */
+	u32_t bounced_frags;	/**< pbuf fragments copied to a bounce buffer */
+	u32_t bounced_bytes;	/**< Bytes copied to bounce buffers */
+	u32_t waits;			/**< Frames that waited for descriptors or bounce buffers */
+};
+
+/**
+ * @brief	Receive poll statistics, see lpc_rx_get_stats()
+ */
+struct lpc_rx_stats {
+	u32_t interrupts;	/**< RX interrupts taken, each masks RX until the ring is drained */
+	u32_t passes;		/**< Poll passes run */
+	u32_t frames;		/**< Frames taken off the ring, errored ones included */
+	u32_t budget_hits;	/**< Passes that used their full budget */
+	u32_t max_pass;		/**< Most frames taken in one pass */
+	u32_t refills;		/**< Batched RX descriptor refills */
+	u32_t alloc_fails;	/**< Refills that ran out of pbufs before every descriptor was queued */
+	u32_t missed;		/**< Frames the MAC dropped for lack of descriptors or FIFO space */
+};
+
 /**
  * @brief	Attempt to read a packet from the EMAC interface
  * @param	netif	: lwip network interface structure pointer
@@ -67,6 +101,26 @@ void lpc_enetif_input(struct netif *netif);
  */
 s32_t lpc_rx_queue(struct netif *netif);
 
+/**
+ * @brief	Receive poll pass
+ * @param	netif	: lwip network interface structure pointer
+ * @param	budget	: Maximum number of frames to take off the RX ring
+ * @return	The number of frames taken, budget if more may be waiting
+ * @note	Passes up to budget received frames to LWIP and refills the RX
+ * descriptors in batches of LPC_RX_REFILL_BATCH. With an RTOS the receive
+ * thread calls this with the RX interrupt masked. Without one it can be
+ * called from the main loop in place of lpc_enetif_input().
+ */
+s32_t lpc_rx_poll(struct netif *netif, s32_t budget);
+
+/**
+ * @brief	Returns the receive poll statistics
+ * @param	netif	: lwip network interface structure pointer
+ * @param	stats	: Pointer to the statistics to fill in
+ * @return	Nothing
+ */
+void lpc_rx_get_stats(struct netif *netif, struct lpc_rx_stats *stats);
+
 /**
  * @brief	Polls if an available TX descriptor is ready
  * @param	netif	: lwip network interface structure pointer
@@ -82,6 +136,14 @@ s32_t lpc_tx_ready(struct netif *netif);
  */
 void lpc_tx_reclaim(struct netif *netif);
 
+/**
+ * @brief	Returns the transmit statistics
+ * @param	netif	: lwip network interface structure pointer
+ * @param	stats	: Pointer to the statistics to fill in
+ * @return	Nothing
+ */
+void lpc_tx_get_stats(struct netif *netif, struct lpc_tx_stats *stats);
+
 /**
  * @brief	LWIP 18xx/43xx EMAC initialization function
  * @param	netif	: lwip network interface structure pointer
@@ -0,0 +1,219 @@
+/*
+ * @brief LWIP checksum routines for the Cortex-M3/M4
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+/** @defgroup NET_LWIP_CHKSUM LWIP checksum routines
+ * @ingroup NET_LWIP
+ * LWIP_CHKSUM and LWIP_CHKSUM_COPY for the Cortex-M3/M4, see cc.h
+ * @{
+ */
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* The sum is kept in 64 bits so each 32-bit word costs an ADDS/ADC pair
+   and the carries are only folded back in once at the end. A native
+   word adds both of its 16-bit halves, so the result is the same as the
+   16-bit sum lwIP's reference routines make, in host order. */
+static u16_t lpc_chksum_fold(uint64_t acc, int odd)
+{
+	u32_t sum;
+
+	acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+	acc = (acc >> 32) + (acc & 0xFFFFFFFF);
+	sum = (u32_t) acc;
+	sum = (sum >> 16) + (sum & 0xFFFF);
+	sum = (sum >> 16) + (sum & 0xFFFF);
+
+	/* Data that started at an odd address was summed byte swapped */
+	if (odd) {
+		sum = ((sum & 0xFF) << 8) | ((sum & 0xFF00) >> 8);
+	}
+
+	return (u16_t) sum;
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Internet checksum of a buffer, not inverted and in host order */
+u16_t lpc_chksum(void *dataptr, int len)
+{
+	const u8_t *pb = (const u8_t *) dataptr;
+	const u32_t *pw;
+	uint64_t acc = 0;
+	u16_t t = 0;
+	int odd = ((mem_ptr_t) pb & 1);
+
+	/* Get aligned to u16_t. A leading odd byte is the high byte of its
+	   16-bit word, a trailing one the low byte. */
+	if (odd && (len > 0)) {
+		((u8_t *) &t)[1] = *pb++;
+		len--;
+	}
+
+	/* Get aligned to u32_t */
+	if (((mem_ptr_t) pb & 2) && (len >= 2)) {
+		acc += *(const u16_t *) (const void *) pb;
+		pb += 2;
+		len -= 2;
+	}
+
+	/* Add the bulk of the data 32 bytes at a time */
+	pw = (const u32_t *) (const void *) pb;
+	while (len >= 32) {
+		acc += pw[0];
+		acc += pw[1];
+		acc += pw[2];
+		acc += pw[3];
+		acc += pw[4];
+		acc += pw[5];
+		acc += pw[6];
+		acc += pw[7];
+		pw += 8;
+		len -= 32;
+	}
+	while (len >= 4) {
+		acc += *pw++;
+		len -= 4;
+	}
+
+	/* Remaining half word and byte */
+	pb = (const u8_t *) pw;
+	if (len >= 2) {
+		acc += *(const u16_t *) (const void *) pb;
+		pb += 2;
+		len -= 2;
+	}
+	if (len > 0) {
+		((u8_t *) &t)[0] = *pb;
+	}
+	acc += t;
+
+	return lpc_chksum_fold(acc, odd);
+}
+
+/* Copies a buffer and returns its checksum, as lpc_chksum() of the copy */
+u16_t lpc_chksum_copy(void *dst, const void *src, u16_t len)
+{
+	u8_t *db = (u8_t *) dst;
+	const u8_t *sb = (const u8_t *) src;
+	u32_t *dw;
+	const u32_t *sw;
+	uint64_t acc = 0;
+	u32_t w0, w1, w2, w3;
+	u16_t t = 0, h;
+	int n = len;
+	int odd = ((mem_ptr_t) db & 1);
+
+	/* Word copies need the source and destination equally aligned. lwIP
+	   mostly copies between pbuf payloads that are, otherwise copy first
+	   and sum the copy while it is still fresh. */
+	if (((mem_ptr_t) db ^ (mem_ptr_t) sb) & 3) {
+		MEMCPY(dst, src, len);
+		return lpc_chksum(dst, len);
+	}
+
+	if (odd && (n > 0)) {
+		((u8_t *) &t)[1] = *db++ = *sb++;
+		n--;
+	}
+	if (((mem_ptr_t) db & 2) && (n >= 2)) {
+		h = *(const u16_t *) (const void *) sb;
+		*(u16_t *) (void *) db = h;
+		acc += h;
+		sb += 2;
+		db += 2;
+		n -= 2;
+	}
+
+	/* Copy and add the bulk of the data 16 bytes at a time */
+	sw = (const u32_t *) (const void *) sb;
+	dw = (u32_t *) (void *) db;
+	while (n >= 16) {
+		w0 = sw[0];
+		w1 = sw[1];
+		w2 = sw[2];
+		w3 = sw[3];
+		dw[0] = w0;
+		dw[1] = w1;
+		dw[2] = w2;
+		dw[3] = w3;
+		acc += w0;
+		acc += w1;
+		acc += w2;
+		acc += w3;
+		sw += 4;
+		dw += 4;
+		n -= 16;
+	}
+	while (n >= 4) {
+		w0 = *sw++;
+		*dw++ = w0;
+		acc += w0;
+		n -= 4;
+	}
+
+	sb = (const u8_t *) sw;
+	db = (u8_t *) dw;
+	if (n >= 2) {
+		h = *(const u16_t *) (const void *) sb;
+		*(u16_t *) (void *) db = h;
+		acc += h;
+		sb += 2;
+		db += 2;
+		n -= 2;
+	}
+	if (n > 0) {
+		((u8_t *) &t)[0] = *db = *sb;
+	}
+	acc += t;
+
+	return lpc_chksum_fold(acc, odd);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,390 @@
+/*
+ * @brief Host fuzzer and benchmark for the lpc_chksum.c checksum routines
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+/*
+ * Runs lpc_chksum() and lpc_chksum_copy() on a (little endian) host next
+ * to lwIP's three reference LWIP_CHKSUM_ALGORITHMs, built from an
+ * unmodified inet_chksum.c.
+ *
+ * fuzz	checks every routine against a byte wise RFC 1071 sum for random
+ *		lengths, alignments and data, and that lpc_chksum_copy() copies
+ *		exactly len bytes.
+ * bench	prints ns per call and MB/s for frame sized buffers. Host numbers
+ *		only rank the routines; a Cortex-M has no cache and the loop
+ *		costs differ, measure on the target before tuning further.
+ *
+ * Build and run, from software/lwip:
+ *
+ * gcc -O2 -Ilpclwip -Ilwip/src -Ilwip/src/include -Ilwip/src/include/ipv4 \
+ *     -I../../applications/lpc18xx_43xx/examples/lwip/lwip_tcpecho_sa \
+ *     lpclwip/tools/chksumtest.c lpclwip/arch/lpc_chksum.c lwip/src/core/def.c \
+ *     -o chksumtest
+ * ./chksumtest fuzz [iterations] [seed]
+ * ./chksumtest bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The reference algorithms. inet_chksum.c is included once per algorithm
+   with its public functions renamed, inet_chksum() returns the inverted
+   sum of each. */
+#define LWIP_CHKSUM lwip_standard_chksum
+
+#define LWIP_CHKSUM_ALGORITHM 1
+#define lwip_standard_chksum ref1_chksum
+#define inet_chksum ref1_inet_chksum
+#define inet_chksum_pbuf ref1_inet_chksum_pbuf
+#define inet_chksum_pseudo ref1_inet_chksum_pseudo
+#define inet_chksum_pseudo_partial ref1_inet_chksum_pseudo_partial
+#define lwip_chksum_copy ref1_chksum_copy
+#include "core/ipv4/inet_chksum.c"
+#undef LWIP_CHKSUM_ALGORITHM
+#undef lwip_standard_chksum
+#undef inet_chksum
+#undef inet_chksum_pbuf
+#undef inet_chksum_pseudo
+#undef inet_chksum_pseudo_partial
+#undef lwip_chksum_copy
+
+#define LWIP_CHKSUM_ALGORITHM 2
+#define lwip_standard_chksum ref2_chksum
+#define inet_chksum ref2_inet_chksum
+#define inet_chksum_pbuf ref2_inet_chksum_pbuf
+#define inet_chksum_pseudo ref2_inet_chksum_pseudo
+#define inet_chksum_pseudo_partial ref2_inet_chksum_pseudo_partial
+#define lwip_chksum_copy ref2_chksum_copy
+#include "core/ipv4/inet_chksum.c"
+#undef LWIP_CHKSUM_ALGORITHM
+#undef lwip_standard_chksum
+#undef inet_chksum
+#undef inet_chksum_pbuf
+#undef inet_chksum_pseudo
+#undef inet_chksum_pseudo_partial
+#undef lwip_chksum_copy
+
+#define LWIP_CHKSUM_ALGORITHM 3
+#define lwip_standard_chksum ref3_chksum
+#define inet_chksum ref3_inet_chksum
+#define inet_chksum_pbuf ref3_inet_chksum_pbuf
+#define inet_chksum_pseudo ref3_inet_chksum_pseudo
+#define inet_chksum_pseudo_partial ref3_inet_chksum_pseudo_partial
+#define lwip_chksum_copy ref3_chksum_copy
+#include "core/ipv4/inet_chksum.c"
+#undef LWIP_CHKSUM_ALGORITHM
+#undef lwip_standard_chksum
+#undef inet_chksum
+#undef inet_chksum_pbuf
+#undef inet_chksum_pseudo
+#undef inet_chksum_pseudo_partial
+#undef lwip_chksum_copy
+
+#undef LWIP_CHKSUM
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define MAX_LEN 65535
+#define GUARD   64
+
+typedef u16_t (*chksum_fn)(void *dataptr, int len);
+
+static u8_t srcbuf[MAX_LEN + GUARD * 2];
+static u8_t dstbuf[MAX_LEN + GUARD * 2];
+static u8_t expbuf[MAX_LEN + GUARD * 2];
+
+static volatile u16_t sink;
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static u16_t ref1(void *dataptr, int len)
+{
+	return (u16_t) ~ref1_inet_chksum(dataptr, (u16_t) len);
+}
+
+static u16_t ref2(void *dataptr, int len)
+{
+	return (u16_t) ~ref2_inet_chksum(dataptr, (u16_t) len);
+}
+
+static u16_t ref3(void *dataptr, int len)
+{
+	return (u16_t) ~ref3_inet_chksum(dataptr, (u16_t) len);
+}
+
+/* RFC 1071 sum of big endian byte pairs, returned in host order the way
+   LWIP_CHKSUM does on a little endian machine */
+static u16_t rfc1071(const u8_t *p, int len)
+{
+	u32_t sum = 0;
+	int i;
+
+	for (i = 0; (i + 1) < len; i += 2) {
+		sum += (p[i] << 8) | p[i + 1];
+	}
+	if (len & 1) {
+		sum += p[len - 1] << 8;
+	}
+	while (sum >> 16) {
+		sum = (sum >> 16) + (sum & 0xFFFF);
+	}
+
+	return (u16_t) (((sum & 0xFF) << 8) | (sum >> 8));
+}
+
+static u32_t rnd(void)
+{
+	static u32_t x = 2463534242u;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static int rnd_len(void)
+{
+	switch (rnd() & 7) {
+	case 0:
+		return rnd() % 8;
+
+	case 1:
+		return MAX_LEN - (rnd() % 64);
+
+	case 2:
+		return rnd() % (MAX_LEN + 1);
+
+	default:
+		return rnd() % 1600;
+	}
+}
+
+/* Random bytes, or runs of 0x00/0xFF that stress the carry folding */
+static void rnd_fill(u8_t *p, int len)
+{
+	int i;
+	u32_t mode = rnd() & 3;
+
+	for (i = 0; i < len; i++) {
+		switch (mode) {
+		case 0:
+			p[i] = 0xFF;
+			break;
+
+		case 1:
+			p[i] = (rnd() & 15) ? 0xFF : (u8_t) rnd();
+			break;
+
+		case 2:
+			p[i] = (rnd() & 15) ? 0x00 : (u8_t) rnd();
+			break;
+
+		default:
+			p[i] = (u8_t) rnd();
+			break;
+		}
+	}
+}
+
+static int fuzz(long iterations, u32_t seed)
+{
+	static const struct {
+		const char *name;
+		chksum_fn fn;
+	} fns[] = {
+		{"lpc_chksum", lpc_chksum},
+		{"algorithm 1", ref1},
+		{"algorithm 2", ref2},
+		{"algorithm 3", ref3},
+	};
+	long it, fails = 0;
+	int len, so, doff, i;
+	u16_t exp, got;
+
+	while (seed--) {
+		rnd();
+	}
+
+	for (it = 0; (it < iterations) && (fails < 10); it++) {
+		len = rnd_len();
+		so = GUARD + (rnd() % 8);
+		doff = GUARD + (rnd() % 8);
+		rnd_fill(srcbuf + so, len);
+		exp = rfc1071(srcbuf + so, len);
+
+		for (i = 0; i < (int) (sizeof(fns) / sizeof(fns[0])); i++) {
+			got = fns[i].fn(srcbuf + so, len);
+			if (got != exp) {
+				printf("%s: len %d offset %d: 0x%04x, expected 0x%04x\n",
+					   fns[i].name, len, so & 7, got, exp);
+				fails++;
+			}
+		}
+
+		memset(dstbuf, 0xA5, sizeof(dstbuf));
+		memset(expbuf, 0xA5, sizeof(expbuf));
+		memcpy(expbuf + doff, srcbuf + so, len);
+		got = lpc_chksum_copy(dstbuf + doff, srcbuf + so, (u16_t) len);
+		if (got != exp) {
+			printf("lpc_chksum_copy: len %d offsets %d/%d: 0x%04x, expected 0x%04x\n",
+				   len, so & 7, doff & 7, got, exp);
+			fails++;
+		}
+		if (memcmp(dstbuf, expbuf, len + GUARD * 2) != 0) {
+			printf("lpc_chksum_copy: len %d offsets %d/%d: copy differs\n",
+				   len, so & 7, doff & 7);
+			fails++;
+		}
+	}
+
+	printf("%ld iterations, %ld failures\n", it, fails);
+	return fails ? 1 : 0;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+/* Best of several runs of a batch of calls, in ns per call */
+static double time_sum(chksum_fn fn, u8_t *p, int len)
+{
+	double best = 1e30, t;
+	long calls = 4000000 / (len + 64) + 100;
+	long i;
+	int run;
+
+	for (run = 0; run < 7; run++) {
+		t = now_ns();
+		for (i = 0; i < calls; i++) {
+			sink = fn(p, len);
+		}
+		t = (now_ns() - t) / calls;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	return best;
+}
+
+static u16_t ref_copy(void *dst, const void *src, u16_t len)
+{
+	memcpy(dst, src, len);
+	return ref2(dst, len);
+}
+
+static double time_copy(u16_t (*fn)(void *, const void *, u16_t), u8_t *d, u8_t *s, int len)
+{
+	double best = 1e30, t;
+	long calls = 4000000 / (len + 64) + 100;
+	long i;
+	int run;
+
+	for (run = 0; run < 7; run++) {
+		t = now_ns();
+		for (i = 0; i < calls; i++) {
+			sink = fn(d, s, (u16_t) len);
+		}
+		t = (now_ns() - t) / calls;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	return best;
+}
+
+static void bench(void)
+{
+	static const int lens[] = {20, 64, 576, 1460};
+	int i, odd;
+	double t1, t2, t3, tl, tc, tf;
+
+	rnd_fill(srcbuf, sizeof(srcbuf));
+
+	printf("%5s %4s  %-18s %-18s %-18s %-18s\n", "len", "odd", "algorithm 1",
+		   "algorithm 2", "algorithm 3", "lpc_chksum");
+	for (i = 0; i < (int) (sizeof(lens) / sizeof(lens[0])); i++) {
+		for (odd = 0; odd < 2; odd++) {
+			t1 = time_sum(ref1, srcbuf + GUARD + odd, lens[i]);
+			t2 = time_sum(ref2, srcbuf + GUARD + odd, lens[i]);
+			t3 = time_sum(ref3, srcbuf + GUARD + odd, lens[i]);
+			tl = time_sum(lpc_chksum, srcbuf + GUARD + odd, lens[i]);
+			printf("%5d %4d  %6.1fns %6.0fMB/s  %6.1fns %6.0fMB/s  %6.1fns %6.0fMB/s  %6.1fns %6.0fMB/s\n",
+				   lens[i], odd, t1, lens[i] * 1e3 / t1, t2, lens[i] * 1e3 / t2,
+				   t3, lens[i] * 1e3 / t3, tl, lens[i] * 1e3 / tl);
+		}
+	}
+
+	printf("\n%5s %4s  %-18s %-18s\n", "len", "odd", "memcpy + alg. 2", "lpc_chksum_copy");
+	for (i = 0; i < (int) (sizeof(lens) / sizeof(lens[0])); i++) {
+		for (odd = 0; odd < 2; odd++) {
+			tc = time_copy(ref_copy, dstbuf + GUARD + odd, srcbuf + GUARD + odd, lens[i]);
+			tf = time_copy(lpc_chksum_copy, dstbuf + GUARD + odd, srcbuf + GUARD + odd, lens[i]);
+			printf("%5d %4d  %6.1fns %6.0fMB/s  %6.1fns %6.0fMB/s\n",
+				   lens[i], odd, tc, lens[i] * 1e3 / tc, tf, lens[i] * 1e3 / tf);
+		}
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* LWIP_PLATFORM_ASSERT() without LWIP_DEBUG */
+void assert_loop(void)
+{
+	abort();
+}
+
+int main(int argc, char *argv[])
+{
+	if ((argc >= 2) && (strcmp(argv[1], "fuzz") == 0)) {
+		return fuzz((argc >= 3) ? atol(argv[2]) : 100000,
+					(argc >= 4) ? (u32_t) atol(argv[3]) : 0);
+	}
+	if ((argc >= 2) && (strcmp(argv[1], "bench") == 0)) {
+		bench();
+		return 0;
+	}
+
+	printf("usage: %s fuzz [iterations] [seed] | bench\n", argv[0]);
+	return 2;
+}
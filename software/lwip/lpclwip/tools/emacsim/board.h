@@ -0,0 +1,25 @@
+/*
+
+	EMACSim stand-in for board.h. The board functions the EMAC driver and
+	PHY layer call are provided by emacsim.c.
+
+*/
+
+#ifndef __BOARD_H_
+#define __BOARD_H_
+
+#include "chip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*p_msDelay_func_t)(uint32_t);
+
+void Board_ENET_GetMacADDR(uint8_t *mcaddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
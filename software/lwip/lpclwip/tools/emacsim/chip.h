@@ -0,0 +1,54 @@
+/*
+
+	EMACSim stand-in for the LPC18xx/43xx chip layer.
+
+	The Ethernet register block is the real lpc_ip one, but LPC_ETHERNET
+	points at an ordinary variable that emacsim.c reads and writes the way
+	the MAC and DMA would. The Chip_ENET_ calls are the chip layer's,
+	minus the CREG/RGU/clock setup there is nothing to model for.
+
+*/
+
+#ifndef __CHIP_H_
+#define __CHIP_H_
+
+#include "lpc_types.h"
+#include "sys_config.h"
+#include "cmsis.h"
+#include "enet_001.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------*/
+typedef IP_ENET_001_T LPC_ENET_T;
+
+/* provided by emacsim.c */
+extern LPC_ENET_T emacsim_enet;
+#define LPC_ETHERNET		(&emacsim_enet)
+
+/*---------------------------------------------------------------------------*/
+static inline void Chip_ENET_Init(LPC_ENET_T *pENET)
+{
+	IP_ENET_Reset(pENET);
+	IP_ENET_SetupMII(pENET, 4, 1);
+	IP_ENET_Init(pENET);
+}
+
+static inline void Chip_ENET_DeInit(LPC_ENET_T *pENET)						{ IP_ENET_DeInit(pENET); }
+static inline void Chip_ENET_Reset(LPC_ENET_T *pENET)						{ IP_ENET_Reset(pENET); }
+static inline void Chip_ENET_SetADDR(LPC_ENET_T *pENET, const uint8_t *macAddr)	{ IP_ENET_SetADDR(pENET, macAddr); }
+static inline void Chip_ENET_SetupMII(LPC_ENET_T *pENET, uint32_t div, uint8_t addr)	{ IP_ENET_SetupMII(pENET, div, addr); }
+static inline void Chip_ENET_TXEnable(LPC_ENET_T *pENET)					{ pENET->MAC_CONFIG |= MAC_CFG_TE; }
+static inline void Chip_ENET_TXDisable(LPC_ENET_T *pENET)					{ pENET->MAC_CONFIG &= ~MAC_CFG_TE; }
+static inline void Chip_ENET_RXEnable(LPC_ENET_T *pENET)					{ pENET->MAC_CONFIG |= MAC_CFG_RE; }
+static inline void Chip_ENET_RXDisable(LPC_ENET_T *pENET)					{ pENET->MAC_CONFIG &= ~MAC_CFG_RE; }
+static inline void Chip_ENET_SetDuplex(LPC_ENET_T *pENET, bool full)		{ IP_ENET_SetDuplex(pENET, full); }
+static inline void Chip_ENET_SetSpeed(LPC_ENET_T *pENET, bool speed100)		{ IP_ENET_SetSpeed(pENET, speed100); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+/*
+
+	EMACSim stand-in for the CMSIS core header.
+
+	Only what lpc_ip/enet_001.h and the LPC18xx/43xx EMAC driver use. The
+	standalone (NO_SYS) driver never enables the EMAC interrupt, so the
+	NVIC calls are no-ops.
+
+*/
+
+#ifndef __CMSIS_H_
+#define __CMSIS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lpc_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------*/
+#define __I					volatile const
+#define __O					volatile
+#define __IO				volatile
+
+#ifndef __INLINE
+#define __INLINE			inline
+#endif
+
+/*---------------------------------------------------------------------------*/
+typedef enum
+{
+	ETHERNET_IRQn = 5
+} IRQn_Type;
+
+static inline void NVIC_EnableIRQ(IRQn_Type irq)	{ (void) irq; }
+static inline void NVIC_DisableIRQ(IRQn_Type irq)	{ (void) irq; }
+static inline void __disable_irq(void)				{ }
+static inline void __enable_irq(void)				{ }
+
+#define __DMB()				__sync_synchronize()
+#define __DSB()				__sync_synchronize()
+#define __ISB()				__asm__ __volatile__("" ::: "memory")
+#define __NOP()				__asm__ __volatile__("pause")
+#define __WFI()				__asm__ __volatile__("pause")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,939 @@
+/*
+ * @brief EMACSim, host model of the LPC18xx/43xx Ethernet MAC and DMA
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+/* See emacsim.h for what is modelled and how */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#include "chip.h"
+#include "board.h"
+#include "lpc_phy.h"
+#include "emacsim.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+/* Largest frame the MAC passes, VLAN tag included, and descriptors a TX
+   frame may span */
+#define EMACSIM_MAX_FRAME	1522
+#define EMACSIM_TX_FIFO		2048
+#define EMACSIM_TX_DESCS	32
+
+/* Enhanced descriptors are 8 words, DMA_BM_DSL is left at 0 */
+#define EMACSIM_DESC_SIZE	32
+
+/* Frame on the wire or in a FIFO */
+typedef struct {
+	uint64_t at;			/* arrival (RX) or transmit end (TX) time */
+	uint32_t len;
+	uint32_t ndesc;			/* TX descriptors to close at 'at' */
+	uint32_t desc[EMACSIM_TX_DESCS];
+	uint8_t data[EMACSIM_MAX_FRAME];
+} EMACSIM_FRAME_T;
+
+/* Frame queue, a power of 2 ring */
+typedef struct {
+	EMACSIM_FRAME_T *f;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t bytes;
+} EMACSIM_QUEUE_T;
+
+LPC_ENET_T emacsim_enet;
+
+static EmacSimOptions simopt;
+static EmacSimStats simstats;
+
+/* Virtual clock in ns, and the thread CPU time it was last synced to */
+static uint64_t now;
+static uint64_t cpu_mark;
+static uint64_t sync_cost;
+static uint64_t real_start;
+
+/* wire -> MAC in flight, the RX FIFO, and MAC -> wire in flight */
+static EMACSIM_QUEUE_T rxwire, rxfifo, txwire;
+static uint64_t rxwire_free, txwire_free;
+
+/* DMA state */
+static uint32_t rx_base, rx_cur, tx_base, tx_cur;
+static int rx_suspended;
+static uint32_t mfrm_bufof;
+
+static int tapfd = -1;
+
+static uint32_t crc_table[256];
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static uint64_t clock_ns(clockid_t id)
+{
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + (uint64_t) ts.tv_nsec;
+}
+
+static void *dma_ptr(uint32_t addr)
+{
+	return (void *) (uintptr_t) addr;
+}
+
+static void fatal(const char *msg)
+{
+	fprintf(stderr, "emacsim: %s\n", msg);
+	exit(2);
+}
+
+/* Frame queues */
+static void queue_init(EMACSIM_QUEUE_T *q, uint32_t size)
+{
+	q->f = calloc(size, sizeof(EMACSIM_FRAME_T));
+	if (q->f == NULL) {
+		fatal("out of memory");
+	}
+	q->size = size;
+	q->head = q->tail = q->bytes = 0;
+}
+
+static uint32_t queue_count(const EMACSIM_QUEUE_T *q)
+{
+	return q->head - q->tail;
+}
+
+static EMACSIM_FRAME_T *queue_peek(EMACSIM_QUEUE_T *q)
+{
+	return queue_count(q) ? &q->f[q->tail & (q->size - 1)] : NULL;
+}
+
+static EMACSIM_FRAME_T *queue_push(EMACSIM_QUEUE_T *q, const uint8_t *data, uint32_t len)
+{
+	EMACSIM_FRAME_T *f;
+
+	if (queue_count(q) == q->size) {
+		fatal("frame queue overflow");
+	}
+	f = &q->f[q->head++ & (q->size - 1)];
+	memcpy(f->data, data, len);
+	f->len = len;
+	f->ndesc = 0;
+	q->bytes += len;
+	return f;
+}
+
+static void queue_pop(EMACSIM_QUEUE_T *q)
+{
+	q->bytes -= q->f[q->tail++ & (q->size - 1)].len;
+}
+
+/* Ethernet FCS */
+static void crc_init(void)
+{
+	uint32_t i, j, c;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++) {
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		}
+		crc_table[i] = c;
+	}
+}
+
+static uint32_t crc32(const uint8_t *p, uint32_t len)
+{
+	uint32_t c = 0xFFFFFFFF;
+
+	while (len--) {
+		c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+	}
+	return ~c;
+}
+
+/* Internet checksum helpers */
+static uint32_t sum16(const uint8_t *p, uint32_t len, uint32_t acc)
+{
+	while (len > 1) {
+		acc += ((uint32_t) p[0] << 8) | p[1];
+		p += 2;
+		len -= 2;
+	}
+	if (len) {
+		acc += (uint32_t) p[0] << 8;
+	}
+	return acc;
+}
+
+static uint16_t fold16(uint32_t acc)
+{
+	acc = (acc >> 16) + (acc & 0xFFFF);
+	acc = (acc >> 16) + (acc & 0xFFFF);
+	return (uint16_t) acc;
+}
+
+static uint32_t pseudo_sum(const uint8_t *ip, uint32_t plen)
+{
+	uint32_t acc = sum16(ip + 12, 8, 0);
+
+	return acc + ip[9] + plen;
+}
+
+/* IPv4 layout of a frame. Returns 0 if it isn't an unfragmented IPv4
+   frame with a sane header. */
+static int ipv4_parse(const uint8_t *f, uint32_t len, uint32_t *hlen, uint32_t *plen, int *frag)
+{
+	uint32_t tot;
+
+	if ((len < 34) || (f[12] != 0x08) || (f[13] != 0x00) || ((f[14] >> 4) != 4)) {
+		return 0;
+	}
+	*hlen = (f[14] & 0x0F) * 4;
+	tot = ((uint32_t) f[16] << 8) | f[17];
+	if ((*hlen < 20) || (tot < *hlen) || ((14 + tot) > len)) {
+		return 0;
+	}
+	*plen = tot - *hlen;
+	*frag = ((f[20] & 0x3F) | f[21]) != 0;
+	return 1;
+}
+
+/* Offset of the checksum field in a TCP/UDP/ICMP header, or 0 */
+static uint32_t l4_csum_offset(uint8_t proto, uint32_t plen)
+{
+	switch (proto) {
+	case 1:
+		return (plen >= 4) ? 2 : 0;
+	case 6:
+		return (plen >= 20) ? 16 : 0;
+	case 17:
+		return (plen >= 8) ? 6 : 0;
+	}
+	return 0;
+}
+
+/* Receive checksum offload (MAC_CONFIG IPC, type 2). Returns RDES0 bits
+   and fills RDES4. */
+static uint32_t rx_coe(const uint8_t *f, uint32_t len, uint32_t *ext)
+{
+	const uint8_t *ip = f + 14;
+	uint32_t hlen, plen, off, acc, status = RDES_ESA;
+	int frag;
+
+	*ext = 0;
+	if (!ipv4_parse(f, len, &hlen, &plen, &frag)) {
+		return 0;
+	}
+	*ext = RDES_ENH_IPV4;
+	if (fold16(sum16(ip, hlen, 0)) != 0xFFFF) {
+		*ext |= RDES_ENH_IPHE;
+		status |= RDES_TSA | RDES_ES;
+		return status;
+	}
+	off = l4_csum_offset(ip[9], plen);
+	if (frag || !off) {
+		*ext |= RDES_ENH_IPCSB;
+		return status;
+	}
+	*ext |= (ip[9] == 17) ? 1 : ((ip[9] == 6) ? 2 : 3);
+	if ((ip[9] == 17) && !ip[hlen + 6] && !ip[hlen + 7]) {
+		return status;
+	}
+	acc = sum16(ip + hlen, plen, (ip[9] == 1) ? 0 : pseudo_sum(ip, plen));
+	if (fold16(acc) != 0xFFFF) {
+		*ext |= RDES_ENH_IPPLE;
+	}
+	return status;
+}
+
+/* Transmit checksum insertion for a descriptor CIC value */
+static void tx_coe(uint8_t *f, uint32_t len, uint32_t cic)
+{
+	uint8_t *ip = f + 14;
+	uint32_t hlen, plen, off, acc;
+	uint16_t sum;
+	int frag;
+
+	if (!cic || !ipv4_parse(f, len, &hlen, &plen, &frag)) {
+		return;
+	}
+	ip[10] = ip[11] = 0;
+	sum = ~fold16(sum16(ip, hlen, 0));
+	ip[10] = (uint8_t) (sum >> 8);
+	ip[11] = (uint8_t) sum;
+
+	off = l4_csum_offset(ip[9], plen);
+	if ((cic < 2) || frag || !off) {
+		return;
+	}
+
+	/* CIC 2 expects the pseudo header sum in the field, 3 computes it */
+	acc = 0;
+	if (cic == 3) {
+		ip[hlen + off] = ip[hlen + off + 1] = 0;
+		if (ip[9] != 1) {
+			acc = pseudo_sum(ip, plen);
+		}
+	}
+	sum = ~fold16(sum16(ip + hlen, plen, acc));
+	if ((ip[9] == 17) && (sum == 0)) {
+		sum = 0xFFFF;
+	}
+	ip[hlen + off] = (uint8_t) (sum >> 8);
+	ip[hlen + off + 1] = (uint8_t) sum;
+}
+
+/* Destination address filter */
+static int mac_filter(const uint8_t *f)
+{
+	uint32_t ff = LPC_ETHERNET->MAC_FRAME_FILTER;
+	uint8_t mac[6];
+
+	if (ff & (MAC_FF_PR | MAC_FF_RA)) {
+		return 1;
+	}
+	if (!memcmp(f, "\xFF\xFF\xFF\xFF\xFF\xFF", 6)) {
+		return !(ff & MAC_FF_DBF);
+	}
+	if (f[0] & 1) {
+		/* The hash filter isn't modelled */
+		return (ff & MAC_FF_PM) != 0;
+	}
+
+	mac[0] = (uint8_t) LPC_ETHERNET->MAC_ADDR0_LOW;
+	mac[1] = (uint8_t) (LPC_ETHERNET->MAC_ADDR0_LOW >> 8);
+	mac[2] = (uint8_t) (LPC_ETHERNET->MAC_ADDR0_LOW >> 16);
+	mac[3] = (uint8_t) (LPC_ETHERNET->MAC_ADDR0_LOW >> 24);
+	mac[4] = (uint8_t) LPC_ETHERNET->MAC_ADDR0_HIGH;
+	mac[5] = (uint8_t) (LPC_ETHERNET->MAC_ADDR0_HIGH >> 8);
+	return !memcmp(f, mac, 6);
+}
+
+/* Counts a frame the MAC dropped. Missed for want of a descriptor goes in
+   the low half of DMA_MFRM_BUFOF, FIFO overflows in the high half. */
+static void count_missed(int overflow)
+{
+	uint32_t n;
+
+	simstats.rx_missed++;
+	if (overflow) {
+		n = DMA_MFRM_FMA(mfrm_bufof);
+		if (n < 0x7FF) {
+			mfrm_bufof = (mfrm_bufof & ~0x0FFE0000) | ((n + 1) << 17);
+		}
+		else {
+			mfrm_bufof |= DMA_MFRM_OF;
+		}
+	}
+	else {
+		n = mfrm_bufof & DMA_MFRM_FMCMSK;
+		if (n < 0xFFFF) {
+			mfrm_bufof++;
+		}
+		else {
+			mfrm_bufof |= DMA_MFRM_OC;
+		}
+	}
+	*(volatile uint32_t *) &LPC_ETHERNET->DMA_MFRM_BUFOF = mfrm_bufof;
+}
+
+/* Next descriptor in a ring or chain */
+static uint32_t rx_next(uint32_t addr)
+{
+	IP_ENET_001_ENHRXDESC_T *d = dma_ptr(addr);
+
+	if (d->CTRL & RDES_ENH_RER) {
+		return rx_base;
+	}
+	return (d->CTRL & RDES_ENH_RCH) ? d->B2ADD : addr + EMACSIM_DESC_SIZE;
+}
+
+static uint32_t tx_next(uint32_t addr)
+{
+	IP_ENET_001_ENHTXDESC_T *d = dma_ptr(addr);
+
+	if (d->CTRLSTAT & TDES_ENH_TER) {
+		return tx_base;
+	}
+	return (d->CTRLSTAT & TDES_ENH_TCH) ? d->B2ADD : addr + EMACSIM_DESC_SIZE;
+}
+
+/* Reacts to CSR writes the firmware made since the last step */
+static void csr_update(void)
+{
+	if (LPC_ETHERNET->DMA_BUS_MODE & DMA_BM_SWR) {
+		/* Reset completes at once */
+		LPC_ETHERNET->DMA_BUS_MODE &= ~DMA_BM_SWR;
+		while (queue_count(&rxfifo)) {
+			queue_pop(&rxfifo);
+		}
+		rx_base = rx_cur = tx_base = tx_cur = 0;
+		rx_suspended = 0;
+	}
+
+	if (LPC_ETHERNET->DMA_REC_DES_ADDR != rx_base) {
+		rx_base = rx_cur = LPC_ETHERNET->DMA_REC_DES_ADDR;
+	}
+	if (LPC_ETHERNET->DMA_TRANS_DES_ADDR != tx_base) {
+		tx_base = tx_cur = LPC_ETHERNET->DMA_TRANS_DES_ADDR;
+	}
+
+	/* A receive poll demand resumes a suspended receive DMA */
+	if (LPC_ETHERNET->DMA_REC_POLL_DEMAND) {
+		LPC_ETHERNET->DMA_REC_POLL_DEMAND = 0;
+		rx_suspended = 0;
+	}
+	LPC_ETHERNET->DMA_TRANS_POLL_DEMAND = 0;
+
+	/* The firmware read and cleared the missed frame counters */
+	if (LPC_ETHERNET->DMA_MFRM_BUFOF != mfrm_bufof) {
+		mfrm_bufof = LPC_ETHERNET->DMA_MFRM_BUFOF;
+	}
+}
+
+/* Receive DMA, empties the RX FIFO into descriptors the DMA owns */
+static void dma_rx(void)
+{
+	EMACSIM_FRAME_T *f;
+	IP_ENET_001_ENHRXDESC_T *d;
+	uint32_t len, done, n, bsize, status, ext, coe;
+	uint32_t fcs;
+	uint8_t buf[EMACSIM_MAX_FRAME + 4];
+
+	if (!(LPC_ETHERNET->DMA_OP_MODE & DMA_OM_SR) || !rx_cur) {
+		return;
+	}
+
+	while (!rx_suspended && (f = queue_peek(&rxfifo)) != NULL) {
+		d = dma_ptr(rx_cur);
+		if (!(d->STATUS & RDES_OWN)) {
+			/* Receive buffer unavailable. Unless flushing is disabled the
+			   frame at the head of the FIFO is dropped. */
+			LPC_ETHERNET->DMA_STAT |= DMA_ST_RU;
+			simstats.rx_unavailable++;
+			rx_suspended = 1;
+			if (!(LPC_ETHERNET->DMA_OP_MODE & DMA_OM_DFF)) {
+				queue_pop(&rxfifo);
+				count_missed(0);
+			}
+			break;
+		}
+
+		/* The frame and its FCS */
+		len = f->len;
+		memcpy(buf, f->data, len);
+		fcs = crc32(buf, len);
+		buf[len] = (uint8_t) fcs;
+		buf[len + 1] = (uint8_t) (fcs >> 8);
+		buf[len + 2] = (uint8_t) (fcs >> 16);
+		buf[len + 3] = (uint8_t) (fcs >> 24);
+		len += 4;
+
+		coe = ext = 0;
+		if (LPC_ETHERNET->MAC_CONFIG & MAC_CFG_IPC) {
+			coe = rx_coe(f->data, f->len, &ext);
+		}
+
+		/* Spread it over as many descriptors as it takes */
+		status = RDES_FS;
+		done = 0;
+		for (;;) {
+			bsize = d->CTRL & 0xFFF;
+			if (!(d->CTRL & RDES_ENH_RCH)) {
+				bsize += (d->CTRL >> 16) & 0xFFF;
+			}
+			n = len - done;
+			if (n > bsize) {
+				n = bsize;
+			}
+			if ((d->CTRL & RDES_ENH_RCH) || (n <= (d->CTRL & 0xFFF))) {
+				memcpy(dma_ptr(d->B1ADD), buf + done, n);
+			}
+			else {
+				memcpy(dma_ptr(d->B1ADD), buf + done, d->CTRL & 0xFFF);
+				memcpy(dma_ptr(d->B2ADD), buf + done + (d->CTRL & 0xFFF), n - (d->CTRL & 0xFFF));
+			}
+			done += n;
+
+			if (done == len) {
+				break;
+			}
+			d->STATUS = status;
+			status = 0;
+			rx_cur = rx_next(rx_cur);
+			d = dma_ptr(rx_cur);
+			if (!(d->STATUS & RDES_OWN)) {
+				/* Ran out mid frame, it is truncated */
+				status |= RDES_DE | RDES_ES;
+				break;
+			}
+		}
+
+		status |= RDES_LS | (len << 16) | coe;
+		if ((f->data[12] << 8 | f->data[13]) >= 0x0600) {
+			status |= RDES_FT;
+		}
+		d->EXTSTAT = ext;
+		d->STATUS = status;
+		rx_cur = rx_next(rx_cur);
+
+		LPC_ETHERNET->DMA_STAT |= DMA_ST_RI | DMA_ST_NIS;
+		simstats.rx_dma++;
+		queue_pop(&rxfifo);
+	}
+}
+
+/* Transmit DMA, moves complete frames the DMA owns into the TX FIFO */
+static void dma_tx(void)
+{
+	IP_ENET_001_ENHTXDESC_T *d;
+	EMACSIM_FRAME_T *f;
+	uint32_t addr, ndesc, len, n, cic;
+	uint32_t desc[EMACSIM_TX_DESCS];
+	uint8_t buf[EMACSIM_TX_FIFO];
+	uint64_t start;
+
+	if (!(LPC_ETHERNET->DMA_OP_MODE & DMA_OM_ST) ||
+		!(LPC_ETHERNET->MAC_CONFIG & MAC_CFG_TE) || !tx_cur) {
+		return;
+	}
+
+	for (;;) {
+		/* Gather FS..LS. The driver hands the first descriptor over last,
+		   so a frame is all there once that one is owned. */
+		addr = tx_cur;
+		ndesc = len = 0;
+		cic = 0;
+		for (;;) {
+			d = dma_ptr(addr);
+			if (!(d->CTRLSTAT & TDES_OWN)) {
+				if (ndesc) {
+					LPC_ETHERNET->DMA_STAT |= DMA_ST_TU;
+				}
+				return;
+			}
+			if (ndesc == EMACSIM_TX_DESCS) {
+				fatal("TX frame spans too many descriptors");
+			}
+			if (!ndesc) {
+				cic = (d->CTRLSTAT >> 22) & 3;
+			}
+			desc[ndesc++] = addr;
+			n = d->BSIZE & 0xFFF;
+			if ((len + n + ((d->BSIZE >> 16) & 0xFFF)) > sizeof(buf)) {
+				fatal("TX frame larger than the TX FIFO");
+			}
+			memcpy(buf + len, dma_ptr(d->B1ADD), n);
+			len += n;
+			if (!(d->CTRLSTAT & TDES_ENH_TCH)) {
+				n = (d->BSIZE >> 16) & 0xFFF;
+				memcpy(buf + len, dma_ptr(d->B2ADD), n);
+				len += n;
+			}
+			if (d->CTRLSTAT & TDES_ENH_LS) {
+				break;
+			}
+			addr = tx_next(addr);
+		}
+
+		/* Wait for room in the TX FIFO */
+		if ((txwire.bytes + len) > EMACSIM_TX_FIFO) {
+			return;
+		}
+
+		/* Payload checksums are only inserted in store and forward mode */
+		if ((cic > 1) && !(LPC_ETHERNET->DMA_OP_MODE & DMA_OM_TSF)) {
+			cic = 1;
+		}
+		tx_coe(buf, len, cic);
+
+		if (len < 60) {
+			memset(buf + len, 0, 60 - len);
+			len = 60;
+		}
+		if (len > EMACSIM_MAX_FRAME) {
+			fatal("TX frame too long");
+		}
+
+		start = (txwire_free > now) ? txwire_free : now;
+		f = queue_push(&txwire, buf, len);
+		f->at = txwire_free = start + EmacSim_WireTime(len);
+		f->ndesc = ndesc;
+		memcpy(f->desc, desc, ndesc * sizeof(desc[0]));
+
+		tx_cur = tx_next(addr);
+	}
+}
+
+/* A frame reached the MAC from the wire */
+static void mac_rx(const EMACSIM_FRAME_T *w)
+{
+	simstats.rx_frames++;
+	simstats.rx_bytes += w->len;
+
+	if (!(LPC_ETHERNET->MAC_CONFIG & MAC_CFG_RE) || !mac_filter(w->data)) {
+		simstats.rx_filtered++;
+		return;
+	}
+	if ((rxfifo.bytes + w->len + 4) > EMACSIM_RX_FIFO) {
+		count_missed(1);
+		return;
+	}
+	queue_push(&rxfifo, w->data, w->len);
+}
+
+/* A frame left the MAC, its descriptors are closed */
+static void mac_tx_done(EMACSIM_FRAME_T *f)
+{
+	IP_ENET_001_ENHTXDESC_T *d;
+	uint32_t i;
+
+	for (i = 0; i < f->ndesc; i++) {
+		d = dma_ptr(f->desc[i]);
+		d->CTRLSTAT &= ~(TDES_OWN | 0x3FFFF);
+	}
+	LPC_ETHERNET->DMA_STAT |= DMA_ST_TI | DMA_ST_NIS;
+
+	simstats.tx_frames++;
+	simstats.tx_bytes += f->len;
+
+	if (tapfd >= 0) {
+		if (write(tapfd, f->data, f->len) < 0) {}
+	}
+	else {
+		Peer_Frame(f->data, f->len);
+	}
+}
+
+static void tap_read(void)
+{
+	uint8_t buf[2048];
+	ssize_t n;
+
+	while ((n = read(tapfd, buf, sizeof(buf))) > 0) {
+		if ((n >= 14) && (n <= EMACSIM_MAX_FRAME)) {
+			EmacSim_Send(buf, (uint32_t) n);
+		}
+	}
+}
+
+/* Runs the MAC, DMA and peer up to 'until' */
+static void model_run(uint64_t until)
+{
+	EMACSIM_FRAME_T *f;
+	uint64_t next, t;
+
+	csr_update();
+	if (tapfd >= 0) {
+		tap_read();
+	}
+
+	for (;;) {
+		dma_rx();
+		dma_tx();
+
+		next = UINT64_MAX;
+		if ((f = queue_peek(&txwire)) != NULL) {
+			next = f->at;
+		}
+		if (((f = queue_peek(&rxwire)) != NULL) && (f->at < next)) {
+			next = f->at;
+		}
+		if (tapfd < 0) {
+			t = Peer_NextEvent();
+			if (t < next) {
+				next = t;
+			}
+		}
+		if (next > until) {
+			break;
+		}
+		if (next > now) {
+			now = next;
+		}
+
+		while (((f = queue_peek(&txwire)) != NULL) && (f->at <= now)) {
+			mac_tx_done(f);
+			queue_pop(&txwire);
+		}
+		while (((f = queue_peek(&rxwire)) != NULL) && (f->at <= now)) {
+			mac_rx(f);
+			queue_pop(&rxwire);
+		}
+		if (tapfd < 0) {
+			Peer_Poll();
+		}
+	}
+
+	if (until > now) {
+		now = until;
+	}
+	if (tapfd < 0) {
+		Peer_Poll();
+		dma_tx();
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+int EmacSim_Init(const EmacSimOptions *options)
+{
+	struct ifreq ifr;
+	uint64_t t;
+	int i;
+
+	simopt = *options;
+	if (!simopt.slowdown) {
+		simopt.slowdown = 1;
+	}
+	crc_init();
+	queue_init(&rxwire, 4096);
+	queue_init(&rxfifo, 64);
+	queue_init(&txwire, 64);
+
+	if (simopt.tap) {
+		tapfd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+		if (tapfd < 0) {
+			perror("emacsim: /dev/net/tun");
+			return -1;
+		}
+		memset(&ifr, 0, sizeof(ifr));
+		ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+		strncpy(ifr.ifr_name, simopt.tap, IFNAMSIZ - 1);
+		if (ioctl(tapfd, TUNSETIFF, &ifr) < 0) {
+			perror("emacsim: TUNSETIFF");
+			return -1;
+		}
+		real_start = clock_ns(CLOCK_MONOTONIC);
+	}
+
+	/* What reading the CPU clock costs, taken off every sync */
+	t = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	for (i = 0; i < 1000; i++) {
+		clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	}
+	sync_cost = (clock_ns(CLOCK_THREAD_CPUTIME_ID) - t) / 1000;
+
+	cpu_mark = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	return 0;
+}
+
+void EmacSim_Sync(void)
+{
+	uint64_t cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	uint64_t d = cpu - cpu_mark;
+
+	d = (d > sync_cost) ? (d - sync_cost) * simopt.slowdown : 0;
+	simstats.firmware_ns += d;
+	if (tapfd >= 0) {
+		model_run(clock_ns(CLOCK_MONOTONIC) - real_start);
+	}
+	else {
+		model_run(now + d);
+	}
+	cpu_mark = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void EmacSim_Idle(void)
+{
+	struct pollfd pfd;
+	EMACSIM_FRAME_T *f;
+	uint64_t next, t;
+
+	if (EmacSim_RxPending()) {
+		return;
+	}
+
+	if (tapfd >= 0) {
+		pfd.fd = tapfd;
+		pfd.events = POLLIN;
+		poll(&pfd, 1, 1);
+		model_run(clock_ns(CLOCK_MONOTONIC) - real_start);
+	}
+	else {
+		/* On to the next wire event or millisecond tick, whichever is
+		   first, so lwIP's timers still run on time */
+		next = ((now / 1000000) + 1) * 1000000;
+		if (((f = queue_peek(&txwire)) != NULL) && (f->at < next)) {
+			next = f->at;
+		}
+		if (((f = queue_peek(&rxwire)) != NULL) && (f->at < next)) {
+			next = f->at;
+		}
+		t = Peer_NextEvent();
+		if (t < next) {
+			next = t;
+		}
+		model_run((next > now) ? next : now);
+	}
+	cpu_mark = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+int EmacSim_RxPending(void)
+{
+	IP_ENET_001_ENHRXDESC_T *d;
+	uint32_t addr = rx_base;
+	int i;
+
+	if (queue_count(&rxfifo)) {
+		return 1;
+	}
+	for (i = 0; addr && (i < 256); i++) {
+		d = dma_ptr(addr);
+		if (!(d->STATUS & RDES_OWN) && (d->STATUS & RDES_LS)) {
+			return 1;
+		}
+		addr = rx_next(addr);
+		if (addr == rx_base) {
+			break;
+		}
+	}
+	return 0;
+}
+
+void EmacSim_MissedRead(void)
+{
+	mfrm_bufof = 0;
+	*(volatile uint32_t *) &LPC_ETHERNET->DMA_MFRM_BUFOF = 0;
+}
+
+uint64_t EmacSim_Now(void)
+{
+	return now;
+}
+
+void EmacSim_GetStats(EmacSimStats *stats)
+{
+	*stats = simstats;
+}
+
+void EmacSim_Send(const uint8_t *frame, uint32_t len)
+{
+	EMACSIM_FRAME_T *f;
+	uint64_t start = (rxwire_free > now) ? rxwire_free : now;
+
+	if (len > EMACSIM_MAX_FRAME) {
+		return;
+	}
+	if (len < 60) {
+		/* Padded on the wire */
+		f = queue_push(&rxwire, frame, len);
+		memset(f->data + len, 0, 60 - len);
+		f->len = 60;
+		rxwire.bytes += 60 - len;
+	}
+	else {
+		f = queue_push(&rxwire, frame, len);
+	}
+	f->at = rxwire_free = start + EmacSim_WireTime(f->len);
+}
+
+uint64_t EmacSim_SendBacklog(void)
+{
+	return (rxwire_free > now) ? rxwire_free - now : 0;
+}
+
+uint64_t EmacSim_WireTime(uint32_t len)
+{
+	/* Preamble/SFD, FCS and the 12 byte gap, 80ns per byte at 100Mbit/s */
+	return (uint64_t) (len + 8 + 4 + 12) * 80;
+}
+
+/* Board and PHY layer */
+void Board_ENET_GetMacADDR(uint8_t *mcaddr)
+{
+	static const uint8_t mac[6] = EMACSIM_TARGET_MAC;
+
+	memcpy(mcaddr, mac, 6);
+}
+
+uint32_t lpc_phy_init(bool rmii, p_msDelay_func_t pDelayMsFunc)
+{
+	(void) rmii;
+	(void) pDelayMsFunc;
+	return SUCCESS;
+}
+
+/* The link comes up at 100Mbit/s full duplex on the first poll */
+uint32_t lpcPHYStsPoll(void)
+{
+	static int polled;
+	uint32_t sts = PHY_LINK_CONNECTED | PHY_LINK_SPEED100 | PHY_LINK_FULLDUPLX;
+
+	if (!polled) {
+		polled = 1;
+		sts |= PHY_LINK_CHANGED;
+	}
+	return sts;
+}
+
+/* lwIP timebase and delay, on the virtual clock */
+uint32_t sys_now(void)
+{
+	return (uint32_t) (now / 1000000);
+}
+
+void msDelay(uint32_t ms)
+{
+	EmacSim_Sync();
+	if (tapfd >= 0) {
+		usleep(ms * 1000);
+		model_run(clock_ns(CLOCK_MONOTONIC) - real_start);
+	}
+	else {
+		model_run(now + ((uint64_t) ms * 1000000));
+	}
+	cpu_mark = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/* lwIP assertions without LWIP_DEBUG */
+void assert_loop(void)
+{
+	fprintf(stderr, "emacsim: lwIP assertion at %llu ns\n", (unsigned long long) now);
+	abort();
+}
@@ -0,0 +1,218 @@
+/*
+
+	EMACSim. Host-side model of the LPC18xx/43xx Ethernet MAC and DMA.
+
+	Runs the unmodified lwIP core, the LPC18xx/43xx EMAC driver
+	(lpclwip/arch/lpc18xx_43xx_emac.c) and lpc_chksum.c as a Linux process
+	against a simulated wire, so descriptor counts, lwIP pools and driver
+	changes can be compared without a board. Each shipped lwipopts.h is
+	built into its own binary; run_all.sh builds and runs them all.
+
+	Registers. LPC_ETHERNET points at a plain IP_ENET_001_T (see chip.h).
+	The model looks at it between firmware steps, the way the DMA would
+	see the CSRs: MAC_CONFIG RE/TE, DMA_OP_MODE SR/ST/TSF, the frame
+	filter, the MAC address, the descriptor list base addresses and
+	DMA_MFRM_BUFOF, which it counts up and clears when the firmware has
+	read it. The driver's descriptor rings are read and written in place
+	as enhanced (8 word) descriptors, ring or chained, OWN handshake and
+	all.
+
+	MAC. The receive side has a 2KB RX FIFO (EMACSIM_RX_FIFO). A frame
+	arriving while the DMA has no descriptor to empty the FIFO into waits
+	there, the next one that doesn't fit is dropped and counted in
+	DMA_MFRM_BUFOF as missed, like the MAC does. With MAC_CONFIG IPC set
+	it checks the IPv4 header and TCP/UDP/ICMP checksums and reports them
+	in RDES0 ESA and RDES4. Transmit honours CIC: 1 inserts the IP header
+	checksum, 2 and 3 the TCP/UDP/ICMP one as well, the latter only in
+	store and forward mode (DMA_OM_TSF) as on the chip.
+
+	Wire. 100Mbit/s full duplex, preamble, FCS and inter frame gap
+	included. The peer (simpeer.c) is the other end of the cable: it
+	answers ARP and runs TCP and UDP scenarios or replays a pcap file. With
+	--tap the wire is a Linux TAP device instead and the kernel is the
+	peer.
+
+	Time. Everything runs on a virtual clock that advances with the
+	firmware's CPU time (CLOCK_THREAD_CPUTIME_ID) times --slowdown, so a
+	host that is 20x faster than a 204MHz Cortex-M4 approximates the
+	target at --slowdown 20. When the firmware has nothing to do (RX ring
+	empty, no timer due) the clock jumps to the next wire event, at most
+	a millisecond ahead, so an idle board costs no host time. sys_now()
+	and msDelay() run on this clock. Compare runs against each other
+	rather than against a board; the absolute numbers only mean as much as
+	the slowdown guess does. With --tap the clock is real time.
+
+	Needs x86-64 Linux and a non-PIE link: descriptors hold buffer
+	addresses as uint32_t, so everything the driver hands the DMA must sit
+	below 4GB. The lwIP heap and pools are static; malloc based
+	configurations (MEM_LIBC_MALLOC) get mmap disabled so the heap stays
+	in the brk area.
+
+	Build, from software/lwip, one binary per lwipopts.h:
+
+	gcc -O2 -g -no-pie -DCORE_M4 -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast \
+		-DEMACSIM_LWIPOPTS='"<example>/lwipopts.h"' \
+		-Ilpclwip/tools/emacsim -I../lpc_core/lpc_ip -I../lpc_core/lpc_board/board_common \
+		-Ilpclwip -Ilpclwip/arch -Ilwip/src/include -Ilwip/src/include/ipv4 -I<example> \
+		lpclwip/tools/emacsim/emacsim.c lpclwip/tools/emacsim/simpeer.c \
+		lpclwip/tools/emacsim/simapp.c lpclwip/arch/lpc18xx_43xx_emac.c \
+		lpclwip/arch/lpc_chksum.c ../lpc_core/lpc_ip/enet_001.c \
+		lwip/src/core/[a-z]*.c lwip/src/core/ipv4/[a-z]*.c lwip/src/netif/etharp.c -o emacsim
+
+	(the dual core configurations also need their common directory on the
+	include path, a GCC tool chain and a board to pick the load target:
+	-D__CODE_RED -DBOARD_KEIL_MCB_18574357 for internal flash)
+
+	./emacsim [--slowdown n] [--budget n] [--seconds n] [--mbytes n]
+		[--size n] [--rate pps] [--delack ms] [--flood] [--copy] [--brief]
+		tcp-rx|tcp-tx|udp-rx|pcap file|tap name
+
+	tcp-rx	the peer sends --mbytes to a discard server on the target
+	tcp-tx	the target sends --mbytes from ROM data (tcp_write() without
+			copy, like httpd) to the peer, --copy copies it instead
+	udp-rx	the peer sends --size byte datagrams at --rate (line rate by
+			default) to a discard port for --seconds
+	pcap	replays an Ethernet pcap file at its own timestamps, or back to
+			back with --flood, unicast frames readdressed to the target
+	tap		bridges to an existing TAP device. Configure the host side as
+			10.1.10.1/24 and point iperf, ping or a browser at 10.1.10.234;
+			TCP port 5001 discards, 5002 sources --mbytes.
+
+	--budget n runs the main loop on lpc_rx_poll(netif, n) instead of
+	lpc_enetif_input(), one frame per loop, and --budget 0 the other way
+	round. The RTOS configurations default to lpc_rx_poll() with the
+	budget of the driver's RX poll task (LPC_RX_BUDGET), which stands in
+	for that task: lwipopts.h forces NO_SYS, so the task itself never
+	runs. --delack sets the peer's delayed ACK timeout when it receives.
+
+	Not covered. Nothing raises the Ethernet interrupt and no FreeRTOS
+	task runs, so the RTOS receive path is never exercised:
+	ETH_IRQHandler() masking the RX interrupts, vPacketReceiveTask()
+	unmasking them and checking the ring again once it is drained, its
+	priority drop and yield while passes use their whole budget, and the
+	TX cleanup task with its descriptor counting semaphore. The RTOS
+	numbers only show lpc_rx_poll() at that budget from a polling loop;
+	interrupt latency and task switching cost nothing here.
+
+	Reported: frames/s the firmware took off the RX ring and frames the
+	MAC missed, TCP goodput, the lwIP pool and heap high water marks and
+	allocation failures (PBUF_POOL among them), link/TCP error counters
+	and the driver's RX/TX statistics. The driver allocates its RX pbufs
+	from the heap (PBUF_RAM), so receive pressure shows there rather than
+	in PBUF_POOL.
+
+	--brief prints one line per run, which run_all.sh collects for each
+	shipped lwipopts.h: scenario, Mbit/s (TCP goodput, else what the
+	applications took), RX ring frames/s, frames missed, PBUF_POOL
+	max/size and allocation failures, heap max/size and failures,
+	driver RX pbuf allocation failures and the lpc_rx_poll() budget (0
+	when the main loop uses lpc_enetif_input()).
+
+*/
+
+#ifndef __EMACSIM_H_
+#define __EMACSIM_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* RX FIFO size in bytes */
+#ifndef EMACSIM_RX_FIFO
+#define EMACSIM_RX_FIFO		2048
+#endif
+
+/* addresses on the simulated segment */
+#define EMACSIM_PEER_MAC	{0x02, 0x00, 0x00, 0x00, 0x00, 0x02}
+#define EMACSIM_TARGET_MAC	{0x00, 0x60, 0x37, 0x12, 0x34, 0x56}
+#define EMACSIM_PEER_IP		0x0A010A01	/* 10.1.10.1 */
+#define EMACSIM_TARGET_IP	0x0A010AEA	/* 10.1.10.234 */
+
+/* target application ports, see simapp.c */
+#define EMACSIM_PORT_DISCARD	5001
+#define EMACSIM_PORT_SOURCE		5002
+#define EMACSIM_PORT_UDP		5001
+
+/*---------------------------------------------------------------------------*/
+typedef struct _EmacSimOptions
+{
+	/* firmware time multiplier, 1 = host speed */
+	uint32_t slowdown;
+	/* TAP device to use as the wire, NULL for the built-in peer */
+	const char *tap;
+} EmacSimOptions;
+
+typedef struct _EmacSimStats
+{
+	/* wire -> MAC */
+	uint64_t rx_frames;
+	uint64_t rx_bytes;
+	/* dropped by the address filter */
+	uint64_t rx_filtered;
+	/* dropped because the RX FIFO was full */
+	uint64_t rx_missed;
+	/* written to an RX descriptor */
+	uint64_t rx_dma;
+	/* times the DMA found no RX descriptor it owns */
+	uint64_t rx_unavailable;
+	/* MAC -> wire */
+	uint64_t tx_frames;
+	uint64_t tx_bytes;
+	/* virtual ns charged to firmware */
+	uint64_t firmware_ns;
+} EmacSimStats;
+
+/*---------------------------------------------------------------------------*/
+/* called once from main() before any firmware code touches the EMAC */
+extern int EmacSim_Init(const EmacSimOptions *options);
+
+/* charges the firmware's CPU time since the last call to the clock and
+   runs the MAC, DMA and peer up to the new time */
+extern void EmacSim_Sync(void);
+
+/* the firmware is idle: let the clock run on to the next event */
+extern void EmacSim_Idle(void);
+
+/* non-zero while the RX ring holds a frame the firmware hasn't taken */
+extern int EmacSim_RxPending(void);
+
+/* DMA_MFRM_BUFOF clears when read, which nothing traps here. Whoever
+   calls lpc_rx_poll(), the only reader, calls this after it. */
+extern void EmacSim_MissedRead(void);
+
+/* virtual time in ns */
+extern uint64_t EmacSim_Now(void);
+
+extern void EmacSim_GetStats(EmacSimStats *stats);
+
+/*---------------------------------------------------------------------------*/
+/* peer only. Puts a frame on the wire towards the MAC. It arrives once the
+   frames before it and its own wire time have passed. */
+extern void EmacSim_Send(const uint8_t *frame, uint32_t len);
+
+/* ns until the wire towards the MAC is free again */
+extern uint64_t EmacSim_SendBacklog(void);
+
+/* wire time of a frame in ns, preamble, FCS and gap included */
+extern uint64_t EmacSim_WireTime(uint32_t len);
+
+/*---------------------------------------------------------------------------*/
+/* provided by simpeer.c */
+
+/* a frame the MAC sent */
+extern void Peer_Frame(const uint8_t *frame, uint32_t len);
+
+/* runs the scenario up to EmacSim_Now() */
+extern void Peer_Poll(void);
+
+/* time of the peer's next timed event, or UINT64_MAX */
+extern uint64_t Peer_NextEvent(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
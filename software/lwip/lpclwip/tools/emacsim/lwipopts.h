@@ -0,0 +1,71 @@
+/*
+
+	EMACSim lwipopts.h. Pulls in the shipped lwipopts.h under test, named
+	by -DEMACSIM_LWIPOPTS='"path/lwipopts.h"', then overrides what the
+	host build can't take from it:
+
+	- NO_SYS. The RTOS configurations run their pools, descriptor counts
+	  and TCP settings through the standalone main loop; FreeRTOS task
+	  scheduling is not modelled, so nothing needs SYS_LIGHTWEIGHT_PROT
+	  either. Their RX poll task never runs, so EMACSIM_RTOS has the main
+	  loop call lpc_rx_poll() with the task's budget in its place.
+	- Statistics, which the report reads. With MEM_LIBC_MALLOC lwIP keeps
+	  no heap statistics, mem_malloc() and mem_free() then go through
+	  emacsim.c, which counts them in lwip_stats.mem.
+
+*/
+
+#ifndef __EMACSIM_LWIPOPTS_H_
+#define __EMACSIM_LWIPOPTS_H_
+
+#include EMACSIM_LWIPOPTS
+
+#if !defined(NO_SYS) || !NO_SYS
+#define EMACSIM_RTOS					1
+#else
+#define EMACSIM_RTOS					0
+#endif
+
+/* cc.h defines BYTE_ORDER for the target, the C library has its own
+   spelling of the same value */
+#include <endian.h>
+#undef BYTE_ORDER
+
+#undef NO_SYS
+#define NO_SYS							1
+#undef LWIP_NETCONN
+#define LWIP_NETCONN					0
+#undef LWIP_SOCKET
+#define LWIP_SOCKET						0
+#undef SYS_LIGHTWEIGHT_PROT
+#define SYS_LIGHTWEIGHT_PROT			0
+
+#undef LWIP_STATS
+#define LWIP_STATS						1
+#undef LINK_STATS
+#define LINK_STATS						1
+#undef IP_STATS
+#define IP_STATS						1
+#undef TCP_STATS
+#define TCP_STATS						1
+#undef UDP_STATS
+#define UDP_STATS						1
+#undef MEM_STATS
+#define MEM_STATS						1
+#undef MEMP_STATS
+#define MEMP_STATS						1
+
+/* lwIP's asserts call assert_loop(), emacsim.c turns that into abort() */
+#undef LWIP_DEBUG
+
+#if MEM_LIBC_MALLOC
+#include <stddef.h>
+void *emacsim_mem_malloc(size_t size);
+void *emacsim_mem_calloc(size_t count, size_t size);
+void emacsim_mem_free(void *mem);
+#define mem_malloc						emacsim_mem_malloc
+#define mem_calloc						emacsim_mem_calloc
+#define mem_free						emacsim_mem_free
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# EMACSim. Builds the simulator once for every LPC18xx/43xx example
+# lwipopts.h and runs the TCP receive, TCP transmit and UDP flood
+# scenarios against each, one line per run. The budget column is the
+# lpc_rx_poll() budget the main loop ran on: the RTOS configurations get
+# their RX poll task's, as emacsim doesn't run FreeRTOS tasks (see
+# emacsim.h), the standalone ones show 0 for lpc_enetif_input(). The
+# RTOS receive task itself, with its RX interrupt masking and priority
+# drop, is not exercised by any of these runs.
+# Options are passed on to emacsim, e.g.
+#
+#	lpclwip/tools/emacsim/run_all.sh --slowdown 40 --budget 4
+#
+# Run from software/lwip. Binaries go to $EMACSIM_OUT (default
+# /tmp/emacsim-bin).
+#
+
+set -e
+
+LWIP=`pwd`
+EXAMPLES=$LWIP/../../applications/lpc18xx_43xx/examples
+OUT=${EMACSIM_OUT:-/tmp/emacsim-bin}
+CC=${CC:-gcc}
+
+if [ ! -f lpclwip/tools/emacsim/emacsim.h ]; then
+	echo "run_all.sh: run from software/lwip" >&2
+	exit 2
+fi
+mkdir -p "$OUT"
+
+printf "%-10s %7s %8s %7s %7s %5s %13s %6s %6s %6s\n" \
+	scenario Mbit/s rxfps missed pool pool! heap heap! rxfail budget
+
+for opts in `cd "$EXAMPLES" && find . -name lwipopts.h | sort`; do
+	dir=`dirname "$EXAMPLES/$opts"`
+	name=`echo "$opts" | sed -e 's|^\./||' -e 's|/lwipopts.h$||' -e 's|/|_|g'`
+	flags=
+	case "$opts" in
+	*dualcore*) flags="-D__CODE_RED -DBOARD_KEIL_MCB_18574357 -I$EXAMPLES/dualcore_43xx/common" ;;
+	esac
+
+	echo
+	echo "$opts"
+	if ! $CC -O2 -g -no-pie -DCORE_M4 $flags -Wno-pointer-to-int-cast -Wno-int-to-pointer-cast \
+		-DEMACSIM_LWIPOPTS="\"$dir/lwipopts.h\"" \
+		-Ilpclwip/tools/emacsim -I../lpc_core/lpc_ip -I../lpc_core/lpc_board/board_common \
+		-Ilpclwip -Ilpclwip/arch -Ilwip/src/include -Ilwip/src/include/ipv4 -I"$dir" \
+		lpclwip/tools/emacsim/emacsim.c lpclwip/tools/emacsim/simpeer.c \
+		lpclwip/tools/emacsim/simapp.c lpclwip/arch/lpc18xx_43xx_emac.c \
+		lpclwip/arch/lpc_chksum.c ../lpc_core/lpc_ip/enet_001.c \
+		lwip/src/core/[a-z]*.c lwip/src/core/ipv4/[a-z]*.c lwip/src/netif/etharp.c \
+		-o "$OUT/$name"; then
+		echo "  build failed"
+		continue
+	fi
+
+	"$OUT/$name" --brief "$@" tcp-rx || true
+	"$OUT/$name" --brief "$@" tcp-tx || true
+	"$OUT/$name" --brief --seconds 1 "$@" udp-rx || true
+done
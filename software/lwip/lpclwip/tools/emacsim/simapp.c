@@ -0,0 +1,593 @@
+/*
+ * @brief EMACSim firmware side, lwIP set up, test applications and report
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "lwip/init.h"
+#include "lwip/opt.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/timers.h"
+#include "netif/etharp.h"
+
+#include "lpc_18xx43xx_emac_config.h"
+#include "lpc18xx_43xx_emac.h"
+#include "lpc_phy.h"
+
+#include "emacsim.h"
+#include "simpeer.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define STR(x)		#x
+#define XSTR(x)		STR(x)
+
+/* Budget of the driver's RX poll task, as lpc18xx_43xx_emac.c has it */
+#ifndef LPC_RX_BUDGET
+#define LPC_RX_BUDGET (2 * LPC_NUM_BUFF_RXDESCS)
+#endif
+
+static struct netif lpc_netif;
+
+/* Options */
+static EmacSimOptions simopt = {20, NULL};
+static PeerConfig peercfg = {PEER_TCP_RX, 4 * 1024 * 1024, 1472, 0, 1000000000ULL, 0, 0, NULL};
+static const char *scenario_name = "tcp-rx";
+static s32_t rx_budget = -1;
+static int tx_copy;
+static int brief;
+static uint64_t time_limit = 60ULL * 1000000000ULL;
+
+/* What the target applications saw */
+static u32_t app_rx_bytes;
+static u32_t app_tx_bytes;
+static u32_t app_tx_errs;
+static u32_t app_udp_frames;
+static u32_t app_tx_left;
+static int app_closing;
+
+/* TX source data, const so it sits in the flash image like httpd's files */
+static const u8_t source_data[TCP_MSS] = {1, 2, 3, 4};
+
+/* Names of the lwIP pools, in memp_t order */
+static const char *const memp_names[] = {
+#define LWIP_MEMPOOL(name, num, size, desc) desc,
+#include "lwip/memp_std.h"
+};
+
+/* mem_malloc() bookkeeping for MEM_LIBC_MALLOC builds */
+typedef union {
+	size_t size;
+	u32_t align[2];
+} HEAP_HDR_T;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+/* TCP discard server */
+static err_t discard_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(err);
+
+	if (p == NULL) {
+		tcp_close(pcb);
+		return ERR_OK;
+	}
+	app_rx_bytes += p->tot_len;
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+static err_t discard_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(err);
+
+	tcp_recv(pcb, discard_recv);
+	return ERR_OK;
+}
+
+/* TCP source server, sends app_tx_left bytes to whoever connects. One
+   segment per tcp_write() so a heap too fragmented for a bigger copy
+   still makes progress. */
+static void source_fill(struct tcp_pcb *pcb)
+{
+	u32_t n;
+
+	while (app_tx_left) {
+		n = tcp_sndbuf(pcb);
+		if (n > app_tx_left) {
+			n = app_tx_left;
+		}
+		if (n > TCP_MSS) {
+			n = TCP_MSS;
+		}
+		if (!n) {
+			break;
+		}
+		if (tcp_write(pcb, source_data, (u16_t) n, tx_copy ? TCP_WRITE_FLAG_COPY : 0) != ERR_OK) {
+			app_tx_errs++;
+			break;
+		}
+		app_tx_left -= n;
+		app_tx_bytes += n;
+	}
+	tcp_output(pcb);
+
+	if (!app_tx_left && !app_closing && (tcp_close(pcb) == ERR_OK)) {
+		app_closing = 1;
+	}
+}
+
+static err_t source_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(len);
+
+	source_fill(pcb);
+	return ERR_OK;
+}
+
+/* Retries a tcp_write() or tcp_close() that ran out of memory with nothing
+   in flight to call source_sent(), like httpd's poll */
+static err_t source_poll(void *arg, struct tcp_pcb *pcb)
+{
+	LWIP_UNUSED_ARG(arg);
+
+	if (!app_closing) {
+		source_fill(pcb);
+	}
+	return ERR_OK;
+}
+
+static err_t source_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(err);
+
+	if (p != NULL) {
+		tcp_recved(pcb, p->tot_len);
+		pbuf_free(p);
+	}
+	return ERR_OK;
+}
+
+static err_t source_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(err);
+
+	tcp_sent(pcb, source_sent);
+	tcp_recv(pcb, source_recv);
+	tcp_poll(pcb, source_poll, 1);
+	source_fill(pcb);
+	return ERR_OK;
+}
+
+static void tcp_listen_on(u16_t port, tcp_accept_fn accept)
+{
+	struct tcp_pcb *pcb = tcp_new();
+
+	if ((pcb == NULL) || (tcp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK)) {
+		fprintf(stderr, "emacsim: can't bind TCP port %u\n", port);
+		exit(2);
+	}
+	pcb = tcp_listen(pcb);
+	tcp_accept(pcb, accept);
+}
+
+#if LWIP_UDP
+/* UDP discard */
+static void udp_discard(void *arg, struct udp_pcb *pcb, struct pbuf *p, ip_addr_t *addr, u16_t port)
+{
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(pcb);
+	LWIP_UNUSED_ARG(addr);
+	LWIP_UNUSED_ARG(port);
+
+	app_udp_frames++;
+	app_rx_bytes += p->tot_len;
+	pbuf_free(p);
+}
+#endif
+
+static void apps_init(void)
+{
+#if LWIP_UDP
+	struct udp_pcb *upcb;
+#endif
+
+	tcp_listen_on(EMACSIM_PORT_DISCARD, discard_accept);
+	tcp_listen_on(EMACSIM_PORT_SOURCE, source_accept);
+	app_tx_left = peercfg.bytes;
+
+#if LWIP_UDP
+	upcb = udp_new();
+	if ((upcb == NULL) || (udp_bind(upcb, IP_ADDR_ANY, EMACSIM_PORT_UDP) != ERR_OK)) {
+		fprintf(stderr, "emacsim: can't bind UDP port\n");
+		exit(2);
+	}
+	udp_recv(upcb, udp_discard, NULL);
+#endif
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+			"usage: emacsim [--slowdown n] [--budget n] [--seconds n] [--mbytes n]\n"
+			"               [--size n] [--rate pps] [--delack ms] [--flood] [--copy] [--brief]\n"
+			"               tcp-rx|tcp-tx|udp-rx|pcap file|tap name\n");
+	exit(2);
+}
+
+static void parse_args(int argc, char *argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--slowdown") && (i + 1 < argc)) {
+			simopt.slowdown = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--budget") && (i + 1 < argc)) {
+			rx_budget = atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--seconds") && (i + 1 < argc)) {
+			time_limit = (uint64_t) (atof(argv[++i]) * 1e9);
+			peercfg.duration = time_limit;
+		}
+		else if (!strcmp(argv[i], "--mbytes") && (i + 1 < argc)) {
+			peercfg.bytes = (uint32_t) (atof(argv[++i]) * 1024 * 1024);
+		}
+		else if (!strcmp(argv[i], "--size") && (i + 1 < argc)) {
+			peercfg.size = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--rate") && (i + 1 < argc)) {
+			peercfg.rate = (uint32_t) atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--delack") && (i + 1 < argc)) {
+			peercfg.delack = (uint64_t) atoi(argv[++i]) * 1000000ULL;
+		}
+		else if (!strcmp(argv[i], "--flood")) {
+			peercfg.flood = 1;
+		}
+		else if (!strcmp(argv[i], "--copy")) {
+			tx_copy = 1;
+		}
+		else if (!strcmp(argv[i], "--brief")) {
+			brief = 1;
+		}
+		else if (!strcmp(argv[i], "tcp-rx")) {
+			peercfg.scenario = PEER_TCP_RX;
+			scenario_name = argv[i];
+		}
+		else if (!strcmp(argv[i], "tcp-tx")) {
+			peercfg.scenario = PEER_TCP_TX;
+			scenario_name = argv[i];
+		}
+		else if (!strcmp(argv[i], "udp-rx")) {
+			peercfg.scenario = PEER_UDP_RX;
+			scenario_name = argv[i];
+		}
+		else if (!strcmp(argv[i], "pcap") && (i + 1 < argc)) {
+			peercfg.scenario = PEER_PCAP;
+			peercfg.pcap = argv[++i];
+			scenario_name = argv[i - 1];
+		}
+		else if (!strcmp(argv[i], "tap") && (i + 1 < argc)) {
+			peercfg.scenario = PEER_NONE;
+			simopt.tap = argv[++i];
+			scenario_name = argv[i - 1];
+		}
+		else {
+			usage();
+		}
+	}
+
+	/* An RTOS configuration takes its frames in the RX poll task, which
+	   the main loop stands in for */
+	if (rx_budget < 0) {
+		rx_budget = EMACSIM_RTOS ? LPC_RX_BUDGET : 0;
+	}
+
+	/* The UDP and pcap runs end on their own, leave time to drain */
+	if ((peercfg.scenario == PEER_UDP_RX) || (peercfg.scenario == PEER_PCAP)) {
+		time_limit = peercfg.duration + 1000000000ULL;
+	}
+}
+
+/* One pass of the standalone examples' main loop */
+static void firmware_loop(void)
+{
+	u32_t physts;
+
+	if (rx_budget) {
+		lpc_rx_poll(&lpc_netif, rx_budget);
+		EmacSim_MissedRead();
+	}
+	else {
+		lpc_enetif_input(&lpc_netif);
+	}
+
+	lpc_tx_reclaim(&lpc_netif);
+
+	sys_check_timeouts();
+
+	physts = lpcPHYStsPoll();
+	if (physts & PHY_LINK_CHANGED) {
+		if (physts & PHY_LINK_CONNECTED) {
+			Chip_ENET_SetSpeed(LPC_ETHERNET, (physts & PHY_LINK_SPEED100) != 0);
+			Chip_ENET_SetDuplex(LPC_ETHERNET, (physts & PHY_LINK_FULLDUPLX) != 0);
+			netif_set_link_up(&lpc_netif);
+		}
+		else {
+			netif_set_link_down(&lpc_netif);
+		}
+	}
+}
+
+static double mbps(uint64_t bytes, uint64_t ns)
+{
+	return ns ? ((double) bytes * 8.0 * 1000.0) / (double) ns : 0.0;
+}
+
+static double per_sec(uint64_t n, uint64_t ns)
+{
+	return ns ? ((double) n * 1e9) / (double) ns : 0.0;
+}
+
+static void print_proto(const char *name, const struct stats_proto *p)
+{
+	printf("  %-6s xmit %8lu  recv %8lu  drop %6lu  chkerr %4lu  lenerr %4lu  memerr %6lu  err %4lu\n",
+		   name, (unsigned long) p->xmit, (unsigned long) p->recv, (unsigned long) p->drop,
+		   (unsigned long) p->chkerr, (unsigned long) p->lenerr, (unsigned long) p->memerr,
+		   (unsigned long) p->err);
+}
+
+static void report(void)
+{
+	EmacSimStats es;
+	PeerResult pr;
+	struct lpc_rx_stats rs;
+	struct lpc_tx_stats ts;
+	uint64_t elapsed, rx_frames;
+	char pool[16], heap[32];
+	int i;
+
+	EmacSim_GetStats(&es);
+	Peer_GetResult(&pr);
+	lpc_rx_get_stats(&lpc_netif, &rs);
+	lpc_tx_get_stats(&lpc_netif, &ts);
+
+	elapsed = (pr.end > pr.start) ? pr.end - pr.start : EmacSim_Now();
+	rx_frames = es.rx_dma;
+
+	if (brief) {
+		/* scenario Mbit/s rxfps missed pool_max/avail pool_err heap_max/avail heap_err rx_alloc_fails
+		   lpc_rx_poll() budget (0 for lpc_enetif_input()),
+		   pools that come from the heap and a libc heap have no size to show */
+#if MEMP_MEM_MALLOC
+		snprintf(pool, sizeof(pool), "-");
+#else
+		snprintf(pool, sizeof(pool), "%u/%u", (unsigned) lwip_stats.memp[MEMP_PBUF_POOL].max,
+				 (unsigned) lwip_stats.memp[MEMP_PBUF_POOL].avail);
+#endif
+#if MEM_LIBC_MALLOC
+		snprintf(heap, sizeof(heap), "%lu/libc", (unsigned long) lwip_stats.mem.max);
+#else
+		snprintf(heap, sizeof(heap), "%lu/%lu", (unsigned long) lwip_stats.mem.max,
+				 (unsigned long) lwip_stats.mem.avail);
+#endif
+		/* TCP goodput, otherwise what the target's applications took */
+		printf("%-10s %7.2f %8.0f %7llu %7s %5u %13s %6u %6u %6u%s\n", scenario_name,
+			   mbps(((peercfg.scenario == PEER_TCP_RX) || (peercfg.scenario == PEER_TCP_TX)) ?
+					pr.bytes : app_rx_bytes, elapsed), per_sec(rx_frames, elapsed),
+			   (unsigned long long) es.rx_missed, pool,
+			   (unsigned) lwip_stats.memp[MEMP_PBUF_POOL].err, heap,
+			   (unsigned) lwip_stats.mem.err, (unsigned) rs.alloc_fails, (unsigned) rx_budget,
+			   (pr.failed || !pr.done) ? "  (incomplete)" : "");
+		return;
+	}
+
+	printf("emacsim %s, %s, slowdown %u%s\n", XSTR(EMACSIM_LWIPOPTS), scenario_name,
+		   (unsigned) simopt.slowdown, rx_budget ? ", lpc_rx_poll()" : "");
+	printf("config: PBUF_POOL_SIZE %u x %u, MEM_SIZE %lu%s, TCP_MSS %u, TCP_WND %u, TCP_SND_BUF %u, "
+		   "RX descs %u, TX descs %u, checksums %s\n",
+		   (unsigned) PBUF_POOL_SIZE, (unsigned) PBUF_POOL_BUFSIZE, (unsigned long) MEM_SIZE,
+		   MEM_LIBC_MALLOC ? " (libc malloc)" : "", (unsigned) TCP_MSS, (unsigned) TCP_WND,
+		   (unsigned) TCP_SND_BUF, (unsigned) LPC_NUM_BUFF_RXDESCS, (unsigned) LPC_NUM_BUFF_TXDESCS,
+		   CHECKSUM_GEN_TCP ? "software" : "EMAC");
+	printf("%s after %.3f s virtual, firmware busy %.1f%%\n",
+		   pr.failed ? "FAILED (reset)" : (pr.done ? "done" : "INCOMPLETE"),
+		   (double) EmacSim_Now() / 1e9, EmacSim_Now() ? (100.0 * es.firmware_ns) / EmacSim_Now() : 0.0);
+
+	printf("\nwire (data phase %.3f s)\n", (double) elapsed / 1e9);
+	printf("  to MAC   %8llu frames  %10llu bytes  filtered %llu  missed %llu  RX buffer unavailable %llu\n",
+		   (unsigned long long) es.rx_frames, (unsigned long long) es.rx_bytes,
+		   (unsigned long long) es.rx_filtered, (unsigned long long) es.rx_missed,
+		   (unsigned long long) es.rx_unavailable);
+	printf("  RX ring  %8llu frames  %10.0f frames/s\n", (unsigned long long) rx_frames, per_sec(rx_frames, elapsed));
+	printf("  from MAC %8llu frames  %10llu bytes  %10.0f frames/s\n",
+		   (unsigned long long) es.tx_frames, (unsigned long long) es.tx_bytes, per_sec(es.tx_frames, elapsed));
+
+	printf("\napplication\n");
+	switch (peercfg.scenario) {
+	case PEER_TCP_RX:
+	case PEER_TCP_TX:
+		printf("  TCP goodput %.2f Mbit/s, %llu bytes\n", mbps(pr.bytes, elapsed), (unsigned long long) pr.bytes);
+		printf("  peer: retransmits %u (fast %u, timeouts %u), out of order %u, zero windows %u, resets %u\n",
+			   pr.retransmits, pr.fast_retransmits, pr.timeouts, pr.out_of_order, pr.zero_windows, pr.resets);
+		if (peercfg.scenario == PEER_TCP_TX) {
+			printf("  target: tcp_write() %u bytes (%s), ERR_MEM %u\n", app_tx_bytes,
+				   tx_copy ? "copied" : "no copy", app_tx_errs);
+		}
+		break;
+
+	case PEER_UDP_RX:
+		printf("  UDP offered %.2f Mbit/s, delivered %u datagrams, %.2f Mbit/s\n", mbps(pr.bytes, elapsed),
+			   app_udp_frames, mbps(app_rx_bytes, elapsed));
+		break;
+
+	default:
+		printf("  received %u bytes, sent %u bytes\n", app_rx_bytes, app_tx_bytes);
+		break;
+	}
+	printf("  peer saw bad IP checksums %u, bad TCP/UDP/ICMP checksums %u\n", pr.bad_ip_csum, pr.bad_l4_csum);
+
+	printf("\nlwIP\n");
+	print_proto("link", &lwip_stats.link);
+	print_proto("ip", &lwip_stats.ip);
+	print_proto("tcp", &lwip_stats.tcp);
+#if LWIP_UDP
+	print_proto("udp", &lwip_stats.udp);
+#endif
+	printf("  %-16s %6s %6s %6s %6s\n", "pool", "avail", "used", "max", "err");
+	printf("  %-16s %6lu %6lu %6lu %6u\n", "heap", (unsigned long) lwip_stats.mem.avail,
+		   (unsigned long) lwip_stats.mem.used, (unsigned long) lwip_stats.mem.max,
+		   (unsigned) lwip_stats.mem.err);
+#if !MEMP_MEM_MALLOC
+	for (i = 0; i < MEMP_MAX; i++) {
+		printf("  %-16s %6u %6u %6u %6u\n", memp_names[i], (unsigned) lwip_stats.memp[i].avail,
+			   (unsigned) lwip_stats.memp[i].used, (unsigned) lwip_stats.memp[i].max,
+			   (unsigned) lwip_stats.memp[i].err);
+	}
+#else
+	(void) i;
+	printf("  (MEMP_MEM_MALLOC, pools come from the heap)\n");
+#endif
+
+	printf("\ndriver\n");
+	printf("  RX passes %u, frames %u, budget hits %u, max pass %u, refills %u, alloc fails %u, missed %u\n",
+		   (unsigned) rs.passes, (unsigned) rs.frames, (unsigned) rs.budget_hits, (unsigned) rs.max_pass,
+		   (unsigned) rs.refills, (unsigned) rs.alloc_fails, (unsigned) rs.missed);
+	printf("  TX frames %u, descriptor waits %u, bounced %u fragments / %u bytes\n",
+		   (unsigned) ts.frames, (unsigned) ts.waits, (unsigned) ts.bounced_frags, (unsigned) ts.bounced_bytes);
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+/* Heap accounting for MEM_LIBC_MALLOC, see lwipopts.h here */
+void *emacsim_mem_malloc(size_t size)
+{
+	HEAP_HDR_T *h = malloc(sizeof(HEAP_HDR_T) + size);
+
+	if (h == NULL) {
+		MEM_STATS_INC(err);
+		return NULL;
+	}
+	h->size = size;
+	lwip_stats.mem.used += size;
+	if (lwip_stats.mem.used > lwip_stats.mem.max) {
+		lwip_stats.mem.max = lwip_stats.mem.used;
+	}
+	return h + 1;
+}
+
+void *emacsim_mem_calloc(size_t count, size_t size)
+{
+	void *p = emacsim_mem_malloc(count * size);
+
+	if (p != NULL) {
+		memset(p, 0, count * size);
+	}
+	return p;
+}
+
+void emacsim_mem_free(void *mem)
+{
+	HEAP_HDR_T *h = (HEAP_HDR_T *) mem - 1;
+
+	if (mem != NULL) {
+		lwip_stats.mem.used -= h->size;
+		free(h);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	ip_addr_t ipaddr, netmask, gw;
+
+	parse_args(argc, argv);
+
+	/* Keep malloc()ed pbufs below 4GB for the DMA, see emacsim.h */
+	mallopt(M_MMAP_MAX, 0);
+
+	if (EmacSim_Init(&simopt) != 0) {
+		return 2;
+	}
+	if (Peer_Start(&peercfg) != 0) {
+		return 2;
+	}
+
+	lwip_init();
+
+	IP4_ADDR(&gw, 10, 1, 10, 1);
+	IP4_ADDR(&ipaddr, 10, 1, 10, 234);
+	IP4_ADDR(&netmask, 255, 255, 255, 0);
+	if (netif_add(&lpc_netif, &ipaddr, &netmask, &gw, NULL, lpc_enetif_init,
+				  ethernet_input) == NULL) {
+		fprintf(stderr, "emacsim: lpc_enetif_init() failed\n");
+		return 2;
+	}
+	netif_set_default(&lpc_netif);
+	netif_set_up(&lpc_netif);
+
+	apps_init();
+
+	for (;;) {
+		firmware_loop();
+		EmacSim_Sync();
+		if (Peer_Done() || (EmacSim_Now() >= time_limit)) {
+			break;
+		}
+		EmacSim_Idle();
+	}
+
+	report();
+
+	return Peer_Done() ? 0 : 1;
+}
@@ -0,0 +1,881 @@
+/*
+ * @brief EMACSim wire peer, TCP/UDP scenarios and pcap replay
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2012
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+/*
+ * The peer is a small, fast host: it never runs out of buffers and
+ * answers at once, so what limits a run is the target. Its TCP is
+ * just enough of one to load the target realistically: initial window
+ * of 10 segments, slow start and congestion avoidance, go-back-N fast
+ * retransmit on 3 duplicate ACKs, a 200ms RTO with backoff and zero
+ * window probes. As a receiver it advertises 64KB and ACKs every second
+ * segment or on the delayed ACK timer. It answers ARP for every address
+ * but the target's, so replayed traffic from any source gets replies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emacsim.h"
+#include "simpeer.h"
+
+/*****************************************************************************
+ * Private types/enumerations/variables
+ ****************************************************************************/
+
+#define TCP_FIN			0x01
+#define TCP_SYN			0x02
+#define TCP_RST			0x04
+#define TCP_PSH			0x08
+#define TCP_ACK			0x10
+
+#define SEQ_LT(a, b)	((int32_t) ((a) - (b)) < 0)
+#define SEQ_LEQ(a, b)	((int32_t) ((a) - (b)) <= 0)
+#define SEQ_GT(a, b)	((int32_t) ((a) - (b)) > 0)
+
+#define PEER_START		10000000ULL		/* scenarios start 10ms in */
+#define PEER_RTO		200000000ULL
+#define PEER_RTO_MAX	60000000000ULL
+#define PEER_PORT		40000
+#define PEER_ISS		0x10000000
+#define PEER_WINDOW		65535
+#define PEER_MTU		1500
+
+typedef enum {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_DONE
+} PEER_TCP_STATE_T;
+
+/* The peer's end of the one TCP connection a scenario uses */
+typedef struct {
+	PEER_TCP_STATE_T state;
+	int sender;				/* the peer sends the payload */
+	uint16_t rport;
+	uint32_t mss;
+
+	/* send side */
+	uint32_t snd_una;
+	uint32_t snd_nxt;
+	uint32_t snd_max;
+	uint32_t snd_end;		/* sequence number after the last payload byte */
+	uint32_t snd_wnd;
+	uint32_t cwnd;
+	uint32_t ssthresh;
+	uint32_t dupacks;
+	uint64_t rto;
+	uint64_t rto_at;
+
+	/* receive side */
+	uint32_t rcv_nxt;
+	uint32_t unacked;
+	uint64_t ack_at;
+} PEER_TCP_T;
+
+static PeerConfig cfg;
+static PeerResult res;
+static PEER_TCP_T tcp;
+
+static const uint8_t peer_mac[6] = EMACSIM_PEER_MAC;
+static const uint8_t target_mac[6] = EMACSIM_TARGET_MAC;
+static uint16_t ip_id;
+
+/* UDP flood */
+static uint64_t udp_next;
+
+/* pcap replay */
+static FILE *pcap;
+static int pcap_swap, pcap_nsec;
+static uint64_t pcap_t0, pcap_due;
+static uint32_t pcap_len;
+static uint8_t pcap_frame[EMACSIM_RX_FIFO];
+static uint64_t pcap_end;
+
+/*****************************************************************************
+ * Public types/enumerations/variables
+ ****************************************************************************/
+
+/*****************************************************************************
+ * Private functions
+ ****************************************************************************/
+
+static void put16(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t) (v >> 8);
+	p[1] = (uint8_t) v;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	put16(p, v >> 16);
+	put16(p + 2, v);
+}
+
+static uint32_t get16(const uint8_t *p)
+{
+	return ((uint32_t) p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return (get16(p) << 16) | get16(p + 2);
+}
+
+static uint32_t sum16(const uint8_t *p, uint32_t len, uint32_t acc)
+{
+	while (len > 1) {
+		acc += get16(p);
+		p += 2;
+		len -= 2;
+	}
+	if (len) {
+		acc += (uint32_t) p[0] << 8;
+	}
+	return acc;
+}
+
+static uint16_t fold16(uint32_t acc)
+{
+	acc = (acc >> 16) + (acc & 0xFFFF);
+	acc = (acc >> 16) + (acc & 0xFFFF);
+	return (uint16_t) acc;
+}
+
+/* TCP/UDP checksum over the pseudo header and 'plen' bytes of payload */
+static uint16_t l4_sum(const uint8_t *ip, uint32_t plen)
+{
+	uint32_t hlen = (ip[0] & 0x0F) * 4;
+	uint32_t acc = sum16(ip + 12, 8, 0) + ip[9] + plen;
+
+	return fold16(sum16(ip + hlen, plen, acc));
+}
+
+/* Ethernet and IPv4 header towards the target. Returns the IP header. */
+static uint8_t *ip_header(uint8_t *f, uint8_t proto, uint32_t plen)
+{
+	uint8_t *ip = f + 14;
+
+	memcpy(f, target_mac, 6);
+	memcpy(f + 6, peer_mac, 6);
+	put16(f + 12, 0x0800);
+
+	ip[0] = 0x45;
+	ip[1] = 0;
+	put16(ip + 2, 20 + plen);
+	put16(ip + 4, ip_id++);
+	put16(ip + 6, 0x4000);
+	ip[8] = 64;
+	ip[9] = proto;
+	put16(ip + 10, 0);
+	put32(ip + 12, EMACSIM_PEER_IP);
+	put32(ip + 16, EMACSIM_TARGET_IP);
+	put16(ip + 10, (uint16_t) ~fold16(sum16(ip, 20, 0)));
+	return ip;
+}
+
+static void send_frame(const uint8_t *f, uint32_t len)
+{
+	EmacSim_Send(f, len);
+	res.frames_sent++;
+}
+
+/* Sends a TCP segment carrying 'len' bytes of the payload from 'seq' */
+static void tcp_send(uint32_t seq, uint8_t flags, uint32_t len)
+{
+	uint8_t f[14 + PEER_MTU];
+	uint8_t *ip, *th;
+	uint32_t hlen = (flags & TCP_SYN) ? 24 : 20;
+	uint32_t i;
+
+	ip = ip_header(f, 6, hlen + len);
+	th = ip + 20;
+	put16(th, PEER_PORT);
+	put16(th + 2, tcp.rport);
+	put32(th + 4, seq);
+	put32(th + 8, (flags & TCP_ACK) ? tcp.rcv_nxt : 0);
+	th[12] = (uint8_t) ((hlen / 4) << 4);
+	th[13] = flags;
+	put16(th + 14, PEER_WINDOW);
+	put16(th + 16, 0);
+	put16(th + 18, 0);
+	if (flags & TCP_SYN) {
+		/* MSS option */
+		th[20] = 2;
+		th[21] = 4;
+		put16(th + 22, PEER_MTU - 40);
+	}
+	for (i = 0; i < len; i++) {
+		th[hlen + i] = (uint8_t) (seq + i);
+	}
+	put16(th + 16, (uint16_t) ~l4_sum(ip, hlen + len));
+
+	send_frame(f, 14 + 20 + hlen + len);
+	tcp.unacked = 0;
+	tcp.ack_at = 0;
+}
+
+static void tcp_connect(uint16_t port, int sender)
+{
+	memset(&tcp, 0, sizeof(tcp));
+	tcp.sender = sender;
+	tcp.rport = port;
+	tcp.rto = PEER_RTO;
+	tcp.snd_una = PEER_ISS;
+	tcp.snd_nxt = tcp.snd_max = PEER_ISS + 1;
+	tcp.state = TCP_SYN_SENT;
+	tcp.rto_at = EmacSim_Now() + tcp.rto;
+	tcp_send(PEER_ISS, TCP_SYN, 0);
+}
+
+/* Sends what the congestion and receive windows allow */
+static void tcp_output(void)
+{
+	uint32_t flight, wnd, len, left;
+	uint8_t flags;
+
+	if ((tcp.state != TCP_ESTABLISHED) || !tcp.sender) {
+		return;
+	}
+
+	while (SEQ_LT(tcp.snd_nxt, tcp.snd_end)) {
+		/* The NIC queue holds one frame, the rest waits in the stack */
+		if (EmacSim_SendBacklog() > EmacSim_WireTime(14 + PEER_MTU)) {
+			break;
+		}
+		flight = tcp.snd_nxt - tcp.snd_una;
+		wnd = (tcp.cwnd < tcp.snd_wnd) ? tcp.cwnd : tcp.snd_wnd;
+		if (flight >= wnd) {
+			break;
+		}
+		left = tcp.snd_end - tcp.snd_nxt;
+		len = wnd - flight;
+		if (len > tcp.mss) {
+			len = tcp.mss;
+		}
+		if (len > left) {
+			len = left;
+		}
+
+		/* Don't send runts into a window that is about to open */
+		if ((len < tcp.mss) && (len < left) && (flight > 0)) {
+			break;
+		}
+
+		flags = TCP_ACK;
+		if (len == left) {
+			flags |= TCP_PSH;
+		}
+		if (SEQ_LT(tcp.snd_nxt, tcp.snd_max)) {
+			res.retransmits++;
+		}
+		tcp_send(tcp.snd_nxt, flags, len);
+		tcp.snd_nxt += len;
+		if (SEQ_GT(tcp.snd_nxt, tcp.snd_max)) {
+			tcp.snd_max = tcp.snd_nxt;
+		}
+		if (!tcp.rto_at) {
+			tcp.rto_at = EmacSim_Now() + tcp.rto;
+		}
+	}
+
+	/* A closed window needs probing, the update could get lost */
+	if (!tcp.snd_wnd && (tcp.snd_una == tcp.snd_max) &&
+		SEQ_LT(tcp.snd_una, tcp.snd_end) && !tcp.rto_at) {
+		res.zero_windows++;
+		tcp.rto_at = EmacSim_Now() + tcp.rto;
+	}
+
+	/* All data sent, close right behind it like an application would.
+	   The FIN gets the last ACK out at once, the target's delayed ACK
+	   timer would hold it for a trailing runt. */
+	if (tcp.snd_nxt == tcp.snd_end) {
+		tcp_send(tcp.snd_end, TCP_FIN | TCP_ACK, 0);
+		tcp.snd_nxt = tcp.snd_end + 1;
+		if (SEQ_GT(tcp.snd_nxt, tcp.snd_max)) {
+			tcp.snd_max = tcp.snd_nxt;
+		}
+		if (!tcp.rto_at) {
+			tcp.rto_at = EmacSim_Now() + tcp.rto;
+		}
+	}
+}
+
+static void tcp_timers(void)
+{
+	uint64_t now = EmacSim_Now();
+	uint32_t flight;
+
+	if (tcp.ack_at && (now >= tcp.ack_at)) {
+		tcp_send(tcp.snd_nxt, TCP_ACK, 0);
+	}
+
+	if (!tcp.rto_at || (now < tcp.rto_at)) {
+		return;
+	}
+	tcp.rto = (tcp.rto * 2 < PEER_RTO_MAX) ? tcp.rto * 2 : PEER_RTO_MAX;
+	tcp.rto_at = now + tcp.rto;
+
+	if (tcp.state == TCP_SYN_SENT) {
+		tcp_send(PEER_ISS, TCP_SYN, 0);
+		return;
+	}
+	if ((tcp.state != TCP_ESTABLISHED) || !tcp.sender) {
+		tcp.rto_at = 0;
+		return;
+	}
+
+	res.timeouts++;
+	flight = tcp.snd_max - tcp.snd_una;
+	tcp.ssthresh = (flight / 2 > 2 * tcp.mss) ? flight / 2 : 2 * tcp.mss;
+	tcp.cwnd = tcp.mss;
+	tcp.dupacks = 0;
+	tcp.snd_nxt = tcp.snd_una;
+	if (!tcp.snd_wnd) {
+		/* Window probe, one byte past the closed window */
+		tcp_send(tcp.snd_una, TCP_ACK, 1);
+		tcp.snd_nxt = tcp.snd_una + 1;
+		if (SEQ_GT(tcp.snd_nxt, tcp.snd_max)) {
+			tcp.snd_max = tcp.snd_nxt;
+		}
+		return;
+	}
+	tcp_output();
+}
+
+static void tcp_input(const uint8_t *ip, uint32_t plen)
+{
+	uint32_t hlen = (ip[0] & 0x0F) * 4;
+	const uint8_t *th = ip + hlen;
+	uint32_t thlen, seq, ack, win, len, acked, flight, i;
+	uint8_t flags;
+	uint64_t now = EmacSim_Now();
+
+	if ((get16(th) != tcp.rport) || (get16(th + 2) != PEER_PORT)) {
+		return;
+	}
+	thlen = (th[12] >> 4) * 4;
+	seq = get32(th + 4);
+	ack = get32(th + 8);
+	flags = th[13];
+	win = get16(th + 14);
+	len = plen - thlen;
+
+	if (flags & TCP_RST) {
+		res.resets++;
+		if (tcp.state != TCP_DONE) {
+			res.failed = 1;
+			res.done = 1;
+			tcp.state = TCP_DONE;
+		}
+		return;
+	}
+
+	if (tcp.state == TCP_SYN_SENT) {
+		if ((flags & (TCP_SYN | TCP_ACK)) != (TCP_SYN | TCP_ACK) || (ack != PEER_ISS + 1)) {
+			return;
+		}
+		tcp.rcv_nxt = seq + 1;
+		tcp.snd_una = ack;
+		tcp.snd_end = tcp.snd_nxt + (tcp.sender ? cfg.bytes : 0);
+		tcp.snd_wnd = win;
+		tcp.mss = 536;
+		for (i = 20; (i + 4) <= thlen; ) {
+			if (th[i] == 0) {
+				break;
+			}
+			if (th[i] == 1) {
+				i++;
+				continue;
+			}
+			if ((th[i] == 2) && (th[i + 1] == 4)) {
+				tcp.mss = get16(th + i + 2);
+			}
+			if (th[i + 1] < 2) {
+				break;
+			}
+			i += th[i + 1];
+		}
+		if (tcp.mss > PEER_MTU - 40) {
+			tcp.mss = PEER_MTU - 40;
+		}
+		tcp.cwnd = 10 * tcp.mss;
+		tcp.ssthresh = 0xFFFFFFFF;
+		tcp.rto = PEER_RTO;
+		tcp.rto_at = 0;
+		tcp.state = TCP_ESTABLISHED;
+		tcp_send(tcp.snd_nxt, TCP_ACK, 0);
+		res.start = now;
+		tcp_output();
+		return;
+	}
+
+	if (tcp.state != TCP_ESTABLISHED) {
+		return;
+	}
+
+	/* ACK processing */
+	if (flags & TCP_ACK) {
+		if (SEQ_GT(ack, tcp.snd_una) && SEQ_LEQ(ack, tcp.snd_max)) {
+			acked = ack - tcp.snd_una;
+			tcp.snd_una = ack;
+			if (SEQ_LT(tcp.snd_nxt, tcp.snd_una)) {
+				tcp.snd_nxt = tcp.snd_una;
+			}
+			if (tcp.sender) {
+				res.bytes += (SEQ_GT(ack, tcp.snd_end)) ? acked - 1 : acked;
+				if (!res.end && !SEQ_LT(ack, tcp.snd_end)) {
+					res.end = now;
+				}
+			}
+			tcp.dupacks = 0;
+			if (tcp.cwnd < tcp.ssthresh) {
+				tcp.cwnd += (acked < tcp.mss) ? acked : tcp.mss;
+			}
+			else {
+				tcp.cwnd += (tcp.mss * tcp.mss) / tcp.cwnd;
+			}
+			tcp.rto = PEER_RTO;
+			tcp.rto_at = (tcp.snd_una == tcp.snd_max) ? 0 : now + tcp.rto;
+		}
+		else if ((ack == tcp.snd_una) && !len && !(flags & (TCP_SYN | TCP_FIN)) &&
+				 (win == tcp.snd_wnd) && (tcp.snd_max != tcp.snd_una) && tcp.sender) {
+			tcp.dupacks++;
+			if (tcp.dupacks == 3) {
+				res.fast_retransmits++;
+				flight = tcp.snd_max - tcp.snd_una;
+				tcp.ssthresh = (flight / 2 > 2 * tcp.mss) ? flight / 2 : 2 * tcp.mss;
+				tcp.cwnd = tcp.ssthresh;
+				tcp.snd_nxt = tcp.snd_una;
+			}
+		}
+		tcp.snd_wnd = win;
+	}
+
+	/* Payload and FIN */
+	if (len || (flags & TCP_FIN)) {
+		if (seq != tcp.rcv_nxt) {
+			/* Out of order or a retransmission, ACK at once */
+			res.out_of_order++;
+			tcp_send(tcp.snd_nxt, TCP_ACK, 0);
+		}
+		else {
+			if (len) {
+				if (!tcp.sender) {
+					if (!res.bytes) {
+						res.start = now;
+					}
+					res.bytes += len;
+					res.end = now;
+				}
+				tcp.rcv_nxt += len;
+				tcp.unacked++;
+			}
+			if (flags & TCP_FIN) {
+				tcp.rcv_nxt++;
+				if (tcp.sender) {
+					tcp_send(tcp.snd_nxt, TCP_ACK, 0);
+				}
+				else {
+					/* Close our side too */
+					tcp_send(tcp.snd_nxt, TCP_FIN | TCP_ACK, 0);
+					tcp.snd_nxt++;
+					tcp.snd_max = tcp.snd_nxt;
+				}
+				tcp.state = TCP_DONE;
+				res.done = 1;
+			}
+			else if ((tcp.unacked >= 2) || (flags & TCP_PSH)) {
+				tcp_send(tcp.snd_nxt, TCP_ACK, 0);
+			}
+			else if (!tcp.ack_at) {
+				tcp.ack_at = now + cfg.delack;
+			}
+		}
+	}
+
+	tcp_output();
+}
+
+/* Answers ARP requests for anything but the target */
+static void arp_input(const uint8_t *f, uint32_t len)
+{
+	uint8_t r[42];
+
+	if ((len < 42) || (get16(f + 20) != 1) || (get32(f + 38) == EMACSIM_TARGET_IP)) {
+		return;
+	}
+	memcpy(r, f + 6, 6);
+	memcpy(r + 6, peer_mac, 6);
+	put16(r + 12, 0x0806);
+	put16(r + 14, 1);
+	put16(r + 16, 0x0800);
+	r[18] = 6;
+	r[19] = 4;
+	put16(r + 20, 2);
+	memcpy(r + 22, peer_mac, 6);
+	memcpy(r + 28, f + 38, 4);
+	memcpy(r + 32, f + 22, 10);
+	send_frame(r, sizeof(r));
+	res.arp_replies++;
+}
+
+/* UDP flood at cfg.rate, or line rate */
+static void udp_output(void)
+{
+	uint8_t f[14 + PEER_MTU];
+	uint8_t *ip, *uh;
+	uint64_t now = EmacSim_Now();
+	uint32_t i;
+
+	while ((now >= udp_next) && (now < PEER_START + cfg.duration)) {
+		if (!cfg.rate && (EmacSim_SendBacklog() > EmacSim_WireTime(14 + 28 + cfg.size))) {
+			udp_next = now + EmacSim_SendBacklog() - EmacSim_WireTime(14 + 28 + cfg.size);
+			return;
+		}
+		ip = ip_header(f, 17, 8 + cfg.size);
+		uh = ip + 20;
+		put16(uh, PEER_PORT);
+		put16(uh + 2, EMACSIM_PORT_UDP);
+		put16(uh + 4, 8 + cfg.size);
+		put16(uh + 6, 0);
+		for (i = 0; i < cfg.size; i++) {
+			uh[8 + i] = (uint8_t) i;
+		}
+		put16(uh + 6, (uint16_t) ~l4_sum(ip, 8 + cfg.size));
+		send_frame(f, 14 + 28 + cfg.size);
+		res.bytes += cfg.size;
+		if (cfg.rate) {
+			udp_next += 1000000000ULL / cfg.rate;
+		}
+	}
+	if (now >= PEER_START + cfg.duration) {
+		res.end = PEER_START + cfg.duration;
+		res.done = 1;
+	}
+}
+
+/* pcap replay */
+static uint32_t pcap32(const uint8_t *p)
+{
+	return pcap_swap ? get32(p) : ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) |
+		   ((uint32_t) p[1] << 8) | p[0];
+}
+
+static int pcap_open(const char *name)
+{
+	uint8_t h[24];
+	uint32_t magic;
+
+	pcap = fopen(name, "rb");
+	if ((pcap == NULL) || (fread(h, 1, 24, pcap) != 24)) {
+		fprintf(stderr, "emacsim: can't read %s\n", name);
+		return -1;
+	}
+	magic = ((uint32_t) h[3] << 24) | ((uint32_t) h[2] << 16) | ((uint32_t) h[1] << 8) | h[0];
+	pcap_swap = (magic == 0xD4C3B2A1) || (magic == 0x4D3CB2A1);
+	pcap_nsec = (magic == 0xA1B23C4D) || (magic == 0x4D3CB2A1);
+	if (!pcap_swap && !pcap_nsec && (magic != 0xA1B2C3D4)) {
+		fprintf(stderr, "emacsim: %s is not a pcap file\n", name);
+		return -1;
+	}
+	if (pcap32(h + 20) != 1) {
+		fprintf(stderr, "emacsim: %s is not an Ethernet capture\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+/* Readdresses a unicast frame to the target, checksums fixed up */
+static void pcap_readdress(uint8_t *f, uint32_t len)
+{
+	uint8_t *ip = f + 14;
+	uint32_t hlen, plen, off;
+
+	if (f[0] & 1) {
+		return;
+	}
+	memcpy(f, target_mac, 6);
+	if ((len < 34) || (get16(f + 12) != 0x0800) || ((ip[0] >> 4) != 4)) {
+		return;
+	}
+	hlen = (ip[0] & 0x0F) * 4;
+	if ((ip[16] >= 224) || (get16(ip + 2) > (len - 14)) || (hlen < 20)) {
+		return;
+	}
+	put32(ip + 16, EMACSIM_TARGET_IP);
+	put16(ip + 10, 0);
+	put16(ip + 10, (uint16_t) ~fold16(sum16(ip, hlen, 0)));
+
+	/* Unfragmented TCP and UDP carry the address in their checksum */
+	plen = get16(ip + 2) - hlen;
+	off = (ip[9] == 6) ? 16 : ((ip[9] == 17) ? 6 : 0);
+	if (!off || ((get16(ip + 6) & 0x3FFF) != 0) || (plen < off + 2)) {
+		return;
+	}
+	if ((ip[9] == 17) && !get16(ip + hlen + 6)) {
+		return;
+	}
+	put16(ip + hlen + off, 0);
+	put16(ip + hlen + off, (uint16_t) ~l4_sum(ip, plen));
+	if ((ip[9] == 17) && !get16(ip + hlen + off)) {
+		put16(ip + hlen + off, 0xFFFF);
+	}
+}
+
+/* Reads the next record into pcap_frame. Returns 0 at the end. */
+static int pcap_next(void)
+{
+	uint8_t h[16];
+	uint32_t caplen;
+	uint64_t ts;
+
+	for (;;) {
+		if (fread(h, 1, 16, pcap) != 16) {
+			return 0;
+		}
+		caplen = pcap32(h + 8);
+		ts = (uint64_t) pcap32(h) * 1000000000ULL +
+			 (uint64_t) pcap32(h + 4) * (pcap_nsec ? 1 : 1000);
+		if ((caplen < 14) || (caplen > sizeof(pcap_frame))) {
+			if (fseek(pcap, caplen, SEEK_CUR)) {
+				return 0;
+			}
+			continue;
+		}
+		if (fread(pcap_frame, 1, caplen, pcap) != caplen) {
+			return 0;
+		}
+		if (!pcap_t0) {
+			pcap_t0 = ts ? ts : 1;
+		}
+		pcap_len = caplen;
+		pcap_due = PEER_START + ((ts > pcap_t0) ? ts - pcap_t0 : 0);
+		pcap_readdress(pcap_frame, pcap_len);
+		return 1;
+	}
+}
+
+static void pcap_output(void)
+{
+	uint64_t now = EmacSim_Now();
+
+	/* pcap_due is never before PEER_START, a flood starts there too */
+	while (pcap_len && (now >= PEER_START) && (cfg.flood || (now >= pcap_due))) {
+		if (cfg.flood && (EmacSim_SendBacklog() > EmacSim_WireTime(pcap_len))) {
+			return;
+		}
+		send_frame(pcap_frame, pcap_len);
+		if (!pcap_next()) {
+			pcap_len = 0;
+			res.end = now;
+			pcap_end = now + 100000000ULL;
+		}
+	}
+	if (!pcap_len && (now >= pcap_end)) {
+		res.done = 1;
+	}
+}
+
+/*****************************************************************************
+ * Public functions
+ ****************************************************************************/
+
+int Peer_Start(const PeerConfig *config)
+{
+	cfg = *config;
+	memset(&res, 0, sizeof(res));
+	memset(&tcp, 0, sizeof(tcp));
+	if (!cfg.delack) {
+		cfg.delack = 40000000ULL;
+	}
+	if (cfg.size > PEER_MTU - 28) {
+		cfg.size = PEER_MTU - 28;
+	}
+	udp_next = PEER_START;
+	if (cfg.scenario == PEER_UDP_RX) {
+		res.start = PEER_START;
+	}
+	if (cfg.scenario == PEER_PCAP) {
+		if (pcap_open(cfg.pcap) != 0) {
+			return -1;
+		}
+		if (!pcap_next()) {
+			fprintf(stderr, "emacsim: %s holds no frames\n", cfg.pcap);
+			return -1;
+		}
+		res.start = PEER_START;
+	}
+	return 0;
+}
+
+int Peer_Done(void)
+{
+	return res.done;
+}
+
+void Peer_GetResult(PeerResult *result)
+{
+	*result = res;
+}
+
+void Peer_Frame(const uint8_t *frame, uint32_t len)
+{
+	const uint8_t *ip = frame + 14;
+	uint32_t hlen, tot;
+
+	if (get16(frame + 12) == 0x0806) {
+		arp_input(frame, len);
+		return;
+	}
+	if ((len < 34) || (get16(frame + 12) != 0x0800) || ((ip[0] >> 4) != 4)) {
+		return;
+	}
+	hlen = (ip[0] & 0x0F) * 4;
+	tot = get16(ip + 2);
+	if ((hlen < 20) || (tot < hlen) || ((14 + tot) > len)) {
+		return;
+	}
+	if (fold16(sum16(ip, hlen, 0)) != 0xFFFF) {
+		res.bad_ip_csum++;
+		return;
+	}
+	if (get32(ip + 16) != EMACSIM_PEER_IP) {
+		return;
+	}
+	if ((get16(ip + 6) & 0x3FFF) == 0) {
+		if (((ip[9] == 6) || ((ip[9] == 17) && get16(ip + hlen + 6))) &&
+			(l4_sum(ip, tot - hlen) != 0xFFFF)) {
+			res.bad_l4_csum++;
+			return;
+		}
+		if ((ip[9] == 1) && (fold16(sum16(ip + hlen, tot - hlen, 0)) != 0xFFFF)) {
+			res.bad_l4_csum++;
+			return;
+		}
+	}
+	if ((ip[9] == 6) && (tcp.state != TCP_CLOSED)) {
+		tcp_input(ip, tot - hlen);
+	}
+}
+
+void Peer_Poll(void)
+{
+	uint64_t now = EmacSim_Now();
+
+	switch (cfg.scenario) {
+	case PEER_TCP_RX:
+	case PEER_TCP_TX:
+		if (tcp.state == TCP_CLOSED) {
+			if (now >= PEER_START) {
+				tcp_connect((cfg.scenario == PEER_TCP_RX) ? EMACSIM_PORT_DISCARD : EMACSIM_PORT_SOURCE,
+							cfg.scenario == PEER_TCP_RX);
+			}
+			break;
+		}
+		tcp_timers();
+		tcp_output();
+		break;
+
+	case PEER_UDP_RX:
+		udp_output();
+		break;
+
+	case PEER_PCAP:
+		pcap_output();
+		break;
+
+	default:
+		break;
+	}
+}
+
+uint64_t Peer_NextEvent(void)
+{
+	uint64_t now = EmacSim_Now();
+	uint64_t next = UINT64_MAX, t, wt;
+
+	switch (cfg.scenario) {
+	case PEER_TCP_RX:
+	case PEER_TCP_TX:
+		if (tcp.state == TCP_CLOSED) {
+			next = PEER_START;
+			break;
+		}
+		if (tcp.rto_at) {
+			next = tcp.rto_at;
+		}
+		if (tcp.ack_at && (tcp.ack_at < next)) {
+			next = tcp.ack_at;
+		}
+		/* Data blocked only by the NIC queue goes once it drains */
+		wt = EmacSim_WireTime(14 + PEER_MTU);
+		if ((tcp.state == TCP_ESTABLISHED) && tcp.sender && SEQ_LT(tcp.snd_nxt, tcp.snd_end) &&
+			((tcp.snd_nxt - tcp.snd_una) < ((tcp.cwnd < tcp.snd_wnd) ? tcp.cwnd : tcp.snd_wnd)) &&
+			(EmacSim_SendBacklog() > wt)) {
+			t = now + EmacSim_SendBacklog() - wt;
+			if (t < next) {
+				next = t;
+			}
+		}
+		break;
+
+	case PEER_UDP_RX:
+		if (!res.done) {
+			next = (udp_next < PEER_START + cfg.duration) ? udp_next : PEER_START + cfg.duration;
+		}
+		break;
+
+	case PEER_PCAP:
+		if (pcap_len) {
+			if (cfg.flood && (now >= PEER_START)) {
+				wt = EmacSim_WireTime(pcap_len);
+				next = now + ((EmacSim_SendBacklog() > wt) ? EmacSim_SendBacklog() - wt : 0);
+			}
+			else if (cfg.flood) {
+				next = PEER_START;
+			}
+			else {
+				next = pcap_due;
+			}
+		}
+		else if (!res.done) {
+			next = pcap_end;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	/* Always a step forward, whatever is due now has been polled */
+	return (next <= now) ? now + 1 : next;
+}
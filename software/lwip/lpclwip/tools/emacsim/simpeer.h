@@ -0,0 +1,76 @@
+/*
+
+	EMACSim wire peer. The host at the other end of the simulated cable,
+	see emacsim.h for the scenarios.
+
+*/
+
+#ifndef __SIMPEER_H_
+#define __SIMPEER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------------*/
+typedef enum
+{
+	PEER_TCP_RX,		/* peer sends, target discards */
+	PEER_TCP_TX,		/* target sends, peer receives */
+	PEER_UDP_RX,		/* peer floods a UDP discard port */
+	PEER_PCAP,			/* peer replays a pcap file */
+	PEER_NONE			/* TAP mode, the host kernel is the peer */
+} PeerScenario;
+
+typedef struct _PeerConfig
+{
+	PeerScenario scenario;
+	/* TCP payload to move */
+	uint32_t bytes;
+	/* UDP payload size */
+	uint32_t size;
+	/* UDP datagrams per second, 0 = line rate */
+	uint32_t rate;
+	/* UDP and pcap, ns */
+	uint64_t duration;
+	/* delayed ACK timeout, ns */
+	uint64_t delack;
+	/* pcap: ignore the timestamps and replay at line rate */
+	int flood;
+	const char *pcap;
+} PeerConfig;
+
+typedef struct _PeerResult
+{
+	/* data phase, first payload byte sent/received to last acked/received */
+	uint64_t start;
+	uint64_t end;
+	/* TCP payload delivered in order */
+	uint64_t bytes;
+	uint64_t frames_sent;
+	uint32_t retransmits;
+	uint32_t timeouts;
+	uint32_t fast_retransmits;
+	uint32_t out_of_order;
+	uint32_t zero_windows;
+	uint32_t resets;
+	/* frames from the target with a bad IP header or TCP/UDP checksum */
+	uint32_t bad_ip_csum;
+	uint32_t bad_l4_csum;
+	uint32_t arp_replies;
+	int done;
+	int failed;
+} PeerResult;
+
+/*---------------------------------------------------------------------------*/
+extern int Peer_Start(const PeerConfig *config);
+extern int Peer_Done(void);
+extern void Peer_GetResult(PeerResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,12 @@
+/*
+
+	EMACSim stand-in for the board sys_config.h
+
+*/
+
+#ifndef __SYS_CONFIG_H_
+#define __SYS_CONFIG_H_
+
+#define CHIP_LPC43XX
+
+#endif